@@ -527,7 +527,7 @@
 ;;
 
 ;; assumes |a| >= |b|
-(define (digits-mul-school a b)
+(define (digits-mul-school* a b)
   (let ((alen (vlen a))
         (blen (vlen b))
         (part (make-vector (+ alen 1) 0)) ;; for each partial product |a|+1
@@ -540,6 +540,20 @@
       )
     r))
 
+;; the same algorithm, using irk_digits_mul from include/header1.c
+(define (digits-mul-school a b)
+  (%backend (c llvm)
+    (let ((r (make-vector (+ (vlen a) (vlen b)) 0)))
+      (%backend c
+        (%%cexp ((vector int) (vector int) (vector int) int -> undefined)
+                "irk_digits_mul (%0, %1, %2, %3)" a b r big/bits))
+      (%backend llvm
+        (%llvm-call ("@irk_ll_digits_mul" ((vector int) (vector int) (vector int) int -> undefined))
+                    a b r big/bits))
+      r))
+  (%backend bytecode
+    (digits-mul-school* a b)))
+
 (define (digits-mul a b)
   (cond ((or (eq? #() a) (eq? #() b)) #()) ;; these handle internal results
         ((and (= 1 (vlen a)) (= a[0] 1)) b) ;; of other algorithms.
@@ -555,8 +569,10 @@
                (karatsuba a b))))
         ))
 
-;; measured with tests/t_find_karatsuba.scm
-(define KARATSUBA-CUTOFF 25)
+;; measured with tests/t_find_karatsuba.scm.  the C schoolbook
+;;   multiply holds its own against karatsuba for much longer.
+(%backend (c llvm) (define KARATSUBA-CUTOFF 100))
+(%backend bytecode (define KARATSUBA-CUTOFF 25))
 
 (define (karatsuba da db)
 
@@ -689,8 +705,9 @@
         (:tuple (digits-add q digits/base) r))
       (let ((qr (make-vector 2 0))
             (_ (div2b1 a[0] a[1] b[0] qr))
-            (q qr[0])
-            (r qr[1])
+            ;; when a[0] = b[0] the estimate is base, which is not a
+            ;;   digit (div2b1 masks it to 0): use base-1 instead.
+            (q (if (= a[0] b[0]) big/mask qr[0]))
             (t (digits-mul b (VEC1 q)))) ;; XXX was digits-mul1
         (when (digits< a t)
           (set! q (- q 1))
@@ -915,16 +932,48 @@
         (big-sub n r)
         r)))
 
-(define (big-exp-mod b e m)
+(define (big-exp-mod* b e m)
   (match e with
     (big:zero) -> big/1
     _ -> (let ((e2 (big-rshift e 1))
-               (x (big-exp-mod b e2 m))
+               (x (big-exp-mod* b e2 m))
                (t (big-mod (big-mul x x) m)))
            (if (big-odd? e)
                (big-mod (big-mul t b) m)
                t))))
 
+;; b^e mod m for odd m, with Montgomery multiplication
+;;   (irk_digits_exp_mod in include/header1.c).  assumes b < m.
+(define (digits-exp-mod b e m)
+  (let ((r (make-vector (vlen m) 0)))
+    (%backend c
+      (%%cexp ((vector int) (vector int) (vector int) (vector int) int -> undefined)
+              "irk_digits_exp_mod (%0, %1, %2, %3, %4)" b e m r big/bits))
+    (%backend llvm
+      (%llvm-call ("@irk_ll_digits_exp_mod" ((vector int) (vector int) (vector int) (vector int) int -> undefined))
+                  b e m r big/bits))
+    (%backend bytecode
+      (impossible))
+    r))
+
+;; note: not constant-time.  see lib/crypto/ctbig.scm.
+(define (big-exp-mod b e m)
+  (%backend (c llvm)
+    (match e m with
+      (big:pos de) (big:pos dm)
+      -> (if (big-odd? m)
+             (match (big-mod b m) with
+               (big:zero) -> (big:zero)
+               (big:pos db)
+               -> (if (digits< db dm)
+                      (digits->big (digits-exp-mod db de dm) #t)
+                      (big-exp-mod* b e m))
+               _ -> (big-exp-mod* b e m))
+             (big-exp-mod* b e m))
+      _ _ -> (big-exp-mod* b e m)))
+  (%backend bytecode
+    (big-exp-mod* b e m)))
+
 ;; XXX this should be named big/bits.  in fact, we need to
 ;;     do an audit of the names in this file to get a clear
 ;;     distinction between `->` and `/` functions.
@@ -4,12 +4,22 @@
 
 (require "lib/basis.scm")
 (require "demo/bignum.scm")
+(require "lib/crypto/ctbig.scm")
 
+;; big-exp-mod uses irk_digits_exp_mod (include/header1.c).
 (define (encrypt msg e n)
   (big (expmod msg e n)))
 
+;; the private key gets the constant-time i31 code, which uses
+;;   irk_i31_modpow.
 (define (decrypt msg d n)
-  (big (expmod msg d n)))
+  (let ((n31 (big->i31 n))
+        (x (i31/make n31[0]))
+        (ds (big->u256 d)))
+    (i31/reduce x (big->i31 msg) n31)
+    (i31/modpow x ds (string-length ds) n31 (i31/ninv31 n31[1])
+                (i31/make n31[0]) (i31/make n31[0]))
+    (i31->big x)))
 
 (define (main)
   (let ((d (big (dec "5617843187844953170308463622230283376298685")))
@@ -3,11 +3,165 @@
 // cheney copying garbage collector
 // --------------------------------------------------
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <time.h>
+
+// the range of the space being evacuated: heap0 during a full
+//   collection, the nursery during a minor one.
+static object * gc_from_lo;
+static object * gc_from_hi;
+
+// set while a collection is moving objects, see irk_sample_record().
+static volatile int gc_active = 0;
+
+// detect an allocation request that no amount of collecting will satisfy.
+static object * gc_last_freep = NULL;
+
+// running totals, see gc_stats_begin() and irk_gc_stats().
+#define GC_PAUSE_BUCKETS 24
+
+typedef struct {
+  uint64_t collections;		// full collections
+  uint64_t minor_collections;
+  uint64_t words_allocated;
+  uint64_t words_copied;
+  uint64_t in_use_before;	// heap words in use before/after the last collection
+  uint64_t in_use_after;
+  uint64_t peak_in_use;
+  uint64_t start_usecs;
+  uint64_t pause_usecs;		// total
+  uint64_t max_pause_usecs;
+  // pauses[i] counts pauses of less than 2^i usecs (the last one, any longer)
+  uint64_t pauses[GC_PAUSE_BUCKETS];
+} gc_stats_t;
+
+static gc_stats_t gc_stats;
+
+// the part of the heap mapped from an image file by load_image(), if any.
+static object * gc_image_map = NULL;
+static size_t gc_image_words = 0;
+
+// --------------------------------------------------
+// heap memory
+// --------------------------------------------------
+//
+// The semispaces are mapped rather than malloc'd, so that pages are
+//   only committed as <freep> reaches them.  Instead of clearing the
+//   from-space after a collection, its pages are handed back to the
+//   kernel and come back zero-filled when next touched.  Allocation
+//   never needs more than that: a zero word is not immediate, but
+//   like IRK_NIL it points outside the heap, so the collector leaves
+//   it alone.
+
+// code generated by older compilers may have included the system
+//   headers without _DEFAULT_SOURCE, in which case plain malloc will do.
+#if defined(MAP_ANON) && defined(MADV_DONTNEED)
+
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+
+static
+size_t
+gc_heap_bytes (size_t words)
+{
+  size_t page = (size_t) sysconf (_SC_PAGESIZE);
+  return ((words * sizeof (object)) + page - 1) & ~(page - 1);
+}
+
+// returns NULL on failure.
+static
+object *
+gc_heap_alloc (size_t words)
+{
+  void * p = mmap (NULL, gc_heap_bytes (words), PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANON | MAP_NORESERVE, -1, 0);
+  if (p == MAP_FAILED) {
+    return NULL;
+  }
+#ifdef MADV_HUGEPAGE
+  // fewer faults when a released space is refilled.
+  madvise (p, gc_heap_bytes (words), MADV_HUGEPAGE);
+#endif
+  return (object *) p;
+}
+
+static
+void
+gc_heap_free (object * p, size_t words)
+{
+  if (p) {
+    if (p == gc_image_map) {
+      gc_image_map = NULL;
+    }
+    munmap (p, gc_heap_bytes (words));
+  }
+}
+
+// drop the contents of a semispace, leaving it zero-filled.
+static
+void
+gc_heap_release (object * p, size_t words)
+{
+#ifdef __linux__
+  // on the pages of an image, MADV_DONTNEED would bring back the file.
+  if (!gc_image_map || (p + words <= gc_image_map) || (p >= gc_image_map + gc_image_words)) {
+    madvise (p, gc_heap_bytes (words), MADV_DONTNEED);
+    return;
+  }
+#endif
+  // elsewhere MADV_DONTNEED need not zero the pages, so map fresh ones.
+  if (p == gc_image_map) {
+    gc_image_map = NULL;
+  }
+  if (mmap (p, gc_heap_bytes (words), PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANON | MAP_NORESERVE | MAP_FIXED, -1, 0) == MAP_FAILED) {
+    clear_space (p, words);
+  }
+}
+
+#else
+
+static
+size_t
+gc_heap_bytes (size_t words)
+{
+  return words * sizeof (object);
+}
+
+static
+object *
+gc_heap_alloc (size_t words)
+{
+  return (object *) calloc (words, sizeof (object));
+}
+
+static
+void
+gc_heap_free (object * p, size_t words)
+{
+  free (p);
+}
+
+static
+void
+gc_heap_release (object * p, size_t words)
+{
+  memset (p, 0, words * sizeof (object));
+}
+
+#endif
+
+#include "gc_los.c"
+
 static
 int
 sitting_duck (object * p)
 {
-  return (p >= heap0) && (p < (heap0 + heap_size));
+  return ((p >= gc_from_lo) && (p < gc_from_hi))
+    || (gc_los_evacuate && is_large_object (p));
 }
 
 static object * scan;
@@ -40,34 +194,19 @@ copy (object * p)
   } else {
     // pp points outside of the heap
     //fprintf (stderr, "?");
+    if (gc_los_marking) {
+      los_mark (pp);
+    }
     return pp;
   }
 }
 
+// scan loop: copy everything reachable from the objects in [scan, freep)
 static
-object
-do_gc (int nroots)
+void
+gc_scan (object * start)
 {
-  int i = 0;
-
-  if (verbose_gc) {
-    fprintf (stderr, "[gc...");
-  }
-
-  // place our roots
-  scan = heap1;
-  freep = scan + nroots;
-
-  // copy the roots
-  for (i = 0; i < nroots; i++) {
-    scan[i] = (object) copy (&(scan[i]));
-  }
-
-  // bump scan
-  scan += nroots;
-
-  // scan loop
-
+  scan = start;
   while (scan < freep) {
     if (IMMEDIATE (*scan)) {
       scan++;
@@ -100,6 +239,8 @@ do_gc (int nroots)
 
       case TC_STRING:
       case TC_BUFFER:
+      case TC_FLOAT:
+      case TC_PACKED:
 	// skip it all
 	scan += length + 1;
 	break;
@@ -124,17 +265,80 @@ do_gc (int nroots)
       }
     }
   }
+}
+
+// the size of heap1, which differs from <heap_size> only while the
+//   heap is being resized.
+static size_t heap1_size;
+
+#ifdef IRK_PARALLEL_GC
+#include "gc_parallel.c"
+#else
+static size_t gc_par_reserve (size_t words) { return 0; }
+#endif
+
+static
+object
+do_gc (int nroots)
+{
+  int i = 0;
+#ifdef IRK_PARALLEL_GC
+  size_t used = (freep - heap0) + (gc_los_evacuate ? los_in_use : 0);
+  int parallel = (freep >= heap0) && (freep < heap0 + heap_size)
+    && (used >= GC_PAR_MIN_WORDS)
+    && (gc_get_threads() > 1)
+    && (used + gc_par_reserve (used) <= heap1_size);
+#endif
+
+  if (verbose_gc) {
+    fprintf (stderr, "[gc...");
+  }
+
+  gc_from_lo = heap0;
+  gc_from_hi = heap0 + heap_size;
+  gc_los_marking = 1;
+
+  // place our roots
+  scan = heap1;
+  freep = scan + nroots;
+
+  // leave room for the roots of future minor collections
+  while (freep < heap1 + GC_ROOT_AREA) {
+    *freep++ = IRK_NIL;
+  }
+
+#ifdef IRK_PARALLEL_GC
+  if (parallel) {
+    freep = gc_parallel (nroots, freep);
+  } else
+#endif
+  {
+    // copy the roots
+    for (i = 0; i < nroots; i++) {
+      scan[i] = (object) copy (&(scan[i]));
+    }
+    // scan loop
+    gc_scan (scan + nroots);
+  }
+
+  gc_los_marking = 0;
+  los_sweep();
+
   // swap heaps
   { object * temp = heap0; heap0 = heap1; heap1 = temp; }
+  { size_t temp = heap_size; heap_size = heap1_size; heap1_size = temp; }
 
+  // the old from-space is empty now.  the new to-space needs no
+  //   clearing, since it was released when it was last a from-space.
   if (clear_fromspace) {
-    // zero the from-space
-    clear_space (heap1, heap_size);
+    // fill the from-space with IRK_NIL
+    clear_space (heap1, heap1_size);
+  } else {
+    gc_heap_release (heap1, heap1_size);
   }
 
-  if (clear_tospace) {
-    clear_space (freep, heap_size - (freep - heap0));
-  }
+  gc_stats.collections++;
+  gc_stats.words_copied += freep - heap0;
 
   if (verbose_gc) {
     fprintf (stderr, "collected %" PRIuPTR " words]\n", freep - heap0);
@@ -142,6 +346,328 @@ do_gc (int nroots)
   return (object) box (freep - heap0);
 }
 
+// --------------------------------------------------
+// heap sizing
+// --------------------------------------------------
+//
+// After a full collection the semispaces are resized so that the
+//   survivors fill between 1/16 and 1/2 of the heap, by doubling or
+//   halving.  The heap never shrinks below its initial size.  When a
+//   collection leaves too little room for the allocation that caused
+//   it, the caller collects again without allocating (see
+//   gc_check_progress()), and that collection doubles the heap.
+
+static size_t heap_size_min;
+static int gc_grow = 0;
+
+// copy the live data (with its roots at heap0[0..nroots)) into a
+//   fresh pair of semispaces of <new_size> words.  returns 0 if they
+//   could not be allocated.
+static
+int
+gc_resize (int nroots, size_t new_size)
+{
+  object * new0 = gc_heap_alloc (new_size);
+  object * new1 = gc_heap_alloc (new_size);
+  if (!new0 || !new1) {
+    gc_heap_free (new0, new_size);
+    gc_heap_free (new1, new_size);
+    return 0;
+  }
+  gc_heap_free (heap1, heap1_size);
+  heap1 = new0;
+  heap1_size = new_size;
+  for (int i = 0; i < nroots; i++) {
+    heap1[i] = heap0[i];
+  }
+  do_gc (nroots);
+  gc_heap_free (heap1, heap1_size);
+  heap1 = new1;
+  heap1_size = new_size;
+  if (verbose_gc) {
+    fprintf (stderr, "[heap resized to %" PRIuPTR " words]\n", (uintptr_t) new_size);
+  }
+  return 1;
+}
+
+// <reserve> is the space that must remain free after a collection.
+static
+void
+gc_adjust_heap (int nroots, size_t reserve)
+{
+  size_t live = (freep - heap0) + reserve;
+  size_t new_size = gc_grow ? heap_size * 2 : heap_size;
+  while (live > new_size / 2) {
+    new_size *= 2;
+  }
+  while (!gc_grow && (new_size / 2 >= heap_size_min) && (live < new_size / 16)) {
+    new_size /= 2;
+  }
+  if ((new_size != heap_size) && !gc_resize (nroots, new_size) && gc_grow) {
+    // otherwise not fatal, carry on at the current size.
+    fprintf (stderr, "heap exhausted\n");
+    abort();
+  }
+  gc_grow = 0;
+}
+
+#ifdef IRK_GENERATIONAL
+
+// --------------------------------------------------
+// generational mode
+// --------------------------------------------------
+//
+// Objects are allocated in the nursery.  A minor collection copies
+//   the survivors to the end of the old space (heap0), using the
+//   roots plus the remembered set, and then empties the nursery.
+//   When the old space runs low, a full collection (do_gc) compacts
+//   it into heap1 and the semispaces are swapped as usual.
+//
+// An allocation that cannot fit in an empty nursery is satisfied
+//   directly from the old space: the mutator keeps allocating there
+//   ('pretenured') until the next flip, which starts a fresh nursery.
+//   No nursery objects exist during that time, so the write barrier
+//   stays quiet.
+
+static object * old_freep;
+static int gc_pretenured = 0;
+
+// remembered set: a sequential store buffer of slots outside the
+//   nursery that were written with a nursery pointer.
+static object ** gc_remset = NULL;
+static size_t gc_remset_len = 0;
+static size_t gc_remset_cap = 0;
+
+static
+void
+gc_remember (object * slot)
+{
+  if (gc_remset_len == gc_remset_cap) {
+    gc_remset_cap = gc_remset_cap ? gc_remset_cap * 2 : 4096;
+    gc_remset = (object **) realloc (gc_remset, sizeof (object *) * gc_remset_cap);
+    if (!gc_remset) {
+      fprintf (stderr, "unable to grow remembered set\n");
+      abort();
+    }
+  }
+  gc_remset[gc_remset_len++] = slot;
+}
+
+// roots are in heap1[0..nroots), they are placed in heap0[0..nroots).
+static
+void
+gc_minor (int nroots)
+{
+  object * top0 = freep;
+  object * promoted = old_freep;
+  size_t i;
+
+  if (verbose_gc) {
+    fprintf (stderr, "[minor gc...");
+  }
+  gc_from_lo = nursery;
+  gc_from_hi = nursery_end;
+  freep = old_freep;
+  for (i = 0; i < (size_t) nroots; i++) {
+    heap0[i] = (object) copy ((object *) &(heap1[i]));
+  }
+  for (i = 0; i < gc_remset_len; i++) {
+    *(gc_remset[i]) = (object) copy (gc_remset[i]);
+  }
+  gc_remset_len = 0;
+  gc_scan (promoted);
+  old_freep = freep;
+  gc_stats.minor_collections++;
+  gc_stats.words_copied += old_freep - promoted;
+  if (clear_tospace) {
+    clear_space (nursery, top0 - nursery);
+  }
+  if (verbose_gc) {
+    fprintf (stderr, "promoted %" PRIuPTR " words]\n", old_freep - promoted);
+  }
+}
+
+// a full collection of the old space, roots as in gc_minor().
+static
+void
+gc_major (int nroots)
+{
+  for (int i = 0; i < nroots; i++) {
+    heap1[i] = heap0[i];
+  }
+  do_gc (nroots);
+  gc_adjust_heap (nroots, nursery_size + head_room);
+  old_freep = freep;
+#ifdef IRK_PROFILE
+  // a minor collection leaves the old space alone, so only count it here.
+  hprof_census (heap0 + nroots, old_freep);
+#endif
+}
+
+static
+void
+gc_set_limit (irk_int room)
+{
+  if (gc_pretenured) {
+    limit = heap0 + (heap_size - room - gc_par_reserve (heap_size));
+  } else {
+    // never let the nursery hold more than the old space can absorb.
+    irk_int avail = (heap0 + heap_size) - old_freep - gc_par_reserve (heap_size);
+    if (avail > (irk_int) nursery_size) {
+      avail = nursery_size;
+    }
+    limit = nursery + (avail - room);
+  }
+}
+
+static
+object
+gc_collect (int nroots)
+{
+  assert (nroots <= GC_ROOT_AREA);
+  if (gc_pretenured) {
+    // the old space is full, start over with a fresh nursery.
+    for (int i = 0; i < nroots; i++) {
+      heap0[i] = heap1[i];
+    }
+    old_freep = freep;
+    gc_pretenured = 0;
+    gc_major (nroots);
+    freep = nursery;
+  } else if ((freep == nursery) && !los_pressure) {
+    // an empty nursery is not enough: compact and allocate from the old space.
+    for (int i = 0; i < nroots; i++) {
+      heap0[i] = heap1[i];
+    }
+    gc_major (nroots);
+    gc_pretenured = 1;
+  } else {
+    gc_minor (nroots);
+    if (los_pressure
+        || (size_t)((heap0 + heap_size) - old_freep)
+           < nursery_size + head_room + gc_par_reserve (heap_size)) {
+      gc_major (nroots);
+    }
+    freep = nursery;
+  }
+  return (object) box (old_freep - heap0);
+}
+
+#else
+
+static
+void
+gc_set_limit (irk_int room)
+{
+  // leave the parallel collector room for its padding.
+  limit = heap0 + (heap_size - room - gc_par_reserve (heap_size));
+}
+
+static
+object
+gc_collect (int nroots)
+{
+  do_gc (nroots);
+  gc_adjust_heap (nroots, head_room);
+#ifdef IRK_PROFILE
+  hprof_census (heap0 + nroots, freep);
+#endif
+  return (object) box (freep - heap0);
+}
+
+#endif // IRK_GENERATIONAL
+
+// --------------------------------------------------
+// statistics
+// --------------------------------------------------
+
+// where allocation started after the last collection.
+static object * gc_alloc_mark;
+static uint64_t gc_pause_start;
+
+static
+uint64_t
+gc_usecs (void)
+{
+#ifdef CLOCK_MONOTONIC
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#else
+  return (uint64_t) clock() * 1000000 / CLOCKS_PER_SEC;
+#endif
+}
+
+static
+size_t
+gc_words_in_use (void)
+{
+#ifdef IRK_GENERATIONAL
+  if (gc_pretenured) {
+    return (freep - heap0) + los_in_use;
+  } else {
+    return (old_freep - heap0) + (freep - nursery) + los_in_use;
+  }
+#else
+  return (freep - heap0) + los_in_use;
+#endif
+}
+
+static
+void
+gc_stats_init (void)
+{
+  gc_stats.start_usecs = gc_usecs();
+  gc_alloc_mark = freep;
+}
+
+static
+void
+gc_stats_begin (void)
+{
+  gc_stats.words_allocated += freep - gc_alloc_mark;
+  gc_stats.in_use_before = gc_words_in_use();
+  if (gc_stats.in_use_before > gc_stats.peak_in_use) {
+    gc_stats.peak_in_use = gc_stats.in_use_before;
+  }
+  gc_pause_start = gc_usecs();
+  gc_active = 1;
+}
+
+static
+void
+gc_stats_end (void)
+{
+  uint64_t pause = gc_usecs() - gc_pause_start;
+  int i = 0;
+  while ((i < GC_PAUSE_BUCKETS - 1) && (pause >= ((uint64_t) 1 << i))) {
+    i++;
+  }
+  gc_stats.pauses[i]++;
+  gc_stats.pause_usecs += pause;
+  if (pause > gc_stats.max_pause_usecs) {
+    gc_stats.max_pause_usecs = pause;
+  }
+  gc_stats.in_use_after = gc_words_in_use();
+  gc_alloc_mark = freep;
+  gc_active = 0;
+}
+
+static
+void
+gc_check_progress (void)
+{
+#ifdef IRK_GENERATIONAL
+  // an empty nursery is expected to fail once, see gc_collect().
+  if (gc_pretenured && (freep == gc_last_freep)) {
+#else
+  if (freep == gc_last_freep) {
+#endif
+    // the last collection left too little room: grow the heap.
+    gc_grow = 1;
+  }
+}
+
 static
 object
 gc_flip (int nregs)
@@ -151,18 +677,22 @@ gc_flip (int nregs)
 #if USE_CYCLECOUNTER
   t0 = rdtsc();
 #endif
+  gc_check_progress();
+  gc_stats_begin();
   // copy roots
   heap1[0] = (object) lenv;
   heap1[1] = (object) k;
   heap1[2] = (object) top;
   //assert (freep < (heap0 + heap_size));
-  nwords = do_gc (nregs + 3);
+  nwords = gc_collect (nregs + 3);
   // replace roots
   lenv = (object *) heap0[0];
   k    = (object *) heap0[1];
   top  = (object *) heap0[2];
   // set new limit
-  limit = heap0 + (heap_size - 4096);
+  gc_set_limit (4096);
+  gc_last_freep = freep;
+  gc_stats_end();
 #if USE_CYCLECOUNTER
   t1 = rdtsc();
   gc_ticks += (t1 - t0);
@@ -178,23 +708,63 @@ static
 object *
 gc_dump (object * thunk)
 {
+  gc_stats_begin();
+  // an image must be self-contained, so the large objects are brought
+  //   back into the heap by the final full collection.  make sure its
+  //   to-space can hold them.
+  if (los_count > 0) {
+    size_t need = heap_size + los_in_use;
+    if (heap1_size < need) {
+      gc_heap_free (heap1, heap1_size);
+      heap1 = gc_heap_alloc (need);
+      if (!heap1) {
+        fprintf (stderr, "unable to allocate space for image\n");
+        abort();
+      }
+      heap1_size = need;
+    }
+  }
   // copy roots
   heap1[0] = (object) lenv;
   heap1[1] = (object) k;
   heap1[2] = (object) top;
   heap1[3] = (object) thunk;
+#ifdef IRK_GENERATIONAL
+  // empty the nursery first, then compact everything.  allocation
+  //   continues in the old space so the image ends at <freep>.
+  if (gc_pretenured) {
+    // everything already lives in the old space: gc_major() takes its
+    //   roots from heap0.
+    for (int i = 0; i < 4; i++) {
+      heap0[i] = heap1[i];
+    }
+    old_freep = freep;
+  } else {
+    gc_minor (4);
+  }
+  // not before: a large object copied by the minor would land in the
+  //   old space, and leave a forwarding address that gc_major() hands
+  //   to the old objects that share it.
+  gc_los_evacuate = 1;
+  gc_major (4);
+  gc_pretenured = 1;
+#else
+  gc_los_evacuate = 1;
   do_gc (4);
+#endif
+  gc_los_evacuate = 0;
   // replace roots
   lenv  = (object *) heap0[0];
   k     = (object *) heap0[1];
   top   = (object *) heap0[2];
   thunk = (object *) heap0[3];
   // set new limit
-  limit = heap0 + (heap_size - 1024);
+  gc_set_limit (1024);
+  gc_last_freep = NULL;
+  gc_stats_end();
   return thunk;
 }
 
-
 static
 void adjust (object * q, irk_int delta)
 {
@@ -244,6 +814,8 @@ gc_relocate (int nroots, object * start, object * finish, irk_int delta)
       break;
     case TC_STRING:
     case TC_BUFFER:
+    case TC_FLOAT:
+    case TC_PACKED:
     case TC_FOREIGN: // XXX should probably squeal in this case.
       // skip it all
       scan += length+1;
@@ -259,52 +831,204 @@ gc_relocate (int nroots, object * start, object * finish, irk_int delta)
   }
 }
 
-// these could probably be written in irken...
+// --------------------------------------------------
+// heap images
+// --------------------------------------------------
+//
+// An image is a header followed, at <data_offset>, by the heap just as
+//   gc_dump() left it: four roots and then the objects.  The offset is
+//   a multiple of any likely page size, so that the data can be mapped
+//   straight from the file.  When it can be mapped at the address it
+//   was dumped from (the same binary, run without address space
+//   randomization), no pointer needs adjusting and a page is only read
+//   when it's first touched.  Otherwise it is read in and relocated.
+
+#define IRK_IMAGE_MAGIC		"IRKIMAGE"
+#define IRK_IMAGE_VERSION	2
+#define IRK_IMAGE_ENDIAN	0x01020304
+#define IRK_IMAGE_ALIGN		65536
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t endian;		// IRK_IMAGE_ENDIAN in the writer's byte order
+  uint32_t word_size;
+  uint32_t data_offset;
+  uint64_t base;		// the address of the heap when dumped
+  uint64_t size;		// words of data
+  uint64_t code;		// the address of dump_image() when dumped
+} irk_image_header;
+
+static irk_int dump_image (char * filename, object * closure);
+
 static irk_int
 dump_image (char * filename, object * closure) {
   FILE * dump_file = fopen (filename, "wb");
-  irk_int offset;
+  irk_image_header h;
   irk_int size;
-  object * start;
+  if (!dump_file) {
+    fprintf (stderr, "unable to open image %s\n", filename);
+    abort();
+  }
   // do a gc for a compact dump
   closure = gc_dump (closure);
-  // for now, start at the front of the heap
-  start = heap0;
-  size = freep - start;
-  offset = (irk_int) heap0;
-  // XXX add endian indicator...
-  fprintf (dump_file, "(irken image %" PRIuPTR " %p)\n", sizeof (irk_int), start);
-  fwrite (&offset, sizeof(irk_int), 1, dump_file);
-  fwrite (&size, sizeof(irk_int), 1, dump_file);
-  fwrite (start, sizeof(irk_int), size, dump_file);
+  size = freep - heap0;
+  memset (&h, 0, sizeof (h));
+  memcpy (h.magic, IRK_IMAGE_MAGIC, sizeof (h.magic));
+  h.version = IRK_IMAGE_VERSION;
+  h.endian = IRK_IMAGE_ENDIAN;
+  h.word_size = sizeof (object);
+  h.data_offset = IRK_IMAGE_ALIGN;
+  h.base = (uint64_t) (uintptr_t) heap0;
+  h.size = (uint64_t) size;
+  h.code = (uint64_t) (uintptr_t) dump_image;
+  fwrite (&h, sizeof (h), 1, dump_file);
+  fseek (dump_file, h.data_offset, SEEK_SET);
+  fwrite (heap0, sizeof (object), size, dump_file);
   fclose (dump_file);
   return size;
 }
 
+static
+void
+read_image_header (char * filename, FILE * file, irk_image_header * h)
+{
+  char * problem = NULL;
+  if ((fread (h, sizeof (*h), 1, file) != 1)
+      || (memcmp (h->magic, IRK_IMAGE_MAGIC, sizeof (h->magic)) != 0)) {
+    problem = "not an irken image";
+  } else if (h->endian != IRK_IMAGE_ENDIAN) {
+    problem = "wrong byte order";
+  } else if (h->version != IRK_IMAGE_VERSION) {
+    problem = "unsupported version";
+  } else if (h->word_size != sizeof (object)) {
+    problem = "wrong word size";
+  } else if (h->data_offset < sizeof (*h)) {
+    problem = "bad data offset";
+  } else if (h->code != (uint64_t) (uintptr_t) dump_image) {
+    // the continuations in the image would jump into the weeds.
+    problem = "dumped by a different binary, or with address randomization";
+  }
+  if (problem) {
+    fprintf (stderr, "%s: %s\n", filename, problem);
+    abort();
+  }
+}
+
+// try to map the image data at the address it was dumped from.
+//   returns the semispace it now occupies, or NULL.  Note: when that
+//   is heap0, whatever was allocated before the load is overwritten.
+static
+object *
+gc_image_place (FILE * file, irk_image_header * h)
+{
+#if defined(MAP_ANON) && defined(MADV_DONTNEED)
+  object * base = (object *) (uintptr_t) h->base;
+  struct stat st;
+  if ((h->data_offset % (uint64_t) sysconf (_SC_PAGESIZE)) != 0
+      || (fstat (fileno (file), &st) != 0)
+      || !S_ISREG (st.st_mode)
+      || ((uint64_t) st.st_size < h->data_offset + h->size * sizeof (object))) {
+    return NULL;
+  }
+  if ((base != heap0) && (base != heap1)) {
+    // make a new to-space there, if that address is free.
+    void * p = mmap (base, gc_heap_bytes (heap_size), PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANON | MAP_NORESERVE, -1, 0);
+    if (p == MAP_FAILED) {
+      return NULL;
+    } else if (p != (void *) base) {
+      munmap (p, gc_heap_bytes (heap_size));
+      return NULL;
+    }
+    gc_heap_free (heap1, heap1_size);
+    heap1 = base;
+    heap1_size = heap_size;
+  }
+  if (mmap (base, gc_heap_bytes (h->size), PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_FIXED, fileno (file), (off_t) h->data_offset) == MAP_FAILED) {
+    fprintf (stderr, "unable to map image\n");
+    abort();
+  }
+  return base;
+#else
+  return NULL;
+#endif
+}
+
 static
 object *
 load_image (char * filename) {
   FILE * load_file = fopen (filename, "rb");
   if (!load_file) {
+    fprintf (stderr, "unable to open image %s\n", filename);
     abort();
   } else {
-    object * start, * thunk;
+    irk_image_header h;
+    object * start, * thunk, * space;
     irk_int size;
-    read_header (load_file);	// XXX verify header...
-    fread (&start, sizeof(irk_int), 1, load_file);
-    fread (&size, sizeof(irk_int), 1, load_file);
-    fread (heap1, sizeof(irk_int), size, load_file);
-    fprintf (stderr, "size=%d\n", (int) size);
-    // relocate heap0
-    gc_relocate (4, heap1, heap1 + size, start - heap1);
+    int mapped;
+    read_image_header (filename, load_file, &h);
+    start = (object *) (uintptr_t) h.base;
+    size = (irk_int) h.size;
+    if ((size_t) size + head_room >= heap_size / 2) {
+      // the image came from a bigger heap.  nothing here is worth
+      //   keeping yet, so just replace both semispaces.
+      size_t n = heap_size;
+      while ((size_t) size + head_room >= n / 2) {
+        n *= 2;
+      }
+      gc_heap_free (heap0, heap_size);
+      gc_heap_free (heap1, heap1_size);
+      heap0 = gc_heap_alloc (n);
+      heap1 = gc_heap_alloc (n);
+      if (!heap0 || !heap1) {
+        fprintf (stderr, "unable to allocate heap\n");
+        abort();
+      }
+      heap_size = heap1_size = n;
+    }
+    space = gc_image_place (load_file, &h);
+    mapped = (space != NULL);
+    if (!mapped) {
+      space = heap1;
+      fseek (load_file, h.data_offset, SEEK_SET);
+      if (fread (heap1, sizeof (object), size, load_file) != (size_t) size) {
+        fprintf (stderr, "%s: truncated image\n", filename);
+        abort();
+      }
+      gc_relocate (4, heap1, heap1 + size, start - heap1);
+    }
+    fclose (load_file);
     // replace roots
-    lenv  = (object *) heap1[0];
-    k     = (object *) heap1[1];
-    top   = (object *) heap1[2];
-    thunk = (object *) heap1[3];
-    freep = heap1 + size;
-    // swap heaps
-    { object * temp = heap0; heap0 = heap1; heap1 = temp; }
+    lenv  = (object *) space[0];
+    k     = (object *) space[1];
+    top   = (object *) space[2];
+    thunk = (object *) space[3];
+    freep = space + size;
+    if (space == heap1) {
+      // swap heaps
+      { object * temp = heap0; heap0 = heap1; heap1 = temp; }
+      { size_t temp = heap_size; heap_size = heap1_size; heap1_size = temp; }
+      gc_heap_release (heap1, heap1_size);
+    } else {
+      // the image went straight into heap0, clear what's left of it.
+      size_t used = gc_heap_bytes (size) / sizeof (object);
+      gc_heap_release (heap0 + used, heap_size - used);
+    }
+    if (mapped) {
+      gc_image_map = start;
+      gc_image_words = gc_heap_bytes (size) / sizeof (object);
+    }
+#ifdef IRK_GENERATIONAL
+    // the image lives in the old space, discard the nursery.
+    gc_heap_release (nursery, nursery_size);
+    gc_remset_len = 0;
+    old_freep = freep;
+    gc_pretenured = 1;
+#endif
+    gc_set_limit (1024);
+    gc_alloc_mark = freep;
     return thunk;
   }
 }
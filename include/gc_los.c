@@ -0,0 +1,143 @@
+// --------------------------------------------------
+// large object space
+// --------------------------------------------------
+//
+// Strings and buffers of at least <los_threshold> words are malloc'd
+//   outside the heap and never moved.  Since they contain no pointers,
+//   a full collection only needs to mark the ones it finds, and sweep
+//   away the rest when it's done.  Minor collections leave them alone.
+//
+// Each object is preceded by a single word holding its mark.  The
+//   objects are kept in an array sorted by address, so that the
+//   collector can tell a large object from any other pointer outside
+//   the heap (e.g. a constructed literal).
+
+const size_t los_threshold = 4096; // words
+
+static object ** los_objects = NULL;
+static size_t los_count = 0;
+static size_t los_cap = 0;
+static object * los_lo = NULL; // lowest address in use
+static object * los_hi = NULL; // highest address in use
+
+// words allocated since the last full collection.
+static size_t los_words = 0;
+// words in all large objects.
+static size_t los_in_use = 0;
+// set when enough has been allocated to justify a full collection.
+static int los_pressure = 0;
+// set during a full collection.
+static int gc_los_marking = 0;
+// set to make a collection copy large objects into the heap.
+static int gc_los_evacuate = 0;
+
+static
+irk_int
+los_find (object * ob)
+{
+  irk_int lo = 0;
+  irk_int hi = (irk_int) los_count - 1;
+  while (lo <= hi) {
+    irk_int mid = (lo + hi) / 2;
+    if (los_objects[mid] == ob) {
+      return mid;
+    } else if (los_objects[mid] < ob) {
+      lo = mid + 1;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  return -1;
+}
+
+static
+int
+is_large_object (object * ob)
+{
+  return (ob >= los_lo) && (ob < los_hi) && (los_find (ob) >= 0);
+}
+
+static
+void
+los_mark (object * ob)
+{
+  if (is_large_object (ob)) {
+    // may race with other gc threads, harmlessly.
+    __atomic_store_n (ob - 1, (object) IRK_TRUE, __ATOMIC_RELAXED);
+  }
+}
+
+static
+object *
+los_alloc (irk_int tc, irk_int nwords)
+{
+  object * block = (object *) malloc (sizeof (object) * (nwords + 2));
+  object * ob;
+  irk_int i;
+  if (!block) {
+    fprintf (stderr, "unable to allocate large object\n");
+    abort();
+  }
+  ob = block + 1;
+  ob[-1] = IRK_FALSE;
+  ob[0] = (object) (nwords<<8 | (tc & 0xff));
+  if (los_count == los_cap) {
+    los_cap = los_cap ? los_cap * 2 : 64;
+    los_objects = (object **) realloc (los_objects, sizeof (object *) * los_cap);
+    if (!los_objects) {
+      fprintf (stderr, "unable to grow large object table\n");
+      abort();
+    }
+  }
+  // keep the table sorted, malloc tends to hand out increasing addresses.
+  for (i = (irk_int) los_count; (i > 0) && (los_objects[i-1] > ob); i--) {
+    los_objects[i] = los_objects[i-1];
+  }
+  los_objects[i] = ob;
+  los_count++;
+  if (!los_lo || (ob < los_lo)) {
+    los_lo = ob;
+  }
+  if (ob + nwords + 1 > los_hi) {
+    los_hi = ob + nwords + 1;
+  }
+  los_words += nwords + 1;
+  los_in_use += nwords + 1;
+  gc_stats.words_allocated += nwords + 1;
+  if (los_words > heap_size / 2) {
+    // ask for a full collection at the next heap check.
+    los_pressure = 1;
+    limit = freep;
+    gc_last_freep = NULL;
+  }
+  return ob;
+}
+
+// free whatever the last collection did not mark.
+static
+void
+los_sweep (void)
+{
+  size_t i, j = 0;
+  los_lo = los_hi = NULL;
+  los_in_use = 0;
+  for (i = 0; i < los_count; i++) {
+    object * ob = los_objects[i];
+    if (ob[-1] == IRK_TRUE) {
+      ob[-1] = IRK_FALSE;
+      los_objects[j++] = ob;
+      los_in_use += GET_TUPLE_LENGTH (*ob) + 1;
+      if (!los_lo) {
+        los_lo = ob;
+      }
+      if (ob + GET_TUPLE_LENGTH (*ob) + 1 > los_hi) {
+        los_hi = ob + GET_TUPLE_LENGTH (*ob) + 1;
+      }
+    } else {
+      free (ob - 1);
+    }
+  }
+  los_count = j;
+  los_words = 0;
+  los_pressure = 0;
+}
@@ -0,0 +1,364 @@
+// --------------------------------------------------
+// parallel copying collector
+// --------------------------------------------------
+//
+// Enabled by compiling with -DIRK_PARALLEL_GC -pthread.  do_gc() hands
+//   the work to gc_parallel() when the heap is big enough to be worth
+//   it.  The layout of the to-space is exactly what the sequential
+//   collector produces, except that objects land in a different order
+//   and unused chunk tails are filled with IRK_NIL (which the scan loop,
+//   gc_relocate() and dump_image() already treat as padding).
+//
+// Each worker copies into a private chunk of the to-space, claimed with
+//   an atomic bump of <gc_par_top>.  The chunk doubles as the worker's
+//   grey queue: [scan, free) holds copied but unscanned objects.
+//   Unscanned ranges are handed to a shared stack when a chunk fills
+//   up, or when another worker is idle, so that the others can steal
+//   them.  Objects over GC_PAR_SMALL words get a region of their own,
+//   which goes straight onto the stack.
+//
+// The padding costs at most GC_PAR_SMALL words per chunk, plus one
+//   chunk per worker.  gc_par_reserve() is that bound: the allocation
+//   limit leaves it free, and do_gc() only goes parallel when the
+//   to-space has room for it, so a parallel collection never runs out
+//   of space where the sequential one would not.
+//
+// Forwarding uses the usual GC_SENTINEL protocol, with one extra step:
+//   a worker claims an object by swapping its header for GC_BUSY, copies
+//   it, stores the forwarding address, and then publishes GC_SENTINEL.
+//   Workers that lose the race wait for the sentinel.
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+// like GC_SENTINEL, an impossible header (its length is -1).
+#define GC_BUSY			(-8)
+// words per chunk
+#define GC_PAR_CHUNK		(1<<14)
+// larger objects are not copied into a chunk
+#define GC_PAR_SMALL		64
+// don't bother below this many words in use
+#define GC_PAR_MIN_WORDS	(1<<20)
+#define GC_PAR_MAX_THREADS	64
+
+typedef struct {
+  object * scan;
+  object * free;
+  object * end;
+} gc_worker;
+
+typedef struct {
+  object * start;
+  object * end;
+} gc_range;
+
+static int gc_threads = 0; // 0: not yet configured
+static object * gc_par_top;
+static object * gc_par_limit;
+
+// the shared stack of grey ranges.
+static pthread_mutex_t gc_par_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gc_par_cond = PTHREAD_COND_INITIALIZER;
+static gc_range * gc_par_stack = NULL;
+static size_t gc_par_stack_len = 0;
+static size_t gc_par_stack_cap = 0;
+static int gc_par_idle = 0;
+
+static int gc_par_nroots;
+static object * gc_par_roots;
+
+// the number of workers comes from IRKEN_GC_THREADS, defaulting to
+//   the number of processors.
+static
+int
+gc_get_threads (void)
+{
+  if (gc_threads == 0) {
+    char * env = getenv ("IRKEN_GC_THREADS");
+    if (env) {
+      gc_threads = atoi (env);
+    } else {
+      gc_threads = (int) sysconf (_SC_NPROCESSORS_ONLN);
+    }
+    if (gc_threads < 1) {
+      gc_threads = 1;
+    } else if (gc_threads > GC_PAR_MAX_THREADS) {
+      gc_threads = GC_PAR_MAX_THREADS;
+    }
+  }
+  return gc_threads;
+}
+
+// the to-space that padding can waste while copying <words> words.
+static
+size_t
+gc_par_reserve (size_t words)
+{
+  if (gc_get_threads() > 1) {
+    return words / 128 + (size_t) gc_threads * GC_PAR_CHUNK;
+  } else {
+    return 0;
+  }
+}
+
+static
+object *
+gc_par_claim (irk_int nwords)
+{
+  object * p = (object *) __atomic_fetch_add (
+    (uintptr_t *) &gc_par_top, nwords * sizeof (object), __ATOMIC_RELAXED
+  );
+  // can't happen, see gc_par_reserve().
+  if (p + nwords > gc_par_limit) {
+    fprintf (stderr, "heap exhausted during parallel gc\n");
+    abort();
+  }
+  return p;
+}
+
+static
+void
+gc_par_push (object * start, object * end)
+{
+  if (start < end) {
+    pthread_mutex_lock (&gc_par_lock);
+    if (gc_par_stack_len == gc_par_stack_cap) {
+      gc_par_stack_cap = gc_par_stack_cap ? gc_par_stack_cap * 2 : 256;
+      gc_par_stack = (gc_range *) realloc (gc_par_stack, sizeof (gc_range) * gc_par_stack_cap);
+      if (!gc_par_stack) {
+        fprintf (stderr, "unable to grow gc work stack\n");
+        abort();
+      }
+    }
+    gc_par_stack[gc_par_stack_len].start = start;
+    gc_par_stack[gc_par_stack_len].end = end;
+    gc_par_stack_len++;
+    pthread_cond_signal (&gc_par_cond);
+    pthread_mutex_unlock (&gc_par_lock);
+  }
+}
+
+// start a new chunk.
+static
+void
+gc_par_refill (gc_worker * w)
+{
+  // publish whatever is still grey, and pad out the rest.
+  gc_par_push (w->scan, w->free);
+  while (w->free < w->end) {
+    *(w->free)++ = IRK_NIL;
+  }
+  w->scan = w->free = gc_par_claim (GC_PAR_CHUNK);
+  w->end = w->free + GC_PAR_CHUNK;
+}
+
+static
+object *
+gc_par_copy (gc_worker * w, object * p)
+{
+  object * pp = (object *) *p;
+  if (is_immediate (pp)) {
+    return pp;
+  } else if (!sitting_duck (pp)) {
+    if (gc_los_marking) {
+      los_mark (pp);
+    }
+    return pp;
+  } else {
+    object h = __atomic_load_n (pp, __ATOMIC_ACQUIRE);
+    while (1) {
+      if (h == (object) GC_SENTINEL) {
+        return (object *) pp[1];
+      } else if (h == (object) GC_BUSY) {
+        // another worker is copying it.
+        sched_yield();
+        h = __atomic_load_n (pp, __ATOMIC_ACQUIRE);
+      } else if (__atomic_compare_exchange_n (pp, &h, (object) GC_BUSY, 0,
+                                              __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+        irk_int length = GET_TUPLE_LENGTH (h);
+        object * addr;
+        irk_int k;
+        if (length + 1 > GC_PAR_SMALL) {
+          addr = gc_par_claim (length + 1);
+        } else {
+          if (w->free + length + 1 > w->end) {
+            gc_par_refill (w);
+          }
+          addr = w->free;
+          w->free += length + 1;
+        }
+        addr[0] = h;
+        for (k=1; k < length+1; k++) {
+          addr[k] = pp[k];
+        }
+        pp[1] = (object) addr;
+        __atomic_store_n (pp, (object) GC_SENTINEL, __ATOMIC_RELEASE);
+        if (length + 1 > GC_PAR_SMALL) {
+          gc_par_push (addr, addr + length + 1);
+        }
+        return addr;
+      }
+      // a failed CAS reloads <h>, go around again.
+    }
+  }
+}
+
+// the object following the one at <scan>.
+static
+object *
+gc_par_next (object * scan)
+{
+  if (IMMEDIATE (*scan)) {
+    return scan + 1;
+  } else {
+    return scan + GET_TUPLE_LENGTH (*scan) + 1;
+  }
+}
+
+// scan one object.  note: this can move the worker to a new chunk.
+static
+void
+gc_par_scan1 (gc_worker * w, object * scan)
+{
+  if (!IMMEDIATE (*scan)) {
+    object * p = scan + 1;
+    unsigned char tc = GET_TYPECODE (*scan);
+    irk_int length = GET_TUPLE_LENGTH (*scan);
+    irk_int i;
+
+    switch (tc) {
+
+    case TC_CLOSURE:
+      // closure = { tag, pc, lenv }
+      p++;				// skip pc
+      *p = gc_par_copy (w, p);		// lenv
+      break;
+
+    case TC_SAVE:
+      // save = { tag, next, lenv, pc, regs[...] }
+      *p = gc_par_copy (w, p); p++;	// next
+      *p = gc_par_copy (w, p); p++;	// lenv
+      p++;				// pc
+      for (i=3; i < length; i++) {
+        *p = gc_par_copy (w, p);
+        p++;
+      }
+      break;
+
+    case TC_STRING:
+    case TC_BUFFER:
+    case TC_FLOAT:
+    case TC_PACKED:
+      break;
+
+    case TC_FOREIGN:
+      if (length == 2) {
+        *p = gc_par_copy (w, p); p++;
+        *p = gc_par_copy (w, p); p++;
+      }
+      break;
+
+    default:
+      for (i=0; i < length; i++) {
+        *p = gc_par_copy (w, p); p++;
+      }
+      break;
+    }
+  }
+}
+
+static
+void *
+gc_par_work (void * arg)
+{
+  irk_int id = (irk_int) arg;
+  int nthreads = gc_threads;
+  gc_worker w;
+  int i, n = 0;
+
+  w.scan = w.free = w.end = NULL;
+  gc_par_refill (&w);
+
+  // each worker takes its share of the roots.
+  for (i = id; i < gc_par_nroots; i += nthreads) {
+    gc_par_roots[i] = (object) gc_par_copy (&w, (object *) &(gc_par_roots[i]));
+  }
+
+  while (1) {
+    if (w.scan < w.free) {
+      // step past the object first, in case scanning it moves us to
+      //   a new chunk.
+      object * ob = w.scan;
+      w.scan = gc_par_next (ob);
+      gc_par_scan1 (&w, ob);
+      // every so often, feed any idle workers.
+      if ((++n & 0xff) == 0
+          && __atomic_load_n (&gc_par_idle, __ATOMIC_RELAXED) > 0
+          && __atomic_load_n (&gc_par_stack_len, __ATOMIC_RELAXED) == 0) {
+        gc_par_push (w.scan, w.free);
+        w.scan = w.free;
+      }
+    } else {
+      gc_range r = {NULL, NULL};
+      pthread_mutex_lock (&gc_par_lock);
+      while (gc_par_stack_len == 0) {
+        gc_par_idle++;
+        if (gc_par_idle == nthreads) {
+          // everyone is out of work: we're done.
+          pthread_cond_broadcast (&gc_par_cond);
+          pthread_mutex_unlock (&gc_par_lock);
+          goto done;
+        }
+        pthread_cond_wait (&gc_par_cond, &gc_par_lock);
+        if (gc_par_idle == nthreads) {
+          pthread_mutex_unlock (&gc_par_lock);
+          goto done;
+        }
+        gc_par_idle--;
+      }
+      r = gc_par_stack[--gc_par_stack_len];
+      pthread_mutex_unlock (&gc_par_lock);
+      while (r.start < r.end) {
+        object * ob = r.start;
+        r.start = gc_par_next (ob);
+        gc_par_scan1 (&w, ob);
+      }
+    }
+  }
+ done:
+  // pad out our last chunk.
+  while (w.free < w.end) {
+    *(w.free)++ = IRK_NIL;
+  }
+  return NULL;
+}
+
+// copy everything reachable from the roots in heap1[0..nroots) into
+//   heap1, starting at <start>.  returns the new value of <freep>.
+static
+object *
+gc_parallel (int nroots, object * start)
+{
+  pthread_t threads[GC_PAR_MAX_THREADS];
+  int nthreads = gc_threads;
+  int i;
+
+  gc_par_top = start;
+  gc_par_limit = heap1 + heap1_size;
+  gc_par_roots = heap1;
+  gc_par_nroots = nroots;
+  gc_par_stack_len = 0;
+  gc_par_idle = 0;
+  for (i = 1; i < nthreads; i++) {
+    if (pthread_create (&threads[i], NULL, gc_par_work, (void *) (irk_int) i) != 0) {
+      fprintf (stderr, "unable to start gc thread\n");
+      abort();
+    }
+  }
+  gc_par_work ((void *) 0);
+  for (i = 1; i < nthreads; i++) {
+    pthread_join (threads[i], NULL);
+  }
+  return gc_par_top;
+}
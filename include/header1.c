@@ -14,6 +14,9 @@ typedef struct {
 static irk_prof prof_funs[];
 static int prof_current_fun;
 static int prof_num_funs;
+// emitted by the compiler, see include/heapprof.c
+static char * prof_tag_names[];
+static void hprof_census (object * start, object * end);
 #endif
 
 static int lookup_field (int tag, int label);
@@ -115,6 +118,10 @@ indent (int n)
 
 static void print_string (object * ob, int quoted);
 static void print_list (irk_pair * l);
+static double irk_unbox_float (object * ob);
+static void irk_float_repr (double x, char * buffer, size_t size);
+static void print_packed (irk_packed * p);
+static int magic_cmp_packed (irk_packed * a, irk_packed * b);
 
 // this is kinda lame, it's part pretty-printer, part not.
 static
@@ -238,6 +245,15 @@ dump_object (object * ob, int depth)
       case TC_SYMBOL:
 	print_string ((object*)ob[1], 0);
 	break;
+      case TC_FLOAT: {
+        char buffer[64];
+        irk_float_repr (irk_unbox_float (ob), buffer, sizeof (buffer));
+        fprintf (stdout, "%s", buffer);
+        break;
+      }
+      case TC_PACKED:
+        print_packed ((irk_packed *) ob);
+        break;
       default: {
         irk_vector * t = (irk_vector *) ob;
         irk_int n = get_tuple_size (ob);
@@ -327,6 +343,13 @@ magic_cmp (object * a, object * b)
       return magic_cmp_string ((irk_string *) a, (irk_string *) b);
     } else if (tca == TC_SYMBOL) {
       return magic_cmp_int ((irk_int)a[2],(irk_int)b[2]);
+    } else if (tca == TC_FLOAT) {
+      // NaN compares equal to everything.
+      double fa = irk_unbox_float (a);
+      double fb = irk_unbox_float (b);
+      return (fa < fb) ? -1 : ((fb < fa) ? +1 : 0);
+    } else if (tca == TC_PACKED) {
+      return magic_cmp_packed ((irk_packed *) a, (irk_packed *) b);
     } else {
       // tags are the same: do per-element comparison.
       // XXX check special internal types like TC_CLOSURE!
@@ -486,35 +509,6 @@ irk_get_vector_length (object * vec)
   }
 }
 
-static
-int
-read_header (FILE * file)
-{
-  int depth = 0;
-  // tiny lisp 'skipper' (as opposed to 'reader')
-  do {
-    char ch = fgetc (file);
-    switch (ch) {
-    case '(':
-      depth++;
-      break;
-    case ')':
-      depth--;
-      break;
-    case '"':
-      while (fgetc (file) != '"') {
-        // empty body
-      }
-      break;
-    default:
-      break;
-    }
-  } while (depth);
-  // read terminating newline
-  fgetc (file);
-  return 0;
-}
-
 #ifndef NO_RANGE_CHECK
 // used to check array references.  some day we might try to teach
 //   the compiler when/how to skip doing this...
@@ -629,11 +623,27 @@ varset (irk_int depth, irk_int index, object * val) {
   while (depth--) {
     lenv0 = (object*)lenv0[1];
   }
-  lenv0[index+2] = val;
+  IRK_STORE (lenv0[index+2], val);
 }
 
 #include "gc1.c"
 
+#ifdef IRK_PROFILE
+#include "heapprof.c"
+
+static inline
+void
+prof_alloc (irk_int tc, irk_int size)
+{
+  prof_funs[prof_current_fun].allocs++;
+  prof_funs[prof_current_fun].alloc_words += size;
+  hprof_countdown -= size + 1;
+  if (hprof_countdown <= 0) {
+    hprof_sample (tc, size);
+  }
+}
+#endif
+
 static object *
 allocate (irk_int tc, irk_int size)
 {
@@ -652,8 +662,7 @@ allocate (irk_int tc, irk_int size)
   freep += size + 1;
 #endif
 #ifdef IRK_PROFILE
-  prof_funs[prof_current_fun].allocs++;
-  prof_funs[prof_current_fun].alloc_words += size;
+  prof_alloc (tc, size);
 #endif
   return save;
 }
@@ -665,9 +674,33 @@ alloc_no_clear (irk_int tc, irk_int size)
   object * save = freep;
   *freep = (object*) (size<<8 | (tc & 0xff));
   freep += size + 1;
+#ifdef IRK_PROFILE
+  prof_alloc (tc, size);
+#endif
   return save;
 }
 
+// strings and buffers: big ones go to the large object space.
+static object *
+alloc_bytes (irk_int tc, irk_int size)
+{
+  if ((size_t) size >= los_threshold) {
+#ifdef IRK_PROFILE
+    prof_alloc (tc, size);
+#endif
+    return los_alloc (tc, size);
+  } else {
+    return alloc_no_clear (tc, size);
+  }
+}
+
+// the heap space needed by alloc_bytes().
+static inline irk_int
+heap_words_for (irk_int size)
+{
+  return ((size_t) size >= los_threshold) ? 0 : size;
+}
+
 object *
 make_vector (irk_int size, object * val)
 {
@@ -701,13 +734,20 @@ make_malloc (irk_int size, irk_int count)
 object *
 make_halloc (irk_int size, irk_int count)
 {
-  object * buffer = alloc_no_clear (TC_BUFFER, HOW_MANY (size * count, sizeof(object)));
+  object * buffer = alloc_bytes (TC_BUFFER, HOW_MANY (size * count, sizeof(object)));
   object * result = allocate (TC_FOREIGN, 2);
   result[1] = buffer;
   result[2] = box(0);
   return result;
 }
 
+// %callocate for the LLVM backend (the C backend calls alloc_bytes() inline).
+object *
+irk_callocate (irk_int size, irk_int count)
+{
+  return alloc_bytes (TC_BUFFER, HOW_MANY (size * count, sizeof (object)));
+}
+
 void *
 get_foreign (object * ob)
 {
@@ -794,30 +834,42 @@ irk_get_errno (void)
   return TAG_INTEGER ((irk_int) errno);
 }
 
-#define LOOKUP_FIELD(rec,label) lookup_field ((GET_TYPECODE(*rec)-TC_USEROBJ)>>2,label)
+// each site that looks up a field at run-time has one of these, keyed
+//  on the last record tag seen there.  row-polymorphic code usually
+//  sees the same record type again, so this is a compare instead of
+//  two rounds of p_hash.
+typedef struct {
+  irk_int tag;
+  irk_int index;
+} irk_field_cache;
+
+static
+inline
+irk_int
+lookup_field_cached (object * rec, irk_int label, irk_field_cache * cache)
+{
+  irk_int tag = (GET_TYPECODE(*rec)-TC_USEROBJ)>>2;
+  if (cache->tag != tag) {
+    cache->index = lookup_field (tag, label);
+    cache->tag = tag;
+  }
+  return cache->index;
+}
+
+#define LOOKUP_FIELD(rec,label,cache) lookup_field_cached (rec,label,&cache)
 
 // used to lookup record elements when the index
 //  cannot be computed at compile-time.
 object *
-record_fetch (object * rec, irk_int label)
+record_fetch (object * rec, irk_int label, irk_field_cache * cache)
 {
-  return ((irk_vector*)rec)->val[
-    lookup_field (
-      (GET_TYPECODE(*rec)-TC_USEROBJ)>>2,
-      label
-    )
-  ];
+  return ((irk_vector*)rec)->val[lookup_field_cached (rec, label, cache)];
 }
 
 void
-record_store (object * rec, irk_int label, object * val)
+record_store (object * rec, irk_int label, irk_field_cache * cache, object * val)
 {
-  ((irk_vector*)rec)->val[
-    lookup_field (
-      (GET_TYPECODE(*rec)-TC_USEROBJ)>>2,
-      label
-    )
-  ] = val;
+  IRK_STORE (((irk_vector*)rec)->val[lookup_field_cached (rec, label, cache)], val);
 }
 
 void
@@ -917,6 +969,9 @@ void exit_continuation (object * result)
   }
 #endif
   prof_dump();
+#ifdef IRK_PROFILE
+  hprof_finish();
+#endif
   if (is_int (result)) {
     exit ((int)(intptr_t)UNTAG_INTEGER(result));
   } else {
@@ -962,7 +1017,7 @@ static
 object *
 make_string (irk_int len)
 {
-  irk_string * result = (irk_string *) allocate (TC_STRING, STRING_TUPLE_LENGTH (len));
+  irk_string * result = (irk_string *) alloc_bytes (TC_STRING, STRING_TUPLE_LENGTH (len));
   result->len = len;
   return (object *) result;
 }
@@ -983,7 +1038,7 @@ invoke_closure (object * closure, object * args)
   t[2] = lenv;
   t[3] = (object *) invoke_closure_1; // see below
   k = t;
-  args[1] = closure[2];
+  IRK_STORE (args[1], closure[2]);
   lenv = args;
   ((kfun)(closure[1]))();
   return result;
@@ -1006,7 +1061,7 @@ object *
 irk_copy_string (char * s)
 {
   int slen = strlen (s);
-  irk_string * r = (irk_string *) alloc_no_clear (TC_STRING, string_tuple_length (slen));
+  irk_string * r = (irk_string *) alloc_bytes (TC_STRING, string_tuple_length (slen));
   r->len = slen;
   memcpy (GET_STRING_POINTER (r), s, slen);
   return (object *) r;
@@ -1050,11 +1105,47 @@ irk_set_verbose_gc (object * data)
   return (object*) r;
 }
 
+// the counters as a vector of ints, in the order expected by gc-stats
+//   in lib/core.scm.
+object *
+irk_gc_stats (void)
+{
+  uint64_t now = gc_usecs();
+  uint64_t mutator = now - gc_stats.start_usecs - gc_stats.pause_usecs;
+  uint64_t allocated = gc_stats.words_allocated + (freep - gc_alloc_mark);
+  uint64_t in_use = gc_words_in_use();
+  object * r = allocate (TC_VECTOR, 10);
+  r[1] = box (gc_stats.collections);
+  r[2] = box (gc_stats.minor_collections);
+  r[3] = box (allocated);
+  r[4] = box (gc_stats.words_copied);
+  // percent of the heap that survived the last collection
+  r[5] = box (gc_stats.in_use_before ? (gc_stats.in_use_after * 100) / gc_stats.in_use_before : 0);
+  // words allocated per second of mutator time
+  r[6] = box (mutator ? (allocated * 1000000) / mutator : 0);
+  r[7] = box ((in_use > gc_stats.peak_in_use) ? in_use : gc_stats.peak_in_use);
+  r[8] = box (gc_stats.pause_usecs);
+  r[9] = box (gc_stats.max_pause_usecs);
+  r[10] = box (now - gc_stats.start_usecs);
+  return r;
+}
+
+// the pause time histogram, see gc_stats_t in gc1.c.
+object *
+irk_gc_pauses (void)
+{
+  object * r = allocate (TC_VECTOR, GC_PAUSE_BUCKETS);
+  for (int i = 0; i < GC_PAUSE_BUCKETS; i++) {
+    r[i+1] = box (gc_stats.pauses[i]);
+  }
+  return r;
+}
+
 object *
 irk_make_string (object * len)
 {
   irk_int len0 = unbox(len);
-  irk_string * r = (irk_string*) alloc_no_clear (TC_STRING, string_tuple_length (len0));
+  irk_string * r = (irk_string*) alloc_bytes (TC_STRING, string_tuple_length (len0));
   r->len = len0;
   return (object *) r;
 }
@@ -1065,6 +1156,173 @@ irk_string_cmp (irk_string * a, irk_string * b)
   return (object*) UITAG (1 + magic_cmp_string (a, b));
 }
 
+// 32-bit FNV-1a over s[start:start+len], see string-hash in lib/string.scm.
+irk_int
+irk_slice_hash (irk_string * s, irk_int start, irk_int len)
+{
+  uint32_t h = 2166136261u;
+  for (irk_int i = start; i < start + len; i++) {
+    h = (h ^ (uint8_t) s->data[i]) * 16777619u;
+  }
+  return (irk_int) h;
+}
+
+irk_int
+irk_string_hash (irk_string * s)
+{
+  return irk_slice_hash (s, 0, s->len);
+}
+
+// compare two string slices (see lib/strslice.scm), same order as irk_string_cmp.
+object *
+irk_slice_cmp (irk_string * a, irk_int a0, irk_int alen, irk_string * b, irk_int b0, irk_int blen)
+{
+  int cmp = memcmp (a->data + a0, b->data + b0, min_int (alen, blen));
+  if (cmp == 0) {
+    return (object*) UITAG (1 + magic_cmp_int (alen, blen));
+  } else {
+    return (object*) UITAG ((irk_int) (cmp < 0 ? 0 : 2));
+  }
+}
+
+// --------------------------------------------------------------------------------
+// string search, used by lib/string.scm.
+//
+// each of these searches s->data[start:end] and returns an index into
+//   s, or -1.  byte and substring search lean on memchr, which libc
+//   already vectorizes.  the byte-set scan has SSE2 and AVX2 versions,
+//   irk_simd_init() picks one at startup.
+
+irk_int
+irk_find_byte (irk_string * s, irk_int start, irk_int end, irk_int ch)
+{
+  uint8_t * base = (uint8_t *) s->data;
+  uint8_t * p = memchr (base + start, (int) ch, end - start);
+  return p ? (irk_int) (p - base) : -1;
+}
+
+// find <needle> in s[start:end]: memchr for its first byte, then memcmp the rest.
+irk_int
+irk_find_bytes (irk_string * needle, irk_string * s, irk_int start, irk_int end)
+{
+  irk_int n = needle->len;
+  irk_int last = end - n;
+  uint8_t * base = (uint8_t *) s->data;
+  if (n == 0) {
+    return start;
+  }
+  for (irk_int i = start; i <= last; i++) {
+    uint8_t * p = memchr (base + i, needle->data[0], last - i + 1);
+    if (!p) {
+      break;
+    }
+    i = p - base;
+    if (memcmp (p + 1, needle->data + 1, n - 1) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+typedef irk_int (*irk_byteset_fun) (const uint8_t *, irk_int, irk_int, const uint8_t *, irk_int);
+
+static irk_int
+irk_find_byteset_scalar (const uint8_t * set, irk_int nset, irk_int i, const uint8_t * p, irk_int end)
+{
+  uint8_t map[256] = {0};
+  for (irk_int j = 0; j < nset; j++) {
+    map[set[j]] = 1;
+  }
+  for (; i < end; i++) {
+    if (map[p[i]]) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+
+// the vector versions compare each block against every member of the
+//   set, so they're only used for small sets (delimiters, CR/LF, ...).
+#define IRK_BYTESET_SIMD_MAX 8
+
+static irk_int
+irk_find_byteset_sse2 (const uint8_t * set, irk_int nset, irk_int i, const uint8_t * p, irk_int end)
+{
+  if (nset > IRK_BYTESET_SIMD_MAX) {
+    return irk_find_byteset_scalar (set, nset, i, p, end);
+  }
+  __m128i members[IRK_BYTESET_SIMD_MAX];
+  for (irk_int j = 0; j < nset; j++) {
+    members[j] = _mm_set1_epi8 ((char) set[j]);
+  }
+  for (; i + 16 <= end; i += 16) {
+    __m128i block = _mm_loadu_si128 ((const __m128i *) (p + i));
+    __m128i hits = _mm_setzero_si128();
+    for (irk_int j = 0; j < nset; j++) {
+      hits = _mm_or_si128 (hits, _mm_cmpeq_epi8 (block, members[j]));
+    }
+    int mask = _mm_movemask_epi8 (hits);
+    if (mask) {
+      return i + __builtin_ctz (mask);
+    }
+  }
+  return irk_find_byteset_scalar (set, nset, i, p, end);
+}
+
+__attribute__((target("avx2")))
+static irk_int
+irk_find_byteset_avx2 (const uint8_t * set, irk_int nset, irk_int i, const uint8_t * p, irk_int end)
+{
+  if (nset > IRK_BYTESET_SIMD_MAX) {
+    return irk_find_byteset_scalar (set, nset, i, p, end);
+  }
+  __m256i members[IRK_BYTESET_SIMD_MAX];
+  for (irk_int j = 0; j < nset; j++) {
+    members[j] = _mm256_set1_epi8 ((char) set[j]);
+  }
+  for (; i + 32 <= end; i += 32) {
+    __m256i block = _mm256_loadu_si256 ((const __m256i *) (p + i));
+    __m256i hits = _mm256_setzero_si256();
+    for (irk_int j = 0; j < nset; j++) {
+      hits = _mm256_or_si256 (hits, _mm256_cmpeq_epi8 (block, members[j]));
+    }
+    unsigned mask = (unsigned) _mm256_movemask_epi8 (hits);
+    if (mask) {
+      return i + __builtin_ctz (mask);
+    }
+  }
+  return irk_find_byteset_sse2 (set, nset, i, p, end);
+}
+
+static irk_byteset_fun irk_find_byteset_impl = irk_find_byteset_sse2;
+
+void
+irk_simd_init (void)
+{
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports ("avx2")) {
+    irk_find_byteset_impl = irk_find_byteset_avx2;
+  }
+}
+#else
+static irk_byteset_fun irk_find_byteset_impl = irk_find_byteset_scalar;
+
+void
+irk_simd_init (void)
+{
+}
+#endif
+
+// find any byte of <set> in s[start:end].
+irk_int
+irk_find_byteset (irk_string * set, irk_string * s, irk_int start, irk_int end)
+{
+  return irk_find_byteset_impl ((uint8_t *) set->data, set->len, start, (uint8_t *) s->data, end);
+}
+
 // --------------------------------------------------------------------------------
 
 // used by bignum.scm
@@ -1136,6 +1394,696 @@ irk_div2b1 (irk_int ah, irk_int al, irk_int b, object * rvo)
 
 #endif
 
+// the digit kernels below work on the digit vectors of bignum.scm:
+//   limbs of <bits> bits (big/bits, at most 60, or 28 on 32-bit),
+//   most significant first.  they never allocate on the heap (scratch
+//   space is malloc'd), and write into a vector supplied by the caller.
+//   any of them may be #(), the (immediate) empty vector.
+
+#ifdef __LP64__
+typedef __uint128_t irk_dword;
+#else
+typedef uint64_t irk_dword;
+#endif
+
+#define DIGIT_MASK(bits) ((((uint64_t)1)<<(bits))-1)
+
+// limb <i> of <v>, counting from the least significant.
+#define DIGIT(v, n, i) ((uint64_t) UNTAG_INTEGER (((irk_vector *)(v))->val[(n)-1-(i)]))
+
+static
+uint64_t *
+digits_alloc (irk_int n)
+{
+  uint64_t * r = (uint64_t *) calloc (n, sizeof (uint64_t));
+  if (!r && n > 0) {
+    fprintf (stderr, "unable to allocate bignum scratch space\n");
+    abort();
+  }
+  return r;
+}
+
+static
+uint64_t *
+digits_load (object * v, irk_int n)
+{
+  uint64_t * r = digits_alloc (n);
+  for (irk_int i = 0; i < n; i++) {
+    r[i] = DIGIT (v, n, i);
+  }
+  return r;
+}
+
+static
+void
+digits_store (object * v, uint64_t * src, irk_int n)
+{
+  irk_vector * rv = (irk_vector *) v;
+  for (irk_int i = 0; i < n; i++) {
+    rv->val[n-1-i] = box ((irk_int) src[i]);
+  }
+}
+
+// schoolbook multiply: r := a * b, where |r| = |a| + |b|.
+object *
+irk_digits_mul (object * a, object * b, object * r, irk_int bits)
+{
+  irk_int alen = irk_get_vector_length (a);
+  irk_int blen = irk_get_vector_length (b);
+  irk_int rlen = alen + blen;
+  uint64_t * A = digits_load (a, alen);
+  uint64_t * R = digits_alloc (rlen);
+  for (irk_int j = 0; j < blen; j++) {
+    uint64_t bj = DIGIT (b, blen, j);
+    uint64_t carry = 0;
+    for (irk_int i = 0; i < alen; i++) {
+      irk_dword t = ((irk_dword) A[i]) * bj + R[i+j] + carry;
+      R[i+j] = (uint64_t) t & DIGIT_MASK (bits);
+      carry = (uint64_t) (t >> bits);
+    }
+    R[j+alen] = carry;
+  }
+  digits_store (r, R, rlen);
+  free (A);
+  free (R);
+  return (object *) IRK_UNDEFINED;
+}
+
+// a >= m?  (a has n+1 limbs, m has n)
+static
+int
+digits_ge (uint64_t * a, uint64_t * m, irk_int n)
+{
+  if (a[n]) {
+    return 1;
+  }
+  for (irk_int i = n - 1; i >= 0; i--) {
+    if (a[i] != m[i]) {
+      return a[i] > m[i];
+    }
+  }
+  return 1;
+}
+
+// a -= m (a has n+1 limbs, m has n)
+static
+void
+digits_sub_in_place (uint64_t * a, uint64_t * m, irk_int n, int bits)
+{
+  uint64_t borrow = 0;
+  for (irk_int i = 0; i < n; i++) {
+    uint64_t d = a[i] - m[i] - borrow;
+    borrow = d >> 63;
+    a[i] = d & DIGIT_MASK (bits);
+  }
+  a[n] -= borrow;
+}
+
+// a := 2a mod m, for a < m.
+static
+void
+digits_double_mod (uint64_t * a, uint64_t * m, irk_int n, int bits)
+{
+  uint64_t carry = 0;
+  for (irk_int i = 0; i < n; i++) {
+    uint64_t d = (a[i] << 1) | carry;
+    carry = d >> bits;
+    a[i] = d & DIGIT_MASK (bits);
+  }
+  a[n] = carry;
+  if (digits_ge (a, m, n)) {
+    digits_sub_in_place (a, m, n, bits);
+  }
+}
+
+// Montgomery multiplication (CIOS): d := a * b / R mod m, where R is
+//   2^(bits*n).  <t> is scratch space of n+2 limbs, <m0i> is -1/m mod 2^bits.
+static
+void
+digits_montymul (uint64_t * d, uint64_t * a, uint64_t * b, uint64_t * m, uint64_t m0i, uint64_t * t, irk_int n, int bits)
+{
+  memset (t, 0, (n + 2) * sizeof (uint64_t));
+  for (irk_int i = 0; i < n; i++) {
+    uint64_t c = 0;
+    irk_dword s;
+    for (irk_int j = 0; j < n; j++) {
+      s = ((irk_dword) a[j]) * b[i] + t[j] + c;
+      t[j] = (uint64_t) s & DIGIT_MASK (bits);
+      c = (uint64_t) (s >> bits);
+    }
+    s = (irk_dword) t[n] + c;
+    t[n] = (uint64_t) s & DIGIT_MASK (bits);
+    t[n+1] = (uint64_t) (s >> bits);
+    uint64_t mu = (t[0] * m0i) & DIGIT_MASK (bits);
+    s = ((irk_dword) mu) * m[0] + t[0];
+    c = (uint64_t) (s >> bits);
+    for (irk_int j = 1; j < n; j++) {
+      s = ((irk_dword) mu) * m[j] + t[j] + c;
+      t[j-1] = (uint64_t) s & DIGIT_MASK (bits);
+      c = (uint64_t) (s >> bits);
+    }
+    s = (irk_dword) t[n] + c;
+    t[n-1] = (uint64_t) s & DIGIT_MASK (bits);
+    t[n] = t[n+1] + (uint64_t) (s >> bits);
+  }
+  if (digits_ge (t, m, n)) {
+    digits_sub_in_place (t, m, n, bits);
+  }
+  memcpy (d, t, n * sizeof (uint64_t));
+}
+
+// r := b^e mod m, for odd m and b < m.  |r| = |m|.
+//   this is not constant-time, see the i31 functions below for that.
+object *
+irk_digits_exp_mod (object * b, object * e, object * m, object * r, irk_int bits)
+{
+  irk_int n = GET_TUPLE_LENGTH (*m);
+  irk_int blen = irk_get_vector_length (b);
+  irk_int elen = irk_get_vector_length (e);
+  uint64_t * M = digits_load (m, n);
+  uint64_t * x = digits_alloc (n + 1);  // b, in Montgomery form
+  uint64_t * acc = digits_alloc (n + 1); // 1, in Montgomery form
+  uint64_t * t = digits_alloc (n + 2);
+  uint64_t m0i = M[0];
+  // Newton's iteration, each step doubles the number of correct bits.
+  for (int i = 0; i < 6; i++) {
+    m0i *= 2 - (M[0] * m0i);
+  }
+  m0i = (-m0i) & DIGIT_MASK (bits);
+  for (irk_int i = 0; i < blen; i++) {
+    x[i] = DIGIT (b, blen, i);
+  }
+  acc[0] = 1;
+  for (irk_int i = 0; i < n * bits; i++) {
+    digits_double_mod (x, M, n, bits);
+    digits_double_mod (acc, M, n, bits);
+  }
+  // left-to-right binary exponentiation.
+  for (irk_int i = elen - 1; i >= 0; i--) {
+    uint64_t ei = DIGIT (e, elen, i);
+    for (int k = bits - 1; k >= 0; k--) {
+      digits_montymul (acc, acc, acc, M, m0i, t, n, bits);
+      if ((ei >> k) & 1) {
+        digits_montymul (acc, acc, x, M, m0i, t, n, bits);
+      }
+    }
+  }
+  // out of Montgomery form.
+  memset (x, 0, (n + 1) * sizeof (uint64_t));
+  x[0] = 1;
+  digits_montymul (acc, acc, x, M, m0i, t, n, bits);
+  digits_store (r, acc, n);
+  free (M);
+  free (x);
+  free (acc);
+  free (t);
+  return (object *) IRK_UNDEFINED;
+}
+
+// constant-time kernels for ctbig.scm: BearSSL's i31 code, on the
+//   vectors used there (element 0 is the encoded bit length, then
+//   31-bit words, least significant first).  Like the digit kernels
+//   above, these copy their arguments to uint32_t arrays and back.
+
+#define I31_MUX(ctl, x, y) ((y) ^ (-(ctl) & ((x) ^ (y))))
+#define I31_NEQ(x, y) ((((x) ^ (y)) | (-((x) ^ (y)))) >> 31)
+
+static
+uint32_t *
+i31_load (object * v)
+{
+  irk_int n = GET_TUPLE_LENGTH (*v);
+  uint32_t * r = (uint32_t *) malloc (n * sizeof (uint32_t));
+  if (!r) {
+    fprintf (stderr, "unable to allocate i31 scratch space\n");
+    abort();
+  }
+  for (irk_int i = 0; i < n; i++) {
+    r[i] = (uint32_t) UNTAG_INTEGER (((irk_vector *) v)->val[i]);
+  }
+  return r;
+}
+
+static
+void
+i31_store (object * v, uint32_t * src)
+{
+  irk_int n = GET_TUPLE_LENGTH (*v);
+  for (irk_int i = 0; i < n; i++) {
+    ((irk_vector *) v)->val[i] = box ((irk_int) src[i]);
+  }
+}
+
+static
+uint32_t
+i31_sub (uint32_t * a, const uint32_t * b, uint32_t ctl)
+{
+  uint32_t cc = 0;
+  size_t m = (a[0] + 63) >> 5;
+  for (size_t u = 1; u < m; u++) {
+    uint32_t aw = a[u];
+    uint32_t naw = aw - b[u] - cc;
+    cc = naw >> 31;
+    a[u] = I31_MUX (ctl, naw & 0x7FFFFFFF, aw);
+  }
+  return cc;
+}
+
+static
+void
+i31_montymul (uint32_t * d, const uint32_t * x, const uint32_t * y, const uint32_t * m, uint32_t m0i)
+{
+  size_t len = (m[0] + 31) >> 5;
+  uint64_t dh = 0;
+  memset (d + 1, 0, len * sizeof (uint32_t));
+  for (size_t u = 0; u < len; u++) {
+    uint32_t xu = x[u + 1];
+    uint32_t f = ((d[1] + xu * y[1]) * m0i) & 0x7FFFFFFF;
+    uint64_t r = 0;
+    for (size_t v = 0; v < len; v++) {
+      uint64_t z = (uint64_t) d[v + 1] + ((uint64_t) xu * y[v + 1]) + ((uint64_t) f * m[v + 1]) + r;
+      r = z >> 31;
+      d[v] = (uint32_t) z & 0x7FFFFFFF;
+    }
+    uint64_t zh = dh + r;
+    d[len] = (uint32_t) zh & 0x7FFFFFFF;
+    dh = zh >> 31;
+  }
+  d[0] = m[0];
+  i31_sub (d, m, I31_NEQ ((uint32_t) dh, 0) | (1 ^ i31_sub (d, m, 0)));
+}
+
+// d := x * y / R mod m
+object *
+irk_i31_montymul (object * d, object * x, object * y, object * m, irk_int m0i)
+{
+  uint32_t * d0 = i31_load (d);
+  uint32_t * x0 = i31_load (x);
+  uint32_t * y0 = i31_load (y);
+  uint32_t * m0 = i31_load (m);
+  i31_montymul (d0, x0, y0, m0, (uint32_t) m0i);
+  i31_store (d, d0);
+  free (d0); free (x0); free (y0); free (m0);
+  return (object *) IRK_UNDEFINED;
+}
+
+// the loop of br_i31_modpow(): x := t1^e mod m, where <t1> is already
+//   in Montgomery form and <e> is a big-endian string of <elen> bytes.
+//   the squaring works on malloc'd copies, so <t1> is only read: unlike
+//   the Irken loop in ctbig.scm, this leaves <t1> unchanged and has no
+//   <t2>.  i31/rsa-crt treats both as scratch, so this doesn't matter there.
+object *
+irk_i31_modpow (object * x, object * t1, irk_string * e, irk_int elen, object * m, irk_int m0i)
+{
+  uint32_t * m0 = i31_load (m);
+  uint32_t * x0 = i31_load (x);
+  uint32_t * t10 = i31_load (t1);
+  uint32_t * t20 = i31_load (t1); // just for the size
+  size_t mlen = (m0[0] + 63) >> 5; // in words
+  x0[0] = m0[0];
+  memset (x0 + 1, 0, (mlen - 1) * sizeof (uint32_t));
+  x0[1] = 1;
+  for (uint32_t k = 0; k < ((uint32_t) elen << 3); k++) {
+    uint32_t ctl = (((uint8_t) e->data[elen - 1 - (k >> 3)]) >> (k & 7)) & 1;
+    i31_montymul (t20, x0, t10, m0, (uint32_t) m0i);
+    for (size_t i = 0; i < mlen; i++) {
+      x0[i] = I31_MUX (ctl, t20[i], x0[i]);
+    }
+    i31_montymul (t20, t10, t10, m0, (uint32_t) m0i);
+    memcpy (t10, t20, mlen * sizeof (uint32_t));
+  }
+  i31_store (x, x0);
+  free (m0); free (x0); free (t10); free (t20);
+  return (object *) IRK_UNDEFINED;
+}
+
+// --------------------------------------------------------------------------------
+
+// used by float.scm
+//
+// a float is a boxed double.  The C backend works on the doubles
+//   directly (and keeps intermediate results unboxed, see
+//   fuse-float-cexps in analyze.scm), the LLVM backend and the VM
+//   call the irk_float_* functions below.
+
+static
+object *
+irk_box_float (double x)
+{
+  object * r = alloc_no_clear (TC_FLOAT, HOW_MANY (sizeof (double), sizeof (object)));
+  memcpy (r + 1, &x, sizeof (double));
+  return r;
+}
+
+static
+double
+irk_unbox_float (object * ob)
+{
+  double x;
+  memcpy (&x, ob + 1, sizeof (double));
+  return x;
+}
+
+// the shortest representation that reads back as the same double,
+//   always with a '.' or an exponent so that it reads back as a float.
+static
+void
+irk_float_repr (double x, char * buffer, size_t size)
+{
+  int prec;
+  if (isnan (x)) {
+    snprintf (buffer, size, "+nan.0");
+  } else if (isinf (x)) {
+    snprintf (buffer, size, (x < 0) ? "-inf.0" : "+inf.0");
+  } else {
+    for (prec = 1; prec <= 17; prec++) {
+      snprintf (buffer, size, "%.*g", prec, x);
+      if (strtod (buffer, NULL) == x) {
+        break;
+      }
+    }
+    if (!strpbrk (buffer, ".e")) {
+      strncat (buffer, ".0", size - strlen (buffer) - 1);
+    }
+  }
+}
+
+static
+object *
+irk_float_2_string (double x)
+{
+  char buffer[64];
+  irk_float_repr (x, buffer, sizeof (buffer));
+  return irk_copy_string (buffer);
+}
+
+// parse all of <s> as a float (the syntax is strtod's).
+static
+int
+irk_parse_float (irk_string * s, double * result)
+{
+  char * text = (char *) malloc (s->len + 1);
+  char * end;
+  int ok;
+  if (!text) {
+    fprintf (stderr, "unable to allocate float text\n");
+    abort();
+  }
+  memcpy (text, s->data, s->len);
+  text[s->len] = 0;
+  *result = strtod (text, &end);
+  ok = (s->len > 0) && !isspace ((unsigned char) text[0]) && (*end == 0);
+  free (text);
+  return ok;
+}
+
+static
+int
+irk_string_is_float (irk_string * s)
+{
+  double x;
+  return irk_parse_float (s, &x);
+}
+
+static
+double
+irk_string_2_float (irk_string * s)
+{
+  double x;
+  return irk_parse_float (s, &x) ? x : NAN;
+}
+
+// op: 0:+ 1:- 2:* 3:/ 4:pow 5:atan2 6:fmod
+object *
+irk_float_op2 (object * op, object * a, object * b)
+{
+  double x = irk_unbox_float (a);
+  double y = irk_unbox_float (b);
+  double r;
+  switch (UNTAG_INTEGER (op)) {
+  case 0: r = x + y; break;
+  case 1: r = x - y; break;
+  case 2: r = x * y; break;
+  case 3: r = x / y; break;
+  case 4: r = pow (x, y); break;
+  case 5: r = atan2 (x, y); break;
+  case 6: r = fmod (x, y); break;
+  default: r = NAN; break;
+  }
+  return irk_box_float (r);
+}
+
+// op: 0:negate 1:abs 2:sqrt 3:floor 4:ceil 5:exp 6:log 7:sin 8:cos 9:tan 10:atan
+object *
+irk_float_op1 (object * op, object * a)
+{
+  double x = irk_unbox_float (a);
+  double r;
+  switch (UNTAG_INTEGER (op)) {
+  case 0: r = -x; break;
+  case 1: r = fabs (x); break;
+  case 2: r = sqrt (x); break;
+  case 3: r = floor (x); break;
+  case 4: r = ceil (x); break;
+  case 5: r = exp (x); break;
+  case 6: r = log (x); break;
+  case 7: r = sin (x); break;
+  case 8: r = cos (x); break;
+  case 9: r = tan (x); break;
+  case 10: r = atan (x); break;
+  default: r = NAN; break;
+  }
+  return irk_box_float (r);
+}
+
+// op: 0:= 1:< 2:<= 3:> 4:>=
+object *
+irk_float_cmp (object * op, object * a, object * b)
+{
+  double x = irk_unbox_float (a);
+  double y = irk_unbox_float (b);
+  switch (UNTAG_INTEGER (op)) {
+  case 0: return IRK_TEST (x == y);
+  case 1: return IRK_TEST (x < y);
+  case 2: return IRK_TEST (x <= y);
+  case 3: return IRK_TEST (x > y);
+  case 4: return IRK_TEST (x >= y);
+  default: return IRK_FALSE;
+  }
+}
+
+// op: 0:int->float 1:float->int 2:float->string 3:string->float
+//     4:string holds a float?
+object *
+irk_float_conv (object * op, object * a)
+{
+  switch (UNTAG_INTEGER (op)) {
+  case 0: return irk_box_float ((double) UNTAG_INTEGER (a));
+  case 1: return TAG_INTEGER ((irk_int) irk_unbox_float (a));
+  case 2: return irk_float_2_string (irk_unbox_float (a));
+  case 3: return irk_box_float (irk_string_2_float ((irk_string *) a));
+  case 4: return IRK_TEST (irk_string_is_float ((irk_string *) a));
+  default: return IRK_UNDEFINED;
+  }
+}
+
+// --------------------------------------------------------------------------------
+
+// used by packed.scm
+//
+// packed arrays hold unboxed u8/i32/i64/f64 elements.  Range checks
+//   are done in packed.scm, these functions trust their arguments.
+//   The C backend indexes the data directly, the VM and the LLVM
+//   backend call the irk_packed_* functions taking objects.
+
+// element sizes, by kind
+static const int irk_packed_sizes[] = {1, 4, 8, 8};
+
+static
+irk_int
+packed_tuple_length (irk_int kind, irk_int n)
+{
+  return HOW_MANY ((2 * sizeof (uint32_t)) + (n * irk_packed_sizes[kind]), sizeof (object));
+}
+
+// zero-filled.
+static
+object *
+make_packed (irk_int kind, irk_int n)
+{
+  irk_packed * r = (irk_packed *) alloc_bytes (TC_PACKED, packed_tuple_length (kind, n));
+  r->len = n;
+  r->kind = kind;
+  memset (r->data, 0, n * irk_packed_sizes[kind]);
+  return (object *) r;
+}
+
+static
+double
+irk_packed_get_float (irk_packed * p, irk_int i)
+{
+  return IRK_PACKED_DATA (p, double)[i];
+}
+
+// the element as an int, or as a double for f64.
+static
+irk_int
+irk_packed_get_int (irk_packed * p, irk_int i)
+{
+  switch (p->kind) {
+  case IRK_PACKED_U8:  return IRK_PACKED_DATA (p, uint8_t)[i];
+  case IRK_PACKED_I32: return IRK_PACKED_DATA (p, int32_t)[i];
+  case IRK_PACKED_I64: return IRK_PACKED_DATA (p, int64_t)[i];
+  default:             return 0;
+  }
+}
+
+static
+void
+irk_packed_put_int (irk_packed * p, irk_int i, irk_int v)
+{
+  switch (p->kind) {
+  case IRK_PACKED_U8:  IRK_PACKED_DATA (p, uint8_t)[i] = (uint8_t) v; break;
+  case IRK_PACKED_I32: IRK_PACKED_DATA (p, int32_t)[i] = (int32_t) v; break;
+  case IRK_PACKED_I64: IRK_PACKED_DATA (p, int64_t)[i] = (int64_t) v; break;
+  }
+}
+
+static
+void
+irk_packed_fill_int (irk_packed * p, irk_int start, irk_int n, irk_int v)
+{
+  if (p->kind == IRK_PACKED_U8) {
+    memset (IRK_PACKED_DATA (p, uint8_t) + start, (uint8_t) v, n);
+  } else {
+    for (irk_int i = start; i < start + n; i++) {
+      irk_packed_put_int (p, i, v);
+    }
+  }
+}
+
+static
+void
+irk_packed_fill_float (irk_packed * p, irk_int start, irk_int n, double v)
+{
+  double * data = IRK_PACKED_DATA (p, double);
+  for (irk_int i = start; i < start + n; i++) {
+    data[i] = v;
+  }
+}
+
+// <src> and <dst> may overlap.
+static
+void
+irk_packed_copy_raw (irk_packed * src, irk_int sstart, irk_int n, irk_packed * dst, irk_int dstart)
+{
+  int size = irk_packed_sizes[src->kind];
+  memmove (IRK_PACKED_DATA (dst, uint8_t) + (dstart * size),
+           IRK_PACKED_DATA (src, uint8_t) + (sstart * size),
+           n * size);
+}
+
+static
+int
+magic_cmp_packed (irk_packed * a, irk_packed * b)
+{
+  if (a->kind != b->kind) {
+    return magic_cmp_int (a->kind, b->kind);
+  }
+  for (irk_int i = 0; i < min_int (a->len, b->len); i++) {
+    if (a->kind == IRK_PACKED_F64) {
+      double x = irk_packed_get_float (a, i);
+      double y = irk_packed_get_float (b, i);
+      if (x != y) {
+        return (x < y) ? -1 : +1;
+      }
+    } else {
+      irk_int x = irk_packed_get_int (a, i);
+      irk_int y = irk_packed_get_int (b, i);
+      if (x != y) {
+        return magic_cmp_int (x, y);
+      }
+    }
+  }
+  return magic_cmp_int (a->len, b->len);
+}
+
+static
+void
+print_packed (irk_packed * p)
+{
+  static const char * names[] = {"u8", "i32", "i64", "f64"};
+  char buffer[64];
+  fprintf (stdout, "#%s(", names[p->kind]);
+  for (irk_int i = 0; i < p->len; i++) {
+    if (p->kind == IRK_PACKED_F64) {
+      irk_float_repr (irk_packed_get_float (p, i), buffer, sizeof (buffer));
+      fprintf (stdout, "%s", buffer);
+    } else {
+      fprintf (stdout, "%" PRIdPTR, irk_packed_get_int (p, i));
+    }
+    if (i < p->len - 1) {
+      fprintf (stdout, " ");
+    }
+  }
+  fprintf (stdout, ")");
+}
+
+object *
+irk_packed_make (object * kind, object * n)
+{
+  return make_packed (UNTAG_INTEGER (kind), UNTAG_INTEGER (n));
+}
+
+object *
+irk_packed_len (object * a)
+{
+  return TAG_INTEGER ((irk_int) ((irk_packed *) a)->len);
+}
+
+object *
+irk_packed_ref (object * a, object * i)
+{
+  irk_packed * p = (irk_packed *) a;
+  if (p->kind == IRK_PACKED_F64) {
+    return irk_box_float (irk_packed_get_float (p, UNTAG_INTEGER (i)));
+  } else {
+    return TAG_INTEGER (irk_packed_get_int (p, UNTAG_INTEGER (i)));
+  }
+}
+
+object *
+irk_packed_set (object * a, object * i, object * v)
+{
+  irk_packed * p = (irk_packed *) a;
+  if (p->kind == IRK_PACKED_F64) {
+    IRK_PACKED_DATA (p, double)[UNTAG_INTEGER (i)] = irk_unbox_float (v);
+  } else {
+    irk_packed_put_int (p, UNTAG_INTEGER (i), UNTAG_INTEGER (v));
+  }
+  return IRK_UNDEFINED;
+}
+
+object *
+irk_packed_fill (object * a, object * start, object * n, object * v)
+{
+  irk_packed * p = (irk_packed *) a;
+  if (p->kind == IRK_PACKED_F64) {
+    irk_packed_fill_float (p, UNTAG_INTEGER (start), UNTAG_INTEGER (n), irk_unbox_float (v));
+  } else {
+    irk_packed_fill_int (p, UNTAG_INTEGER (start), UNTAG_INTEGER (n), UNTAG_INTEGER (v));
+  }
+  return IRK_UNDEFINED;
+}
+
+object *
+irk_packed_copy (object * src, object * sstart, object * n, object * dst, object * dstart)
+{
+  irk_packed_copy_raw ((irk_packed *) src, UNTAG_INTEGER (sstart), UNTAG_INTEGER (n),
+                       (irk_packed *) dst, UNTAG_INTEGER (dstart));
+  return IRK_UNDEFINED;
+}
+
 // --------------------------------------------------------------------------------
 
 extern uint32_t irk_ambig_size;
@@ -1165,22 +2113,318 @@ static int lookup_field (int tag, int label)
 
 void toplevel (void);
 
+// --------------------------------------------------------------------------------
+// sampling profiler.
+//
+// run a program with IRKEN_SAMPLE=<path> and it samples itself on a
+//   SIGPROF timer (IRKEN_SAMPLE_HZ per cpu-second, default 997), then
+//   writes folded stacks to <path> at exit, ready for flamegraph.pl.
+//   a sample is the interrupted pc followed by the pc saved in each
+//   frame of the continuation chain <k>: the logical irken call stack.
+//   pcs are only turned into names when the file is written, using
+//   irk_pc_table (the pc where each function or continuation starts,
+//   and a NULL name where the irken code ends).
+//   the C and LLVM backends emit the table; the VM loads it from the
+//   map written next to the bytecode, and records samples at calls.
+
+#include <signal.h>
+#include <sys/time.h>
+
+typedef struct {
+  void * pc;
+  const char * name;
+} irk_pc_entry;
+
+// emitted by the compiler.  weak, so that a program compiled without
+//   one (e.g. by an older compiler) still links, with an empty table.
+#ifdef __GNUC__
+__attribute__((weak)) irk_pc_entry * irk_pc_table;
+__attribute__((weak)) irk_int irk_pc_table_size;
+#else
+irk_pc_entry * irk_pc_table;
+irk_int irk_pc_table_size;
+#endif
+
+#define IRK_SAMPLE_DEPTH 64
+#define IRK_SAMPLE_MAX (1 << 16)
+// pseudo-pcs, out of range for both native and VM code.
+#define IRK_SAMPLE_GC (UINTPTR_MAX)
+#define IRK_SAMPLE_TRUNCATED (UINTPTR_MAX - 1)
+
+typedef struct {
+  irk_int depth;
+  uintptr_t pcs[IRK_SAMPLE_DEPTH]; // innermost first
+} irk_sample;
+
+static irk_sample * irk_samples = NULL;
+static volatile irk_int irk_nsamples = 0;
+static irk_int irk_samples_dropped = 0;
+static char * irk_sample_path = NULL;
+
+#if defined(__linux__) && defined(__x86_64__)
+#include <ucontext.h>
+#define IRK_UC_PC(uc) ((uintptr_t) ((ucontext_t *) (uc))->uc_mcontext.gregs[16]) // REG_RIP
+#elif defined(__linux__) && defined(__aarch64__)
+#include <ucontext.h>
+#define IRK_UC_PC(uc) ((uintptr_t) ((ucontext_t *) (uc))->uc_mcontext.pc)
+#else
+#define IRK_UC_PC(uc) ((uintptr_t) 0)
+#endif
+
+static int
+irk_sample_in_heap (object * f)
+{
+  if (IMMEDIATE (f)) {
+    return 0;
+  }
+#ifdef IRK_GENERATIONAL
+  if (f >= nursery && f < nursery_end) {
+    return 1;
+  }
+#endif
+  return f >= heap0 && f < heap0 + heap_size;
+}
+
+// record the stack under <f>, whose frames have typecode <tc>.  the VM
+//   keeps its pcs as tagged integers.  runs in the signal handler, so
+//   it only writes to the preallocated sample buffer, and it checks
+//   each frame since <k> may be in the middle of an update.
+static void
+irk_sample_record (uintptr_t leaf, object * f, irk_int tc, int tagged)
+{
+  if (irk_nsamples >= IRK_SAMPLE_MAX) {
+    irk_samples_dropped++;
+    return;
+  }
+  irk_sample * s = &irk_samples[irk_nsamples];
+  irk_int n = 0;
+  if (gc_active) {
+    // the frames are being moved.
+    s->pcs[n++] = IRK_SAMPLE_GC;
+  } else {
+    if (leaf) {
+      s->pcs[n++] = leaf;
+    }
+    while (irk_sample_in_heap (f) && GET_TYPECODE (*f) == tc) {
+      if (n == IRK_SAMPLE_DEPTH - 1) {
+        s->pcs[n++] = IRK_SAMPLE_TRUNCATED;
+        break;
+      }
+      s->pcs[n++] = tagged ? (uintptr_t) UNTAG_INTEGER (f[3]) : (uintptr_t) f[3];
+      f = f[1];
+    }
+  }
+  s->depth = n;
+  irk_nsamples++;
+}
+
+// the VM replaces this, see irkvm.c.
+static void
+irk_sample_native (void * uc)
+{
+  irk_sample_record (IRK_UC_PC (uc), k, TC_SAVE, 0);
+}
+
+static void (*irk_sample_hook) (void * uc) = irk_sample_native;
+
+static void
+irk_sample_handler (int sig, siginfo_t * info, void * uc)
+{
+  irk_sample_hook (uc);
+}
+
+static int
+irk_pc_entry_cmp (const void * a, const void * b)
+{
+  uintptr_t pa = (uintptr_t) ((irk_pc_entry *) a)->pc;
+  uintptr_t pb = (uintptr_t) ((irk_pc_entry *) b)->pc;
+  return (pa > pb) - (pa < pb);
+}
+
+static int
+irk_strptr_cmp (const void * a, const void * b)
+{
+  return strcmp (*(char **) a, *(char **) b);
+}
+
+// the name of the function containing <pc>, or NULL.
+static const char *
+irk_pc_name (uintptr_t pc)
+{
+  switch (pc) {
+  case IRK_SAMPLE_GC: return "[gc]";
+  case IRK_SAMPLE_TRUNCATED: return "[truncated]";
+  }
+  if (pc == (uintptr_t) exit_continuation) {
+    // the frame under toplevel
+    return NULL;
+  }
+  irk_int lo = 0;
+  irk_int hi = irk_pc_table_size;
+  // find the last entry <= pc
+  while (lo < hi) {
+    irk_int mid = (lo + hi) / 2;
+    if ((uintptr_t) irk_pc_table[mid].pc <= pc) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return (lo == 0) ? NULL : irk_pc_table[lo - 1].name;
+}
+
+static void
+irk_sample_write_stack (FILE * f, irk_sample * s)
+{
+  int first = 1;
+  // outermost first
+  for (irk_int i = s->depth - 1; i >= 0; i--) {
+    const char * name = irk_pc_name (s->pcs[i]);
+    if (!name && i == 0) {
+      // interrupted outside irken code
+      name = "[runtime]";
+    }
+    if (name) {
+      fprintf (f, "%s%s", first ? "" : ";", name);
+      first = 0;
+    }
+  }
+  if (first) {
+    fprintf (f, "[unknown]");
+  }
+}
+
+static void
+irk_sample_dump (void)
+{
+  struct itimerval off = {{0, 0}, {0, 0}};
+  setitimer (ITIMER_PROF, &off, NULL);
+  irk_int n = irk_nsamples;
+  FILE * f = fopen (irk_sample_path, "w");
+  char ** stacks = malloc (n * sizeof (char *));
+  if (!f || (n > 0 && !stacks)) {
+    fprintf (stderr, "unable to write samples to %s\n", irk_sample_path);
+    free (stacks);
+    if (f) {
+      fclose (f);
+    }
+    return;
+  }
+  qsort (irk_pc_table, irk_pc_table_size, sizeof (irk_pc_entry), irk_pc_entry_cmp);
+  // different pcs in the same functions give the same stack, so
+  //   merge them by name.
+  for (irk_int i = 0; i < n; i++) {
+    size_t size;
+    FILE * sf = open_memstream (&stacks[i], &size);
+    irk_sample_write_stack (sf, &irk_samples[i]);
+    fclose (sf);
+  }
+  qsort (stacks, n, sizeof (char *), irk_strptr_cmp);
+  for (irk_int i = 0; i < n; ) {
+    irk_int j = i + 1;
+    while (j < n && strcmp (stacks[i], stacks[j]) == 0) {
+      j++;
+    }
+    fprintf (f, "%s %" PRIdPTR "\n", stacks[i], j - i);
+    i = j;
+  }
+  for (irk_int i = 0; i < n; i++) {
+    free (stacks[i]);
+  }
+  free (stacks);
+  fclose (f);
+  if (irk_samples_dropped) {
+    fprintf (stderr, "%" PRIdPTR " samples dropped (buffer full)\n", irk_samples_dropped);
+  }
+}
+
+static void
+irk_sample_init (void)
+{
+  irk_sample_path = getenv ("IRKEN_SAMPLE");
+  if (irk_sample_path) {
+    char * hz0 = getenv ("IRKEN_SAMPLE_HZ");
+    long hz = hz0 ? strtol (hz0, NULL, 0) : 997;
+    long usecs = (hz > 0 && hz <= 1000000) ? 1000000 / hz : 1000000 / 997;
+    // pages are only touched as they fill.
+    irk_samples = calloc (IRK_SAMPLE_MAX, sizeof (irk_sample));
+    if (!irk_samples) {
+      fprintf (stderr, "unable to allocate sample buffer\n");
+      return;
+    }
+    struct sigaction sa;
+    memset (&sa, 0, sizeof (sa));
+    sa.sa_sigaction = irk_sample_handler;
+    sa.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset (&sa.sa_mask);
+    sigaction (SIGPROF, &sa, NULL);
+    atexit (irk_sample_dump);
+    struct itimerval it = {{0, usecs}, {0, usecs}};
+    setitimer (ITIMER_PROF, &it, NULL);
+  }
+}
+
+// the initial heap size comes from the IRKEN_HEAP environment
+//   variable, or from a --irk-heap=<words> argument (which is removed
+//   from argv before the program sees it).
+static
+void
+get_heap_size (int * argc, char ** argv)
+{
+  char * env = getenv ("IRKEN_HEAP");
+  size_t n = 0;
+  int j = 1;
+  if (env) {
+    n = strtoull (env, NULL, 0);
+  }
+  for (int i = 1; i < *argc; i++) {
+    if (strncmp (argv[i], "--irk-heap=", 11) == 0) {
+      n = strtoull (argv[i] + 11, NULL, 0);
+    } else {
+      argv[j++] = argv[i];
+    }
+  }
+  argv[j] = NULL;
+  *argc = j;
+  if (n > 0) {
+    heap_size = (n < 4 * head_room) ? 4 * head_room : n;
+  }
+}
+
 int
 main (int argc, char * argv[])
 {
-  heap0 = (object *) malloc (sizeof (object) * heap_size);
-  heap1 = (object *) malloc (sizeof (object) * heap_size);
+  get_heap_size (&argc, argv);
+  heap_size_min = heap_size;
+  heap1_size = heap_size;
+  // fresh mappings are zero-filled, see gc1.c.
+  heap0 = gc_heap_alloc (heap_size);
+  heap1 = gc_heap_alloc (heap_size);
   if (!heap0 || !heap1) {
     fprintf (stderr, "unable to allocate heap\n");
     return -1;
   } else {
-    if (clear_tospace) {
-      clear_space (heap0, heap_size);
-    }
     irk_argc = argc;
     irk_argv = argv;
-    limit = heap0 + (heap_size - head_room);
+#ifdef IRK_GENERATIONAL
+    nursery = gc_heap_alloc (nursery_size);
+    if (!nursery) {
+      fprintf (stderr, "unable to allocate nursery\n");
+      return -1;
+    }
+    nursery_end = nursery + nursery_size;
+    old_freep = heap0 + GC_ROOT_AREA;
+    freep = nursery;
+#else
     freep = heap0;
+#endif
+    gc_set_limit (head_room);
+    gc_stats_init();
+    irk_simd_init();
+    irk_sample_init();
+#ifdef IRK_PROFILE
+    hprof_init();
+#endif
     k = allocate (TC_SAVE, 3);
     k[1] = (object *) IRK_NIL; // top of stack
     k[2] = (object *) IRK_NIL; // null environment
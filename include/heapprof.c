@@ -0,0 +1,227 @@
+// --------------------------------------------------
+// heap profiler
+// --------------------------------------------------
+//
+// Built with IRK_PROFILE (compile -p).  When IRKEN_HEAP_PROFILE names a
+//   file, two kinds of records are written to it:
+//
+//   census <n> <objects> <words> <type>
+//     a count of the objects of each type, taken once at the end of
+//     every full collection, so every object counted is retained.
+//     With -G, minor collections are not counted.
+//
+//   site <samples> <words> <function> <type>
+//     allocation samples, one every IRKEN_HEAP_SAMPLE words (default
+//     1024), charged to the function that was running and the type
+//     allocated.  <words> is the estimate, samples * interval.  These
+//     are written at exit, sorted by function and type.
+//
+// Every line stands on its own, so the profiles of two runs can be
+//   compared with diff.  User objects are named by their tag, which
+//   the datatypes, records and polymorphic variants of a program
+//   share; prof_tag_names[] (emitted by the compiler) lists them all.
+
+static FILE * hprof_file = NULL;
+static irk_int hprof_interval = 1024;
+static irk_int hprof_countdown = INTPTR_MAX;
+static int hprof_census_count = 0;
+
+typedef struct {
+  int fun;
+  int tc;
+  uint64_t samples;
+} hprof_site;
+
+static hprof_site * hprof_sites = NULL;
+static size_t hprof_nsites = 0;
+static size_t hprof_cap = 0; // a power of two
+
+static
+void
+hprof_init (void)
+{
+  char * path = getenv ("IRKEN_HEAP_PROFILE");
+  char * interval = getenv ("IRKEN_HEAP_SAMPLE");
+  if (path) {
+    hprof_file = fopen (path, "w");
+    if (!hprof_file) {
+      fprintf (stderr, "unable to open heap profile %s\n", path);
+      return;
+    }
+    if (interval && (atol (interval) > 0)) {
+      hprof_interval = atol (interval);
+    }
+    hprof_countdown = hprof_interval;
+  }
+}
+
+static
+void
+hprof_type_name (int tc, char * buffer, size_t size)
+{
+  switch (tc) {
+  case TC_SAVE:    snprintf (buffer, size, "save"); break;
+  case TC_CLOSURE: snprintf (buffer, size, "closure"); break;
+  case TC_TUPLE:   snprintf (buffer, size, "tuple"); break;
+  case TC_STRING:  snprintf (buffer, size, "string"); break;
+  case TC_VECTOR:  snprintf (buffer, size, "vector"); break;
+  case TC_PAIR:    snprintf (buffer, size, "pair"); break;
+  case TC_SYMBOL:  snprintf (buffer, size, "symbol"); break;
+  case TC_BUFFER:  snprintf (buffer, size, "buffer"); break;
+  case TC_FOREIGN: snprintf (buffer, size, "foreign"); break;
+  case TC_FLOAT:   snprintf (buffer, size, "float"); break;
+  case TC_PACKED:  snprintf (buffer, size, "packed"); break;
+  default:
+    if (tc >= TC_USEROBJ) {
+      int i, index = (tc - TC_USEROBJ) >> 2;
+      // the table is NULL-terminated.
+      for (i = 0; prof_tag_names[i] && (i < index); i++) {
+      }
+      if (prof_tag_names[i] && prof_tag_names[i][0]) {
+        snprintf (buffer, size, "u%d[%s]", index, prof_tag_names[i]);
+      } else {
+        snprintf (buffer, size, "u%d", index);
+      }
+    } else {
+      snprintf (buffer, size, "tc%d", tc);
+    }
+  }
+}
+
+// count the objects in [start, end) and the large object space.
+static
+void
+hprof_census (object * start, object * end)
+{
+  uint64_t objects[256];
+  uint64_t words[256];
+  object * p = start;
+  size_t i;
+  char name[1024];
+
+  if (!hprof_file) {
+    return;
+  }
+  memset (objects, 0, sizeof (objects));
+  memset (words, 0, sizeof (words));
+  while (p < end) {
+    if (IMMEDIATE (*p)) {
+      // padding
+      p++;
+    } else {
+      int tc = GET_TYPECODE (*p);
+      irk_int length = GET_TUPLE_LENGTH (*p);
+      objects[tc]++;
+      words[tc] += length + 1;
+      p += length + 1;
+    }
+  }
+  for (i = 0; i < los_count; i++) {
+    object * ob = los_objects[i];
+    int tc = GET_TYPECODE (*ob);
+    objects[tc]++;
+    words[tc] += GET_TUPLE_LENGTH (*ob) + 1;
+  }
+  for (i = 0; i < 256; i++) {
+    if (objects[i]) {
+      hprof_type_name ((int) i, name, sizeof (name));
+      fprintf (hprof_file, "census %d %" PRIu64 " %" PRIu64 " %s\n",
+               hprof_census_count, objects[i], words[i], name);
+    }
+  }
+  hprof_census_count++;
+}
+
+static
+hprof_site *
+hprof_find (int fun, int tc)
+{
+  size_t mask = hprof_cap - 1;
+  size_t i = (((size_t) fun * 257) + tc) & mask;
+  while (hprof_sites[i].samples && !((hprof_sites[i].fun == fun) && (hprof_sites[i].tc == tc))) {
+    i = (i + 1) & mask;
+  }
+  return &hprof_sites[i];
+}
+
+static
+void
+hprof_grow (void)
+{
+  hprof_site * old = hprof_sites;
+  size_t old_cap = hprof_cap;
+  size_t i;
+  hprof_cap = hprof_cap ? hprof_cap * 2 : 1024;
+  hprof_sites = (hprof_site *) calloc (hprof_cap, sizeof (hprof_site));
+  if (!hprof_sites) {
+    fprintf (stderr, "unable to grow heap profile\n");
+    abort();
+  }
+  for (i = 0; i < old_cap; i++) {
+    if (old[i].samples) {
+      *hprof_find (old[i].fun, old[i].tc) = old[i];
+    }
+  }
+  free (old);
+}
+
+// called when <hprof_countdown> runs out, see allocate().
+static
+void
+hprof_sample (irk_int tc, irk_int size)
+{
+  hprof_site * site;
+  uint64_t n = 0;
+  while (hprof_countdown <= 0) {
+    hprof_countdown += hprof_interval;
+    n++;
+  }
+  if (hprof_nsites * 2 >= hprof_cap) {
+    hprof_grow();
+  }
+  site = hprof_find (prof_current_fun, (int) (tc & 0xff));
+  if (!site->samples) {
+    site->fun = prof_current_fun;
+    site->tc = (int) (tc & 0xff);
+    hprof_nsites++;
+  }
+  site->samples += n;
+}
+
+static
+int
+hprof_site_cmp (const void * a, const void * b)
+{
+  const hprof_site * sa = (const hprof_site *) a;
+  const hprof_site * sb = (const hprof_site *) b;
+  int r = strcmp (prof_funs[sa->fun].name, prof_funs[sb->fun].name);
+  return r ? r : (sa->tc - sb->tc);
+}
+
+static
+void
+hprof_finish (void)
+{
+  size_t i, j = 0;
+  char name[1024];
+  if (!hprof_file) {
+    return;
+  }
+  // squeeze out the empty slots, then sort.
+  for (i = 0; i < hprof_cap; i++) {
+    if (hprof_sites[i].samples) {
+      hprof_sites[j++] = hprof_sites[i];
+    }
+  }
+  qsort (hprof_sites, j, sizeof (hprof_site), hprof_site_cmp);
+  for (i = 0; i < j; i++) {
+    hprof_type_name (hprof_sites[i].tc, name, sizeof (name));
+    fprintf (hprof_file, "site %" PRIu64 " %" PRIu64 " %s %s\n",
+             hprof_sites[i].samples,
+             hprof_sites[i].samples * (uint64_t) hprof_interval,
+             prof_funs[hprof_sites[i].fun].name,
+             name);
+  }
+  fclose (hprof_file);
+  hprof_file = NULL;
+}
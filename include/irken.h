@@ -1,6 +1,11 @@
 #ifndef IRK_H
 #define IRK_H
 
+// for mmap() and friends under -std=c99.
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
@@ -8,16 +13,51 @@
 #include <ctype.h>
 #include <assert.h>
 #include <inttypes.h>
+#include <math.h>
 
 typedef intptr_t irk_int;
 typedef void * object;
 
-const size_t heap_size = 50000000; // about 400MB on 64-bit machine
+// initial size of each semispace, in words.  can be overridden with
+//   the IRKEN_HEAP environment variable or the --irk-heap=<words>
+//   argument, and is adjusted after each collection (see gc1.c).
+size_t heap_size = 50000000; // about 400MB on 64-bit machine
 const size_t head_room = 8192;
 
 object * heap0 = NULL;
 object * heap1 = NULL;
 
+#ifdef IRK_GENERATIONAL
+// new objects are allocated in the nursery, survivors are promoted
+//   into heap0 (the old space).  see gc1.c.
+const size_t nursery_size = 2000000; // about 16MB on 64-bit machine
+// minor collections leave their roots at the front of the old space.
+#define GC_ROOT_AREA 256
+
+object * nursery = NULL;
+object * nursery_end = NULL;
+
+#define IN_NURSERY(p) (((object*)(p) >= nursery) && ((object*)(p) < nursery_end))
+
+// write barrier: any store into an existing object must remember
+//   the slot if it creates an old->young pointer.
+static void gc_remember (object * slot);
+
+static inline void
+irk_store (object * slot, object val)
+{
+  *slot = val;
+  if (IN_NURSERY (val) && !IN_NURSERY (slot)) {
+    gc_remember (slot);
+  }
+}
+
+#define IRK_STORE(lval, val) irk_store ((object *) &(lval), (object) (val))
+#else
+#define GC_ROOT_AREA 0
+#define IRK_STORE(lval, val) ((lval) = (val))
+#endif
+
 /* Type Tags */
 
 #define TC_INT                  (0<<1) // 00000000 00
@@ -46,8 +86,15 @@ object * heap1 = NULL;
 // alias
 #define TC_CONTINUATION TC_SAVE
 
-// the range TC_USEROBJ to 252 is available for variant records,
-//   leaving a max of 59 variants in any one type.
+// boxed doubles, see lib/float.scm.  the VM borrows the three tags
+//   above this one for its own objects (see vm/irkvm.c).
+#define TC_FLOAT              (60<<2) // 11110000  f0
+// packed arrays, see lib/packed.scm.
+#define TC_PACKED             (59<<2) // 11101100  ec
+
+// the range TC_USEROBJ to 252, less TC_PACKED and TC_FLOAT, is
+//   available for variant records: the compiler skips UOTAG(49) and
+//   UOTAG(50), leaving a max of 52 variants in any one type.
 
 // immediate constants
 #define IRK_FALSE		(object *) (0x000 | TC_BOOL)
@@ -167,6 +214,23 @@ typedef struct _string {
   char data[];
 } irk_string;
 
+// a packed array of <len> unboxed elements.  like a string, the
+//   collector does not look inside it.  data is word-aligned.
+typedef struct _packed {
+  header tc;
+  uint32_t len;
+  uint32_t kind;
+  uint64_t data[];
+} irk_packed;
+
+// packed array kinds
+#define IRK_PACKED_U8  0
+#define IRK_PACKED_I32 1
+#define IRK_PACKED_I64 2
+#define IRK_PACKED_F64 3
+
+#define IRK_PACKED_DATA(p, t)   ((t *)(((irk_packed *)(p))->data))
+
 typedef struct _pair {
   header tc;
   object * car;
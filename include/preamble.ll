@@ -17,6 +17,7 @@
 @freep	= external global i8**
 
 %struct._string = type { i64, i32, [0 x i8] }
+%struct._packed = type { i64, i32, i32, [0 x i64] }
 
 ;; intrinsics
 declare void @llvm.memcpy.p0i8.p0i8.i64(i8* %dst, i8* %src, i64 %len, i32 %align, i1 %isvolatile)
@@ -29,8 +30,8 @@ declare i64 @llvm.readcyclecounter ()
 declare void @check_heap()
 declare i8** @make_vector (i64 %size, i8** %val)
 declare void @vector_range_check (i8** %vec, i64 %index)
-declare i8** @record_fetch (i8** %rec, i64 %label)
-declare void @record_store (i8** %rec, i64 %label, i8** %val)
+declare i8** @record_fetch (i8** %rec, i64 %label, i64* %cache)
+declare void @record_store (i8** %rec, i64 %label, i64* %cache, i8** %val)
 declare void @exit_continuation(i8**)
 declare void @DO (i8** %ob)
 declare void @DENV()
@@ -43,18 +44,40 @@ declare i8** @irk_putc (i8**)
 declare i8** @irk_flush()
 declare i8** @irk_make_argv()
 declare i8** @irk_set_verbose_gc(i8**)
+declare i8** @irk_gc_stats()
+declare i8** @irk_gc_pauses()
 declare i8** @irk_string_cmp (i8** %a, i8** %b)
+declare i64 @irk_string_hash (i8** %s)
+declare i64 @irk_slice_hash (i8** %s, i64 %start, i64 %len)
+declare i8** @irk_slice_cmp (i8** %a, i64 %a0, i64 %alen, i8** %b, i64 %b0, i64 %blen)
+declare i64 @irk_find_byte (i8** %s, i64 %start, i64 %end, i64 %ch)
+declare i64 @irk_find_bytes (i8** %needle, i8** %s, i64 %start, i64 %end)
+declare i64 @irk_find_byteset (i8** %set, i8** %s, i64 %start, i64 %end)
 declare i8** @irk_make_string (i8** %len)
 declare void @relocate_llvm_literals (i8**, i32*)
 declare i8** @irk_copy_tuple (i8**)
 declare i8** @irk_mul2 (i64, i64, i8**)
 declare i8** @irk_div2b1 (i64, i64, i64, i8**)
+declare i8** @irk_digits_mul (i8**, i8**, i8**, i64)
+declare i8** @irk_digits_exp_mod (i8**, i8**, i8**, i8**, i64)
+declare i8** @irk_i31_montymul (i8**, i8**, i8**, i8**, i64)
+declare i8** @irk_i31_modpow (i8**, i8**, i8**, i64, i8**, i64)
 declare i8** @irk_object2int (i8**)
 declare i8** @irk_objectptr2int (i8**)
+declare i8** @irk_float_op2 (i8**, i8**, i8**)
+declare i8** @irk_float_op1 (i8**, i8**)
+declare i8** @irk_float_cmp (i8**, i8**, i8**)
+declare i8** @irk_float_conv (i8**, i8**)
+declare i8** @irk_packed_make (i8**, i8**)
+declare i8** @irk_packed_ref (i8**, i8**)
+declare i8** @irk_packed_set (i8**, i8**, i8**)
+declare i8** @irk_packed_fill (i8**, i8**, i8**, i8**)
+declare i8** @irk_packed_copy (i8**, i8**, i8**, i8**, i8**)
 
 ;; FFI
 declare i8** @make_malloc (i64 %size, i64 %count)
 declare i8** @make_halloc (i64 %size, i64 %count)
+declare i8** @irk_callocate (i64 %size, i64 %count)
 declare i8** @make_foreign (i8* %p)
 declare i8*  @get_foreign (i8** %ob)
 declare i8** @offset_foreign (i8** %foreign, i64 %offset)
@@ -419,22 +442,6 @@ define internal fastcc i8** @irk_int_cmp(i8**, i8**) {
   ret i8** %10
 }
 
-define internal fastcc i8** @insn_callocate(i64, i64) {
-  %3 = mul nsw i64 %1, %0
-  %4 = add i64 %3, 7
-  %5 = lshr i64 %4, 3
-  %6 = load i8**, i8*** @freep
-  %7 = shl i64 %5, 8
-  %8 = or i64 %7, 32
-  %9 = inttoptr i64 %8 to i8*
-  store i8* %9, i8** %6
-  %10 = add nuw nsw i64 %5, 1
-  %11 = load i8**, i8*** @freep
-  %12 = getelementptr inbounds i8*, i8** %11, i64 %10
-  store i8** %12, i8*** @freep
-  ret i8** %6
-}
-
 define internal fastcc i8** @irk_string_len(i8**) {
   %2 = getelementptr inbounds i8*, i8** %0, i64 1
   %3 = bitcast i8** %2 to i32*
@@ -483,10 +490,163 @@ define internal fastcc i8** @irk_buffer_copy(i8**, i8**, i8**, i8**, i8**) {
   ret i8** inttoptr (i64 14 to i8**)
 }
 
+;; packed array element access.  (the f64 kind goes through
+;;   irk_packed_ref/irk_packed_set in header1.c, which box and unbox)
+
+define internal fastcc i8** @irk_packed_len(i8** %a) {
+  %p = getelementptr inbounds i8*, i8** %a, i64 1
+  %n0 = bitcast i8** %p to i32*
+  %n1 = load i32, i32* %n0
+  %n2 = zext i32 %n1 to i64
+  %n3 = shl nuw nsw i64 %n2, 1
+  %n4 = or i64 %n3, 1
+  %n5 = inttoptr i64 %n4 to i8**
+  ret i8** %n5
+}
+
+define internal fastcc i8** @irk_u8array_ref(i8** %a, i8** %i) {
+  %i0 = ptrtoint i8** %i to i64
+  %i1 = ashr i64 %i0, 1
+  %p = bitcast i8** %a to %struct._packed*
+  %d = getelementptr inbounds %struct._packed, %struct._packed* %p, i64 0, i32 3, i64 0
+  %d0 = bitcast i64* %d to i8*
+  %ep = getelementptr inbounds i8, i8* %d0, i64 %i1
+  %e = load i8, i8* %ep
+  %v = zext i8 %e to i64
+  %r0 = shl i64 %v, 1
+  %r1 = or i64 %r0, 1
+  %r2 = inttoptr i64 %r1 to i8**
+  ret i8** %r2
+}
+
+define internal fastcc i8** @irk_u8array_set(i8** %a, i8** %i, i8** %v) {
+  %i0 = ptrtoint i8** %i to i64
+  %i1 = ashr i64 %i0, 1
+  %v0 = ptrtoint i8** %v to i64
+  %v1 = ashr i64 %v0, 1
+  %e = trunc i64 %v1 to i8
+  %p = bitcast i8** %a to %struct._packed*
+  %d = getelementptr inbounds %struct._packed, %struct._packed* %p, i64 0, i32 3, i64 0
+  %d0 = bitcast i64* %d to i8*
+  %ep = getelementptr inbounds i8, i8* %d0, i64 %i1
+  store i8 %e, i8* %ep
+  ret i8** inttoptr (i64 14 to i8**)
+}
+
+define internal fastcc i8** @irk_i32array_ref(i8** %a, i8** %i) {
+  %i0 = ptrtoint i8** %i to i64
+  %i1 = ashr i64 %i0, 1
+  %p = bitcast i8** %a to %struct._packed*
+  %d = getelementptr inbounds %struct._packed, %struct._packed* %p, i64 0, i32 3, i64 0
+  %d0 = bitcast i64* %d to i32*
+  %ep = getelementptr inbounds i32, i32* %d0, i64 %i1
+  %e = load i32, i32* %ep
+  %v = sext i32 %e to i64
+  %r0 = shl i64 %v, 1
+  %r1 = or i64 %r0, 1
+  %r2 = inttoptr i64 %r1 to i8**
+  ret i8** %r2
+}
+
+define internal fastcc i8** @irk_i32array_set(i8** %a, i8** %i, i8** %v) {
+  %i0 = ptrtoint i8** %i to i64
+  %i1 = ashr i64 %i0, 1
+  %v0 = ptrtoint i8** %v to i64
+  %v1 = ashr i64 %v0, 1
+  %e = trunc i64 %v1 to i32
+  %p = bitcast i8** %a to %struct._packed*
+  %d = getelementptr inbounds %struct._packed, %struct._packed* %p, i64 0, i32 3, i64 0
+  %d0 = bitcast i64* %d to i32*
+  %ep = getelementptr inbounds i32, i32* %d0, i64 %i1
+  store i32 %e, i32* %ep
+  ret i8** inttoptr (i64 14 to i8**)
+}
+
+define internal fastcc i8** @irk_i64array_ref(i8** %a, i8** %i) {
+  %i0 = ptrtoint i8** %i to i64
+  %i1 = ashr i64 %i0, 1
+  %p = bitcast i8** %a to %struct._packed*
+  %d = getelementptr inbounds %struct._packed, %struct._packed* %p, i64 0, i32 3, i64 0
+  %d0 = bitcast i64* %d to i64*
+  %ep = getelementptr inbounds i64, i64* %d0, i64 %i1
+  %v = load i64, i64* %ep
+  %r0 = shl i64 %v, 1
+  %r1 = or i64 %r0, 1
+  %r2 = inttoptr i64 %r1 to i8**
+  ret i8** %r2
+}
+
+define internal fastcc i8** @irk_i64array_set(i8** %a, i8** %i, i8** %v) {
+  %i0 = ptrtoint i8** %i to i64
+  %i1 = ashr i64 %i0, 1
+  %v0 = ptrtoint i8** %v to i64
+  %v1 = ashr i64 %v0, 1
+  %p = bitcast i8** %a to %struct._packed*
+  %d = getelementptr inbounds %struct._packed, %struct._packed* %p, i64 0, i32 3, i64 0
+  %d0 = bitcast i64* %d to i64*
+  %ep = getelementptr inbounds i64, i64* %d0, i64 %i1
+  store i64 %v1, i64* %ep
+  ret i8** inttoptr (i64 14 to i8**)
+}
+
 ;; this is just to make the linker happy.
 ;; currently there is no support for profiling the LLVM backend.
 define void @prof_dump() { ret void }
 
+;; wrapper for header1.c/irk_string_hash
+define internal fastcc i8** @irk_ll_string_hash (i8** %s) {
+  %h = call i64 @irk_string_hash (i8** %s)
+  %r = call fastcc i8** @insn_box (i64 %h)
+  ret i8** %r
+}
+
+;; wrapper for header1.c/irk_slice_hash
+define internal fastcc i8** @irk_ll_slice_hash (i8** %s, i8** %start, i8** %len) {
+  %start0 = call fastcc i64 @insn_unbox (i8** %start)
+  %len0 = call fastcc i64 @insn_unbox (i8** %len)
+  %h = call i64 @irk_slice_hash (i8** %s, i64 %start0, i64 %len0)
+  %r = call fastcc i8** @insn_box (i64 %h)
+  ret i8** %r
+}
+
+;; wrapper for header1.c/irk_slice_cmp
+define internal fastcc i8** @irk_ll_slice_cmp (i8** %a, i8** %a0, i8** %alen, i8** %b, i8** %b0, i8** %blen) {
+  %a00 = call fastcc i64 @insn_unbox (i8** %a0)
+  %alen0 = call fastcc i64 @insn_unbox (i8** %alen)
+  %b00 = call fastcc i64 @insn_unbox (i8** %b0)
+  %blen0 = call fastcc i64 @insn_unbox (i8** %blen)
+  %r = call i8** @irk_slice_cmp (i8** %a, i64 %a00, i64 %alen0, i8** %b, i64 %b00, i64 %blen0)
+  ret i8** %r
+}
+
+;; wrapper for header1.c/irk_find_byte
+define internal fastcc i8** @irk_ll_find_byte (i8** %s, i8** %start, i8** %end, i8** %ch) {
+  %start0 = call fastcc i64 @insn_unbox (i8** %start)
+  %end0 = call fastcc i64 @insn_unbox (i8** %end)
+  %ch0 = call fastcc i64 @insn_unbox (i8** %ch)
+  %i = call i64 @irk_find_byte (i8** %s, i64 %start0, i64 %end0, i64 %ch0)
+  %r = call fastcc i8** @insn_box (i64 %i)
+  ret i8** %r
+}
+
+;; wrapper for header1.c/irk_find_bytes
+define internal fastcc i8** @irk_ll_find_bytes (i8** %needle, i8** %s, i8** %start, i8** %end) {
+  %start0 = call fastcc i64 @insn_unbox (i8** %start)
+  %end0 = call fastcc i64 @insn_unbox (i8** %end)
+  %i = call i64 @irk_find_bytes (i8** %needle, i8** %s, i64 %start0, i64 %end0)
+  %r = call fastcc i8** @insn_box (i64 %i)
+  ret i8** %r
+}
+
+;; wrapper for header1.c/irk_find_byteset
+define internal fastcc i8** @irk_ll_find_byteset (i8** %set, i8** %s, i8** %start, i8** %end) {
+  %start0 = call fastcc i64 @insn_unbox (i8** %start)
+  %end0 = call fastcc i64 @insn_unbox (i8** %end)
+  %i = call i64 @irk_find_byteset (i8** %set, i8** %s, i64 %start0, i64 %end0)
+  %r = call fastcc i8** @insn_box (i64 %i)
+  ret i8** %r
+}
+
 ;; ---- bignum helpers ----
 
 ;; note: there doesn't seem to be any speed advantage to copying the
@@ -509,6 +669,35 @@ define internal fastcc i8** @irk_ll_div2b1 (i8** %ah, i8** %al, i8** %b, i8** %r
   ret i8** %u
 }
 
+;; wrapper for header1.c/irk_digits_mul
+define internal fastcc i8** @irk_ll_digits_mul (i8** %a, i8** %b, i8** %r, i8** %bits) {
+  %bits0 = call fastcc i64 @insn_unbox (i8** %bits)
+  %u = call i8** @irk_digits_mul (i8** %a, i8** %b, i8** %r, i64 %bits0)
+  ret i8** %u
+}
+
+;; wrapper for header1.c/irk_digits_exp_mod
+define internal fastcc i8** @irk_ll_digits_exp_mod (i8** %b, i8** %e, i8** %m, i8** %r, i8** %bits) {
+  %bits0 = call fastcc i64 @insn_unbox (i8** %bits)
+  %u = call i8** @irk_digits_exp_mod (i8** %b, i8** %e, i8** %m, i8** %r, i64 %bits0)
+  ret i8** %u
+}
+
+;; wrapper for header1.c/irk_i31_montymul
+define internal fastcc i8** @irk_ll_i31_montymul (i8** %d, i8** %x, i8** %y, i8** %m, i8** %m0i) {
+  %m0i0 = call fastcc i64 @insn_unbox (i8** %m0i)
+  %u = call i8** @irk_i31_montymul (i8** %d, i8** %x, i8** %y, i8** %m, i64 %m0i0)
+  ret i8** %u
+}
+
+;; wrapper for header1.c/irk_i31_modpow
+define internal fastcc i8** @irk_ll_i31_modpow (i8** %x, i8** %t1, i8** %e, i8** %elen, i8** %m, i8** %m0i) {
+  %elen0 = call fastcc i64 @insn_unbox (i8** %elen)
+  %m0i0 = call fastcc i64 @insn_unbox (i8** %m0i)
+  %u = call i8** @irk_i31_modpow (i8** %x, i8** %t1, i8** %e, i64 %elen0, i8** %m, i64 %m0i0)
+  ret i8** %u
+}
+
 define internal fastcc i8** @irk_popcount (i8** %n) {
   %n0 = call fastcc i64 @insn_unbox (i8** %n)
   %r0 = call i64 @llvm.ctpop.i64 (i64 %n0)
@@ -273,6 +273,16 @@
 (define (magic=? a b)
   (eq? (cmp:=) (magic-cmp a b)))
 
+;; fold <v> into the running hash <h> (32-bit FNV-1a style).  used by
+;;   the functions generated by datatype-hash.
+(define (hash-mix h v)
+  (logand #xffffffff (* (logxor h (logand #xffffffff (logxor v (>> v 32)))) #x01000193)))
+
+;; hash tables mask off the low bits, so fold the high bits back down.
+(define (int-hash n)
+  (let ((h (hash-mix #x811c9dc5 n)))
+    (logxor h (>> h 16))))
+
 (define (eq? a b)
   (%backend c (%%cexp ('a 'a -> bool) "%0==%1" a b))
   (%backend llvm (%lleq #f a b))
@@ -317,8 +327,8 @@
   )
 
 (define (make-vector n val)
+  (%ensure-heap #f n)
   (%backend (c llvm)
-    (%ensure-heap #f n)
     (%make-vector #f n val))
   (%backend bytecode
     (%%cexp (int 'a -> (vector 'a))
@@ -636,6 +646,38 @@
   (%backend bytecode (%%cexp (-> sexp) "meta"))
   )
 
+;; collector statistics since startup.  survival is the percentage of
+;;   the heap that survived the last collection, alloc-rate is in words
+;;   per second of mutator time, and pauses[i] counts collections that
+;;   took less than 2^i usecs (the last bucket, any longer).
+(define (gc-stats)
+  (let ((v (gc-stats-vector 0))
+        (p (gc-stats-vector 1)))
+    {collections=v[0]
+     minor-collections=v[1]
+     words-allocated=v[2]
+     words-copied=v[3]
+     survival=v[4]
+     alloc-rate=v[5]
+     peak-words=v[6]
+     pause-usecs=v[7]
+     max-pause-usecs=v[8]
+     elapsed-usecs=v[9]
+     pauses=p}))
+
+;; 0: the counters, 1: the pause histogram.
+(define (gc-stats-vector which)
+  (%ensure-heap #f 32)
+  (%backend c
+    (%%cexp (int -> (vector int)) "(%0 ? irk_gc_pauses() : irk_gc_stats())" which))
+  (%backend llvm
+    (if (= which 0)
+        (%llvm-call ("@irk_gc_stats" (-> (vector int)) ccc))
+        (%llvm-call ("@irk_gc_pauses" (-> (vector int)) ccc))))
+  (%backend bytecode
+    (%%cexp (int -> (vector int)) "gcstat" which))
+  )
+
 (define (~~object->int ob)
   (%backend c (%%cexp ('a -> int) "unbox(irk_object2int(%0))" ob))
   (%backend llvm (%llvm-call ("@irk_object2int" ('a -> int) ccc) ob))
@@ -21,6 +21,12 @@
 ;; the original code, because we are really doing all calcuations with
 ;; i64/i63 integers.
 
+;; In the C and LLVM backends, the two hot spots (montymul and the
+;; modpow loop) are done by C translations of the same BearSSL code
+;; (irk_i31_montymul and irk_i31_modpow in include/header1.c), which
+;; are constant-time in the same sense as the originals.  The VM uses
+;; the Irken versions here.
+
 (define (NOT ctl)
   (logand 1 (logxor ctl 1)))
 
@@ -284,6 +290,17 @@
                     ($loop))))))
 
 (define (i31/montymul d x y m m0i)
+  (%backend c
+    (%%cexp ((vector int) (vector int) (vector int) (vector int) int -> undefined)
+            "irk_i31_montymul (%0, %1, %2, %3, %4)"
+            d x y m m0i))
+  (%backend llvm
+    (%llvm-call ("@irk_ll_i31_montymul" ((vector int) (vector int) (vector int) (vector int) int -> undefined))
+                d x y m m0i))
+  (%backend bytecode
+    (i31/montymul* d x y m m0i)))
+
+(define (i31/montymul* d x y m m0i)
   (let ((len (>> (+ m[0] 31) 5))
         (len4 (logand len (lognot 3)))
         (dh 0) (zh 0) (f 0) (z 0) (v 0) (r 0)
@@ -341,7 +358,9 @@
         ))
     ))
 
-;; `e` is a string in u256 form.
+;; `e` is a string in u256 form.  `t1` and `t2` are scratch, and what
+;;   they hold afterwards depends on the backend: irk_i31_modpow leaves
+;;   `t1` as the Montgomery form of `x` and does not touch `t2`.
 (define (i31/modpow x e elen m m0i t1 t2)
   (let ((mlen (>> (+ m[0] 63) 5)) ;; in words, NOT bytes
         (ex 0)
@@ -349,16 +368,25 @@
     (for-range i mlen
       (set! t1[i] x[i]))
     (i31->monty t1 m)
-    (i31/zero x m[0])
-    (set! x[1] 1)
-    (for-range k (<< elen 3)
-      (set! ex (char->int (string-ref e (- elen 1 (>> k 3)))))
-      (set! ctl (logand (>> ex (logand k 7)) 1))
-      (i31/montymul t2 x t1 m m0i)
-      (CCOPY ctl x t2 mlen)
-      (i31/montymul t2 t1 t1 m m0i)
-      (for-range i mlen
-        (set! t1[i] t2[i])))))
+    (%backend c
+      (%%cexp ((vector int) (vector int) (raw string) int (vector int) int -> undefined)
+              "irk_i31_modpow (%0, %1, %2, %3, %4, %5)"
+              x t1 e elen m m0i))
+    (%backend llvm
+      (%llvm-call ("@irk_ll_i31_modpow" ((vector int) (vector int) string int (vector int) int -> undefined))
+                  x t1 e elen m m0i))
+    (%backend bytecode
+      (i31/zero x m[0])
+      (set! x[1] 1)
+      (for-range k (<< elen 3)
+        (set! ex (char->int (string-ref e (- elen 1 (>> k 3)))))
+        (set! ctl (logand (>> ex (logand k 7)) 1))
+        (i31/montymul t2 x t1 m m0i)
+        (CCOPY ctl x t2 mlen)
+        (i31/montymul t2 t1 t1 m m0i)
+        (for-range i mlen
+          (set! t1[i] t2[i]))))
+    ))
 
 (define (i31/mulacc d a b)
   (let ((alen (>> (+ a[0] 31) 5))
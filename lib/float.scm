@@ -0,0 +1,107 @@
+;; -*- Mode: Irken -*-
+
+;; double-precision floating point.
+;;
+;; a float is a boxed double (TC_FLOAT).  Literals like 1.5, -2.0e-3
+;;   and 6e23 are read as floats.  In the C backend a nest of float
+;;   operations is fused into a single C expression (see
+;;   fuse-float-cexps in self/analyze.scm), so only the final result
+;;   is boxed.  The LLVM backend and the VM call the irk_float_*
+;;   functions in include/header1.c, passing the operation code.
+
+(defmacro define-float-op2
+  (define-float-op2 name code template)
+  -> (define (name a b)
+       (%backend c (%%cexp (float float -> float) template a b))
+       (%backend llvm (%llvm-call ("@irk_float_op2" (int float float -> float) ccc) code a b))
+       (%backend bytecode (%%cexp (int float float -> float) "fop2" code a b))
+       ))
+
+(defmacro define-float-op1
+  (define-float-op1 name code template)
+  -> (define (name a)
+       (%backend c (%%cexp (float -> float) template a))
+       (%backend llvm (%llvm-call ("@irk_float_op1" (int float -> float) ccc) code a))
+       (%backend bytecode (%%cexp (int float -> float) "fop1" code a))
+       ))
+
+(defmacro define-float-cmp
+  (define-float-cmp name code template)
+  -> (define (name a b)
+       (%backend c (%%cexp (float float -> bool) template a b))
+       (%backend llvm (%llvm-call ("@irk_float_cmp" (int float float -> bool) ccc) code a b))
+       (%backend bytecode (%%cexp (int float float -> bool) "fcmp" code a b))
+       ))
+
+(define-float-op2 float+ 0 "%0+%1")
+(define-float-op2 float- 1 "%0-%1")
+(define-float-op2 float* 2 "%0*%1")
+(define-float-op2 float/ 3 "%0/%1")
+(define-float-op2 float-pow 4 "pow(%0, %1)")
+(define-float-op2 float-atan2 5 "atan2(%0, %1)")
+(define-float-op2 float-fmod 6 "fmod(%0, %1)")
+
+(define-float-op1 float-negate 0 "-%0")
+(define-float-op1 float-abs 1 "fabs(%0)")
+(define-float-op1 float-sqrt 2 "sqrt(%0)")
+(define-float-op1 float-floor 3 "floor(%0)")
+(define-float-op1 float-ceil 4 "ceil(%0)")
+(define-float-op1 float-exp 5 "exp(%0)")
+(define-float-op1 float-log 6 "log(%0)")
+(define-float-op1 float-sin 7 "sin(%0)")
+(define-float-op1 float-cos 8 "cos(%0)")
+(define-float-op1 float-tan 9 "tan(%0)")
+(define-float-op1 float-atan 10 "atan(%0)")
+
+(define-float-cmp float= 0 "%0==%1")
+(define-float-cmp float< 1 "%0<%1")
+(define-float-cmp float<= 2 "%0<=%1")
+(define-float-cmp float> 3 "%0>%1")
+(define-float-cmp float>= 4 "%0>=%1")
+
+;; note: a NaN is neither less nor greater than anything.
+(define (float-cmp a b)
+  (cond ((float< a b) (cmp:<))
+        ((float< b a) (cmp:>))
+        (else (cmp:=))))
+
+(define (float-min a b) (if (float< b a) b a))
+(define (float-max a b) (if (float< a b) b a))
+
+(define (int->float n)
+  (%backend c (%%cexp (int -> float) "(double)%0" n))
+  (%backend llvm (%llvm-call ("@irk_float_conv" (int int -> float) ccc) 0 n))
+  (%backend bytecode (%%cexp (int int -> float) "fconv" 0 n))
+  )
+
+;; truncates toward zero.
+(define (float->int x)
+  (%backend c (%%cexp (float -> int) "(irk_int)%0" x))
+  (%backend llvm (%llvm-call ("@irk_float_conv" (int float -> int) ccc) 1 x))
+  (%backend bytecode (%%cexp (int float -> int) "fconv" 1 x))
+  )
+
+;; the shortest string that reads back as the same float.
+(define (float->string x)
+  (%backend c (%%cexp (float -> string) "irk_float_2_string(%0)" x))
+  (%backend llvm (%llvm-call ("@irk_float_conv" (int float -> string) ccc) 2 x))
+  (%backend bytecode (%%cexp (int float -> string) "fconv" 2 x))
+  )
+
+;; does <s> hold a float (in the syntax of strtod(3))?
+(define (string-float? s)
+  (%backend c (%%cexp ((raw string) -> bool) "irk_string_is_float(%0)" s))
+  (%backend llvm (%llvm-call ("@irk_float_conv" (int string -> bool) ccc) 4 s))
+  (%backend bytecode (%%cexp (int string -> bool) "fconv" 4 s))
+  )
+
+(define (string->float* s)
+  (%backend c (%%cexp ((raw string) -> float) "irk_string_2_float(%0)" s))
+  (%backend llvm (%llvm-call ("@irk_float_conv" (int string -> float) ccc) 3 s))
+  (%backend bytecode (%%cexp (int string -> float) "fconv" 3 s))
+  )
+
+(define (string->float s)
+  (if (string-float? s)
+      (string->float* s)
+      (raise (:String/BadFloat s))))
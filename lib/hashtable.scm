@@ -0,0 +1,131 @@
+;; -*- Mode: Irken -*-
+
+;; open-addressing hash table with linear probing.
+;;
+;; the collector moves objects, so keys are never hashed by address:
+;;   the caller supplies a structural hash (string-hash, int-hash,
+;;   symbol-hash, or one made by datatype-hash) along with an equality
+;;   predicate.  the hash of each key is stored in its slot, so a
+;;   resize never calls the hash function again and most probe
+;;   mismatches are rejected without calling <eq>.
+;;
+;; capacity is always a power of two, and at least a quarter of the
+;;   slots are empty, so a probe always terminates.  deleted slots
+;;   are left as tombstones until the next resize.
+
+(datatype hashslot
+  (:empty)
+  (:deleted)
+  (:full int 'a 'b) ;; hash key value
+  )
+
+(define (hashtable/make hash eq)
+  {slots=(make-vector 8 (hashslot:empty)) count=0 used=0 hash=hash eq=eq})
+
+(define (hashtable/count ht)
+  ht.count)
+
+;; index of <k>'s slot, or -1.
+(define (hashtable/find ht k h)
+  (let ((mask (- (vector-length ht.slots) 1)))
+    (let loop ((i (logand h mask)))
+      (match ht.slots[i] with
+        (hashslot:empty) -> -1
+        (hashslot:deleted) -> (loop (logand (+ i 1) mask))
+        (hashslot:full h0 k0 _)
+        -> (if (and (= h h0) (ht.eq k k0))
+               i
+               (loop (logand (+ i 1) mask)))
+        ))))
+
+;; rebuild into a table big enough for the live entries, dropping
+;;   tombstones.  the table only grows when it's at least half full
+;;   of live entries, otherwise it just sheds its tombstones.
+(define (hashtable/resize! ht)
+  (let ((old ht.slots)
+        (n (vector-length old))
+        (n1 (if (>= (* ht.count 2) n) (* n 2) n))
+        (mask (- n1 1))
+        (new (make-vector n1 (hashslot:empty))))
+    (for-range i n
+      (match old[i] with
+        (hashslot:full h _ _)
+        -> (let loop ((j (logand h mask)))
+             (match new[j] with
+               (hashslot:empty) -> (set! new[j] old[i])
+               _ -> (loop (logand (+ j 1) mask))))
+        _ -> #u
+        ))
+    (set! ht.slots new)
+    (set! ht.used ht.count)
+    ))
+
+(define (hashtable/put! ht k v)
+  (let ((h (ht.hash k))
+        (i (hashtable/find ht k h)))
+    (if (>= i 0)
+        (set! ht.slots[i] (hashslot:full h k v))
+        ;; new key: take the first free slot on its probe path.
+        (let ((mask (- (vector-length ht.slots) 1))
+              (j (let loop ((j (logand h mask)))
+                   (match ht.slots[j] with
+                     (hashslot:full _ _ _) -> (loop (logand (+ j 1) mask))
+                     (hashslot:deleted) -> j
+                     (hashslot:empty) -> (begin (inc! ht.used) j)))))
+          (set! ht.slots[j] (hashslot:full h k v))
+          (inc! ht.count)
+          (when (> (* ht.used 4) (* (vector-length ht.slots) 3))
+            (hashtable/resize! ht))))))
+
+(define (hashtable/get ht k)
+  (let ((i (hashtable/find ht k (ht.hash k))))
+    (if (< i 0)
+        (maybe:no)
+        (match ht.slots[i] with
+          (hashslot:full _ _ v) -> (maybe:yes v)
+          _ -> (impossible)))))
+
+(define (hashtable/get-default ht k default)
+  (match (hashtable/get ht k) with
+    (maybe:yes v) -> v
+    (maybe:no) -> default
+    ))
+
+(define (hashtable/present? ht k)
+  (>= (hashtable/find ht k (ht.hash k)) 0))
+
+(define (hashtable/delete! ht k)
+  (let ((i (hashtable/find ht k (ht.hash k))))
+    (when (>= i 0)
+      (set! ht.slots[i] (hashslot:deleted))
+      (dec! ht.count))))
+
+(define (hashtable/clear! ht)
+  (set! ht.slots (make-vector 8 (hashslot:empty)))
+  (set! ht.count 0)
+  (set! ht.used 0))
+
+;; visits entries in slot order, which is not insertion order and
+;;   changes on resize.  don't add or delete keys from <p>.
+(define (hashtable/iterate p ht)
+  (let ((slots ht.slots))
+    (for-range i (vector-length slots)
+      (match slots[i] with
+        (hashslot:full _ k v) -> (begin (p k v) #u)
+        _ -> #u
+        ))))
+
+(defmacro for-hashtable
+  (for-hashtable k v ht body ...)
+  -> (hashtable/iterate (lambda (k v) body ...) ht)
+  )
+
+(define (hashtable/keys ht)
+  (let ((r '()))
+    (for-hashtable k v ht (push! r k))
+    r))
+
+(define (hashtable/values ht)
+  (let ((r '()))
+    (for-hashtable k v ht (push! r v))
+    r))
@@ -1,5 +1,7 @@
 ;; -*- Mode: Irken -*-
 
+(require "lib/float.scm")
+
 (define json-parser
   (%%sexp
    (parser
@@ -12,7 +14,7 @@
                           ;; backslash + any character
                           (cat (lit "\\") (reg "."))))
                       (lit "\"")))
-     (NUMBER     (reg "\\-?[0-9]+")) ;; XXX floating-point.
+     (NUMBER     (reg "\\-?[0-9]+(\\.[0-9]+)?([eE][\\-+]?[0-9]+)?"))
      (TRUE       (lit "true"))
      (FALSE      (lit "false"))
      (NULL       (lit "null"))
@@ -40,6 +42,7 @@
 (datatype json
   (:string string)
   (:number int)
+  (:float float)
   (:bool bool)
   (:null)
   (:array (list json))
@@ -55,6 +58,7 @@
 (define json-repr
   (json:string s)   -> (format (string s))
   (json:number n)   -> (format (int n))
+  (json:float x)    -> (float->string x)
   (json:bool #t)    -> "true"
   (json:bool #f)    -> "false"
   (json:null)       -> "null"
@@ -74,6 +78,7 @@
   (json:bool #f)  -> 6
   (json:null)     -> 4
   (json:number n) -> (string-length (int->string n))
+  (json:float x)  -> (string-length (float->string x))
   (json:string s) -> (+ 2 (string-length s))
   (json:obj pairs)
   -> (fold binary+ (* 2 (length pairs)) (map json-pp-pair-size pairs))
@@ -169,11 +174,19 @@
   x -> (impossible)
   )
 
+;; integers stay ints, anything with a fraction or an exponent is a float.
+(define (parse-number s)
+  (if (or (>= (string-find "." s) 0)
+          (>= (string-find "e" s) 0)
+          (>= (string-find "E" s) 0))
+      (json:float (string->float s))
+      (json:number (string->int s))))
+
 (define parse-value
   (parse:nt 'value ((parse:t tok)))
   -> (match tok.kind with
        'STRING -> (json:string (parse-string tok.val))
-       'NUMBER -> (json:number (string->int tok.val))
+       'NUMBER -> (parse-number tok.val)
        'TRUE   -> (json:bool #t)
        'FALSE  -> (json:bool #f)
        'NULL   -> (json:null)
@@ -2,15 +2,9 @@
 
 ;; XXX consider rewriting with more experience
 
-;; XXX: for debug info:
-;; 1) attach path/line/pos info to each symbol (this should be enough for most debugging)
-;; but another approach might be to
-;; 2) add a (sexp:pos ...) arm that can be inserted literally anywhere in a sexp,
-;;   and ignored by most code.
-;;
-;; #2 seems much more lispy, and feels cleaner. fingers crossed.
-;; also, I think #2 could push pos info into node records pretty easily.
-;; [and it should be an optional feature of `read`]
+;; debug info: with <pos?>, every list is wrapped in (sexp:pos path line ...),
+;;   which most code can ignore with sexp/unpos or sexp/strip.  the
+;;   compiler (see -g) carries these through to node records.
 
 ;; ------------------------------
 
@@ -31,7 +25,7 @@
    (#\0 0) (#\1 1) (#\2 2) (#\3 3) (#\4 4) (#\5 5) (#\6 6) (#\7 7)
    ))
 
-(define (reader path read-char)
+(define (reader* path read-char pos?)
 
   (let ((char #\eof) ;; one-character buffer
 	(line 1)
@@ -142,7 +136,10 @@
       (let ((ch (peek)))
 	(match ch with
 	  #\eof -> (read-error1 "unexpected end of file" 0)
-	  #\(   -> (sexp:list (read-list))
+	  #\(   -> (if pos?
+		      (let ((line0 line))
+			(sexp:pos path line0 (sexp:list (read-list))))
+		      (sexp:list (read-list)))
 	  #\{   -> (read-record)
 	  #\"   -> (read-string)
 	  #\'   -> (begin (next) (sexp (sexp:symbol 'quote) (read)))
@@ -183,8 +180,10 @@
 	  #\)   -> (read-error0 "unexpected close-paren")
 	  _     -> (match (read-atom) with
 		      (:atom chars #t n _) -> (sexp:int (read-int chars n))
-		      (:atom chars #f _ 0) -> (sexp:symbol (string->symbol chars))
-		      (:atom chars #f _ n) -> (dotted-symbol chars n)
+		      (:atom chars #f _ n)
+		      -> (cond ((float-syntax? chars) (sexp:float chars))
+			       ((= n 0) (sexp:symbol (string->symbol chars)))
+			       (else (dotted-symbol chars n)))
 		      )
 	  )
 	)
@@ -306,6 +305,32 @@
 	      (else
 	       (string->symbol (list->string (reverse result)))))))
 
+    ;; [-]digits[.digits][(e|E)[+|-]digits], with a fraction or an exponent.
+    (define (float-syntax? s)
+      (let ((n (string-length s))
+	    (i 0)
+	    (frac? #f)
+	    (exp? #f))
+	(define (digits)
+	  (let ((start i))
+	    (while (and (< i n) (digit? (string-ref s i)))
+	      (inc! i))
+	    (> i start)))
+	(define (skip ch)
+	  (if (and (< i n) (eq? (string-ref s i) ch))
+	      (begin (inc! i) #t)
+	      #f))
+	(skip #\-)
+	(and (digits)
+	     (or (not (skip #\.))
+		 (begin (set! frac? #t) (digits)))
+	     (or (not (or (skip #\e) (skip #\E)))
+		 (begin (set! exp? #t)
+			(or (skip #\+) (skip #\-))
+			(digits)))
+	     (= i n)
+	     (or frac? exp?))))
+
     (define (read-int s n)
       (let ((neg? (eq? (string-ref s 0) #\-))
 	    (start (if neg? 1 0)))
@@ -354,6 +379,9 @@
     (read-all)
     ))
 
+(define (reader path read-char)
+  (reader* path read-char #f))
+
 (define (read-string s)
   (reader "<string>" (string-reader s)))
 
@@ -22,8 +22,15 @@
 (define the-variant-label-map #())
 
 (define (build-variant-label-map)
-  (let ((variants (fetch-metadata 'variants)))
-    (set! the-variant-label-map (make-vector (length variants) ""))
+  ;; tags can have gaps (TC_PACKED and TC_FLOAT are skipped), so size
+  ;;   the map by the highest one.
+  (let ((variants (fetch-metadata 'variants))
+        (ntags 0))
+    (for-list item variants
+      (match item with
+        (sexp:list (_ (sexp:int tag))) -> (set! ntags (max ntags (+ 1 tag)))
+        _ -> #u))
+    (set! the-variant-label-map (make-vector ntags ""))
     (let loop ((vls variants))
       (match vls with
         ((sexp:list ((sexp:symbol name) (sexp:int tag))) . tl)
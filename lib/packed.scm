@@ -0,0 +1,148 @@
+;; -*- Mode: Irken -*-
+
+;; packed arrays.
+;;
+;; u8array, i32array, i64array and f64array hold their elements
+;;   unboxed, in a single TC_PACKED object that the collector does not
+;;   scan.  A u8array takes one byte per element where a vector takes
+;;   a word.  The elements are read and written as ints (as floats for
+;;   f64array); i64array elements are truncated to the range of an int
+;;   when read.  New arrays are zero-filled.
+
+(require "lib/float.scm")
+
+(defmacro packed-range-check
+  (packed-range-check n i)
+  -> (when (not (and (<= 0 i) (< i n)))
+       (raise (:Packed/Range n i i)))
+  (packed-range-check n lo hi)
+  -> (when (not (and (<= 0 lo) (<= lo hi) (<= hi n)))
+       (raise (:Packed/Range n lo hi))))
+
+;; the words taken by <n> elements of <size> bytes, as in
+;;   packed_tuple_length() in header1.c.
+(define (packed-tuple-length size n)
+  (how-many (+ 8 (* n size)) (get-word-size)))
+
+(defmacro define-packed-make
+  (define-packed-make name type kind size)
+  -> (define (name n)
+       (when (< n 0)
+         (raise (:Packed/Range n n n)))
+       (%backend c
+         ;; large arrays are allocated outside the heap.
+         (%ensure-heap #f (%%cexp (int int -> int) "heap_words_for (packed_tuple_length (%0, %1))" kind n))
+         (%%cexp (int int -> type) "make_packed (%0, %1)" kind n))
+       (%backend llvm
+         (%ensure-heap #f (packed-tuple-length size n))
+         (%llvm-call ("@irk_packed_make" (int int -> type) ccc) kind n))
+       (%backend bytecode
+         (%ensure-heap #f (packed-tuple-length size n))
+         (%%cexp (int int -> type) "pmake" kind n))
+       ))
+
+(defmacro define-packed-length
+  (define-packed-length name type)
+  -> (define (name a)
+       (%backend c (%%cexp ((raw type) -> int) "%0->len" a))
+       (%backend llvm (%llvm-call ("@irk_packed_len" (type -> int)) a))
+       (%backend bytecode (%%cexp (type -> int) "plen" a))
+       ))
+
+;; <llvm-fun> is the %llvm-call target: inline IR for the int kinds,
+;;   a C function that boxes for f64array.
+(defmacro define-packed-ref
+  (define-packed-ref name type elt length llvm-fun)
+  -> (define (name a i)
+       (packed-range-check (length a) i)
+       (%backend c (%%cexp (type int -> elt) "%0[%1]" a i))
+       (%backend llvm (%llvm-call llvm-fun a i))
+       (%backend bytecode (%%cexp (type int -> elt) "pref" a i))
+       ))
+
+(defmacro define-packed-set
+  (define-packed-set name type elt length llvm-fun)
+  -> (define (name a i v)
+       (packed-range-check (length a) i)
+       (%backend c
+         (%%cexp (type int elt -> undefined) "%0[%1] = %2" a i v)
+         #u) ;; avoid C warning.
+       (%backend llvm (%llvm-call llvm-fun a i v))
+       (%backend bytecode (%%cexp (type int elt -> undefined) "pset" a i v))
+       ))
+
+;; set the <n> elements starting at <start> to <v>.
+(defmacro define-packed-fill
+  (define-packed-fill name type elt length template)
+  -> (define (name a start n v)
+       (packed-range-check (length a) start (+ start n))
+       (%backend c
+         (%%cexp ((raw type) int int elt -> undefined) template a start n v)
+         #u)
+       (%backend llvm
+         (%llvm-call ("@irk_packed_fill" (type int int elt -> undefined) ccc) a start n v))
+       (%backend bytecode
+         (%%cexp (type int int elt -> undefined) "pfill" a start n v))
+       ))
+
+;; like buffer-copy.  the ranges may overlap.
+(defmacro define-packed-copy
+  (define-packed-copy name type length)
+  -> (define (name src src-start n dst dst-start)
+       (packed-range-check (length src) src-start (+ src-start n))
+       (packed-range-check (length dst) dst-start (+ dst-start n))
+       (%backend c
+         (%%cexp ((raw type) int int (raw type) int -> undefined)
+                 "irk_packed_copy_raw (%0, %1, %2, %3, %4)"
+                 src src-start n dst dst-start)
+         #u)
+       (%backend llvm
+         (%llvm-call ("@irk_packed_copy" (type int int type int -> undefined) ccc)
+                     src src-start n dst dst-start))
+       (%backend bytecode
+         (%%cexp (type int int type int -> undefined) "pcopy" src src-start n dst dst-start))
+       ))
+
+(define-packed-make make-u8array u8array 0 1)
+(define-packed-length u8array-length u8array)
+(define-packed-ref u8array-ref u8array int u8array-length ("@irk_u8array_ref" (u8array int -> int)))
+(define-packed-set u8array-set! u8array int u8array-length ("@irk_u8array_set" (u8array int int -> undefined)))
+(define-packed-fill u8array-fill! u8array int u8array-length "irk_packed_fill_int (%0, %1, %2, %3)")
+(define-packed-copy u8array-copy u8array u8array-length)
+
+(define-packed-make make-i32array i32array 1 4)
+(define-packed-length i32array-length i32array)
+(define-packed-ref i32array-ref i32array int i32array-length ("@irk_i32array_ref" (i32array int -> int)))
+(define-packed-set i32array-set! i32array int i32array-length ("@irk_i32array_set" (i32array int int -> undefined)))
+(define-packed-fill i32array-fill! i32array int i32array-length "irk_packed_fill_int (%0, %1, %2, %3)")
+(define-packed-copy i32array-copy i32array i32array-length)
+
+(define-packed-make make-i64array i64array 2 8)
+(define-packed-length i64array-length i64array)
+(define-packed-ref i64array-ref i64array int i64array-length ("@irk_i64array_ref" (i64array int -> int)))
+(define-packed-set i64array-set! i64array int i64array-length ("@irk_i64array_set" (i64array int int -> undefined)))
+(define-packed-fill i64array-fill! i64array int i64array-length "irk_packed_fill_int (%0, %1, %2, %3)")
+(define-packed-copy i64array-copy i64array i64array-length)
+
+(define-packed-make make-f64array f64array 3 8)
+(define-packed-length f64array-length f64array)
+(define-packed-ref f64array-ref f64array float f64array-length ("@irk_packed_ref" (f64array int -> float) ccc))
+(define-packed-set f64array-set! f64array float f64array-length ("@irk_packed_set" (f64array int float -> undefined) ccc))
+(define-packed-fill f64array-fill! f64array float f64array-length "irk_packed_fill_float (%0, %1, %2, %3)")
+(define-packed-copy f64array-copy f64array f64array-length)
+
+;; strings hold bytes, so these are for code that has been using
+;;   strings as byte arrays.
+(define (string->u8array s)
+  (let ((n (string-length s))
+        (r (make-u8array n)))
+    (for-range i n
+      (u8array-set! r i (char->int (string-ref s i))))
+    r))
+
+(define (u8array->string a)
+  (let ((n (u8array-length a))
+        (r (make-string n)))
+    (for-range i n
+      (string-set! r i (int->char (u8array-ref a i))))
+    r))
@@ -14,6 +14,8 @@
   (:record (list field))
   (:cons symbol symbol) ;; constructor ':' syntax
   (:attr sexp symbol)	;; attribute '.' syntax
+  (:float string)	;; the text of a float literal
+  (:pos string int sexp) ;; file line exp, see reader*
   )
 
 (datatype field
@@ -38,6 +40,7 @@
   (sexpf (<bool> b))        -> (sexp:bool b)
   (sexpf (<sym> s))         -> (sexp:symbol s)
   (sexpf (<string> s))      -> (sexp:string s)
+  (sexpf (<float> s))       -> (sexp:float s)
   (sexpf (<list> exp))      -> (sexp:list exp) ;; exp is (list sexp)
   (sexpf (<rec> field ...)) -> (sexp:record (sexprec field ...))
   (sexpf (<undef>))         -> (sexp:undef)
@@ -82,6 +85,24 @@
 (define (sexp=? a b)
   (eq? (cmp:=) (magic-cmp a b)))
 
+(define sexp/unpos
+  (sexp:pos _ _ exp) -> (sexp/unpos exp)
+  exp -> exp
+  )
+
+(define strip-field
+  (field:t name val) -> (field:t name (sexp/strip val)))
+
+;; remove all the source positions from <exp>.
+(define sexp/strip
+  (sexp:pos _ _ exp) -> (sexp/strip exp)
+  (sexp:list l)      -> (sexp:list (map sexp/strip l))
+  (sexp:vector l)    -> (sexp:vector (map sexp/strip l))
+  (sexp:record fl)   -> (sexp:record (map strip-field fl))
+  (sexp:attr exp a)  -> (sexp:attr (sexp/strip exp) a)
+  exp                -> exp
+  )
+
 (define (sexp1 sym rest)
   ;; build an s-expression with <sym> at the front followed by <rest>
   (sexp:list (list:cons (sexp:symbol sym) rest)))
@@ -114,6 +135,8 @@
   (sexp:record fl)  -> (format "{" (join repr-field " " fl) "}")
   (sexp:cons dt c)  -> (format (if (eq? dt 'nil) "" (symbol->string dt)) ":" (sym c))
   (sexp:attr lhs a) -> (format (repr lhs) "." (sym a))
+  (sexp:float s)    -> s
+  (sexp:pos _ _ x)  -> (repr x)
   )
 
 (define (indent n)
@@ -134,6 +157,8 @@
   (sexp:record fl)  -> (foldr binary+ (+ (length fl) 1) (map pp-size-field fl))
   (sexp:cons dt c)  -> (+ 1 (+ (string-length (symbol->string dt)) (string-length (symbol->string c))))
   (sexp:attr lhs a) -> (+ 1 (+ (pp-size lhs) (string-length (symbol->string a))))
+  (sexp:float s)    -> (string-length s)
+  (sexp:pos _ _ x)  -> (pp-size x)
   )
 
 (define (pp* exp width depth)
@@ -142,6 +167,8 @@
       (if (< size width)
 	  (printf (repr exp))
 	  (match exp with
+	    (sexp:pos _ _ x)
+	    -> (recur d x)
 	    (sexp:list ())
 	    -> (printf "()")
 	    (sexp:list (hd . tl))
@@ -8,15 +8,18 @@
   )
 
 (define (make-string n)
-  (%ensure-heap #f (string-tuple-length n))
   (%backend c
+    ;; large strings are allocated outside the heap.
+    (%ensure-heap #f (%%cexp (int -> int) "heap_words_for (string_tuple_length (%0))" n))
     (%%cexp
      (int -> string)
-     "(t=alloc_no_clear (TC_STRING, string_tuple_length (%0)), ((irk_string*)(t))->len = %0, t)"
+     "(t=alloc_bytes (TC_STRING, string_tuple_length (%0)), ((irk_string*)(t))->len = %0, t)"
      n))
   (%backend llvm
+    (%ensure-heap #f (string-tuple-length n))
     (%llvm-call ("@irk_make_string" (int -> string) ccc) n))
   (%backend bytecode
+    (%ensure-heap #f (string-tuple-length n))
     (%%cexp (int -> string) "smake" n))
   )
 
@@ -113,14 +116,13 @@
       (sj l '())))
 
 (define (string-split s ch)
-  (let loop ((i 0)
-	     (j 0)
-	     (acc '()))
-    (cond ((= i (string-length s)) (reverse (list:cons (substring s j i) acc)))
-	  ((char=? (string-ref s i) ch)
-	   (loop (+ i 1) (+ i 1) (list:cons (substring s j i) acc)))
-	  (else
-	   (loop (+ i 1) j acc)))))
+  (let ((n (string-length s)))
+    (let loop ((j 0)
+               (acc '()))
+      (let ((i (string-find-char ch s j n)))
+        (if (= i -1)
+            (reverse (list:cons (substring s j n) acc))
+            (loop (+ i 1) (list:cons (substring s j i) acc)))))))
 
 ;; XXX this needs to be renamed 'string-cmp'
 (define (string-compare a b) : (string string -> cmp)
@@ -134,19 +136,75 @@
 ;; alias
 (define string-cmp string-compare)
 
+;; compare a[a0:a0+alen] with b[b0:b0+blen], without copying.
+(define (string-range-cmp a a0 alen b b0 blen)
+  (%backend c
+    (%%cexp ((raw string) int int (raw string) int int -> cmp)
+            "irk_slice_cmp (%0, %1, %2, %3, %4, %5)"
+            a a0 alen b b0 blen))
+  (%backend llvm
+    (%llvm-call ("@irk_ll_slice_cmp" (string int int string int int -> cmp))
+                a a0 alen b b0 blen))
+  (%backend bytecode
+    (let loop ((i 0))
+      (cond ((or (= i alen) (= i blen)) (int-cmp alen blen))
+            (else
+             (let ((ca (char->int (string-ref a (+ a0 i))))
+                   (cb (char->int (string-ref b (+ b0 i)))))
+               (if (= ca cb)
+                   (loop (+ i 1))
+                   (int-cmp ca cb))))))))
+
+;; searching: each of these looks in s[start:end] and returns an index
+;;   into <s>, or -1.  under C and LLVM they're runtime scans
+;;   (memchr, and SSE2/AVX2 for char sets).
+
+(define (string-find-char ch s start end)
+  (string-range-check s start end)
+  (%backend c
+    (%%cexp ((raw string) int int int -> int) "irk_find_byte (%0, %1, %2, %3)"
+            s start end (char->int ch)))
+  (%backend llvm
+    (%llvm-call ("@irk_ll_find_byte" (string int int int -> int)) s start end (char->int ch)))
+  (%backend bytecode
+    (let loop ((i start))
+      (cond ((= i end) -1)
+            ((char=? (string-ref s i) ch) i)
+            (else (loop (+ i 1)))))))
+
+;; find any of the chars in the string <set>.
+(define (string-find-any set s start end)
+  (string-range-check s start end)
+  (%backend c
+    (%%cexp ((raw string) (raw string) int int -> int) "irk_find_byteset (%0, %1, %2, %3)"
+            set s start end))
+  (%backend llvm
+    (%llvm-call ("@irk_ll_find_byteset" (string string int int -> int)) set s start end))
+  (%backend bytecode
+    (let ((nset (string-length set)))
+      (let loop ((i start))
+        (cond ((= i end) -1)
+              ((>= (string-find-char (string-ref s i) set 0 nset) 0) i)
+              (else (loop (+ i 1))))))))
+
+;; find the string <a>.
+(define (string-find-range a s start end)
+  (string-range-check s start end)
+  (%backend c
+    (%%cexp ((raw string) (raw string) int int -> int) "irk_find_bytes (%0, %1, %2, %3)"
+            a s start end))
+  (%backend llvm
+    (%llvm-call ("@irk_ll_find_bytes" (string string int int -> int)) a s start end))
+  (%backend bytecode
+    (let ((alen (string-length a)))
+      (let loop ((i start))
+        (cond ((> (+ i alen) end) -1)
+              ((eq? (cmp:=) (string-range-cmp a 0 alen s i alen)) i)
+              (else (loop (+ i 1))))))))
+
 (define (string-find-from a b pos)
   ;; find <a> in <b>, starting at b[pos]
-  (let ((alen (string-length a))
-	(blen (string-length b)))
-    (if (< blen alen)
-	-1
-	(let loop ((i pos) (j 0))
-	  (cond ((= j alen) (- i j))
-		((= i blen) -1)
-		((eq? (string-ref a j) (string-ref b i))
-		 (loop (+ i 1) (+ j 1)))
-		(else
-		 (loop (+ i 1) 0)))))))
+  (string-find-range a b pos (string-length b)))
 
 (define (string-find a b)
   (string-find-from a b 0))
@@ -173,30 +231,32 @@
 
 (define (starts-with a b)
   ;; does <a> start with <b>?
-  (let ((alen (string-length a))
-	(blen (string-length b)))
-    (if (< alen blen)
-	#f
-	(let loop ((i 0))
-	  (cond ((= i blen) #t)
-		((eq? (string-ref a i) (string-ref b i))
-		 (loop (+ i 1)))
-		(else #f))))))
+  (let ((blen (string-length b)))
+    (and (<= blen (string-length a))
+         (eq? (cmp:=) (string-range-cmp a 0 blen b 0 blen)))))
 
 (define (ends-with a b)
   ;; does <a> end with <b>?
   (let ((alen (string-length a))
 	(blen (string-length b)))
-    (if (< alen blen)
-	#f
-	(let loop ((i 0))
-	  (cond ((= i blen) #t)
-		((eq? (string-ref a (- alen 1 i)) (string-ref b (- blen 1 i)))
-		 (loop (+ i 1)))
-		(else #f))))))
+    (and (<= blen alen)
+         (eq? (cmp:=) (string-range-cmp a (- alen blen) blen b 0 blen)))))
+
+;; 32-bit FNV-1a.
+(define (string-hash s)
+  (%backend c
+    (%%cexp ((raw string) -> int) "irk_string_hash (%0)" s))
+  (%backend llvm
+    (%llvm-call ("@irk_ll_string_hash" (string -> int)) s))
+  (%backend bytecode
+    (let ((h #x811c9dc5))
+      (for-range i (string-length s)
+        (set! h (logand #xffffffff (* (logxor h (char->int (string-ref s i))) #x01000193))))
+      h)))
 
 (define (string=? s1 s2)
-  (eq? (string-compare s1 s2) (cmp:=)))
+  (and (= (string-length s1) (string-length s2))
+       (eq? (string-compare s1 s2) (cmp:=))))
 (define (string<? s1 s2)
   (eq? (string-compare s1 s2) (cmp:<)))
 (define (string>? s1 s2)
@@ -0,0 +1,130 @@
+;; -*- Mode: Irken -*-
+
+;; a string slice is a view into part of a string: the base string, a
+;;   start offset and a length.  making one (or a slice of a slice)
+;;   doesn't copy.  the slice holds its base like any other field, so
+;;   the collector keeps the base alive and moves it along with the
+;;   slice; the offsets don't change.
+;;
+;; strings are mutable, so a slice sees writes to its base.  use
+;;   strslice->string for an owned copy.
+
+(datatype strslice
+  (:t string int int) ;; base start length
+  )
+
+(define (string->strslice s)
+  (strslice:t s 0 (string-length s)))
+
+(define (strslice/make s start end)
+  (string-range-check s start end)
+  (strslice:t s start (- end start)))
+
+(define strslice/length
+  (strslice:t _ _ len) -> len)
+
+;; slice <start>..<end> of a slice, relative to its start.
+(define (strslice/sub sl start end)
+  (match sl with
+    (strslice:t s start0 len)
+    -> (begin
+         (when (not (and (<= 0 start) (<= start end) (<= end len)))
+           (raise (:String/Range s start end)))
+         (strslice:t s (+ start0 start) (- end start)))))
+
+(define (strslice/ref sl i)
+  (match sl with
+    (strslice:t s start len)
+    -> (begin
+         (when (not (and (<= 0 i) (< i len)))
+           (raise (:String/Range s i i)))
+         (string-ref s (+ start i)))))
+
+(define strslice->string
+  (strslice:t s start len) -> (substring s start (+ start len)))
+
+(define strslice/compare
+  (strslice:t sa a0 alen) (strslice:t sb b0 blen)
+  -> (string-range-cmp sa a0 alen sb b0 blen))
+
+(define (strslice=? a b)
+  (and (= (strslice/length a) (strslice/length b))
+       (eq? (cmp:=) (strslice/compare a b))))
+
+(define (strslice<? a b)
+  (eq? (cmp:<) (strslice/compare a b)))
+
+;; compare against a string without copying either.
+(define (strslice/string=? sl s)
+  (strslice=? sl (string->strslice s)))
+
+;; the same as string-hash of the copy, so slices and strings can be
+;;   looked up in each other's hash tables.
+(define (slice-hash s start len)
+  (%backend c
+    (%%cexp ((raw string) int int -> int) "irk_slice_hash (%0, %1, %2)" s start len))
+  (%backend llvm
+    (%llvm-call ("@irk_ll_slice_hash" (string int int -> int)) s start len))
+  (%backend bytecode
+    (let ((h #x811c9dc5))
+      (for-range* i start (+ start len)
+        (set! h (logand #xffffffff (* (logxor h (char->int (string-ref s i))) #x01000193))))
+      h)))
+
+(define strslice-hash
+  (strslice:t s start len) -> (slice-hash s start len))
+
+;; find string <a> in <sl>, starting at sl[pos].  returns an index
+;;   relative to the slice, or -1.
+(define (strslice/find-from a sl pos)
+  (match sl with
+    (strslice:t s start len)
+    -> (let ((i (string-find-range a s (+ start pos) (+ start len))))
+         (if (= i -1) -1 (- i start)))))
+
+;; find any of the chars in <set>, likewise.
+(define (strslice/find-any set sl pos)
+  (match sl with
+    (strslice:t s start len)
+    -> (let ((i (string-find-any set s (+ start pos) (+ start len))))
+         (if (= i -1) -1 (- i start)))))
+
+(define (strslice/find a sl)
+  (strslice/find-from a sl 0))
+
+(define (strslice/starts-with sl prefix)
+  (let ((n (string-length prefix)))
+    (and (<= n (strslice/length sl))
+         (strslice/string=? (strslice/sub sl 0 n) prefix))))
+
+;; like string-split, but the pieces are views of <sl>.
+(define (strslice/split sl ch)
+  (match sl with
+    (strslice:t s start len)
+    -> (let ((end (+ start len)))
+         (let loop ((j start)
+                    (acc '()))
+           (let ((i (string-find-char ch s j end)))
+             (if (= i -1)
+                 (reverse (list:cons (strslice:t s j (- end j)) acc))
+                 (loop (+ i 1) (list:cons (strslice:t s j (- i j)) acc))))))))
+
+;; like string-split-string, but the pieces are views of <sl>.
+(define (strslice/split-string sl sep)
+  (let ((len (strslice/length sl))
+        (seplen (string-length sep))
+        (r '()))
+    (when (= seplen 0)
+      (raise (:String/SplitEmpty sep)))
+    (let loop ((pos 0))
+      (let ((where (strslice/find-from sep sl pos)))
+        (if (= where -1)
+            (begin
+              (push! r (strslice/sub sl pos len))
+              (reverse r))
+            (begin
+              (push! r (strslice/sub sl pos where))
+              (loop (+ where seplen))))))))
+
+(define (strslice-repr sl)
+  (repr-string (strslice->string sl)))
@@ -3,6 +3,8 @@
 ;; note: this is in derived.scm (which is auto-included)
 ;; (datatype symbol (:t string int)) ;; string unique-id
 
+(require "lib/hashtable.scm")
+
 (define symbol->string
   (symbol:t str _) -> str
   )
@@ -11,17 +13,20 @@
   (symbol:t _ index) -> index
   )
 
+;; the intern table is hashed on the symbol's name.  it's seeded with
+;;   the symbol literals the backend emitted into the program image.
+
 (define symbol-table-size 0)
 (define the-symbol-table (initial-symbol-table))
 
 (define (intern-symbol sym)
-  (tree/insert! the-symbol-table string-compare (symbol->string sym) sym)
+  (hashtable/put! the-symbol-table (symbol->string sym) sym)
   (inc! symbol-table-size)
   sym
   )
 
 (define (string->symbol str)
-  (match (tree/member the-symbol-table string-compare str) with
+  (match (hashtable/get the-symbol-table str) with
     (maybe:no) -> (intern-symbol (symbol:t str symbol-table-size))
     (maybe:yes sym) -> sym
     ))
@@ -38,6 +43,10 @@
 (define symbol-index-cmp
   (symbol:t _ i0) (symbol:t _ i1) -> (int-cmp i0 i1))
 
+;; interned symbols are unique, so eq? is enough to compare them.
+(define (symbol-hash sym)
+  (int-hash (symbol->index sym)))
+
 (define (get-internal-symbols)
   (%backend c
     (%%cexp (vector symbol) "(object *) irk_internal_symbols"))
@@ -49,9 +58,9 @@
 
 (define (initial-symbol-table)
   (let ((v (get-internal-symbols))
-        (map (tree/empty)))
+        (map (hashtable/make string-hash string=?)))
     (for-range i (vector-length v)
-      (tree/insert! map string-compare (symbol->string v[i]) v[i]))
+      (hashtable/put! map (symbol->string v[i]) v[i]))
     (set! symbol-table-size (vector-length v))
     map
     ))
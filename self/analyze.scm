@@ -776,6 +776,148 @@
   (search root)
   )
 
+;; C backend only, after typing.
+;;
+;; (float+ (float* a b) c) inlines to
+;;
+;;   (let ((t (%%cexp (float float -> float) "%0*%1" a b)))
+;;     (%%cexp (float float -> float) "%0+%1" t c))
+;;
+;; which boxes <t> only to unbox it again.  When a float-valued cexp
+;;   of float/int variables and literals is used exactly once, as a
+;;   float argument of another cexp (and not from inside a function),
+;;   fold it into that cexp:
+;;
+;;   (%%cexp (float float float -> float) "(%0*%1)+%2" a b c)
+;;
+;; so that intermediate results stay in C doubles.  such a cexp is pure,
+;;   and its variables are never assigned, so it can be evaluated later.
+
+(define (fuse-float-cexps root)
+
+  (let ((refs (tree/empty)) ;; name -> {n=int set=bool}
+        (fused '()))
+
+    (define (get-ref name)
+      (match (tree/member refs symbol-index-cmp name) with
+        (maybe:yes r) -> r
+        (maybe:no)
+        -> (let ((r {n=0 set=#f}))
+             (tree/insert! refs symbol-index-cmp name r)
+             r)))
+
+    (define (count node)
+      (match (noderec->t node) with
+        (node:varref name) -> (let ((r (get-ref name))) (set! r.n (+ r.n 1)))
+        (node:varset name) -> (let ((r (get-ref name))) (set! r.set #t))
+        _ -> #u)
+      (for-each count (noderec->subs node)))
+
+    (define (float-type? t)
+      (is-pred? t 'float))
+
+    (define (simple-arg? node)
+      (match (noderec->t node) with
+        (node:varref name) -> (let ((r (get-ref name))) (not r.set))
+        (node:literal _)   -> #t
+        _                  -> #f))
+
+    (define (fusable? node)
+      (match (noderec->t node) with
+        (node:cexp _ (type:pred 'arrow (result . params) _) template)
+        -> (and (float-type? result)
+                (every? (lambda (t) (or (float-type? t) (is-pred? t 'int))) params)
+                (every? simple-arg? (noderec->subs node))
+                (= -1 (string-find "%%" template)))
+        _ -> #f))
+
+    ;; fold <inner> into argument <k> of <outer>.
+    (define (fuse outer k inner)
+      (match (noderec->t outer) (noderec->t inner) with
+        (node:cexp gens0 (type:pred 'arrow (r0 . ps0) _) t0)
+        (node:cexp gens1 (type:pred 'arrow (_ . ps1) _) t1)
+        -> (let ((n0 (length ps0))
+                 (n1 (length ps1))
+                 (inner-vals (map (lambda (j) (format "%" (int (+ k j)))) (range n1)))
+                 (vals (map (lambda (i)
+                              (cond ((< i k) (format "%" (int i)))
+                                    ((= i k) (format "(" (cexp-subst t1 inner-vals) ")"))
+                                    (else (format "%" (int (+ i n1 -1))))))
+                            (range n0)))
+                 (args0 (noderec->subs outer)))
+             (set-node-t! outer (node:cexp (append gens0 gens1)
+                                           (arrow r0 (append (slice ps0 0 k) ps1 (slice ps0 (+ k 1) n0)))
+                                           (cexp-subst t0 vals)))
+             (set-node-subs! outer (append (slice args0 0 k)
+                                           (noderec->subs inner)
+                                           (slice args0 (+ k 1) n0))))
+        _ _ -> (impossible)))
+
+    ;; the argument of <node> that can take a cexp from <cands>, if any.
+    (define (find-arg node cands)
+      (match (noderec->t node) with
+        (node:cexp _ (type:pred 'arrow (_ . params) _) template)
+        -> (let loop ((i 0) (args (noderec->subs node)) (params params))
+             (match args params with
+               (arg . args) (param . params)
+               -> (match (float-type? param) (noderec->t arg) with
+                    #t (node:varref name)
+                    -> (match (tree/member cands symbol-index-cmp name) with
+                         (maybe:yes inner)
+                         -> (if (< (+ (length (noderec->subs node)) (length (noderec->subs inner))) 12)
+                                (maybe:yes (:tuple i name inner))
+                                (maybe:no))
+                         (maybe:no) -> (loop (+ i 1) args params))
+                    _ _ -> (loop (+ i 1) args params))
+               _ _ -> (maybe:no)))
+        _ -> (maybe:no)))
+
+    (define (search node cands)
+      (match (noderec->t node) with
+        (node:function _ _)
+        -> (begin (set-node-subs! node (map (lambda (x) (search x (tree/empty))) (noderec->subs node)))
+                  node)
+        (node:let names)
+        -> (let ((subs (noderec->subs node))
+                 (n (length names))
+                 (inits '()))
+             (for-range i n
+               (let ((name (nth names i))
+                     (init (search (nth subs i) cands))
+                     (r (get-ref name)))
+                 (push! inits init)
+                 (when (and (= r.n 1) (not r.set) (fusable? init))
+                   (tree/insert! cands symbol-index-cmp name init))))
+             (let ((body (search (nth subs n) cands))
+                   (new-names '())
+                   (new-inits '()))
+               ;; drop the bindings that were folded away
+               (for-range-rev i n
+                 (let ((name (nth names i)))
+                   (when (not (member-eq? name fused))
+                     (push! new-names name)
+                     (push! new-inits (nth inits (- n i 1))))))
+               (if (null? new-names)
+                   body
+                   (begin
+                     (set-node-t! node (node:let new-names))
+                     (set-node-subs! node (append new-inits (list body)))
+                     node))))
+        _ -> (begin
+               (set-node-subs! node (map (lambda (x) (search x cands)) (noderec->subs node)))
+               (let loop ()
+                 (match (find-arg node cands) with
+                   (maybe:yes (:tuple k name inner))
+                   -> (begin (fuse node k inner)
+                             (push! fused name)
+                             (loop))
+                   (maybe:no) -> node)))
+        ))
+
+    (count root)
+    (search root (tree/empty))
+    ))
+
 ;; remove unused functions/variables from fix nodes.
 (define (do-trim top)
   (let ((g the-context.dep-graph)
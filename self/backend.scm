@@ -32,6 +32,18 @@
     {write=write-string indent=indent dedent=dedent copy=push close=close-file get-total=get-total flush=flush}
     ))
 
+;; a writer that knows the source position of the code being written
+;;   (see insn:line), and passes each line through <annotate> to mark
+;;   it with that position.  the position is only ever set with -g.
+(define (make-pos-writer o annotate)
+  (let ((pos (srcpos:none)))
+    (define (write s) (annotate o pos s))
+    (define (get-pos) pos)
+    (define (set-pos p) (set! pos p))
+    {write=write indent=o.indent dedent=o.dedent copy=o.copy close=o.close
+     get-total=o.get-total flush=o.flush get-pos=get-pos set-pos=set-pos}
+    ))
+
 (define (make-name-frobber)
   (define safe-name-map
     (literal
@@ -116,6 +128,8 @@
 (define TC_BUFFER       (<<  8 2)) ;; 00100000  20
 (define TC_FOREIGN      (<<  9 2)) ;; 00100100  24
 (define TC_USEROBJ      (<< 10 2)) ;; 00100100  24
+(define TC_FLOAT        (<< 60 2)) ;; 11110000  f0
+(define TC_PACKED       (<< 59 2)) ;; 11101100  ec
 
 (define (find-jumps insns)
   (let ((used (map-maker int-cmp)))
@@ -179,6 +193,29 @@ void prof_dump (void)
       (o.write (format "   {0, 0, 0, 0, \"" (join symbol->string "." name) "\"},"))))
   (o.write "   {0, 0, 0, 0, NULL}};"))
 
+;; names for the heap profiler: every datatype alt, record and
+;;   polymorphic variant that may be using each user object tag.
+(define (emit-profile-tag-names o)
+  (let ((ntags UOTAG-LIMIT)
+        (names (make-vector UOTAG-LIMIT '())))
+    (define (add! index name)
+      (when (< index ntags)
+        (set! names[index] (list:cons name names[index]))))
+    (for-alist name dt the-context.datatypes
+      (when (not (eq? name 'list)) ;; list:cons is a TC_PAIR
+        (dt.iterate
+         (lambda (tag alt)
+           (when (> (length alt.types) 0)
+             (add! alt.index (format (sym name) ":" (sym tag))))))))
+    (for-map index sig the-context.records.rev
+      (add! index (format "{" (join symbol->string " " sig) "}")))
+    (for-alist label index the-context.variant-labels
+      (add! index (format ":" (sym label))))
+    (o.write "static char * prof_tag_names[] = {")
+    (for-range i ntags
+      (o.write (format "  \"" (join " " (reverse names[i])) "\",")))
+    (o.write "  NULL};")))
+
 ;; with large programs, the constructed initializers can get *really*
 ;;  long... long enough to cause problems even for emacs.
 (define (sprinkle-newlines parts)
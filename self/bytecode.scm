@@ -7,6 +7,9 @@
   (let ((m (map-maker symbol-index-cmp)))
     (for-vector info opcode-info
       (m::add info.name info))
+    (for-vector sup superop-info
+      (let ((info sup.info))
+        (m::add info.name info)))
     m))
 
 (define (name->info name)
@@ -21,16 +24,50 @@
     ))
 
 ;; insn stream consists of bytecodes, label defs, and label refs.
+;;   resolve-labels turns an insn into a wide one when one of its
+;;   operands doesn't fit in a byte.
 (datatype stream
   (:label int)
   (:insn symbol (list int))
+  (:wide symbol (list int))
   )
 
+;; the low <nbytes> bytes of <n>, least significant first.
+(define (le-bytes n nbytes)
+  (let ((s (make-string nbytes)))
+    (for-range i nbytes
+      (string-set! s i (ascii->char (logand #xff (>> n (* 8 i))))))
+    s))
+
+;; a .byc file is a header, the literals as a heap image and then the
+;;   code, all little-endian.  see read_bytecode_image() in vm/irkvm.c.
+(define BYC-MAGIC (format "IRKBYC" (le-bytes 0 2)))
+(define BYC-VERSION 3)
+(define BYC-HEADER-SIZE 64)
+
 (define stream-repr
   (stream:label n)  -> (format "L" (int n) ":")
   (stream:insn op args) -> (format " " (sym op) " " (join int->string " " args))
+  (stream:wide op args) -> (format " wide " (sym op) " " (join int->string " " args))
   )
 
+;; the size in bytes of an insn: a narrow one is an opcode and a
+;;   signed byte for each operand, a wide one is the 'wide' opcode,
+;;   the opcode and four bytes for each operand.
+(define stream-size
+  (stream:label _)     -> 0
+  (stream:insn _ args) -> (+ 1 (length args))
+  (stream:wide _ args) -> (+ 2 (* 4 (length args)))
+  )
+
+(define stream-insn?
+  (stream:label _) -> #f
+  _                -> #t
+  )
+
+(define (fits-byte? n)
+  (and (>= n -128) (< n 128)))
+
 (defmacro INSN
   (INSN name arg0 ...)
   -> (stream:insn name (list arg0 ...))
@@ -51,8 +88,15 @@
         (jump-label-map (map-maker int-cmp))
         (fun-label-map (map-maker symbol-index-cmp))
         (fatbar-map (map-maker int-cmp))
+        ;; label -> the function whose code starts there
+        (label-owners (map-maker int-cmp))
+        (current-fun 'toplevel)
         (sizeoff-map (cmap/make magic-cmp))
         (lit-already (map-maker magic-cmp))
+        ;; the literal image, see image-literal
+        (image '())
+        (image-words 2)
+        (nsymbols 0)
         ;; remember where the metadata is
         (metadata-index the-context.literals.count)
         )
@@ -84,7 +128,7 @@
         (insn:close name nreg body k)                 -> (emitk (emit-close name nreg body k.target) k)
         (insn:new-env size top? types k)              -> (emitk (emit-new-env size top? types k.target) k)
         (insn:push r k)                               -> (emitk (emit-push r) k)
-        (insn:store off arg tup i k)                  -> (emitk (emit-store off arg tup i) k)
+        (insn:store off arg tup i _ k)                -> (emitk (emit-store off arg tup i) k)
         (insn:varref d i k)                           -> (emitk (emit-varref d i k.target) k)
         (insn:tail name fun args)                     -> (emit-tail name fun args)
         (insn:varset d i v k)                         -> (emitk (emit-varset d i v k.target) k)
@@ -101,31 +145,9 @@
         (insn:testcexp regs sig tmpl jn k0 k1 k)      -> (impossible)
         (insn:ffi sig type name args k)               -> (error1 "ffi being redesigned." insn)
         (insn:label label next)                       -> (emit next)
+        (insn:line pos next)                          -> (emit next) ;; no line table in the VM
         ))
 
-    (define (encode-int n)
-
-      (define E
-        0 acc -> (list->string
-                  (cons (ascii->char 255)
-                        (cons (ascii->char (length acc))
-                              acc)))
-        n acc -> (E (>> n 8) (cons (ascii->char (logand n #xff)) acc))
-        )
-
-      ;; encoding:
-      ;; n  < 254 := n
-      ;; n == 254 := -encoded
-      ;; n == 255 := <nbytes> <byte n> <byte n-1> ... <byte 0>
-
-      (cond ((< n 0) (format "\xfe" (encode-int (- n))))
-            ((< n 254) (char->string (ascii->char n)))
-            (else
-             (let ((r (E n '())))
-               (if (> (string-length r) 254)
-                   (raise (:IntegerTooBig n))
-                   r)))))
-
     (define (UITAG n) (+ TC_USERIMM (<< n 8)))
     (define (UOTAG n) (+ TC_USEROBJ (<< n 2)))
 
@@ -219,13 +241,18 @@
                     (LINSN 'gc)
                     '())))
         (fun-label-map::add name lfun)
-        (append
-         (LINSN 'fun target l0)
-         (list (stream:label lfun))
-         gc
-         (emit body)
-         (list (stream:label l0))
-         )))
+        (label-owners::add lfun name)
+        (label-owners::add l0 current-fun)
+        (let ((outer current-fun)
+              (code (begin (set! current-fun name) (emit body))))
+          (set! current-fun outer)
+          (append
+           (LINSN 'fun target l0)
+           (list (stream:label lfun))
+           gc
+           code
+           (list (stream:label l0))
+           ))))
 
     (define (emit-new-env size top? types target)
       (append
@@ -376,7 +403,7 @@
                 (maybe:no)
                 -> (begin
                      (ambig label-code)
-                     (LINSN 'rref target rec-reg label-code))
+                     (LINSN 'rref target rec-reg label-code 0 0))
                 ))
          _ _ -> (primop-error))
 
@@ -389,7 +416,7 @@
                 (maybe:no)
                 -> (begin
                      (ambig label-code)
-                     (LINSN 'rset rec-reg label-code arg-reg))))
+                     (LINSN 'rset rec-reg label-code arg-reg 0 0))))
          _ _ -> (primop-error))
 
        (define prim-getcc
@@ -653,179 +680,261 @@
           (literal:vector (list (literal:vector (map literal:int (vector->list G)))
                                 (literal:vector (map literal:int (vector->list V))))))))
 
-    ;; XXX why did I do this with a quasi-readable encoding?  seems like it would
-    ;;   have made more sense to just use the runtime encoding?  i.e., instead of
-    ;;   'T'==#t, use #106?
-
-    ;; XXX once we have an 'official' streaming encoding for random datatypes, consider
-    ;;   switching to that encoding for literals/etc.
-
     (define get-dtcon-tag
       'nil label -> (alist/get the-context.variant-labels label "unknown variant label")
       dt variant -> (let ((dtob (alist/get the-context.datatypes dt "no such datatype"))
                           (alt (dtob.get variant)))
                       alt.index))
 
-    (define (emit-one-literal ob)
+    ;; the literal section is a heap image: two roots (the literals
+    ;;   vector and the field lookup table), then the objects.  a
+    ;;   pointer is the byte offset of its object from the start of the
+    ;;   section; the VM adds the address it mapped the section at.
+
+    (define (image-word w)
+      (push! image (le-bytes w 8))
+      (inc! image-words))
+
+    ;; lay out a tuple and return a pointer to it.
+    (define (image-tuple tag words)
+      (let ((ptr (* 8 image-words)))
+        (image-word (logior (<< (length words) 8) tag))
+        (for-list w words
+          (image-word w))
+        ptr))
+
+    (define (image-string s)
+      (let ((n (string-length s))
+            (nwords (how-many (+ n 4) 8))
+            (ptr (* 8 image-words)))
+        (image-word (logior (<< nwords 8) TC_STRING))
+        (push! image (le-bytes n 4))
+        (push! image s)
+        (push! image (le-bytes 0 (- (* 8 nwords) (+ n 4))))
+        (set! image-words (+ image-words nwords))
+        ptr))
+
+    ;; the word for <ob>: an immediate, or a pointer into the image.
+    (define (image-literal ob)
       (match (lit-already::get ob) with
-        (maybe:yes index)
-        -> (o.copy (format "P" (encode-int index)))
+        (maybe:yes w) -> w
         (maybe:no)
         -> (match ob with
-             (literal:int n)
-             -> (if (< n 0)
-                    (o.copy (format "-" (encode-int (- 0 n))))
-                    (o.copy (format "+" (encode-int n))))
-             (literal:char ch) -> (o.copy (format "c" (encode-int (char->ascii ch))))
-             (literal:undef)   -> (o.copy "u")
-             (literal:string s)
-             -> (begin
-                  (o.copy (format "S" (encode-int (string-length s))))
-                  (o.copy s))
-             (literal:bool #t) -> (o.copy "T")
-             (literal:bool #f) -> (o.copy "F")
+             (literal:string s) -> (image-string s)
+             (literal:symbol s)
+             -> (let ((name (image-string (symbol->string s)))
+                      (index nsymbols))
+                  (inc! nsymbols)
+                  (image-tuple TC_SYMBOL (list name (encode-immediate (literal:int index)))))
+             (literal:cons dt variant ())
+             -> (get-uitag dt variant (get-dtcon-tag dt variant))
              (literal:cons dt variant args)
-             -> (let ((tag (get-dtcon-tag dt variant))
-                      (nargs (length args)))
-                  (if (= nargs 0)
-                      ;; immediate constructor
-                      (o.copy (format "I" (encode-int (get-uitag dt variant tag))))
-                      ;; constructor with args
-                      (begin
-                        (o.copy (format "C"
-                                        (encode-int (get-uotag dt variant tag))
-                                        (encode-int nargs)))
-                        (for-list arg args
-                          (emit-one-literal arg)))))
+             -> (let ((words (map image-literal args)))
+                  (image-tuple (get-uotag dt variant (get-dtcon-tag dt variant)) words))
+             (literal:vector ())
+             -> (encode-immediate ob)
              (literal:vector args)
-             -> (begin
-                  (o.copy (format "V" (encode-int (length args))))
-                  (for-list arg args
-                    (emit-one-literal arg)))
+             -> (image-tuple TC_VECTOR (map image-literal args))
              (literal:record tag fields)
-             -> (begin
-                  (o.copy (format "C"
-                                  (encode-int (+ TC_USEROBJ (<< tag 2)))
-                                  (encode-int (length fields))))
-                  (for-list field fields
-                    (match field with
-                      (litfield:t _ val)
-                      -> (emit-one-literal val))))
-             (literal:symbol s)
-             -> (let ((s0 (symbol->string s)))
-                  (o.copy (format "Y" (encode-int (string-length s0))))
-                  (o.copy s0))
+             -> (let ((words (map (lambda (field)
+                                    (match field with
+                                      (litfield:t _ val) -> (image-literal val)))
+                                  fields)))
+                  (image-tuple (+ TC_USEROBJ (<< tag 2)) words))
              ;; Note: sexp is done via literal:cons
-             _ -> (error1 "NYI literal type" (literal->string ob))
-             )
-        ))
-
-    (define (emit-literals)
-      ;; encode literals into the bytecode stream.
-      ;; emit constructed literals as a vector
-      (let ((lits0 the-context.literals)
-            (nlits lits0.count))
-        (o.copy (format "V" (encode-int nlits)))
+             _ -> (encode-immediate ob)
+             )))
+
+    ;; returns the whole literal section.  the sizeoff vector replaces
+    ;;   the sentinel at <sizeoff-index>, if there is one.
+    (define (build-literal-image sizeoff-index sizeoff-literal)
+      (let ((lits the-context.literals)
+            (nlits lits.count)
+            (words (make-vector nlits 0)))
         (for-range i nlits
-          (let ((item (cmap->item lits0 i)))
-            (emit-one-literal item)
-            (lit-already::add item i))
-          )
-        ))
-
+          (let ((item (cmap->item lits i))
+                (w (image-literal item)))
+            (set! words[i] w)
+            (lit-already::add item w)))
+        (let ((table (image-literal (build-field-lookup-table)))
+              (sizeoff (image-literal (literal:vector sizeoff-literal))))
+          (when (>= sizeoff-index 0)
+            (set! words[sizeoff-index] sizeoff))
+          (let ((vec (image-tuple TC_VECTOR (vector->list words))))
+            (string-concat (prepend (le-bytes vec 8) (le-bytes table 8) (reverse image)))))))
+
+    ;; offsets are in bytes, from the start of the insn, and how far a
+    ;;   label is depends on which insns before it are wide.  so start
+    ;;   with every insn narrow, and widen the ones that don't fit until
+    ;;   nothing changes.  an insn never gets narrower again, so this
+    ;;   terminates.  labels are kept in the result, for write-pc-map.
     (define (resolve-labels s)
 
-      ;; we use pc-relative offsets here, trying to keep the code size small.
-
-      (let ((pc 0)
-            (r '())
+      (let ((items (list->vector s))
+            (n (vector-length items))
+            (wide (make-vector n #f))
             (label-map (map-maker int-cmp)))
 
-        (define (resolve index)
+        (define (resolve index pc)
           (match (label-map::get index) with
             (maybe:yes val) -> (- val pc)
             (maybe:no)      -> (raise (:BadLabel index))
             ))
 
-        (define resolve-tag-pairs
-          (tag lab . rest)
-          -> (cons tag (cons (resolve lab) (resolve-tag-pairs rest)))
-          () -> '()
-          x -> (error1 "odd-length tag pairs" x)
-          )
-
-        ;; first pass - compute label offsets (and make sure no negative args)
-        (for-list insn s
-          (match insn with
-            (stream:insn name args)
-            -> (begin
-                 (set! pc (+ pc 1 (length args)))
-                 (if (some? <0 args)
-                     (raise (:BadBytecodeArg pc))))
-            (stream:label index)
-            -> (label-map::add index pc)
+        (define (resolve-tag-pairs pairs pc)
+          (match pairs with
+            (tag lab . rest) -> (cons tag (cons (resolve lab pc) (resolve-tag-pairs rest pc)))
+            () -> '()
+            x -> (error1 "odd-length tag pairs" x)
             ))
 
-        (set! pc 0)
-        ;; second pass - replace label index with label offsets
-        (for-list insn s
+        ;; the operands of <insn> at <pc>, with label indexes replaced by offsets.
+        (define (resolve-args insn pc)
           (match insn with
-            ;; ignore label defs
-            (stream:label _)
-            -> #u
             (stream:insn 'tst (target index))
-            -> (push! r (INSN 'tst target (resolve index)))
+            -> (list target (resolve index pc))
             (stream:insn 'jmp (index))
-            -> (push! r (INSN 'jmp (resolve index)))
+            -> (list (resolve index pc))
             (stream:insn 'fun (target index))
-            -> (push! r (INSN 'fun target (resolve index)))
+            -> (list target (resolve index pc))
             (stream:insn 'trcall (index depth nregs . args))
-            -> (push! r (stream:insn 'trcall (prepend (resolve index) depth nregs args)))
+            -> (prepend (resolve index pc) depth nregs args)
             (stream:insn 'trcall0 (index depth))
-            -> (push! r (INSN 'trcall0 (resolve index) depth))
+            -> (list (resolve index pc) depth)
             (stream:insn 'nvcase (ob elabel nalts . pairs))
-            -> (let ((pairs0 (resolve-tag-pairs pairs)))
-                 (push! r (stream:insn 'nvcase (prepend ob (resolve elabel) nalts pairs0))))
-            _ -> (push! r insn)
-            )
-          ;; bump pc *after* offsets resolved.
-          (match insn with
-            (stream:label _)
-            -> #u
+            -> (prepend ob (resolve elabel pc) nalts (resolve-tag-pairs pairs pc))
             (stream:insn _ args)
-            -> (set! pc (+ pc 1 (length args)))
+            -> args
+            (stream:label _)
+            -> (list:nil)
+            _ -> (impossible)
+            ))
+
+        (define (place insn args wide?)
+          (match insn with
+            (stream:insn name _)
+            -> (cond ((not wide?) (stream:insn name args))
+                     ((wide-op? name) (stream:wide name args))
+                     (else (raise (:WideOperand name args))))
+            _ -> insn
+            ))
+
+        ;; the label indexes take up as much room as the offsets.
+        (define (insn-size insn wide?)
+          (match insn with
+            (stream:insn name args)
+            -> (stream-size (if wide? (stream:wide name args) insn))
+            _ -> 0
             ))
 
-        ;; modified insns
-        (reverse r)
+        ;; make sure no negative args
+        (for-vector insn items
+          (match insn with
+            (stream:insn name args)
+            -> (when (some? <0 args)
+                 (raise (:BadBytecodeArg name)))
+            _ -> #u
+            ))
 
+        (let loop ()
+          (let ((pc 0)
+                (changed #f))
+            ;; where the labels are, with the current widths.
+            (set! label-map (map-maker int-cmp))
+            (for-range i n
+              (match items[i] with
+                (stream:label index)
+                -> (label-map::add index pc)
+                insn
+                -> (set! pc (+ pc (insn-size insn wide[i])))
+                ))
+            ;; widen the insns that don't fit.  the pc has to agree with
+            ;;   label-map, so it goes by the widths from before this pass.
+            (set! pc 0)
+            (for-range i n
+              (let ((insn items[i])
+                    (size (insn-size insn wide[i])))
+                (match insn with
+                  (stream:insn name _)
+                  -> (when (and (not wide[i]) (not (every? fits-byte? (resolve-args insn pc))))
+                       (set! wide[i] #t)
+                       (set! changed #t))
+                  _ -> #u)
+                (set! pc (+ pc size))))
+            (when changed
+              (loop))))
+
+        (let ((pc 0)
+              (r '()))
+          (for-range i n
+            (let ((insn items[i]))
+              (push! r (place insn (resolve-args insn pc) wide[i]))
+              (set! pc (+ pc (insn-size insn wide[i])))))
+          (reverse r))
         ))
 
-    (define (encode-insn name args)
+    ;; for the sampling profiler, see read_pc_map() in vm/irkvm.c.
+    (define (write-pc-map s)
+      (let ((mfile (file/open-write (string-append opath ".map") #t #o644))
+            (m (make-writer mfile))
+            (pc 0))
+        (m.write "0 toplevel")
+        (for-list item s
+          (match item with
+            (stream:label index)
+            -> (match (label-owners::get index) with
+                 (maybe:yes name) -> (m.write (format (int pc) " " (sym name)))
+                 (maybe:no) -> #u)
+            _ -> (set! pc (+ pc (stream-size item)))
+            ))
+        (m.close)))
+
+    (define (insn-words name args)
       (let ((info (name->info name)))
         (match (int-cmp (length args) info.nargs) info.varargs with
           (cmp:<)  _ -> (raise (:BadArity name))
           (cmp:>) #f -> (raise (:BadArity name))
-          _ _        -> (string-concat (map encode-int (cons info.code args)))
+          _ _        -> (list:cons info.code args)
           )))
 
-    (define (emit-stream s)
-      ;; first, compute the length (in words) of this stream.
-      (let ((len 0))
+    ;; the code section, see stream-size.
+    (define (encode-stream s)
+      (let ((len (fold (lambda (item acc) (+ acc (stream-size item))) 0 s))
+            (code (make-string len))
+            (pc 0))
+        (define (put n nbytes)
+          (for-range i nbytes
+            (string-set! code (+ pc i) (ascii->char (logand #xff (>> n (* 8 i))))))
+          (set! pc (+ pc nbytes)))
         (for-list item s
           (match item with
             (stream:insn name args)
-            -> (set! len (+ len 1 (length args)))
-            _ -> (error1 "unresolved label?" item)
+            -> (for-list w (insn-words name args)
+                 (put w 1))
+            (stream:wide name args)
+            -> (begin
+                 (put (name->opcode 'wide) 1)
+                 (put (name->opcode name) 1)
+                 (for-list w args
+                   (when (or (< w (- 0 (<< 1 31))) (>= w (<< 1 31)))
+                     (raise (:IntegerTooBig w)))
+                   (put w 4)))
+            (stream:label _)
+            -> #u
             ))
-        ;; let the VM know how many words are coming...
-        (o.copy (encode-int len)))
-      (for-list item s
-        (match item with
-          (stream:insn name args)
-          -> (o.copy (encode-insn name args))
-          _ -> (impossible)
-          )))
+        code))
+
+    (define (emit-header lit-bytes code-bytes)
+      (o.copy BYC-MAGIC)
+      (o.copy (le-bytes BYC-VERSION 4))
+      (o.copy (le-bytes #x01020304 4)) ;; byte order
+      (o.copy (le-bytes 8 4))          ;; word size
+      (o.copy (le-bytes (+ (vector-length opcode-info) (vector-length superop-info)) 4))
+      (o.copy (le-bytes BYC-HEADER-SIZE 8))
+      (o.copy (le-bytes (/ lit-bytes 8) 8))
+      (o.copy (le-bytes (+ BYC-HEADER-SIZE lit-bytes) 8))
+      (o.copy (le-bytes code-bytes 8))
+      (o.copy (le-bytes metadata-index 8)))
 
     (define peephole
       ;; only one optimization so far
@@ -842,16 +951,48 @@
       acc () -> (reverse acc)
       )
 
+    (define run-matches?
+      () _ -> #t
+      (op . ops) ((stream:insn name _) . tl) -> (and (eq? op name) (run-matches? ops tl))
+      _ _ -> #f
+      )
+
+    ;; the longest superinstruction that starts at the front of <s>.
+    (define (match-superop s)
+      (let ((best (maybe:no))
+            (best-len 0))
+        (for-vector sup superop-info
+          (let ((n (length sup.ops)))
+            (when (and (> n best-len) (run-matches? sup.ops s))
+              (set! best (maybe:yes sup))
+              (set! best-len n))))
+        best))
+
+    ;; replace the opcode of the first insn of each superinstruction
+    ;;   (see self/byteops.scm), leaving the rest of the sequence alone.
+    (define (fuse s)
+      (let loop ((s s)
+                 (acc '()))
+        (match s with
+          () -> (reverse acc)
+          (insn . tl)
+          -> (match insn (match-superop s) with
+               (stream:insn _ args) (maybe:yes sup)
+               -> (let ((info sup.info)
+                        (rest tl))
+                    (push! acc (stream:insn info.name args))
+                    (for-range i (- (length sup.ops) 1)
+                      (push! acc (car rest))
+                      (set! rest (cdr rest)))
+                    (loop rest acc))
+               _ _ -> (loop tl (list:cons insn acc)))
+          )))
+
     (define (print-stream s)
       (let ((pc 0))
         (for-list item s
           (printf (rpad 5 (int pc)) " " (stream-repr item) "\n")
-          (match item with
-            (stream:insn name args)
-            -> (set! pc (+ pc 1 (length args)))
-            _ -> #u
-            )
-          )))
+          (set! pc (+ pc (stream-size item))))))
 
     ;; some immediate literals we cannot encode in the bytecode
     ;;  stream, so we refer to them by index.
@@ -921,8 +1062,6 @@
 
     (notquiet (printf "bytecode output...\n"))
 
-    (o.copy "IRKVM0") ;; oh oh it's magic.
-
     ;; assign a label to every used jump.
     (for-list jn (used-jumps::keys)
       (jump-label-map::add jn (new-label)))
@@ -941,17 +1080,18 @@
       ;; ensure that all symbols used in sizeoff are singletons
       (for-list lit sizeoff-literal (find-symbols lit))
       (verbose (printf "emit literals...\n"))
-      (emit-literals)
-      (verbose (printf "done. (" (int the-context.literals.count) " literals).\n"))
-      (emit-one-literal (build-field-lookup-table))
-      (emit-one-literal (literal:int index))
-      (emit-one-literal (literal:vector sizeoff-literal))
-      (emit-one-literal (literal:int metadata-index))
-      (set! cps (insn:return 0))
-      (verbose
-       (printf "labels:\n")
-       (print-stream s))
-      (emit-stream (resolve-labels s))
+      (let ((lits (build-literal-image index sizeoff-literal)))
+        (verbose (printf "done. (" (int the-context.literals.count) " literals).\n"))
+        (set! cps (insn:return 0))
+        (let ((s (resolve-labels s))
+              (code (encode-stream (fuse (filter stream-insn? s)))))
+          (verbose
+           (printf "labels:\n")
+           (print-stream s))
+          (write-pc-map s)
+          (emit-header (string-length lits) (string-length code))
+          (o.copy lits)
+          (o.copy code)))
       (set! s '())
       (o.close)
       (notquiet (printf "wrote " (int (o.get-total)) " bytes to " opath ".\n"))
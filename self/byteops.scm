@@ -2,6 +2,8 @@
 
 ;; table of all opcodes for the vm.
 
+(require "self/superops.scm")
+
 ;; NOTE: if you change this file, you need to re-run `vm/genopcodes` to
 ;;   regenerate the include file used by `vm/irkvm.c`.
 
@@ -72,8 +74,8 @@
     (OI 'vset    3      #f     #f)   ;; vec index-reg val
     (OI 'vmake   3      #f     #t)   ;; target size val
     (OI 'alloc   3      #f     #t)   ;; target tag size
-    (OI 'rref    3      #f     #t)   ;; target rec label-code
-    (OI 'rset    3      #f     #f)   ;; rec label-code val
+    (OI 'rref    5      #f     #t)   ;; target rec label-code cache-tag cache-index
+    (OI 'rset    5      #f     #f)   ;; rec label-code val cache-tag cache-index
     (OI 'getcc   1      #f     #t)   ;; target
     (OI 'putcc   3      #f     #t)   ;; target k val
     ;; (OI 'irk     3      #t     #t)   ;; target closure nargs arg0 ...
@@ -111,6 +113,18 @@
     (OI 'obptr2int 2    #f     #t)   ;; target src
     (OI 'errno   1      #f     #t)   ;; target
     (OI 'meta    1      #f     #t)   ;; target
+    (OI 'gcstat  2      #f     #t)   ;; target which
+    (OI 'fop2    4      #f     #t)   ;; target op a b
+    (OI 'fop1    3      #f     #t)   ;; target op a
+    (OI 'fcmp    4      #f     #t)   ;; target op a b
+    (OI 'fconv   3      #f     #t)   ;; target op a
+    (OI 'pmake   3      #f     #t)   ;; target kind n
+    (OI 'plen    2      #f     #t)   ;; target array
+    (OI 'pref    3      #f     #t)   ;; target array index
+    (OI 'pset    3      #f     #f)   ;; array index val
+    (OI 'pfill   4      #f     #f)   ;; array start n val
+    (OI 'pcopy   5      #f     #f)   ;; src src-start n dst dst-start
+    (OI 'wide    0      #f     #f)   ;; prefix, see <wide-ops>
     ;;  name   nargs varargs target? args
     ))
 
@@ -118,3 +132,68 @@
   (let ((info opcode-info[i]))
     (set! info.code i)))
 
+;; superinstructions: one handler that runs a sequence of opcodes, with
+;;   a single dispatch.  the compiler replaces the opcode of the first
+;;   insn of the sequence and leaves the rest of it in place, so the
+;;   layout of the code doesn't change and a jump into the middle still
+;;   works.  the sequences (self/superops.scm) are picked by
+;;   vm/genopcodes from the counts of a training run.
+
+;; opcodes that can be part of one.  vm/irkvm.c has a DO_<OP> macro
+;;   for each.  the <superop-last> opcodes transfer control, so they
+;;   can only end a sequence.
+(define superop-middle
+  (list 'lit 'litc 'add 'sub 'mul 'div 'srem 'shl 'ashr 'or 'xor 'and
+        'eq 'lt 'gt 'le 'ge 'cmp 'env 'stor 'ref 'mov 'epush 'ref0 'pop
+        'topref 'topset 'set 'set0 'pop0 'epop 'gc 'imm 'makei 'tupref
+        'vlen 'vref 'vset 'alloc 'rref 'rset 'slen 'unchar))
+
+(define superop-last
+  (list 'ret 'tst 'jmp 'fun 'tail 'tail0 'trcall 'trcall0 'call 'call0
+        'make 'nvcase))
+
+;; operands are normally a signed byte each.  an insn with one that
+;;   doesn't fit is written as 'wide', the opcode, and four bytes for
+;;   each operand.  only these opcodes can be wide: vm/irkvm.c compiles
+;;   their DO_<OP> macros a second time for it.  the rest only take
+;;   registers and small counts.
+(define wide-ops
+  (append superop-middle superop-last
+          (list 'malloc 'halloc 'cget 'cset 'caref 'csref 'csize)))
+
+(define (wide-op? name)
+  (member-eq? name wide-ops))
+
+;; the JIT (vm/irkvm_jit.c) runs each of these through a stencil made
+;;   from its DO_<OP> macro (see vm/irkvm_jit.h), or emits its own code
+;;   for it.  'ret' has its own stencil, and the others left out here
+;;   can return from vm_go().  anything else is left to the interpreter.
+(define jit-ops
+  (let ((skip (list 'ret 'malloc 'cget 'cset)))
+    (filter (lambda (name) (not (member-eq? name skip))) wide-ops)))
+
+(define (opcode-named name)
+  (let loop ((i 0))
+    (if (= i (vector-length opcode-info))
+        (raise (:NoSuchOpcode name))
+        (let ((info opcode-info[i]))
+          (if (eq? name info.name)
+              info
+              (loop (+ i 1)))))))
+
+;; the opcode info for each sequence in <runs>, numbered after the
+;;   base opcodes.  a superinstruction takes the args of its first insn.
+(define (make-superop-info runs)
+  (let ((code (vector-length opcode-info))
+        (r '()))
+    (for-list ops runs
+      (let ((first (opcode-named (car ops)))
+            (info (OI (string->symbol (format (join symbol->string "_" ops)))
+                      first.nargs first.varargs first.target)))
+        (set! info.code code)
+        (inc! code)
+        (push! r {info=info ops=ops})))
+    (list->vector (reverse r))))
+
+(define superop-info (make-superop-info superop-runs))
+
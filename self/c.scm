@@ -11,6 +11,11 @@
 	 'int	       -> (format "UNTAG_INTEGER(" arg ")")
 	 'bool         -> (format "IRK_IS_TRUE(" arg ")")
 	 'string       -> (format "((irk_string*)(" arg "))->data")
+	 'float        -> (format "irk_unbox_float(" arg ")")
+	 'u8array      -> (format "IRK_PACKED_DATA(" arg ", uint8_t)")
+	 'i32array     -> (format "IRK_PACKED_DATA(" arg ", int32_t)")
+	 'i64array     -> (format "IRK_PACKED_DATA(" arg ", int64_t)")
+	 'f64array     -> (format "IRK_PACKED_DATA(" arg ", double)")
 	 'cstring      -> (format "(char*)" arg)
 	 'buffer       -> (format "((" (irken-type->c-type type) ")(((irk_vector*)" arg ")+1))")
          'cref         -> (format "(" (irken-type->c-type type) ") get_foreign(" arg ")")
@@ -21,6 +26,10 @@
 	 'continuation -> arg
 	 'raw	       -> (match predargs with
 			    ((type:pred 'string _ _)) -> (format "((irk_string*)(" arg "))")
+			    ((type:pred name0 _ _))
+			    -> (if (member-eq? name0 '(u8array i32array i64array f64array))
+				   (format "((irk_packed*)(" arg "))")
+				   (error1 "unknown raw type in %cexp" type))
 			    _ -> (error1 "unknown raw type in %cexp" type))
 	 kind          -> (if (member-eq? kind c-int-types)
 			      (format "unbox(" arg ")")
@@ -53,6 +62,7 @@
     'ulong     -> "unsigned long"
     'longlong  -> "long long"
     'ulonglong -> "unsigned long long"
+    'float     -> "double"
     x -> (format (sym x)))
 
   (match t with
@@ -75,6 +85,7 @@
   (match type with
     (type:pred 'int _ _)     -> (format "TAG_INTEGER((irk_int)" exp ")")
     (type:pred 'bool _ _)    -> (format "IRK_TEST(" exp ")")
+    (type:pred 'float _ _)   -> (format "irk_box_float(" exp ")")
     (type:pred 'cstring _ _) -> (format "(object*)" exp)
     (type:pred 'cref _ _)    -> (format "(make_foreign((void*)" exp "))")
     (type:pred '* _ _)       -> (format "(make_foreign((void*)" exp "))")
@@ -141,10 +152,12 @@
 	(current-function-name 'toplevel)
 	(current-function-part (make-counter 1))
 	(env-counter (make-counter 0))
+	(field-caches (make-counter 0))
 	(env-stack '())
 	(used-jumps (find-jumps insns))
 	(fatbar-free (map-maker int-cmp))
-	(declared (set2-maker string-compare)))
+	(declared (set2-maker string-compare))
+	(pc-names '()))
 
     (define emit
       (insn:return target)                         -> (o.write (format "IRK_RETURN(" (int target) ");"))
@@ -160,7 +173,7 @@
       (insn:varset d i v k)                        -> (begin (emit-varset d i v k.target) (emit k.insn))
       (insn:new-env size top? types k)             -> (begin (emit-new-env size top? types k.target) (emit k.insn))
       (insn:alloc tag size k)                      -> (begin (emit-alloc tag size k.target) (emit k.insn))
-      (insn:store off arg tup i k)                 -> (begin (emit-store off arg tup i) (emit k.insn))
+      (insn:store off arg tup i init? k)           -> (begin (emit-store off arg tup i init?) (emit k.insn))
       (insn:invoke name fun args k)                -> (emit-call name fun args k)
       (insn:tail name fun args)                    -> (emit-tail name fun args)
       (insn:trcall d n args)                       -> (emit-trcall d n args)
@@ -173,8 +186,14 @@
       (insn:nvcase tr dt tags jn alts ealt k)      -> (emit-nvcase tr dt tags jn alts ealt k)
       (insn:pvcase tr tags arities jn alts ealt k) -> (emit-pvcase tr tags arities jn alts ealt k)
       (insn:label label next)                      -> (emit next)
+      (insn:line pos next)                         -> (begin (o.set-pos pos) (emit next))
       )
 
+    ;; code emitted later picks up the source position where it was pushed.
+    (define (push-fun! thunk)
+      (let ((pos (o.get-pos)))
+        (push! fun-stack (lambda () (o.set-pos pos) (thunk)))))
+
     ;; XXX arrange to avoid duplicates caused by jump conts
     (define (declare-function name extern? kfun?)
       (when (not (declared::member name))
@@ -266,7 +285,7 @@
 
     (define (emit-check-heap free size)
       (let ((n (length free)))
-	(o.write (format "if (freep + " size " >= limit) {"))
+	(o.write (format "while (freep + " size " >= limit) {"))
 	(o.indent)
 	;; copy free variables into tospace
 	(for-range
@@ -301,9 +320,25 @@
                         (impossible))
         ))
 
+    ;; every C function, named for the irken function it's part of.
+    (define (add-pc-name! cname name)
+      (push! pc-names {cname=cname name=name}))
+
+    ;; for the sampling profiler, see irk_sample_dump().
+    (define (emit-pc-table)
+      (o.write "static irk_pc_entry irk_pc_table0[] = {")
+      (for-list x pc-names
+        (o.write (format "  {(void *) " x.cname ", \"" (c-string (symbol->string x.name)) "\"},")))
+      ;; emitted last, this marks the end of the irken code.
+      (o.write "  {(void *) irk_get_metadata, NULL},")
+      (o.write "};")
+      (o.write "irk_pc_entry * irk_pc_table = irk_pc_table0;")
+      (o.write (format "irk_int irk_pc_table_size = " (int (+ 1 (length pc-names))) ";")))
+
     (define (emit-cfun o name cname body)
       (set! current-function-name name)
       (set! current-function-cname cname)
+      (add-pc-name! cname name)
       (o.write (format "static void " cname " (void) {"))
       (o.indent)
       (when the-context.options.trace (o.write (format "TRACE(\"" cname "\");")))
@@ -322,14 +357,15 @@
     (define (emit-close name nreg body target)
       (let ((cname (gen-function-cname name 0)))
 	(declare-function cname #f #f)
-	(push! fun-stack (lambda () (emit-cfun o name cname body)))
+	(push-fun! (lambda () (emit-cfun o name cname body)))
 	(o.write (format "O r" (int target) " = allocate (TC_CLOSURE, 2);"))
 	(o.write (format "r" (int target) "[1] = " cname "; r" (int target) "[2] = lenv;"))
 	))
 
     (define (push-continuation cname insn args)
+      (add-pc-name! cname current-function-name)
       (let ((args (format (join (lambda (x) (format "O r" (int x))) ", " args))))
-	(push! fun-stack
+	(push-fun!
 	      (lambda ()
 		(o.write (format "static void " cname "(" args ") {"))
 		(o.indent)
@@ -365,9 +401,9 @@
 
     (define (emit-varset d i v target)
       (if (= d -1)
-	  (o.write (format "top[" (int (+ 2 i)) "] = r" (int v) ";"))
+	  (o.write (format "IRK_STORE (top[" (int (+ 2 i)) "], r" (int v) ");"))
 	  ;;(o.write (format "varset (" (int d) ", " (int i) ", r" (int v) ");"))
-	  (o.write (format "((object*" (repeat d "*") ") lenv) " (repeat d "[1]") "[" (int (+ i 2)) "] = r" (int v) ";"))
+	  (o.write (format "IRK_STORE (((object*" (repeat d "*") ") lenv) " (repeat d "[1]") "[" (int (+ i 2)) "], r" (int v) ");"))
 	  )
       (when (>= target 0)
 	    ;; this handles this idiom:
@@ -392,8 +428,10 @@
 	    (o.write (format "O r" (int target) " = (object*)" tag-string ";"))
 	    (o.write (format "O r" (int target) " = allocate (" tag-string ", " (int size) ");")))))
 
-    (define (emit-store off arg tup i)
-      (o.write (format "r" (int tup) "[" (int (+ 1 (+ i off))) "] = r" (int arg) ";")))
+    (define (emit-store off arg tup i init?)
+      (if init?
+	  (o.write (format "r" (int tup) "[" (int (+ 1 (+ i off))) "] = r" (int arg) ";"))
+	  (o.write (format "IRK_STORE (r" (int tup) "[" (int (+ 1 (+ i off))) "], r" (int arg) ");"))))
 
     (define (safe-known-fun name)
       (let ((var (vars-get-var name)))
@@ -417,7 +455,7 @@
     (define (emit-tail name fun args)
       (let ((funcall (format-call name fun)))
 	(if (>= args 0)
-	    (o.write (format "r" (int args) "[1] = r" (int fun) "[2]; lenv = r" (int args) "; " funcall))
+	    (o.write (format "IRK_STORE (r" (int args) "[1], r" (int fun) "[2]); lenv = r" (int args) "; " funcall))
 	    (o.write (format "lenv = r" (int fun) "[2]; " funcall))
 	    )))
 
@@ -434,14 +472,15 @@
 		   i nregs
 		   (format "t[" (int (+ i 4)) "] = r" (int (nth free i))))))
 	  (declare-function kfun #f #t)
+	  (add-pc-name! kfun current-name)
 	  (o.write (format "t[1] = k; t[2] = lenv; t[3] = " kfun "; " (string-join saves "; ") "; k = t;")))
 	;; call
 	(let ((funcall (format-call name fun)))
 	  (if (>= args 0)
-	      (o.write (format "r" (int args) "[1] = r" (int fun) "[2]; lenv = r" (int args) "; " funcall))
+	      (o.write (format "IRK_STORE (r" (int args) "[1], r" (int fun) "[2]); lenv = r" (int args) "; " funcall))
 	      (o.write (format "lenv = r" (int fun) "[2]; " funcall))))
 	;; emit a new c function to represent the continuation of the current irken function
-	(push! fun-stack
+	(push-fun!
 	      (lambda ()
 		(set! current-function-cname kfun)
 		(o.write (format "static void " kfun " (O rr) {"))
@@ -471,14 +510,16 @@
 	    (set! npop (+ npop 1)))
 	(if (> npop 0)
 	    (o.write (format "lenv = ((object " (join (n-of npop "*")) ")lenv)" (join (n-of npop "[1]")) ";")))
+	;; the frame is reused, and may have been promoted since it was made.
 	(for-range
 	    i nargs
-	    (o.write (format "lenv[" (int (+ 2 i)) "] = r" (int (nth regs i)) ";")))
+	    (o.write (format "IRK_STORE (lenv[" (int (+ 2 i)) "], r" (int (nth regs i)) ");")))
 	(declare-function cname #f #f)
 	(o.write (format cname "();"))
       ))
 
     (define (emit-push args)
+      ;; <args> was allocated just before, see c-let-env.
       (o.write (format "r" (int args) "[1] = lenv; lenv = r" (int args) ";")))
 
     (define (emit-pop src target)
@@ -560,7 +601,7 @@
           (vec index val)
           -> (begin
                (o.write (format "range_check (GET_TUPLE_LENGTH(*(object*)r" (int vec) "), unbox(r" (int index)"));"))
-               (o.write (format "((irk_vector*)r" (int vec) ")->val[unbox(r" (int index) ")] = r" (int val) ";"))
+               (o.write (format "IRK_STORE (((irk_vector*)r" (int vec) ")->val[unbox(r" (int index) ")], r" (int val) ");"))
                (when (>= k.target 0)
                  (o.write (format "O r" (int k.target) " = (object *) TC_UNDEFINED;"))))
           _ -> (primop-error))
@@ -580,12 +621,14 @@
                        ")->val[" (int (index-eq label sig0))
                        "]")
             (maybe:no)
-            ;; run-time lookup
-            -> (let ((label-code (lookup-label-code label)))
+            ;; run-time lookup, through this site's cache
+            -> (let ((label-code (lookup-label-code label))
+                     (cache (format "irk_fc" (int (field-caches.inc)))))
                  (ambig label-code)
+                 (decls.write (format "static irk_field_cache " cache " = {-1, 0};"))
                  (format "((irk_vector*)r" (int reg)
                          ")->val[LOOKUP_FIELD(r" (int reg)
-                         "," (int label-code) ")]"))
+                         "," (int label-code) "," cache ")]"))
             ))
 
         (define prim-record-get
@@ -597,7 +640,7 @@
         (define prim-record-set
           (sexp:list ((sexp:symbol label) (sexp:list sig))) (rec-reg arg-reg)
           -> (let ((refexp (record-slot-exp sig label rec-reg)))
-               (oformat refexp " = r" (int arg-reg) ";")
+               (oformat "IRK_STORE (" refexp ", r" (int arg-reg) ");")
                (when (>= k.target 0)
                  (o.write (format "O r" (int k.target) " = (O) TC_UNDEFINED;"))))
           _ _ -> (primop-error))
@@ -628,9 +671,9 @@
 
         (define (prim-callocate parm args)
           (let ((type (parse-type parm))) ;; gets parsed twice, convert to %%cexp?
-            ;; XXX maybe make alloc_no_clear do an ensure_heap itself?
+            ;; XXX maybe make alloc_bytes do an ensure_heap itself?
             (if (>= k.target 0)
-                (o.write (format "O r" (int k.target) " = alloc_no_clear (TC_BUFFER, HOW_MANY (sizeof (" (irken-type->c-type type)
+                (o.write (format "O r" (int k.target) " = alloc_bytes (TC_BUFFER, HOW_MANY (sizeof (" (irken-type->c-type type)
                                  ") * unbox(r" (int (car args)) "), sizeof (object)));"))
                 (error1 "%callocate: dead target?" type))))
 
@@ -1023,18 +1066,31 @@
 	() -> #u
 	_  -> (begin ((pop! fun-stack)) (loop))
 	))
+    (o.set-pos (srcpos:none))
+    (add-pc-name! "toplevel" 'toplevel)
+    (emit-pc-table)
     (emit-get-metadata o)
     (emit-c-lookup-field-hashtables o)
     ))
 
+;; -g: map each line of C back to the irken source.
+(define (c-line-annotate o pos s)
+  (match pos with
+    (srcpos:t file line) -> (o.copy (format "#line " (int line) " \"" (c-string file) "\"\n"))
+    (srcpos:none) -> #u)
+  (o.write s))
+
 (define (compile-to-c base cps)
   (let ((opath (string-append base ".c"))
         (ofile (file/open-write opath #t #o644))
         (o (make-writer ofile))
         (tmp-path (format base ".tmp.c"))
         (tfile (file/open-write tmp-path #t #o644))
-        (o0 (make-writer tfile)))
+        (o0 (make-pos-writer (make-writer tfile) c-line-annotate)))
     (notquiet (printf "\n-- C output --\n : " opath "\n"))
+    ;; the runtime needs more than c99 from the system headers (e.g. mmap),
+    ;;   and the first #include decides what they provide.
+    (o.write "#define _DEFAULT_SOURCE")
     (for-each
      (lambda (path) (o.write (format "#include <" path ">")))
      (reverse the-context.cincludes))
@@ -1050,7 +1106,9 @@
         (emit-profile-0 o)
         (o.write "void prof_dump (void) {}"))
     (emit-c o0 o cps)
-    (if the-context.options.profile (emit-profile-1 o))
+    (when the-context.options.profile
+      (emit-profile-1 o)
+      (emit-profile-tag-names o))
     (notquiet (print-string "done.\n"))
     (o0.close)
     ;; copy code after declarations
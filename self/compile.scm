@@ -46,13 +46,89 @@
 
 (define (read-file path)
   (let ((file (file/open-read path))
-	(result (reader path (lambda () (file/read-char file)))))
+	(result (reader* path (lambda () (file/read-char file)) the-context.options.debug-info)))
     result))
 
 (define (find-and-read-file path)
   ;;(printf "reading file '" path "'\n")
   (let (((path0 file) (find-file the-context.options.include-dirs path)))
-    (reader path0 (lambda () (file/read-char file)))))
+    (read-forms path0 file)))
+
+;; when making a snapshot (see below), and in the compiler resumed from
+;;   one, the forms of every file read are kept in the-context.read-cache,
+;;   and reused as long as the file's contents are unchanged.  forms read
+;;   with positions (-g) are never cached.
+(define (read-forms path file)
+  (let ((contents (read-file-contents file)))
+    (if (not the-context.cache-reads)
+        (read-forms* path contents)
+        (match (tree/member the-context.read-cache string-compare path) with
+          (maybe:yes (:tuple contents0 forms))
+          -> (if (and (string=? contents contents0)
+                      (not the-context.options.debug-info))
+                 forms
+                 (begin
+                   (tree/delete! the-context.read-cache string-compare path)
+                   (read-forms* path contents)))
+          (maybe:no)
+          -> (read-forms* path contents)
+          ))))
+
+(define (read-forms* path contents)
+  (let ((pos 0)
+        (pos? the-context.options.debug-info)
+        (forms (reader* path (lambda ()
+                               (if (< pos (string-length contents))
+                                   (let ((ch (string-ref contents pos)))
+                                     (inc! pos)
+                                     ch)
+                                   #\eof))
+                        pos?)))
+    (when (and the-context.cache-reads (not pos?))
+      (tree/insert! the-context.read-cache string-compare path (:tuple contents forms)))
+    forms))
+
+;; read <path> and everything it includes or requires, whatever the backend.
+(define (warm-read-cache path)
+  (define walk
+    (sexp:list ((sexp:symbol '%backend) _ . subs)) -> (for-each walk subs)
+    (sexp:list ((sexp:symbol 'include) (sexp:string path0))) -> (warm-read-cache path0)
+    (sexp:list ((sexp:symbol 'require) (sexp:string path0))) -> (warm-read-cache path0)
+    _ -> #u
+    )
+  (let (((path0 file) (find-file the-context.options.include-dirs path)))
+    (match (tree/member the-context.read-cache string-compare path0) with
+      (maybe:yes _) -> #u
+      (maybe:no) -> (for-each walk (read-forms path0 file))
+      )))
+
+;; 'compile -snapshot <image>' reads the standard macros and library, and
+;;   dumps the compiler in that state.  'compile -image <image> ...' then
+;;   resumes here, skipping the compiler's own startup and the reading
+;;   of the library.  like any image, it only works with the binary
+;;   that made it, run without address randomization (setarch -R).
+(define (snapshot path)
+  (set! the-context.cache-reads #t)
+  (warm-read-cache the-context.standard-macros)
+  (warm-read-cache "lib/basis.scm")
+  (%backend c
+    (if (= 0 (callcc (lambda (k) (dump path k))))
+        (begin
+          ;; resumed: pick up this process's arguments and environment.
+          (set! sys.argv (get-argv))
+          (set! sys.argc (vector-length sys.argv))
+          (set! the-context.options (make-options))
+          (compile-file))
+        (printf "wrote snapshot " path "\n")))
+  (%backend (llvm bytecode)
+    (raise (:UnsupportedOption "snapshots need a compiler built with the C backend" "-snapshot")))
+  )
+
+(define (resume path)
+  (%backend c (throw (load path) 0))
+  (%backend (llvm bytecode)
+    (raise (:UnsupportedOption "snapshots need a compiler built with the C backend" "-image")))
+  )
 
 (define (parse-dump-spec spec)
   (map string->symbol (string-split spec #\,)))
@@ -86,9 +162,11 @@
         (cflags (getenv-or "CFLAGS" CFLAGS))
         (cflags (format cflags " " (if options.optimize "-O" "") " " options.extra-cflags))
         (cflags (format cflags (if options.profile " -DIRK_PROFILE" "")))
+        (cflags (format cflags (if options.generational " -DIRK_GENERATIONAL" "")))
+        (cflags (format cflags (if options.debug-info " -g" "")))
         (cflags (format cflags " " (join " " (get-ffi-cflags))))
         (libs (format (join " " (map (lambda (lib) (format "-l" lib)) options.libraries))))
-        (libs (format libs " " (join " " (get-ffi-lflags))))
+        (libs (format libs " " (join " " (get-ffi-lflags)) " -lm")) ;; for float.scm
         (cmd (format cc " " cflags " " (join " " paths) " " extra " " libs " -o " base)))
     (notquiet (print-string (format "system: " cmd "\n")))
     (if (not (= 0 (system cmd)))
@@ -112,9 +190,12 @@
 	  "-dt"   -> (set! options.debugtyping #t)
 	  "-ni"   -> (set! options.noinline #t)
 	  "-p"    -> (set! options.profile #t)
+	  "-G"    -> (set! options.generational #t)
 	  "-n"    -> (set! options.noletreg #t)
 	  "-q"    -> (set! options.quiet #t)
 	  "-nr"   -> (set! options.no-range-check #t)
+	  "-g"    -> (set! options.debug-info #t)
+          "-image" -> (set! i (+ i 1)) ;; see resume
           ;; XXX make these mutually exclusive?
 	  "-llvm" -> (set! options.backend (backend:llvm))
           "-b"    -> (set! options.backend (backend:bytecode))
@@ -126,6 +207,9 @@
                          (raise (:UnknownOption "Unknown option" x))
                          (set! filename-index i))
 	  ))
+    (when (and options.generational (eq? options.backend (backend:llvm)))
+      ;; the llvm preamble has no write barrier.
+      (raise (:UnsupportedOption "generational gc is not supported by the llvm backend" "-G")))
     (set-verbose-gc (not options.quiet))
     (when options.dumptypes
       ;; disable inlining so every function has a type.
@@ -147,15 +231,20 @@ Usage: compile <irken-src-file> [options]
  -dump  : comma-separated list from (sexp,expand,ast,typed,cps)
  -ni    : no inlining
  -p     : generate profile-printing code (C backend only)
+ -G     : use the generational collector (C backend only)
  -n     : disable letreg optimization
  -O     : rounds of optimization (default: 5)
  -i <n> : set inline threshold (10-20)
  -q     : quiet the compiler
  -nr    : no range check (e.g. vector access)
+ -g     : debug info: #line in the C output, DWARF line tables with LLVM
  -h     : display this usage
  -llvm  : compile using the LLVM backend.
  -b     : compile using the bytecode backend.
 
+ compile -snapshot <image>          : save a compiler with the library read
+ compile -image <image> <file> ...  : compile using a saved compiler
+
 default flags:
   CC='" CC "'
   CFLAGS='" CFLAGS "'
@@ -177,6 +266,19 @@ default flags:
   (when (< sys.argc 2)
         (usage)
         (raise (:NotEnoughArgs)))
+  (match sys.argv[1] with
+    "-snapshot" -> (snapshot (get-image-arg))
+    "-image"    -> (resume (get-image-arg))
+    _           -> (compile-file)
+    ))
+
+(define (get-image-arg)
+  (when (< sys.argc 3)
+        (usage)
+        (raise (:NotEnoughArgs)))
+  sys.argv[2])
+
+(define (compile-file)
   (let ((filearg (get-options sys.argv the-context.options))
         (transform (transformer))
         (path sys.argv[filearg])
@@ -224,6 +326,9 @@ default flags:
         ;;(_ (print-type-tree noden))
         (_ (if-dump 'typed (pp-node noden)))
         (_ (remove-onearmed-nvcase noden)) ;; safe after typing
+        (noden (if (eq? (backend:c) the-context.options.backend)
+                   (fuse-float-cexps noden) ;; needs types
+                   noden))
         (_ (notquiet (printf "cps...\n")))
         )
     (if the-context.options.dumptypes
@@ -14,6 +14,7 @@
    trace		= #f
    debugmacroexpansion	= #f
    profile		= #f
+   generational		= #f
    noinline		= #f
    noletreg		= #f
    debugtyping          = #f
@@ -21,6 +22,7 @@
    dump                 = '()
    quiet                = #f
    no-range-check       = #f
+   debug-info           = #f
    opt-rounds           = 5
    inline-threshold     = 13
    backend              = (backend:c)
@@ -51,9 +53,10 @@
     exceptions          = (alist/make)
     profile-funs        = (tree/empty)
     cexps               = (map-maker magic-cmp)
-    callocates          = (map-maker magic-cmp)
     ffi-map             = (cmap/make magic-cmp)
     ambig-rec           = (tree/empty)
+    read-cache          = (tree/empty) ;; path -> (:tuple contents forms)
+    cache-reads         = #f ;; set by -snapshot
     }
   )
 
@@ -121,6 +124,26 @@
 (define (lookup-label-code label)
   (cmap->index the-context.labels label))
 
+;; user objects are tagged UOTAG(index), from TC_USEROBJ up to the top
+;;   of the 8-bit typecode.  TC_PACKED and TC_FLOAT sit inside that
+;;   range, so tuple alts, records and polymorphic variants skip the
+;;   two indices that would land on them.
+(define UOTAG-LIMIT 54) ;; UOTAG(54) is 256
+
+(define (uotag-index index what)
+  (cond ((or (= index 49) (= index 50)) ;; TC_PACKED, TC_FLOAT
+         (uotag-index 51 what))
+        ((>= index UOTAG-LIMIT)
+         (error1 "out of user object tags at" what))
+        (else index)))
+
+(define (add-record-sig sig)
+  (let ((records the-context.records))
+    (when (not (cmap/present? records sig))
+      (set! records.count
+            (uotag-index records.count (format "{" (join symbol->string " " sig) "}"))))
+    (cmap/add records sig)))
+
 (define (print-vars)
   (let ((flagpad (+ 2 VFLAG-NFLAGS)))
     (print-string "vars = {\n")
@@ -48,8 +48,8 @@
   (:new-env int bool (list type) cont)
   ;; alloc <tag> <size> <k>
   (:alloc int int cont)
-  ;; store <offset> <arg> <tuple> <i> <k>
-  (:store int int int int cont)
+  ;; store <offset> <arg> <tuple> <i> <init?> <k>
+  (:store int int int int bool cont)
   ;; invoke <name> <closure> <args> <k>
   (:invoke (maybe symbol) int int cont)
   ;; tail <name> <closure> <args>
@@ -74,6 +74,8 @@
   (:pvcase int (list symbol) (list int) int (list insn) (maybe insn) cont)
   ;; label <label-number> <next>
   (:label int insn)
+  ;; line <source-position> <next>  (-g)
+  (:line srcpos insn)
   )
 
 ;; we use several kinds of environment 'ribs' during this phase
@@ -133,6 +135,7 @@
 (define (compile exp)
 
   (let ((current-funs '(top))
+        (current-pos (srcpos:none))
         (regalloc (make-register-allocator)))
 
     (define (add-to-set reg set)
@@ -165,7 +168,21 @@
       (printf "node id=" (int (noderec->id exp0)) "\n")
       (error msg))
 
+    ;; with -g, the code for each node starts with the position of the
+    ;;   nearest enclosing node that has one.
     (define (compile tail? exp lenv k)
+      (let ((pos0 current-pos))
+        (match (noderec->pos exp) with
+          (srcpos:t _ _) -> (set! current-pos (noderec->pos exp))
+          (srcpos:none)  -> #u)
+        (let ((pos current-pos)
+              (insn (compile* tail? exp lenv k)))
+          (set! current-pos pos0)
+          (match pos with
+            (srcpos:t _ _) -> (insn:line pos insn)
+            (srcpos:none)  -> insn))))
+
+    (define (compile* tail? exp lenv k)
 
       ;; override continuation when in tail position
       (if tail?
@@ -376,10 +393,16 @@
           '%c-cast     -> (compile tail? (first args) lenv k)
 	  ;; note: discards first argument...
 	  '%exn-handle -> (compile tail? (second args) lenv k)
+	  ;; the float functions return a new box.
+	  '%llvm-call  -> (begin (when (is-pred? (noderec->type exp) 'float)
+				   (set-flag! VFLAG-ALLOCATES))
+				 (c-primargs args name params (noderec->type exp) lenv k))
 	  _ -> (c-primargs args name params (noderec->type exp) lenv k))))
 
     (define (c-cexp sig template exp lenv k)
       ;;(print-string (format "c-cexp: sig = " (type-repr sig) " solved type = " (type-repr (noderec->type exp)) "\n"))
+      (when (is-pred? (noderec->type exp) 'float) ;; boxes its result
+        (set-flag! VFLAG-ALLOCATES))
       (collect-primargs (noderec->subs exp) lenv k
 			(lambda (regs)
 			  (insn:cexp sig (noderec->type exp) template regs k))))
@@ -503,18 +526,31 @@
                    (add-to-set k.target k.free) lenv k)))
                 )))
 
+    ;; can evaluating <exp> run the collector?
+    (define (may-collect? exp)
+      (or (not (node-get-flag exp NFLAG-LEAF))
+	  (match (noderec->t exp) with
+	    (node:primapp '%ensure-heap _) -> #t
+	    _ -> (some? may-collect? (noderec->subs exp)))))
+
     (define (compile-store-args i offset args tuple-reg free-regs lenv k)
-      (compile
-       #f (car args) lenv
-       (cont free-regs
-	     (lambda (arg-reg)
-	       (insn:store
-		offset arg-reg tuple-reg i
-		(if (null? (cdr args)) ;; was this the last argument?
-                    (dead free-regs k.insn) ;; avoid bogus target for <store>
-		    (dead
-		     free-regs
-		     (compile-store-args (+ i 1) offset (cdr args) tuple-reg free-regs lenv k))))))))
+      (compile-store-args* #t i offset args tuple-reg free-regs lenv k))
+
+    ;; <init?>: no collection can have happened since the tuple was
+    ;;   allocated, so it is still young and the store needs no write barrier.
+    (define (compile-store-args* init? i offset args tuple-reg free-regs lenv k)
+      (let ((init? (and init? (not (may-collect? (car args))))))
+	(compile
+	 #f (car args) lenv
+	 (cont free-regs
+	       (lambda (arg-reg)
+		 (insn:store
+		  offset arg-reg tuple-reg i init?
+		  (if (null? (cdr args)) ;; was this the last argument?
+		      (dead free-regs k.insn) ;; avoid bogus target for <store>
+		      (dead
+		       free-regs
+		       (compile-store-args* init? (+ i 1) offset (cdr args) tuple-reg free-regs lenv k)))))))))
 
     (define (c-let-reg tail? formals subs lenv k)
       (for-each (lambda (f) (vars-set-flag! f VFLAG-REG)) formals)
@@ -714,7 +750,7 @@
     ;;  but expressions that *build* records are not caught until this phase.
     (define (get-record-tag sig)
       (for-each record-label-tag sig)
-      (cmap/add the-context.records sig))
+      (add-record-sig sig))
 
     (define (gen-return reg)
       (insn:return reg))
@@ -846,7 +882,7 @@
   (insn:close name nreg body k)    -> (printf "close " (sym name) " nreg:" (int nreg))
   (insn:varref d i k)              -> (printf "ref " (int d) "," (int i))
   (insn:varset d i v k)            -> (printf "set " (int d) "," (int i) " val:" (int v))
-  (insn:store o a t i k)           -> (printf "stor off:" (int o) " arg:" (int a) " tup:" (int t) " idx:" (int i))
+  (insn:store o a t i n k)         -> (printf "stor off:" (int o) " arg:" (int a) " tup:" (int t) " idx:" (int i) " init?:" (bool n))
   (insn:invoke n c a k)            -> (printf "invoke " (maybe n symbol->string "lambda") " cl:" (int c) " args:" (int a))
   (insn:new-env n top? types k)    -> (printf "env n:" (int n) " top?:" (bool top?) " " (join type-repr " " types))
   (insn:alloc tag size k)          -> (printf "alloc tag:" (int tag) " size:" (int size))
@@ -862,17 +898,28 @@
   (insn:pvcase tr labels arities jn alts ealt k)
   -> (printf "pvcase " (int tr) " (" (join symbol->string " " labels) ") arities:" (fintlist arities) " L" (int jn))
   (insn:label label next)          -> (printf "L" (int label) ":")
+  (insn:line _ next)               -> (printf "line")
   )
 
 (define (print-cps insn d)
 
-  (match insn with
-    (insn:label label next)
-    -> (begin
-         (printf "\nL" (int label) ":")
-         (set! insn next))
-    _ -> #u
-    )
+  ;; a position is shown at the end of the previous line.
+  (let loop ()
+    (match insn with
+      (insn:label label next)
+      -> (begin
+           (printf "\nL" (int label) ":")
+           (set! insn next)
+           (loop))
+      (insn:line pos next)
+      -> (begin
+           (match pos with
+             (srcpos:t file line) -> (printf " ;; " file ":" (int line))
+             (srcpos:none) -> #u)
+           (set! insn next)
+           (loop))
+      _ -> #u
+      ))
 
   (let ((k (insn->cont insn)))
     (printf "\n" (repeat d " ") (if (<= k.target 0) "-" (int->string k.target)) " ")
@@ -894,7 +941,7 @@
   (insn:test reg _ _ _ _)          -> (list reg)
   (insn:jump reg trg _ _)          -> (list reg trg)
   (insn:varset _ _ v _)            -> (list v)
-  (insn:store _ a t _ _)           -> (list a t)
+  (insn:store _ a t _ _ _)         -> (list a t)
   (insn:invoke _ c a _)            -> (list c a)
   (insn:push r _)                  -> (list r)
   (insn:pop r _)                   -> (list r)
@@ -930,7 +977,7 @@
   (insn:ffi _ _ _ _ k)          -> k
   (insn:varref _ _ k)           -> k
   (insn:varset _ _ _ k)         -> k
-  (insn:store _ _ _ _ k)        -> k
+  (insn:store _ _ _ _ _ k)      -> k
   (insn:invoke _ _ _ k)         -> k
   (insn:new-env _ _ _ k)        -> k
   (insn:alloc _ _ k)            -> k
@@ -939,6 +986,7 @@
   (insn:primop _ _ _ _ k)       -> k
   (insn:move _ _ k)             -> k
   (insn:label _ next)           -> (insn->cont next)
+  (insn:line _ next)            -> (insn->cont next)
   _                             -> null-cont
   )
 
@@ -967,6 +1015,7 @@
       (insn:return _)     -> #t
       (insn:tail _ _ _)   -> #t
       (insn:trcall _ _ _) -> #t
+      (insn:line _ next)  -> (no-cont? next)
       _                   -> #f
       )
 
@@ -974,9 +1023,11 @@
       ;; special handling for labels.
       (match insn with
         (insn:label num next)
-        -> (let ((refset (W* next refset)))
+        -> (let ((refset (W next refset)))
              (tree/insert! jumps int-cmp num refset)
              refset)
+        (insn:line _ next)
+        -> (W next refset)
         _ -> (W* insn refset)
         ))
 
@@ -1028,6 +1079,7 @@
     (p insn d)
     (match insn with
       (insn:label label next) -> (walk next d)
+      (insn:line _ next) -> (walk next d)
       _ -> (begin
              (for-list sub (insn->subexps insn)
                (walk sub (+ d 1)))
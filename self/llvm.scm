@@ -19,6 +19,13 @@
 (define litcons (set2-maker int-cmp))
 (define ffifuns (set2-maker symbol-index-cmp))
 (define extobjs (set2-maker string-compare))
+;; for the sampling profiler: each function with the irken function
+;;   it belongs to, and the owners of the FAIL/JUMP continuations.
+(define pc-names '())
+(define pc-owners (map-maker string-compare))
+;; one inline cache per run-time record field lookup, see
+;;   lookup_field_cached() in include/header1.c.
+(define field-caches (make-counter 0))
 
 ;; CPS registers are mapped to LLVM idents like this:
 ;;  r5 -> "%r5"
@@ -50,6 +57,11 @@
 	(arg-counter (make-counter 0))
         (tid-counter (make-counter 0))
 	(renamed (map-maker int-cmp))
+	(owner (if (member-eq? name '(fail jump))
+                   (match (pc-owners::get cname) with
+                     (maybe:yes owner) -> owner
+                     (maybe:no) -> name)
+                   name))
 	)
 
     (define (ID)
@@ -75,8 +87,18 @@
           (ID)
           (format "%r" (int target))))
 
+    ;; functions emitted later keep the source position they were pushed with.
+    (define (push-fun! thunk)
+      (let ((pos (o.get-pos)))
+        (push! fun-stack (lambda () (o.set-pos pos) (thunk)))))
+
     (define (push-continuation name cname cps args)
-      (push! fun-stack (lambda () (cps->llvm cps o name cname args #f))))
+      (pc-owners::add cname owner)
+      (push-fun! (lambda () (cps->llvm cps o name cname args #f))))
+
+    (define (add-pc-name! cname nargs)
+      (let ((type (format "void(" (join ", " (n-of nargs "i8**")) ")*")))
+        (push! pc-names {cname=cname name=owner type=type})))
 
     (define (push-fail-continuation cps jump args)
       (push-continuation 'fail (format "FAIL_" (int jump)) cps args))
@@ -216,24 +238,8 @@
 	'%ensure-heap _ _
 	-> #u
 
-	;; XXX move to emit-callocate
-	'%callocate _ (count)
-	-> (let ((id0 (ID))
-		 (id1 (ID)))
-	     (match type with
-	       (type:pred 'buffer (type0) _)
-	       -> (match (the-context.callocates::get type0) with
-		    (maybe:yes index)
-		    -> (begin
-			 (oformat id0 " = load i64, i64* @size_" (int index))
-			 (oformat id1 " = call fastcc i64 @insn_unbox (i8** %r" (int count) ")")
-			 (oformat "%r" (int target) " = call fastcc i8** @insn_callocate (i64 " id0 ", i64 " id1 ")")
-			 )
-		    (maybe:no)
-		    -> (error1 "%callocate failed type lookup" (type-repr type))
-		    )
-	       _ -> (error1 "%callocate unexpected type" (type-repr type))
-	       ))
+	'%callocate params (count)
+	-> (emit-callocate params count target)
 
 	'%getcc _ ()
 	-> (o.write (format "%r" (int target) " = load i8**, i8*** @k ;; %getcc"))
@@ -302,6 +308,10 @@
     (define (ambig code)
       (tree/insert! the-context.ambig-rec int-cmp code #u))
 
+    ;; a new cache for a record field lookup site.
+    (define (field-cache)
+      (format "bitcast ([2 x i64]* @irk_fc." (int (field-caches.inc)) " to i64*)"))
+
     (define (emit-record-get label sig rec target)
       (let ((label-code (lookup-label-code label)))
 	(match (guess-record-type sig) with
@@ -315,6 +325,7 @@
                (oformat "%r" (int target) " = call i8** @record_fetch ("
                         "i8** %r" (int rec)
                         ", i64 " (int label-code)
+                        ", i64* " (field-cache)
                         ")")
                (ambig label-code))
 	  )))
@@ -333,6 +344,7 @@
                (oformat "call void @record_store ("
                         "i8** %r" (int rec)
                         ", i64 " (int label-code)
+                        ", i64* " (field-cache)
                         ", i8** %r" (int val)
                         ")")
                (ambig label-code))
@@ -420,6 +432,16 @@
         (oformat "%r" (int target) " = call i8** @make_"
                  (if malloc? "malloc" "halloc") " (i64 " (int size) ", i64 " id0 ")")))
 
+    ;; like the C backend, this goes through alloc_bytes().
+    (define (emit-callocate params count target)
+      (let ((ctype (parse-ctype params))
+            (size (ctype->size ctype))
+            (id0 (ID)))
+        (if (< target 0)
+            (error "dead %callocate target"))
+        (oformat id0 " = call fastcc i64 @insn_unbox (i8** %r" (int count) ")")
+        (oformat "%r" (int target) " = call i8** @irk_callocate (i64 " (int size) ", i64 " id0 ")")))
+
     (define (emit-c-get-int type src target)
       (let ((ctype (irken-type->ctype type))
             (iname (ctype->llvm ctype))
@@ -532,6 +554,7 @@
 	;; save
 	(oformat ids[0] " = call fastcc i8** @allocate (i64 " (int TC_SAVE) ", i64 " (int (+ 3 nregs)) ")")
 	(oformat ids[1] " = bitcast void(i8**)* @" kfun " to i8**")
+	(add-pc-name! kfun 1)
 	(for-range i nregs
 	   (oformat "call fastcc void @insn_store ("
 		    "i8** " ids[0]
@@ -547,7 +570,7 @@
         (emit-call* name fun)
 	(oformat "ret void")
 	;; emit a new c function to represent the continuation of the current irken function
-	(push! fun-stack
+	(push-fun!
 	      (lambda ()
 		(oformat "\ndefine internal fastcc void @" kfun "(i8** %rr) {")
 		(o.indent)
@@ -605,7 +628,7 @@
 
     (define (emit-close name nreg body target)
       (let ((cname (gen-function-cname name 0)))
-	(push! fun-stack
+	(push-fun!
 	      (lambda ()
 		(cps->llvm body o name cname '() #f)))
 	(oformat "%r" (int target) " = call fastcc i8** @insn_close (void()* @" cname ")")
@@ -780,7 +803,7 @@
 	   (move r k.target)
 	   (walk k.insn))
 
-      (insn:store off arg tup i k)
+      (insn:store off arg tup i _ k)
       -> (begin
 	   (oformat "call fastcc void @insn_store ("
 		    "i8** %r" (int tup)
@@ -828,6 +851,9 @@
       (insn:label label next)
       -> (walk next)
 
+      (insn:line pos next)
+      -> (begin (o.set-pos pos) (walk next))
+
       x -> (begin (printf "cps->llvm insn= ")
       		  (print-cps x 0) (printf "\n")
       		  (raise (:CPSNotImplemented x)))
@@ -839,6 +865,7 @@
 		   cname
 		   "\\00\", align 1"))
 
+    (add-pc-name! cname (length args))
     (oformat "\ndefine " (if external? "external" "internal fastcc")
 	     " void @" cname "("
 	     (join (lambda (x) (format "i8** %r" (int x))) ", " args)
@@ -1139,18 +1166,158 @@
       (oformat "i32 0];")
       )))
 
+(define (emit-llvm-field-caches o)
+  (for-range i (field-caches.get)
+    (oformat "@irk_fc." (int i) " = internal global [2 x i64] [i64 -1, i64 0]")))
+
 (define (emit-llvm-get-metadata o)
   (oformat "define internal fastcc i8** @irk_get_metadata() {\n"
            "  %1 = call fastcc i8** @insn_getlit (i64 " (int (- the-context.literals.count 1)) ")\n"
            "  ret i8** %1\n}"))
 
-(define (emit-llvm o cname cps)
-  (cps->llvm cps o 'toplevel cname '() #t)
-  (llvm-emit-constructed o)
-  (emit-llvm-lookup-field-hashtables o)
-  (emit-llvm-get-metadata o)
-  (emit-ffi-declarations o)
-  )
+(define (emit-llvm-pc-table o)
+  (let ((n (+ 1 (length pc-names)))
+        (i 0))
+    (for-list x pc-names
+      (let ((name (symbol->string x.name)))
+        (oformat "@.pcname." (int i) " = private unnamed_addr constant ["
+                 (int (+ 1 (string-length name))) " x i8] c\"" (llvm-string name) "\\00\"")
+        (inc! i)))
+    (oformat "@irk_pc_table0 = global [" (int n) " x {i8*, i8*}] [")
+    (set! i 0)
+    (for-list x pc-names
+      (let ((ltype (format "[" (int (+ 1 (string-length (symbol->string x.name)))) " x i8]")))
+        (oformat "  {i8*, i8*} {i8* bitcast (" x.type " @" x.cname " to i8*), "
+                 "i8* getelementptr (" ltype ", " ltype "* @.pcname." (int i) ", i64 0, i64 0)},")
+        (inc! i)))
+    ;; emitted last, this marks the end of the irken code.
+    (oformat "  {i8*, i8*} {i8* bitcast (i8**()* @irk_get_metadata to i8*), i8* null}]")
+    (oformat "@irk_pc_table = global {i8*, i8*}* getelementptr ([" (int n) " x {i8*, i8*}], ["
+             (int n) " x {i8*, i8*}]* @irk_pc_table0, i64 0, i64 0)")
+    (oformat "@irk_pc_table_size = global i64 " (int n))))
+
+;; -g: DWARF line tables.  each function gets a DISubprogram at the
+;;   position it was pushed with, and each instruction a DILocation at
+;;   the current position.  <path> is the main source file.
+(define (make-llvm-debug-info path)
+  (let ((counter (make-counter 5)) ;; !0-!4 are written by finish
+        (nodes '())
+        (files (map-maker string-compare))
+        (locs (map-maker string-compare)) ;; per function
+        (sp -1)
+        (sp-name "")
+        (sp-file 1)
+        (sp-line 0))
+
+    (define (node s)
+      (let ((id (counter.inc)))
+        (push! nodes (format "!" (int id) " = " s))
+        id))
+
+    (define (cached key make)
+      (match (locs::get key) with
+        (maybe:yes id) -> id
+        (maybe:no) -> (let ((id (make))) (locs::add key id) id)))
+
+    (define (file-id file)
+      (if (string=? file path)
+          1
+          (match (files::get file) with
+            (maybe:yes id) -> id
+            (maybe:no)
+            -> (let ((id (node (format "!DIFile(filename: \"" (llvm-string file) "\", directory: \"\")"))))
+                 (files::add file id)
+                 id))))
+
+    ;; lines from another file (e.g. inlined code) need a scope of their own.
+    (define (scope file)
+      (let ((fid (file-id file)))
+        (if (= fid sp-file)
+            sp
+            (cached (format "@" (int fid))
+                    (lambda ()
+                      (node (format "!DILexicalBlockFile(scope: !" (int sp) ", file: !" (int fid) ", discriminator: 0)")))))))
+
+    (define (location pos)
+      (let ((file (match pos with (srcpos:t file _) -> file (srcpos:none) -> ""))
+            (line (match pos with (srcpos:t _ line) -> line (srcpos:none) -> sp-line)))
+        (cached (format file ":" (int line))
+                (lambda ()
+                  (node (format "!DILocation(line: " (int line) ", column: 0, scope: !"
+                                (int (if (string=? file "") sp (scope file))) ")"))))))
+
+    ;; <s> is "define ... @name(args) {"
+    (define (start-function s pos)
+      (let ((at (string-find "@" s)))
+        (set! sp (counter.inc))
+        (set! sp-name (substring s (+ at 1) (string-find-from "(" s at)))
+        (match pos with
+          (srcpos:t file line) -> (begin (set! sp-file (file-id file)) (set! sp-line line))
+          (srcpos:none)        -> (begin (set! sp-file 1) (set! sp-line 0)))
+        (set! locs (map-maker string-compare))
+        (format (substring s 0 (- (string-length s) 1)) "!dbg !" (int sp) " {")))
+
+    (define (end-function)
+      (push! nodes (format "!" (int sp) " = distinct !DISubprogram(name: \"" (llvm-string sp-name) "\""
+                           ", scope: !" (int sp-file) ", file: !" (int sp-file)
+                           ", line: " (int sp-line) ", type: !2, scopeLine: " (int sp-line)
+                           ", spFlags: DISPFlagDefinition, unit: !0)"))
+      (set! sp -1))
+
+    ;; labels, comments and the cases of a switch aren't instructions.
+    (define (instruction? s)
+      (let loop ((i 0))
+        (if (and (< i (string-length s)) (eq? #\space (string-ref s i)))
+            (loop (+ i 1))
+            (let ((s (substring s i (string-length s))))
+              (not (or (= 0 (string-length s))
+                       (ends-with s ":")
+                       (ends-with s "[")
+                       (starts-with s "i64 ")
+                       (starts-with s ";")))))))
+
+    (define (with-dbg s id)
+      (let ((i (string-find " ;" s)))
+        (if (= i -1)
+            (format s ", !dbg !" (int id))
+            (format (substring s 0 i) ", !dbg !" (int id) (substring s i (string-length s))))))
+
+    (define (annotate o pos s)
+      (cond ((not the-context.options.debug-info) (o.write s))
+            ((and (or (starts-with s "define ") (starts-with s "\ndefine ")) (ends-with s "{"))
+             (o.write (start-function s pos)))
+            ((< sp 0) (o.write s))
+            ((string=? s "}") (begin (end-function) (o.write s)))
+            ((instruction? s) (o.write (with-dbg s (location pos))))
+            (else (o.write s))))
+
+    (define (finish o)
+      (when the-context.options.debug-info
+        (o.write "!llvm.dbg.cu = !{!0}")
+        (o.write "!llvm.module.flags = !{!3, !4}")
+        (o.write (format "!0 = distinct !DICompileUnit(language: DW_LANG_C99, file: !1, producer: \"irken\", "
+                         "isOptimized: false, runtimeVersion: 0, emissionKind: LineTablesOnly)"))
+        (o.write (format "!1 = !DIFile(filename: \"" (llvm-string path) "\", directory: \"\")"))
+        (o.write "!2 = !DISubroutineType(types: !{})")
+        (o.write "!3 = !{i32 2, !\"Debug Info Version\", i32 3}")
+        (o.write "!4 = !{i32 7, !\"Dwarf Version\", i32 4}")
+        (for-list n (reverse nodes)
+          (o.write n))))
+
+    {annotate=annotate finish=finish}
+    ))
+
+(define (emit-llvm o base cname cps)
+  (let ((dbg (make-llvm-debug-info (format base ".scm"))))
+    (cps->llvm cps (make-pos-writer o dbg.annotate) 'toplevel cname '() #t)
+    (emit-llvm-pc-table o)
+    (llvm-emit-constructed o)
+    (emit-llvm-lookup-field-hashtables o)
+    (emit-llvm-field-caches o)
+    (emit-llvm-get-metadata o)
+    (emit-ffi-declarations o)
+    (dbg.finish o)
+    ))
 
 (define (compile-to-llvm base cps)
   (let ((llpath (format base ".ll"))
@@ -1159,7 +1326,7 @@
     (notquiet (printf "\n-- LLVM output --\n : " llpath "\n"))
     (ollvm.copy
      (get-file-contents "include/preamble.ll"))
-    (emit-llvm ollvm "toplevel" cps)
+    (emit-llvm ollvm base "toplevel" cps)
     (ollvm.close)
     (notquiet (printf "wrote " (int (ollvm.get-total)) " bytes to " llpath ".\n"))
     (let (((path0 ignore-file) (find-file the-context.options.include-dirs "include/header1.c")))
@@ -76,6 +76,8 @@
       (sexp:record fields) -> (parse-record-fields '() fields)
       ;;(sexp:vector subs)   -> (pattern:vector (map kind subs))
       (sexp:bool b)	   -> (pattern:constructor 'bool (if b 'true 'false) '())
+      (sexp:float s)	   -> (error1 "float patterns are not supported" s)
+      (sexp:pos _ _ exp)   -> (kind exp) ;; -g
       (sexp:list l)
       -> (match l with
 	   () -> (pattern:constructor 'list 'nil '())
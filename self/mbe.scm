@@ -59,6 +59,8 @@
 	   -> (angle-bracket-equal? v0 v1) ;; both literal symbols
 	   _ -> #f) ;; literal symbol matched against a non-symbol
 	 #t) ;; non-literal symbol matches anything
+  ;; source positions (-g) are invisible to patterns.
+  p (sexp:pos _ _ e) -> (matches-pattern? p e)
   ;; list pattern
   (sexp:list pl) (sexp:list el) -> (matches-list? pl el)
   ;; other objects, e.g. sexp:cons.
@@ -132,6 +134,7 @@
     )
   (match p e with
      (sexp:symbol k) e           -> (list (sexp p e))
+     p (sexp:pos _ _ e)          -> (get-bindings p e)
      (sexp:list p) (sexp:list e) -> (dolist p e)
      _ _ -> '()
      )
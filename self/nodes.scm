@@ -41,6 +41,12 @@
   ;;   should be their own node types.
   )
 
+;; where a node came from, with -g.
+(datatype srcpos
+  (:none)
+  (:t string int) ;; file line
+  )
+
 ;; to avoid recursive types, we wrap the node record in a datatype.
 (datatype noderec
   (:t {
@@ -50,6 +56,7 @@
        id=int		   ;; unique id
        type=type	   ;; solved/assigned type
        flags=int	   ;; bit flags (recursive, leaf, etc...)
+       pos=srcpos	   ;; source position
        })
   )
 
@@ -75,6 +82,9 @@
 (define noderec->flags
   (noderec:t n) -> n.flags)
 
+(define noderec->pos
+  (noderec:t n) -> n.pos)
+
 (define set-node-subs!
   (noderec:t nr) s -> (set! nr.subs s))
 
@@ -90,6 +100,9 @@
 (define set-node-t!
   (noderec:t nr) t -> (set! nr.t t))
 
+(define set-node-pos!
+  (noderec:t nr) p -> (set! nr.pos p))
+
 ;; --- accessors ---
 
 (define node-counter (make-counter 0))
@@ -122,17 +135,17 @@
 (define NFLAG-NFLAGS    4)
 
 ;;(typealias rnode
-;;   {t=node subs=(list rnode) size=int id=int type=type flags=int})
+;;   {t=node subs=(list rnode) size=int id=int type=type flags=int pos=srcpos})
 
 (define (make-node t subs)
-  (noderec:t {t=t subs=subs size=(sum-size subs) id=(node-counter.inc) type=no-type flags=0})
+  (noderec:t {t=t subs=subs size=(sum-size subs) id=(node-counter.inc) type=no-type flags=0 pos=(srcpos:none)})
   )
 
 (define (node-copy node0)
   (match node0 with
     (noderec:t {t=(node:literal _) ...}) -> node0 ;; don't copy literals
     (noderec:t nr)
-    -> (noderec:t {t=nr.t subs=nr.subs size=nr.size id=(node-counter.inc) type=nr.type flags=nr.flags})
+    -> (noderec:t {t=nr.t subs=nr.subs size=nr.size id=(node-counter.inc) type=nr.type flags=nr.flags pos=nr.pos})
     ))
 
 (define (node/varref name)
@@ -384,6 +397,7 @@
   (sexp:symbol s)  -> #f ;; i.e., varref
   (sexp:list ((sexp:symbol 'quote) . _)) -> #t
   (sexp:list ((sexp:cons _ _) . args))   -> (every? can-haz-literal? args)
+  (sexp:pos _ _ exp)                     -> (can-haz-literal? exp)
   (sexp:list l)                          -> (every? can-haz-literal? l)
   (sexp:vector l)                        -> (every? can-haz-literal? l)
   ;; note: we cannot have embedded record literals (because mutability)
@@ -408,7 +422,7 @@
   (define (build-record-literal fields)
     (let ((fields0 (sort field<? fields))
           (sig (map (lambda (x) (match x with (field:t name _) -> name)) fields0))
-          (tag (cmap/add the-context.records sig)))
+          (tag (add-record-sig sig)))
       (for-each (lambda (label) (cmap/add the-context.labels label)) sig)
       (cmap/add the-context.records sig)
       (literal:record tag (map build-field fields0))))
@@ -423,6 +437,8 @@
     (sexp:list l)    -> (build-list-literal l)
     (sexp:vector l)  -> (literal:vector (map build-literal l))
     (sexp:record fs) -> (build-record-literal fs)
+    (sexp:pos _ _ e) -> (build-literal e)
+    (sexp:float s)   -> (error1 "float literals cannot be quoted" s)
     ;; XXX the rest
     exp -> (error1 "unhandled literal type" exp)
     )
@@ -537,6 +553,11 @@
     (sexp:vector l)     -> (build-vector l)
     (sexp:attr exp sym) -> (node/primapp '%raccess (sexp:symbol sym) (list (walk exp)))
     (sexp:cons dt alt)  -> (node/varref (string->symbol (format (sym dt) ":" (sym alt))))
+    (sexp:float s)      -> (error1 "unexpanded float literal" s) ;; see expand-float
+    (sexp:pos file line exp)
+    -> (let ((n (walk exp)))
+         (set-node-pos! n (srcpos:t file line))
+         n)
     (sexp:list l)
     -> (match l with
          ((sexp:symbol 'begin) . exps)                -> (node/sequence (map walk exps))
@@ -641,6 +662,7 @@
   (sexp:vector l)  -> (literal:cons 'sexp 'vector (map unsexp l))
   (sexp:attr b n)  -> (literal:cons 'sexp 'attr (list (unsexp b) (literal:symbol n)))
   (sexp:cons d a)  -> (literal:cons 'sexp 'cons (list (literal:symbol d) (literal:symbol a)))
+  (sexp:float s)   -> (literal:cons 'sexp 'float (list (literal:string s)))
   exp -> (error1 "unsexp: unhandled literal type" exp)
   )
 
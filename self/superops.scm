@@ -0,0 +1,40 @@
+;; -*- Mode: Irken -*-
+
+;; generated by vm/genopcodes - do not edit
+;; superinstructions, see self/byteops.scm.
+
+(define superop-runs
+  (list
+   (list 'ref 'tupref 'stor)
+   (list 'ref0 'tupref 'ref0)
+   (list 'gc 'ref0 'nvcase)
+   (list 'tupref 'stor 'ref)
+   (list 'stor 'ref 'tupref)
+   (list 'tupref 'ref0 'tupref)
+   (list 'stor 'ref0)
+   (list 'env 'epush 'ref)
+   (list 'env 'ref 'stor)
+   (list 'epush 'ref 'tupref)
+   (list 'pop 'stor 'ref0)
+   (list 'ref0 'tupref 'mov)
+   (list 'stor 'topref 'call)
+   (list 'stor 'ref 'call)
+   (list 'ref0 'stor 'ref)
+   (list 'stor 'ref0 'nvcase)
+   (list 'ref 'stor 'ref0)
+   (list 'tupref 'stor 'env)
+   (list 'stor 'ref0 'stor)
+   (list 'stor 'env 'ref)
+   (list 'env 'ref0 'stor)
+   (list 'ref0 'ref0)
+   (list 'gc 'env 'epush)
+   (list 'mov 'ref0)
+   (list 'stor 'topref 'tail)
+   (list 'eq 'tst)
+   (list 'stor 'env 'ref0)
+   (list 'mov 'tupref 'mov)
+   (list 'env 'epush 'env)
+   (list 'ref0 'eq 'tst)
+   (list 'ref0 'stor 'topref)
+   (list 'ref 'stor 'topref)
+   ))
@@ -39,10 +39,43 @@
 
   (define splice
     (sexp:list forms)
-    -> (sexp:list (splice-list forms '()))
+    -> (sexp:list (splice-list (map unpos-decl forms) '()))
+    (sexp:pos file line exp)
+    -> (sexp:pos file line (splice exp))
     x -> x
     )
 
+  ;; --- source positions (-g) ---
+  ;; with -g the reader wraps every list in (sexp:pos file line ...).
+  ;;   expansion keeps the wrappers around expressions so that sexp->node
+  ;;   can tag nodes with them; everything that is syntax rather than
+  ;;   code (formals, patterns, types, declarations) is stripped first.
+
+  (define decl-heads
+    (list 'datatype 'typealias 'defmacro '%%splice '%backend 'include 'require 'require-ffi
+          'quote 'literal))
+
+  (define decl-form?
+    (sexp:list ((sexp:symbol head) . _))
+    -> (member-eq? head decl-heads)
+    _ -> #f)
+
+  ;; declarations are never wrapped.
+  (define (unpos-decl exp)
+    (match (sexp/unpos exp) with
+      (sexp:list ((sexp:symbol '%backend) which . subs))
+      -> (sexp:list (list:cons (sexp:symbol '%backend) (list:cons (sexp/strip which) subs)))
+      exp0 -> (if (decl-form? exp0) exp0 exp)))
+
+  ;; the position of an expanded list; an inner one wins.
+  (define (pos-wrap file line exp)
+    (match exp with
+      (sexp:list _) -> (if (decl-form? exp) exp (sexp:pos file line exp))
+      _ -> exp))
+
+  (define (strip exp)
+    (if the-context.options.debug-info (sexp/strip exp) exp))
+
   (define (wrap-fix names inits body)
     (if (> (length names) 0)
         (sexp (sym 'fix)
@@ -80,7 +113,7 @@
           (exps3 (splice-list (map expand exps2) '()))
           (exps4 (find-declarations exps3))
           ((defs1 exps5) (collect-definitions defs0 '() exps4))
-          (defs2 (map parse-define (reverse defs1))))
+          (defs2 (map parse-define* (reverse defs1))))
       (wrap-definitions defs2 exps5)))
 
   (define collect-definitions
@@ -88,7 +121,9 @@
     defs exps (hd . tl)
     -> (match hd with
          (sexp:list ((sexp:symbol 'define) . body))
-         ->   (collect-definitions (list:cons body defs) exps tl)
+         ->   (collect-definitions (list:cons (sexp:list body) defs) exps tl)
+         (sexp:pos file line (sexp:list ((sexp:symbol 'define) . body)))
+         ->   (collect-definitions (list:cons (sexp:pos file line (sexp:list body)) defs) exps tl)
          _ -> (collect-definitions defs (list:cons hd exps) tl)
          ))
 
@@ -98,11 +133,11 @@
       (hd . tl) acc
       -> (match hd with
 	   (sexp:list ((sexp:symbol 'typealias) . dtl))
-	   -> (begin (parse-typealias dtl) (recur tl acc))
+	   -> (begin (parse-typealias (map strip dtl)) (recur tl acc))
 	   (sexp:list ((sexp:symbol 'datatype) . dtl))
-	   -> (begin (parse-datatype dtl) (recur tl acc))
+	   -> (begin (parse-datatype (map strip dtl)) (recur tl acc))
 	   (sexp:list ((sexp:symbol 'defmacro) . dtl))
-	   -> (begin (parse-defmacro dtl) (recur tl acc))
+	   -> (begin (parse-defmacro (map strip dtl)) (recur tl acc))
 	   _ -> (recur tl (list:cons hd acc))))
     (recur exps '()))
 
@@ -111,7 +146,7 @@
           (result '()))
       (when (not (set/member? the-context.required string-compare path0))
         (set/add! the-context.required string-compare path0)
-        (set! result (reader path0 (lambda () (file/read-char file)))))
+        (set! result (read-forms path0 file)))
       (file/close file)
       result))
 
@@ -136,7 +171,7 @@
       acc (hd . tl)
       -> (loop (list:cons hd acc) tl)
       )
-    (loop '() forms))
+    (loop '() (map unpos-decl forms)))
 
   (define expand-field
     (field:t name exp) -> (field:t name (expand exp)))
@@ -147,9 +182,28 @@
       (sexp:vector rands)  -> (sexp:vector (map expand rands))
       (sexp:record fields) -> (sexp:record (map expand-field fields))
       (sexp:attr exp sym)  -> (sexp:attr (expand exp) sym)
+      (sexp:float s)       -> (expand-float s)
+      (sexp:pos file line exp) -> (pos-wrap file line (expand exp))
       _                    -> exp
       ))
 
+  ;; a float literal is a constant expression in C, the other
+  ;;   backends parse it at runtime (see irk_float_conv).
+  (define (expand-float s)
+    (match the-context.options.backend with
+      (backend:c)
+      -> (sexp (sym '%%cexp) (sexp (sym '->) (sym 'float)) (string s))
+      (backend:llvm)
+      -> (sexp (sym '%llvm-call)
+               (sexp (string "@irk_float_conv")
+                     (sexp (sym 'int) (sym 'string) (sym '->) (sym 'float))
+                     (sym 'ccc))
+               (int 3) (string s))
+      (backend:bytecode)
+      -> (sexp (sym '%%cexp) (sexp (sym 'int) (sym 'string) (sym '->) (sym 'float))
+               (string "fconv") (int 3) (string s))
+      ))
+
   (define (expand exp)
     (try
      (expand* exp)
@@ -169,18 +223,18 @@
     (match l with
       () -> (sexp:list '())
       (rator . rands)
-      -> (match rator with
+      -> (match (sexp/unpos rator) with
 	   (sexp:symbol sym)
 	   -> (match (alist/lookup transform-table sym) with
 		(maybe:yes fun)
-                -> (fun rands)
+                -> (fun (if (member-eq? sym pos-aware) rands (map strip rands)))
 		(maybe:no)
                 -> (match (tree/member the-context.macros symbol-index-cmp sym) with
                      (maybe:yes macro) -> (expand (macro.apply (sexp:list l) the-context.options.debugmacroexpansion))
                      (maybe:no)
                      -> (if (primop? sym)
                             ;; do *not* expand the primop param.
-                            (sexp:list (list:cons rator (list:cons (first rands) (map expand (rest rands)))))
+                            (sexp:list (list:cons rator (list:cons (strip (first rands)) (map expand (rest rands)))))
                             (sexp:list (list:cons rator (map expand rands))))))
 	   ;; automagically insert the <self> argument
 	   ;; (ob.o.method args0 ...) => (ob.o.method ob args0 ...)
@@ -202,7 +256,7 @@
 
   (define expand-set!
     (lhs0 rhs0)
-    -> (let ((lhs (expand lhs0)) ;; early expansion of lhs allows macros to expand to <attr> and <array-ref>
+    -> (let ((lhs (sexp/unpos (expand lhs0))) ;; early expansion of lhs allows macros to expand to <attr> and <array-ref>
 	     (rhs (expand rhs0)))
 	 (match lhs with
 	   (sexp:attr lhs attr)
@@ -222,30 +276,34 @@
     )
 
   (define expand-let-splat
-    ((sexp:list bindings) . body)
+    (bindings . body) -> (expand-let-splat* (sexp/unpos bindings) body)
+    x -> (error1 "malformed LET-SPLAT" x))
+
+  (define expand-let-splat*
+    (sexp:list bindings) body
     -> (let ((bindings0
 	      (map
 	       (lambda (pair)
-		 (match pair with
+		 (match (sexp/unpos pair) with
 		   (sexp:list (var val))
-		   -> (sexp var (expand val))
+		   -> (sexp (strip var) (expand val))
 		   _ -> (error1 "malformed binding in LET-SPLAT" pair)))
 	       bindings)))
          (sexp (sym 'let-splat) (list bindings0) (expand-body body)))
-    x -> (error1 "malformed LET-SPLAT" x))
+    x _ -> (error1 "malformed LET-SPLAT" x))
 
   ;; avoid macro-expanding let-subst bindings
   (define expand-let-subst
-    (pair . body) -> (sexp (sym 'let-subst) pair (expand-body body))
+    (pair . body) -> (sexp (sym 'let-subst) (strip pair) (expand-body body))
     x -> (error1 "malformed LET-SUBST" x)
     )
 
   (define expand-lambda
-    (formals . body) -> (exp-function (sexp:symbol 'lambda) formals (sexp:bool #f) (expand-body body))
+    (formals . body) -> (exp-function (sexp:symbol 'lambda) (strip formals) (sexp:bool #f) (expand-body body))
     x		     -> (error1 "malformed LAMBDA" x))
 
   (define expand-function
-    (name formals type . body) -> (exp-function name formals type (expand-body body))
+    (name formals type . body) -> (exp-function (strip name) (strip formals) (strip type) (expand-body body))
     x			  -> (error1 "malformed FUNCTION" x))
 
   ;; --- handy sugar ---
@@ -314,9 +372,15 @@
     ((sexp:symbol value) . alts)		  -> (expand-vcase* 'nil value alts)
     x -> (error1 "expand-vcase" x))
 
+  ;; an alt's pattern is syntax, its body is code.
+  (define (unpos-alt alt)
+    (match (sexp/unpos alt) with
+      (sexp:list (pat . code)) -> (sexp:list (list:cons (sexp/strip pat) code))
+      alt0 -> alt0))
+
   (define (expand-vcase* dt value alts)
     (split-alts
-     alts
+     (if the-context.options.debug-info (map unpos-alt alts) alts)
      (lambda (tags formals alts ealt?)
        (let ((arities '())
 	     (alts0 '()))
@@ -373,14 +437,18 @@
   (define (make-datatype tvars name)
 
     (let ((alt-map (alist-maker))
-	  (nalts 0))
+	  (nalts 0)
+	  (next 0))
 
       (define (get tag)
 	(alt-map::get-err tag "no such alt in datatype"))
 
       (define (add alt)
 	(alt-map::add alt.name alt)
-	(set! alt.index nalts)
+	(set! alt.index (if (= alt.arity 0)
+			    next
+			    (uotag-index next (format (sym name) ":" (sym alt.name)))))
+	(set! next (+ 1 alt.index))
 	(set! nalts (+ 1 nalts))
 	)
 
@@ -410,7 +478,6 @@
 
       (define (to-sexp)
         (let ((tvar-cmap (cmap/make magic-cmp))
-              (index 0)
               (r '()))
           (for-list tvar (get-tvars)
             (match tvar with
@@ -418,9 +485,8 @@
               _ -> (impossible)))
           (for-list alt (reverse (alt-map::values))
             (push! r (sexp (sym alt.name)
-                          (int index)
-                          (list (map (lambda (t) (type->sexp* tvar-cmap t)) alt.types))))
-            (set! index (+ 1 index)))
+                          (int alt.index)
+                          (list (map (lambda (t) (type->sexp* tvar-cmap t)) alt.types)))))
           (sexp (sym name)
                 (list (reverse r)))))
 
@@ -496,6 +562,15 @@
     ;;-> (alist/push the-context.aliases name alias)
     x -> (error1 "malformed typealias" x))
 
+  ;; the body of a define, with its position if it has one.
+  (define parse-define*
+    (sexp:pos file line (sexp:list (head . rest)))
+    -> (match (parse-define (list:cons (sexp/strip head) rest)) with
+         (:pair name init) -> (:pair name (pos-wrap file line init)))
+    (sexp:list (head . rest))
+    -> (parse-define (list:cons (strip head) rest))
+    x -> (error1 "malformed <define>" x))
+
   (define parse-define
     ;; (define name ...)
     ((sexp:symbol name) . body)
@@ -742,8 +817,364 @@
          (maybe:no)     -> (error1 "unknown datatype" dtname))
     x -> (error1 "malformed dtreflect" x))
 
+  ;; --------------------------------------------------------------------------------
+  ;; generated compare, equality and hash functions.
+  ;;
+  ;; (datatype-cmp name dict ...)  => (T T -> cmp)
+  ;; (datatype=? name dict ...)    => (T T -> bool)
+  ;; (datatype-hash name dict ...) => (T -> int)
+  ;;
+  ;; <name> is a datatype, or a typealias (e.g. for a record type).
+  ;;   there is one <dict> for each of its type variables, in the order
+  ;;   printed by datatype->sexp: a cmp, equality or hash function for
+  ;;   the values of that variable.  hash functions take the running
+  ;;   hash and a value, (int 'a -> int); hash-mix will do for ints.
+  ;;
+  ;; the code follows the layout of each type, where magic-cmp has to
+  ;;   discover it at runtime, but it orders values the same way.  the
+  ;;   last field of an alt is compared in tail position, so lists are
+  ;;   walked by a loop.  fields of other types (functions, foreign
+  ;;   data, open records) fall back to magic-cmp and are left out of
+  ;;   the hash.
+
+  (define (derive kind rands)
+
+    (let ((counter 0)
+          (fnames (alist:nil)) ;; datatype => function name
+          (defs '()))
+
+      (define (fresh prefix)
+        (set! counter (+ 1 counter))
+        (string->symbol (format (sym prefix) (int counter))))
+
+      (define (kind-name prefix dtname)
+        (string->symbol (format (sym prefix) (sym kind) "/" (sym dtname))))
+
+      (define (cmp=)
+        (sexp (cons 'cmp '=)))
+
+      ;; base types.  <a> and <b> are the two values, or for 'hash the
+      ;;   running hash and the value.
+      (define (base name a b)
+        (match kind name with
+          'cmp 'int       -> (maybe:yes (sexp (sym 'int-cmp) a b))
+          'cmp 'char      -> (maybe:yes (sexp (sym 'int-cmp) (sexp (sym 'char->int) a) (sexp (sym 'char->int) b)))
+          'cmp 'bool      -> (maybe:yes (sexp (sym 'int-cmp) (sexp (sym 'if) a (int 1) (int 0)) (sexp (sym 'if) b (int 1) (int 0))))
+          'cmp 'string    -> (maybe:yes (sexp (sym 'string-compare) a b))
+          'cmp 'symbol    -> (maybe:yes (sexp (sym 'symbol-index-cmp) a b))
+          'cmp 'float     -> (maybe:yes (sexp (sym 'float-cmp) a b))
+          'cmp 'undefined -> (maybe:yes (cmp=))
+          'eq 'int        -> (maybe:yes (sexp (sym '=) a b))
+          'eq 'char       -> (maybe:yes (sexp (sym 'eq?) a b))
+          'eq 'bool       -> (maybe:yes (sexp (sym 'eq?) a b))
+          'eq 'string     -> (maybe:yes (sexp (sym 'string=?) a b))
+          'eq 'symbol     -> (maybe:yes (sexp (sym 'eq?) a b))
+          'eq 'float      -> (maybe:yes (sexp (sym 'float=) a b))
+          'eq 'undefined  -> (maybe:yes (sexp:bool #t))
+          'hash 'int      -> (maybe:yes (sexp (sym 'hash-mix) a b))
+          'hash 'char     -> (maybe:yes (sexp (sym 'hash-mix) a (sexp (sym 'char->int) b)))
+          'hash 'bool     -> (maybe:yes (sexp (sym 'hash-mix) a (sexp (sym 'if) b (int 1) (int 0))))
+          'hash 'string   -> (maybe:yes (sexp (sym 'hash-mix) a (sexp (sym 'string-hash) b)))
+          'hash 'symbol   -> (maybe:yes (sexp (sym 'hash-mix) a (sexp (sym 'symbol->index) b)))
+          _ _             -> (maybe:no)
+          ))
+
+      (define (fallback a b)
+        (match kind with
+          'cmp -> (sexp (sym 'magic-cmp) a b)
+          'eq  -> (sexp (sym 'magic=?) a b)
+          _    -> a
+          ))
+
+      ;; <items> is a list of (:tuple type a b): compare them in order,
+      ;;   the last one in tail position.  for 'hash, <a> is the value
+      ;;   and <h> is the running hash.
+      (define (seq items tmap h)
+        (match kind items with
+          'cmp () -> (cmp=)
+          'eq ()  -> (sexp:bool #t)
+          _ ()    -> h
+          'hash ((:tuple t x _)) -> (field t tmap h x)
+          'hash ((:tuple t x _) . tl)
+          -> (let ((h0 (fresh 'h)))
+               (sexp (sym 'let) (sexp (sexp (sym h0) (field t tmap h x)))
+                     (seq tl tmap (sexp:symbol h0))))
+          _ ((:tuple t a b)) -> (field t tmap a b)
+          'cmp ((:tuple t a b) . tl)
+          -> (let ((c (fresh 'c)))
+               (sexp (sym 'let) (sexp (sexp (sym c) (field t tmap a b)))
+                     (sexp (sym 'if) (sexp (sym 'eq?) (sym c) (cmp=))
+                           (seq tl tmap h)
+                           (sym c))))
+          _ ((:tuple t a b) . tl)
+          -> (sexp (sym 'and) (field t tmap a b) (seq tl tmap h))
+          ))
+
+      (define (field t tmap a b)
+        (match t with
+          (type:tvar id _)
+          -> (match (alist/lookup tmap id) with
+               (maybe:yes d) -> (sexp (sym d) a b)
+               (maybe:no)    -> (fallback a b))
+          (type:pred 'rproduct (row) _)
+          -> (match (row->fields row '()) with
+               (maybe:yes fields) -> (record-fields fields tmap a b)
+               (maybe:no)         -> (fallback a b))
+          (type:pred 'vector (elt) _)
+          -> (vector-loop elt tmap a b)
+          (type:pred name args _)
+          -> (match (base name a b) with
+               (maybe:yes exp) -> exp
+               (maybe:no)
+               -> (match (alist/lookup the-context.datatypes name) with
+                    (maybe:yes _)
+                    -> (sexp:list (append (list (sexp:symbol (need name)))
+                                          (map (lambda (t) (dict t tmap)) args)
+                                          (list a b)))
+                    (maybe:no) -> (fallback a b)))
+          ))
+
+      ;; the function to pass for a type argument.
+      (define (dict t tmap)
+        (match t with
+          (type:tvar id _)
+          -> (match (alist/lookup tmap id) with
+               (maybe:yes d) -> (sexp:symbol d)
+               (maybe:no)    -> (dict-lambda t tmap))
+          _ -> (dict-lambda t tmap)
+          ))
+
+      (define (dict-lambda t tmap)
+        (let ((a (fresh 'a))
+              (b (fresh 'b)))
+          (sexp (sym 'lambda) (sexp (sym a) (sym b))
+                (field t tmap (sexp:symbol a) (sexp:symbol b)))))
+
+      (define field<?
+        (:pair la _) (:pair lb _) -> (symbol<? la lb))
+
+      ;; the fields of a closed record, in layout order.
+      (define row->fields
+        (type:pred 'rlabel ((type:pred label _ _) (type:pred 'pre (t) _) rest) _) acc
+        -> (row->fields rest (list:cons (:pair label t) acc))
+        (type:pred 'rdefault _ _) acc
+        -> (maybe:yes (sort field<? acc))
+        _ _
+        -> (maybe:no)
+        )
+
+      (define (record-fields fields tmap a b)
+        (match kind with
+          'hash -> (seq (map (lambda (f) (match f with (:pair label t) -> (:tuple t (sexp:attr b label) b))) fields)
+                        tmap a)
+          _     -> (seq (map (lambda (f) (match f with (:pair label t) -> (:tuple t (sexp:attr a label) (sexp:attr b label)))) fields)
+                        tmap a)
+          ))
+
+      ;; element by element, then by length (like magic-cmp).
+      (define (vector-loop elt tmap a b)
+        (let ((loop (fresh 'loop))
+              (i (fresh 'i))
+              (x (fresh 'x))
+              (y (fresh 'y))
+              (n0 (fresh 'n))
+              (n1 (fresh 'n)))
+          (define (ref v) (sexp (sym '%array-ref) (bool #f) v (sym i)))
+          (define (next) (sexp (sym loop) (sexp (sym '+) (sym i) (int 1))))
+          (define (next-hash h) (sexp (sym loop) (sexp (sym '+) (sym i) (int 1)) h))
+          (match kind with
+            'cmp
+            -> (let ((c (fresh 'c)))
+                 (sexp (sym 'let) (sexp (sexp (sym n0) (sexp (sym 'vector-length) a))
+                                        (sexp (sym n1) (sexp (sym 'vector-length) b)))
+                       (sexp (sym 'let) (sym loop) (sexp (sexp (sym i) (int 0)))
+                             (sexp (sym 'if) (sexp (sym 'or) (sexp (sym '=) (sym i) (sym n0)) (sexp (sym '=) (sym i) (sym n1)))
+                                   (sexp (sym 'int-cmp) (sym n0) (sym n1))
+                                   (sexp (sym 'let) (sexp (sexp (sym x) (ref a))
+                                                          (sexp (sym y) (ref b))
+                                                          (sexp (sym c) (field elt tmap (sexp:symbol x) (sexp:symbol y))))
+                                         (sexp (sym 'if) (sexp (sym 'eq?) (sym c) (cmp=)) (next) (sym c)))))))
+            'eq
+            -> (sexp (sym 'let) (sexp (sexp (sym n0) (sexp (sym 'vector-length) a)))
+                     (sexp (sym 'and) (sexp (sym '=) (sym n0) (sexp (sym 'vector-length) b))
+                           (sexp (sym 'let) (sym loop) (sexp (sexp (sym i) (int 0)))
+                                 (sexp (sym 'if) (sexp (sym '=) (sym i) (sym n0))
+                                       (bool #t)
+                                       (sexp (sym 'let) (sexp (sexp (sym x) (ref a))
+                                                              (sexp (sym y) (ref b)))
+                                             (sexp (sym 'and) (field elt tmap (sexp:symbol x) (sexp:symbol y)) (next)))))))
+            _ ;; hash: <a> is the running hash
+            -> (let ((h (fresh 'h)))
+                 (sexp (sym 'let) (sexp (sexp (sym n0) (sexp (sym 'vector-length) b)))
+                       (sexp (sym 'let) (sym loop) (sexp (sexp (sym i) (int 0)) (sexp (sym h) a))
+                             (sexp (sym 'if) (sexp (sym '=) (sym i) (sym n0))
+                                   (sym h)
+                                   (sexp (sym 'let) (sexp (sexp (sym x) (ref b)))
+                                         (next-hash (field elt tmap (sexp:symbol h) (sexp:symbol x))))))))
+            )))
+
+      ;; schedule the function for <dtname> and return its name.
+      (define (need dtname)
+        (match (alist/lookup fnames dtname) with
+          (maybe:yes fname) -> fname
+          (maybe:no)
+          -> (let ((fname (kind-name 'dt dtname)))
+               (alist/push fnames dtname fname)
+               (match (alist/lookup the-context.datatypes dtname) with
+                 (maybe:yes dt) -> (gen-datatype dt fname)
+                 (maybe:no)     -> (impossible))
+               fname)))
+
+      ;; (:tuple vars pattern)
+      (define (alt-pattern dtname alt prefix)
+        (let ((vars (map-range i alt.arity (sexp:symbol (fresh prefix)))))
+          (:tuple vars (sexp:list (list:cons (sexp:cons dtname alt.name) vars)))))
+
+      (define (gen-datatype dt fname)
+        (let ((tmap (alist:nil))
+              (dparams '())
+              (alts '())
+              (nalts (dt.get-nalts))
+              (nindex (let ((n 0))
+                        (dt.iterate (lambda (tag alt) (set! n (max n (+ 1 alt.index)))))
+                        n))
+              (rank (kind-name 'dtrank dt.name))
+              (a (sexp:symbol (fresh 'a)))
+              (b (sexp:symbol (fresh 'b)))
+              (clauses '())
+              (ncovered 0))
+
+          ;; immediates (nullary alts) sort before tuples, see magic_cmp().
+          ;;   alt indexes can have gaps (see uotag-index), so tuples are
+          ;;   ranked above the highest one rather than above nalts.
+          (define (alt-rank alt)
+            (if (= alt.arity 0) alt.index (+ nindex alt.index)))
+
+          (define (rank-clause alt)
+            (list (sexp:list (list:cons (sexp:cons dt.name alt.name) (n-of alt.arity (sexp:symbol '_))))
+                  (sexp:symbol '->)
+                  (sexp:int (alt-rank alt))))
+
+          (define (rank-fun)
+            (let ((x (sexp:symbol (fresh 'x))))
+              (sexp (sym 'function) (sym rank) (sexp x) (bool #f)
+                    (sexp:list (append (list (sexp:symbol 'match) x (sexp:symbol 'with))
+                                       (foldr append2 '() (map rank-clause alts)))))))
+
+          (define (fun body)
+            (sexp (sym 'function) (sym fname) (sexp:list (append (reverse dparams) (list a b))) (bool #f) body))
+
+          (define (match-with vals default)
+            (if (null? clauses)
+                default
+                (sexp:list (append (list:cons (sexp:symbol 'match) vals)
+                                   (list (sexp:symbol 'with))
+                                   clauses
+                                   (if (and (= ncovered nalts) (or (= nalts 1) (null? (cdr vals))))
+                                       '()
+                                       (append (map (lambda (_) (sexp:symbol '_)) vals)
+                                               (list (sexp:symbol '->) default)))))))
+
+          (define (alt-clause alt)
+            (match kind (alt-pattern dt.name alt 'x) (alt-pattern dt.name alt 'y) with
+              'hash (:tuple xs px) _
+              -> (list px (sexp:symbol '->)
+                       (seq (map2 (lambda (x t) (:tuple t x x)) xs alt.types)
+                            tmap
+                            (sexp (sym 'hash-mix) a (int (alt-rank alt)))))
+              _ (:tuple xs px) (:tuple ys py)
+              -> (list px py (sexp:symbol '->)
+                       (seq (map2 (lambda (xy t) (match xy with (:pair x y) -> (:tuple t x y)))
+                                  (map2 (lambda (x y) (:pair x y)) xs ys)
+                                  alt.types)
+                            tmap a))
+              ))
+
+          (for-list tvar (dt.get-tvars)
+            (match tvar with
+              (type:tvar id _)
+              -> (let ((d (fresh 'd)))
+                   (alist/push tmap id d)
+                   (push! dparams (sexp:symbol d)))
+              _ -> (impossible)))
+          (dt.iterate (lambda (tag alt) (push! alts alt)))
+          (for-list alt alts
+            (when (> alt.arity 0)
+              (set! clauses (append (alt-clause alt) clauses))
+              (inc! ncovered)))
+          (push! defs (:tuple rank (rank-fun)))
+          (push! defs
+                 (:tuple
+                  fname
+                  (match kind with
+                    'cmp
+                    -> (fun (sexp (sym 'if) (sexp (sym 'eq?) a b)
+                                  (cmp=)
+                                  (match-with (list a b) (sexp (sym 'int-cmp) (sexp (sym rank) a) (sexp (sym rank) b)))))
+                    'eq
+                    -> (fun (sexp (sym 'or) (sexp (sym 'eq?) a b)
+                                  (match-with (list a b) (sexp:bool #f))))
+                    _ ;; hash: <a> is the running hash
+                    -> (fun (match-with (list b) (sexp (sym 'hash-mix) a (sexp (sym rank) b))))
+                    )))
+          ))
+
+      (define (top tvars type dicts)
+        (if (not (= (length tvars) (length dicts)))
+            (error1 "wrong number of dicts" (sexp:list rands))
+            (let ((tmap (alist:nil))
+                  (binds '())
+                  (a (fresh 'a))
+                  (b (fresh 'b)))
+              (for-range i (length tvars)
+                (match (nth tvars i) with
+                  (type:tvar id _)
+                  -> (let ((d (fresh 'u)))
+                       (alist/push tmap id d)
+                       (push! binds (sexp (sym d) (nth dicts i))))
+                  _ -> (impossible)))
+              (let ((body (match kind with
+                            'hash -> (sexp (sym 'lambda) (sexp (sym b)) (field type tmap (sexp:int 0) (sexp:symbol b)))
+                            _     -> (sexp (sym 'lambda) (sexp (sym a) (sym b))
+                                           (field type tmap (sexp:symbol a) (sexp:symbol b))))))
+                (sexp (sym 'let) (sexp:list (reverse binds))
+                      (if (null? defs)
+                          body
+                          (sexp (sym 'letrec)
+                                (sexp:list (map (lambda (def)
+                                                  (match def with
+                                                    (:tuple name fun) -> (sexp (sym name) fun)))
+                                                (reverse defs)))
+                                body)))))))
+
+      (match rands with
+        ((sexp:symbol name) . dicts)
+        -> (match (alist/lookup the-context.datatypes name) (alist/lookup the-context.aliases name) with
+             (maybe:yes dt) _
+             -> (expand (top (dt.get-tvars) (pred name (dt.get-tvars)) dicts))
+             _ (maybe:yes (:scheme gens type))
+             -> (expand (top gens type dicts))
+             _ _
+             -> (error1 "unknown datatype" name))
+        x -> (error1 "malformed datatype-cmp" x))
+      ))
+
+  (define (expand-datatype-cmp rands) (derive 'cmp rands))
+  (define (expand-datatype=? rands) (derive 'eq rands))
+  (define (expand-datatype-hash rands) (derive 'hash rands))
+
+  ;; quoted data is expanded as before, but without positions.
+  (define (expand-quote rands)
+    (sexp:list (list:cons (sexp:symbol 'quote) (map expand rands))))
+
+  ;; these take their arguments with positions, the rest of the
+  ;;   table gets them stripped.
+  (define pos-aware
+    (list 'if 'set! 'begin 'lambda 'λ 'function 'vcase 'let-splat 'let-subst 'match))
+
   (define transform-table
      (alist/make
+      ('quote expand-quote)
       ('if expand-if)
       ('set! expand-set!)
       ('begin expand-begin)
@@ -775,6 +1206,9 @@
       ('logior expand-logior)
       ('datatype->sexp expand-datatype->sexp)
       ('dtreflect expand-dtreflect)
+      ('datatype-cmp expand-datatype-cmp)
+      ('datatype=? expand-datatype=?)
+      ('datatype-hash expand-datatype-hash)
       ))
 
   go
@@ -39,6 +39,12 @@
 (define bool-type       (pred 'bool '()))
 (define symbol-type     (pred 'symbol '()))
 (define sexp-type       (pred 'sexp '()))
+(define float-type      (pred 'float '()))
+;; packed arrays, see lib/packed.scm
+(define u8array-type    (pred 'u8array '()))
+(define i32array-type   (pred 'i32array '()))
+(define i64array-type   (pred 'i64array '()))
+(define f64array-type   (pred 'f64array '()))
 
 (define base-types
   (alist/make
@@ -47,6 +53,11 @@
    ('string string-type)
    ('undefined undefined-type)
    ('symbol symbol-type)
+   ('float float-type)
+   ('u8array u8array-type)
+   ('i32array i32array-type)
+   ('i64array i64array-type)
+   ('f64array f64array-type)
    ))
 
 (define cint-types
@@ -526,10 +526,16 @@
       _ -> (error1 "malformed pvcase" exp)
       ))
 
+  ;; the newest label is at the front.
+  (define next-variant-index
+    (alist:entry _ index _) -> (+ 1 index)
+    (alist:nil)             -> 0)
+
   (define (remember-variant-label label)
     (match (alist/lookup the-context.variant-labels label) with
       (maybe:yes _) -> #u
-      (maybe:no) -> (let ((index (alist/length the-context.variant-labels)))
+      (maybe:no) -> (let ((index (uotag-index (next-variant-index the-context.variant-labels)
+					      (format ":" (sym label)))))
 		      (alist/push the-context.variant-labels label index))))
 
   ;; these are used in type schemes in lookup-primap.  Since they are generalized
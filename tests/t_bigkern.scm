@@ -0,0 +1,109 @@
+;; -*- Mode: Irken -*-
+
+(require "lib/basis.scm")
+(require "demo/bignum.scm")
+(require "lib/crypto/ctbig.scm")
+
+;; check the C bignum kernels (irk_digits_mul, irk_digits_exp_mod,
+;;   irk_i31_montymul and irk_i31_modpow in include/header1.c) against
+;;   the pure-Irken versions.  under the VM, both sides are Irken.
+
+(define (all-ones n)
+  (make-vector n big/mask))
+
+(define (ramp n)
+  (let ((v (make-vector n 0)))
+    (for-range i n
+      (set! v[i] (logand big/mask (* (+ i 1) #x123456789abcdef))))
+    v))
+
+(define (check-mul name a b)
+  (printf name " "
+          (bool (magic=? (digits-mul-school a b) (digits-mul-school* a b)))
+          "\n"))
+
+(define (kernel-exp-mod b e m)
+  (%backend (c llvm)
+    (digits->big (digits-exp-mod b e m) #t))
+  (%backend bytecode
+    (big-exp-mod* (digits->big b #t) (digits->big e #t) (digits->big m #t))))
+
+(define (check-kernel-exp-mod name b e m)
+  (printf name " "
+          (bool (big= (kernel-exp-mod b e m)
+                      (big-exp-mod* (digits->big b #t) (digits->big e #t) (digits->big m #t))))
+          "\n"))
+
+;; b^e mod m with the constant-time i31 code, for odd m.
+(define (i31-exp-mod b e m)
+  (let ((m31 (big->i31 m))
+        (x (i31/make m31[0]))
+        (es (big->u256 e)))
+    (i31/reduce x (big->i31 b) m31)
+    (i31/modpow x es (string-length es) m31 (i31/ninv31 m31[1])
+                (i31/make m31[0]) (i31/make m31[0]))
+    (i31->big x)))
+
+(define (check-exp-mod name b e m)
+  (let ((r (big-exp-mod* b e m)))
+    (printf name " " (bool (big= (big-exp-mod b e m) r)))
+    ;; the i31 code wants a positive base and an odd modulus.
+    (when (and (big-odd? m) (not (big-zero? b)))
+      (printf " " (bool (big= (i31-exp-mod b e m) r))))
+    (printf "\n")))
+
+(define (check-montymul name x y m)
+  (let ((m31 (big->i31 m))
+        (x31 (i31/make m31[0]))
+        (y31 (i31/make m31[0]))
+        (m0i (i31/ninv31 m31[1]))
+        (d0 (i31/make m31[0]))
+        (d1 (i31/make m31[0])))
+    (i31/reduce x31 (big->i31 x) m31)
+    (i31/reduce y31 (big->i31 y) m31)
+    (i31/montymul d0 x31 y31 m31 m0i)
+    (i31/montymul* d1 x31 y31 m31 m0i)
+    (printf name " " (bool (magic=? d0 d1)) "\n")))
+
+(define (go)
+  (let ((ones4 (digits->big (all-ones 4) #t))
+        (p3 (big-pow big/3 323))
+        (n (dec->big "9516311845790656153499716760847001433441357"))
+        (d (dec->big "5617843187844953170308463622230283376298685")))
+
+    (printf "-- mul\n")
+    (check-mul "1x1" #(7) #(9))
+    (check-mul "ones 1x1" (all-ones 1) (all-ones 1))
+    (check-mul "ones 5x3" (all-ones 5) (all-ones 3))
+    (check-mul "ones 40x40" (all-ones 40) (all-ones 40))
+    (check-mul "ramp 17x9" (ramp 17) (ramp 9))
+    (check-mul "empty" #() #())
+    (check-mul "ones 3x0" (all-ones 3) #())
+
+    (printf "-- kernel exp-mod\n")
+    (check-kernel-exp-mod "4^13 mod 497" #(4) #(13) #(497))
+    (check-kernel-exp-mod "empty exponent" #(5) #() #(7))
+    (check-kernel-exp-mod "empty base" #() #(3) #(7))
+    (check-kernel-exp-mod "ones" (vcons (all-ones 3) (- big/mask 2)) (all-ones 4) (all-ones 4))
+    (check-kernel-exp-mod "ramp" #(1 0 0) (ramp 5) #(1 0 1))
+
+    (printf "-- big-exp-mod\n")
+    (printf "4^13 mod 497 = " (big-repr (big-exp-mod big/4 (int->big 13) (int->big 497))) "\n")
+    (check-exp-mod "small" big/4 (int->big 13) (int->big 497))
+    (check-exp-mod "zero base" big/0 (int->big 13) (int->big 497))
+    (check-exp-mod "zero exponent" big/5 big/0 (int->big 497))
+    (check-exp-mod "base > m" (int->big 1000) (int->big 13) (int->big 497))
+    (check-exp-mod "m = 1" big/5 big/3 big/1)
+    (check-exp-mod "even m" big/7 (int->big 1000) (int->big 1000))
+    (check-exp-mod "ones" (big-sub ones4 big/2) (big-sub ones4 big/2) ones4)
+    (check-exp-mod "3^323" (big-pow big/7 150) (big-pow big/5 200) p3)
+    (check-exp-mod "m-1" (big-sub p3 big/1) (big-sub p3 big/2) p3)
+    (check-exp-mod "rsa" (b256->big "rubber ducky") d n)
+
+    (printf "-- i31 montymul\n")
+    (check-montymul "small" big/4 (int->big 13) (int->big 497))
+    (check-montymul "ones" (big-sub ones4 big/2) (big-sub ones4 big/3) ones4)
+    (check-montymul "3^323" (big-pow big/7 150) (big-sub p3 big/1) p3)
+    ))
+
+(go)
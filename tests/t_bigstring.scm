@@ -0,0 +1,27 @@
+;; -*- Mode: Irken -*-
+
+(include "lib/basis.scm")
+
+;; allocates strings big enough to live in the large object space,
+;;   keeps a few of them alive across collections and drops the rest.
+
+(define (make-big n ch)
+  (let ((s (make-string n)))
+    (for-range i n
+      (string-set! s i ch))
+    s))
+
+(define (go)
+  (let ((keep (make-vector 10 "")))
+    (for-range i 200
+      (let ((s (make-big (+ 100000 i) (int->char (+ 65 (mod i 26))))))
+        (when (= 0 (mod i 20))
+          (set! keep[(/ i 20)] s))))
+    (for-range i 10
+      (let ((s keep[i]))
+        (printn (string-length s))
+        (printn (string-ref s (- (string-length s) 1)))))
+    (printn (string-length (string-concat (vector->list keep))))
+    ))
+
+(go)
@@ -0,0 +1,101 @@
+;; -*- Mode: Irken -*-
+
+(require "lib/basis.scm")
+
+(typealias point {x=int y=int})
+
+(datatype thing
+  (:empty)
+  (:leaf int)
+  (:node string (list thing) {w=int name=symbol})
+  (:pair (list int) (list string))
+  (:vec (vector char) bool)
+  (:point point)
+  (:none)
+  )
+
+(datatype bush
+  (:tip)
+  (:branch 'a (list (bush 'a)))
+  )
+
+(define thing-cmp (datatype-cmp thing))
+(define thing=? (datatype=? thing))
+(define thing-hash (datatype-hash thing))
+
+(define bush-cmp (datatype-cmp bush int-cmp))
+(define bush=? (datatype=? bush =))
+(define bush-hash (datatype-hash bush hash-mix))
+
+(define point-cmp (datatype-cmp point))
+
+(define things
+  (list (thing:empty)
+        (thing:none)
+        (thing:leaf 1)
+        (thing:leaf 2)
+        (thing:leaf -5)
+        (thing:node "a" '() {w=1 name='x})
+        (thing:node "a" '() {w=1 name='y})
+        (thing:node "a" (list (thing:leaf 1)) {w=1 name='x})
+        (thing:node "ab" (list (thing:leaf 1) (thing:empty)) {w=0 name='x})
+        (thing:node "b" (list (thing:leaf 1) (thing:none)) {w=0 name='x})
+        (thing:pair '(1 2 3) '("x"))
+        (thing:pair '(1 2) '("x"))
+        (thing:pair '(1 2 3) '("x" "y"))
+        (thing:vec #(#\a #\b) #t)
+        (thing:vec #(#\a #\b) #f)
+        (thing:vec #(#\a) #t)
+        (thing:vec #() #t)
+        (thing:point {x=1 y=2})
+        (thing:point {x=2 y=1})
+        ))
+
+(define bushes
+  (list (bush:tip)
+        (bush:branch 1 '())
+        (bush:branch 1 (list (bush:tip)))
+        (bush:branch 1 (list (bush:branch 2 '())))
+        (bush:branch 1 (list (bush:branch 3 '()) (bush:tip)))
+        (bush:branch 0 (list (bush:branch 3 '())))
+        ))
+
+;; the generated functions agree with magic-cmp, and equal values
+;;   have equal hashes.
+(defmacro check-all
+  (check-all vals cmp eq hash)
+  -> (let (($n 0))
+       (for-list a vals
+         (for-list b vals
+           (assert (eq? (cmp a b) (magic-cmp a b)))
+           (assert (eq? (eq a b) (magic=? a b)))
+           (when (eq a b)
+             (assert (= (hash a) (hash b))))
+           (inc! $n)))
+       (printf (int $n) " pairs checked\n")))
+
+(check-all things thing-cmp thing=? thing-hash)
+(check-all bushes bush-cmp bush=? bush-hash)
+
+;; fresh copies are equal, with the same hash.
+(let ((a (thing:node "abc" (list (thing:leaf 3) (thing:pair '(1) '("z"))) {w=2 name='q}))
+      (b (thing:node (format "ab" "c") (list (thing:leaf 3) (thing:pair (list 1) (list "z"))) {w=2 name='q})))
+  (printn (thing=? a b))
+  (printn (= (thing-hash a) (thing-hash b)))
+  (printn (thing-cmp a b)))
+
+(printn (point-cmp {x=1 y=5} {x=1 y=2}))
+(printn (list (bush-hash (bush:branch 1 (list (bush:tip)))) (string-hash "hello")))
+
+;; long lists are walked by a loop.
+(let ((a (thing:pair (range 100000) '()))
+      (b (thing:pair (range 100000) '("x"))))
+  (printn (thing-cmp a b))
+  (printn (thing=? a a)))
+
+;; in a map.
+(let ((m (tree/empty)))
+  (for-list t things
+    (tree/insert! m thing-cmp t (thing-hash t)))
+  (printn (tree/size m))
+  (printn (tree/member m thing-cmp (thing:pair '(1 2) '("x")))))
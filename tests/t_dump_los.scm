@@ -0,0 +1,40 @@
+;; -*- Mode: Irken -*-
+
+(include "lib/basis.scm")
+
+;; a large string reachable from both an old object and a young one
+;;   when the image is dumped.  with -G the dump empties the nursery
+;;   before compacting the old space; the string must come through
+;;   both intact.
+
+(define (churn n)
+  (let loop ((i n) (acc '()))
+    (if (= i 0)
+        (length acc)
+        (loop (- i 1) (list:cons i acc)))))
+
+(define (make-big n)
+  (let ((s (make-string n)))
+    (for-range i n
+      (string-set! s i #\a))
+    s))
+
+(define (go holder)
+  (let ((young (list holder[0])))
+    (callcc (lambda (k) (dump "test3.image" k)))
+    (printn (string-length holder[0]))
+    (printn (string-ref holder[0] 99999))
+    (printn (string-length (car young)))
+    0))
+
+(define (main)
+  (let ((holder (make-vector 1 "")))
+    (set! holder[0] (make-big 100000))
+    ;; age <holder> into the old space.
+    (for-range i 3000
+      (churn 1000))
+    (go holder)))
+
+(if (> sys.argc 1)
+    (throw (load "test3.image") 0)
+    (main))
@@ -0,0 +1,21 @@
+;; -*- Mode: Irken -*-
+
+(include "lib/basis.scm")
+
+;; dump twice from different continuations: the second image must
+;;   resume at the second dump, not the first.  run with -G as well,
+;;   where the second dump happens with the heap already pretenured.
+
+(define (g n)
+  (callcc (lambda (k) (dump "test2.image" k)))
+  (printn "after second")
+  (+ n 1))
+
+(define (f)
+  (callcc (lambda (k) (dump "test2.image" k)))
+  (printn "after first")
+  (g 1))
+
+(if (> sys.argc 1)
+    (printn (throw (load "test2.image") 0))
+    (printn (f)))
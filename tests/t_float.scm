@@ -0,0 +1,45 @@
+;; -*- Mode: Irken -*-
+
+(include "lib/basis.scm")
+(include "lib/float.scm")
+
+;; a nest of float operations, fused into one C expression.
+(define (poly x)
+  (float+ (float* (float* 3.0 x) x) (float- (float* -2.5 x) 1e-1)))
+
+(define (sum-to n)
+  (let loop ((i 0) (acc 0.0))
+    (if (= i n)
+        acc
+        (loop (+ i 1) (float+ acc (float/ 1.0 (int->float (+ i 1))))))))
+
+(define (show x)
+  (printf (float->string x) "\n"))
+
+(show 1.5)
+(show -0.25)
+(show 6.02e23)
+(show (poly 2.0))
+(show (sum-to 1000))
+(show (float-sqrt 2.0))
+(show (float-pow 2.0 0.5))
+(show (float/ 1.0 3.0))
+(show (float-floor -1.5))
+(show (float-negate (float-abs -3.0)))
+(printn (float->int 7.9))
+(printn (float->int -7.9))
+(printn (float< 1.0 2.0))
+(printn (float>= 1.0 2.0))
+(printn (float= (float* 0.1 3.0) 0.3))
+(printn (float-cmp 2.0 1.0))
+(printn (float-max 2.0 1.0))
+(printn (list 1.25 2.5))
+(show (string->float "123.5e-2"))
+(printn (string-float? "1.5x"))
+(printn (try (float->string (string->float "pi")) except (:String/BadFloat s) -> s))
+(printn (magic<? 1.0 2.0))
+;; enough boxes to keep the collector busy.
+(let loop ((i 0) (acc 0.0))
+  (if (< i 1000000)
+      (loop (+ i 1) (float+ acc 0.5))
+      (show acc)))
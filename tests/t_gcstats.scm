@@ -0,0 +1,36 @@
+;; -*- Mode: Irken -*-
+
+(include "lib/basis.scm")
+
+;; churn through enough garbage to force some collections, then make
+;;   sure the collector's statistics add up.
+
+(define (churn n)
+  (let loop ((i n) (acc '()))
+    (if (= i 0)
+        (length acc)
+        (loop (- i 1) (list:cons i acc)))))
+
+(define (sum-vector v)
+  (let ((r 0))
+    (for-range i (vector-length v)
+      (set! r (+ r v[i])))
+    r))
+
+(define (go)
+  (for-range i 3000
+    (churn 10000))
+  (let ((s (gc-stats)))
+    (printn (> (+ s.collections s.minor-collections) 0))
+    ;; one pause may include a minor and a full collection.
+    (printn (> (sum-vector s.pauses) 0))
+    (printn (<= (sum-vector s.pauses) (+ s.collections s.minor-collections)))
+    (printn (vector-length s.pauses))
+    (printn (> s.words-allocated 80000000))
+    (printn (and (>= s.survival 0) (<= s.survival 100)))
+    (printn (> s.peak-words 0))
+    (printn (<= s.max-pause-usecs s.pause-usecs))
+    (printn (<= s.pause-usecs s.elapsed-usecs))
+    ))
+
+(go)
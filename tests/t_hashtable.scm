@@ -0,0 +1,55 @@
+;; -*- Mode: Irken -*-
+
+(require "lib/basis.scm")
+(require "lib/hashtable.scm")
+
+;; ints, checked against a tree with the same contents.
+(let ((ht (hashtable/make int-hash =))
+      (m (tree/empty)))
+  (for-range i 10000
+    (let ((k (* i 1024)))
+      (hashtable/put! ht k i)
+      (tree/insert! m int-cmp k i)))
+  ;; delete every third key, overwrite every fifth.
+  (for-range i 10000
+    (let ((k (* i 1024)))
+      (when (= 0 (mod i 3))
+        (hashtable/delete! ht k)
+        (tree/delete! m int-cmp k))
+      (when (= 0 (mod i 5))
+        (hashtable/put! ht k (- i))
+        (tree/delete! m int-cmp k)
+        (tree/insert! m int-cmp k (- i)))))
+  (printn (hashtable/count ht))
+  (printn (tree/size m))
+  (for-map k v m
+    (assert (eq? v (hashtable/get-default ht k 0))))
+  (for-hashtable k v ht
+    (assert (match (tree/member m int-cmp k) with
+              (maybe:yes v0) -> (= v v0)
+              (maybe:no) -> #f)))
+  (printn (hashtable/get ht 3072))
+  (printn (hashtable/get ht 5120))
+  (printn (hashtable/present? ht 7))
+  (hashtable/clear! ht)
+  (printn (hashtable/count ht)))
+
+;; strings: the key is a fresh copy, so this is structural.
+(let ((ht (hashtable/make string-hash string=?)))
+  (for-list w '("apple" "banana" "cherry" "date")
+    (hashtable/put! ht w (string-length w)))
+  (printn (hashtable/get ht (format "ban" "ana")))
+  (printn (hashtable/get ht "fig"))
+  (hashtable/delete! ht "apple")
+  (hashtable/put! ht "fig" 3)
+  (printn (sort < (hashtable/values ht))))
+
+;; symbols, surviving a collection.
+(let ((ht (hashtable/make symbol-hash eq?)))
+  (for-list s '(a b c d e f g h i j)
+    (hashtable/put! ht s (symbol->string s)))
+  ;; churn the heap to force some collections.
+  (for-range i 100
+    (assert (= 100000 (vector-length (make-vector 100000 i)))))
+  (printn (hashtable/get ht 'e))
+  (printn (sort symbol<? (hashtable/keys ht))))
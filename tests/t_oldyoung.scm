@@ -0,0 +1,43 @@
+;; -*- Mode: Irken -*-
+
+(include "lib/core.scm")
+(include "lib/pair.scm")
+
+;; stores young objects into a long-lived vector and record while
+;;   churning through garbage, exercising the write barrier when
+;;   compiled with the generational collector (-G).
+
+(define (churn n)
+  (let loop ((i n) (acc '()))
+    (if (= i 0)
+        (length acc)
+        (loop (- i 1) (list:cons i acc)))))
+
+(define (fresh n)
+  (churn 1000000)
+  (list n n n))
+
+;; the argument frame is allocated before (fresh 2) runs and promoted
+;;   by the collections in it, so the stores after that are not
+;;   initializing ones.
+(define (show-args a b c)
+  (churn 1000000)
+  (printn (list a b c)))
+
+(define (go)
+  (let ((v (make-vector 100 '()))
+        (r {total=0 last='()}))
+    (for-range i 2000
+      (set! v[(mod i 100)] (list:cons i v[(mod i 100)]))
+      (set! r.last (list i i))
+      (churn 1000))
+    (for-range i 100
+      (set! r.total (+ r.total (length v[i]))))
+    (printn r.total)
+    (printn r.last)
+    (printn (reverse v[7]))
+    (for-range i 2
+      (show-args (list 1) (fresh 2) (list 3)))
+    ))
+
+(go)
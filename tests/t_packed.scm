@@ -0,0 +1,54 @@
+;; -*- Mode: Irken -*-
+
+(include "lib/basis.scm")
+(include "lib/packed.scm")
+
+(define (sum-u8 a)
+  (let loop ((i 0) (sum 0))
+    (if (= i (u8array-length a))
+        sum
+        (loop (+ i 1) (+ sum (u8array-ref a i))))))
+
+(let ((a (make-u8array 10))
+      (b (make-i32array 5))
+      (c (make-i64array 3))
+      (d (make-f64array 4)))
+  (printn a)
+  (for-range i 10
+    (u8array-set! a i (* i 30)))
+  ;; elements wrap around to fit.
+  (printn a)
+  (printn (sum-u8 a))
+  (u8array-fill! a 2 3 7)
+  (printn a)
+  (u8array-copy a 0 4 a 6)
+  (printn a)
+  (i32array-set! b 0 -1)
+  (i32array-set! b 1 #x7fffffff)
+  (i32array-set! b 2 #x80000000)
+  (printn b)
+  (printn (i32array-ref b 0))
+  (i64array-fill! c 0 3 -123456789012)
+  (i64array-set! c 1 42)
+  (printn c)
+  (for-range i 4
+    (f64array-set! d i (float/ (int->float i) 4.0)))
+  (printn d)
+  (f64array-copy d 0 2 d 2)
+  (printn (f64array-ref d 3))
+  (printn (u8array->string (string->u8array "hello")))
+  (printn (magic<? (string->u8array "abc") (string->u8array "abd")))
+  (printn (try (u8array-ref a 10) except (:Packed/Range n lo hi) -> (- 0 n)))
+  )
+
+;; enough arrays to keep the collector busy, and one big one.
+(let loop ((i 0) (keep (make-u8array 1)))
+  (if (< i 100000)
+      (let ((a (make-u8array 100)))
+        (u8array-set! a 99 (logand i #xff))
+        (loop (+ i 1) (if (= 0 (mod i 1000)) a keep)))
+      (printn (u8array-ref keep 99))))
+(let ((big (make-i64array 100000)))
+  (i64array-set! big 99999 1)
+  (printn (i64array-length big))
+  (printn (i64array-ref big 99999)))
@@ -0,0 +1,30 @@
+;; -*- Mode: Irken -*-
+
+(include "lib/core.scm")
+(include "lib/pair.scm")
+
+;; grow a long live list through a series of full collections.  the
+;;   runner builds this with -DIRK_PARALLEL_GC and a small initial heap,
+;;   so that the parallel collector runs with the to-space nearly full.
+;;   every 100th element is a vector big enough to be copied outside
+;;   the collector's chunks.
+
+(define (build n)
+  (let loop ((i n) (acc '()))
+    (if (= i 0)
+        acc
+        (loop (- i 1)
+              (list:cons (if (= 0 (mod i 100))
+                             (make-vector 200 i)
+                             (make-vector 1 i))
+                         acc)))))
+
+(define (sum l)
+  (let loop ((l l) (total 0))
+    (match l with
+      () -> total
+      (hd . tl) -> (loop tl (+ total hd[(- (vector-length hd) 1)])))))
+
+(let ((l (build 2000000)))
+  (printn (length l))
+  (printn (sum l)))
@@ -0,0 +1,54 @@
+;; -*- Mode: Irken -*-
+
+(require "lib/basis.scm")
+
+;; check the search primitives against simple loops, on strings long
+;;   enough to cross the vector block sizes.
+
+(define (naive-find-char ch s start end)
+  (let loop ((i start))
+    (cond ((= i end) -1)
+          ((char=? ch (string-ref s i)) i)
+          (else (loop (+ i 1))))))
+
+(define (naive-find-any set s start end)
+  (let loop ((i start))
+    (cond ((= i end) -1)
+          ((member-eq? (string-ref s i) (string->list set)) i)
+          (else (loop (+ i 1))))))
+
+(define (naive-find a s start end)
+  (let ((n (string-length a)))
+    (let loop ((i start))
+      (cond ((> (+ i n) end) -1)
+            ((string=? a (substring s i (+ i n))) i)
+            (else (loop (+ i 1)))))))
+
+(define text
+  (format "GET /a/b/c?q=1 HTTP/1.1\r\nHost: x\r\nX-Long: "
+          (join (n-of 20 "abcdefghijklmnopqrstuvwxyz0123456789"))
+          ";;;aab\r\n\r\n"))
+
+(define n (string-length text))
+(define checked 0)
+
+(for-range start 70
+  (for-list end (list n (- n 1) (- n 17) (+ start 33) start)
+    (when (<= start end)
+      (for-list ch (string->list ":;\r?Z")
+        (assert (= (string-find-char ch text start end) (naive-find-char ch text start end)))
+        (inc! checked))
+      (for-list set '("\r\n" ":;" "?=&/" "" "zyxwvutsrqpo" ";")
+        (assert (= (string-find-any set text start end) (naive-find-any set text start end)))
+        (inc! checked))
+      (for-list a '("\r\n" "aab" "HTTP" "" "789;" "nope" "9abc")
+        (assert (= (string-find-range a text start end) (naive-find a text start end)))
+        (inc! checked)))))
+(printn checked)
+
+(printn (string-find "aab" "aaab"))
+(printn (string-find-any ";" text 0 n))
+(printn (list (starts-with text "GET ") (starts-with "GE" "GET") (ends-with text "\r\n\r\n")))
+(printn (list (string=? "abc" "abc") (string=? "abc" "abcd") (string=? "" "")))
+(printn (string-split "a,b,,c," #\,))
+(printn (string-split-string "k1: v1\r\nk2: v2\r\n" "\r\n"))
@@ -0,0 +1,55 @@
+;; -*- Mode: Irken -*-
+
+(require "lib/basis.scm")
+(require "lib/strslice.scm")
+
+(define (show l)
+  (printn (map strslice->string l)))
+
+(let ((buf "GET /index.html HTTP/1.1\r\nHost: example.com\r\nAccept: */*\r\n\r\n")
+      (lines (strslice/split-string (string->strslice buf) "\r\n"))
+      (request (strslice/split (first lines) #\space)))
+  (show lines)
+  (show request)
+  (printn (strslice/string=? (first request) "GET"))
+  (printn (strslice/starts-with (nth lines 1) "Host:"))
+  (printn (strslice/find ": " (nth lines 1)))
+  (printn (strslice/ref (nth request 1) 1))
+  ;; every piece is a view of <buf>.
+  (printn (every? (lambda (sl) (match sl with (strslice:t s _ _) -> (eq? s buf))) lines))
+  ;; and sees writes to it.
+  (string-set! buf 0 #\P)
+  (printn (strslice->string (first request))))
+
+;; ordering and hashing agree with strings.
+(let ((words '("" "a" "ab" "abc" "abd" "b" "ba" "zz"))
+      (text (string-concat (map (lambda (w) (format "[" w "]")) words)))
+      (views (map (lambda (sl) (strslice/sub sl 1 (strslice/length sl)))
+                  (butlast (strslice/split (string->strslice text) #\])))))
+  (show views)
+  (for-list a views
+    (for-list b views
+      (assert (eq? (strslice/compare a b)
+                   (string-compare (strslice->string a) (strslice->string b))))))
+  (for-list v views
+    (assert (= (strslice-hash v) (string-hash (strslice->string v)))))
+  (printn (length views)))
+
+;; a slice can be a hash table key.
+(let ((ht (hashtable/make strslice-hash strslice=?))
+      (src (string->strslice "one two three two one two")))
+  (for-list w (strslice/split src #\space)
+    (hashtable/put! ht w (+ 1 (hashtable/get-default ht w 0))))
+  (printn (hashtable/get ht (string->strslice "two")))
+  (printn (hashtable/count ht)))
+
+;; views survive a collection.
+(let ((sl (strslice/sub (string->strslice (format "hello, " "world")) 7 12)))
+  (for-range i 100
+    (assert (= 100000 (vector-length (make-vector 100000 i)))))
+  (printn (strslice->string sl)))
+
+(printn (try
+         (strslice/length (strslice/sub (string->strslice "abc") 2 5))
+         except
+         (:String/Range _ lo hi) -> (- hi lo)))
@@ -0,0 +1,87 @@
+;; -*- Mode: Irken -*-
+
+(include "lib/basis.scm")
+
+;; a datatype with 52 tuple alts, so that some of them are numbered
+;;   past the tags taken by TC_PACKED and TC_FLOAT.  their fields
+;;   must survive a collection.
+
+(datatype big
+  (:a0 string)
+  (:a1 string)
+  (:a2 string)
+  (:a3 string)
+  (:a4 string)
+  (:a5 string)
+  (:a6 string)
+  (:a7 string)
+  (:a8 string)
+  (:a9 string)
+  (:a10 string)
+  (:a11 string)
+  (:a12 string)
+  (:a13 string)
+  (:a14 string)
+  (:a15 string)
+  (:a16 string)
+  (:a17 string)
+  (:a18 string)
+  (:a19 string)
+  (:a20 string)
+  (:a21 string)
+  (:a22 string)
+  (:a23 string)
+  (:a24 string)
+  (:a25 string)
+  (:a26 string)
+  (:a27 string)
+  (:a28 string)
+  (:a29 string)
+  (:a30 string)
+  (:a31 string)
+  (:a32 string)
+  (:a33 string)
+  (:a34 string)
+  (:a35 string)
+  (:a36 string)
+  (:a37 string)
+  (:a38 string)
+  (:a39 string)
+  (:a40 string)
+  (:a41 string)
+  (:a42 string)
+  (:a43 string)
+  (:a44 string)
+  (:a45 string)
+  (:a46 string)
+  (:a47 string)
+  (:a48 string)
+  (:a49 string)
+  (:a50 string)
+  (:a51 string)
+  )
+
+(define big->string
+  (big:a48 s) -> s
+  (big:a49 s) -> s
+  (big:a51 s) -> s
+  _ -> "other")
+
+(define (churn n)
+  (let loop ((i n) (acc '()))
+    (if (= i 0)
+        (length acc)
+        (loop (- i 1) (list:cons i acc)))))
+
+(define (go)
+  (let ((v (list->vector (list (big:a48 (int->string 48))
+                               (big:a49 (int->string 49))
+                               (big:a50 (int->string 50))
+                               (big:a51 (int->string 51))))))
+    (for-range i 3000
+      (churn 10000))
+    (for-range i (vector-length v)
+      (printn (big->string v[i])))
+    ))
+
+(go)
@@ -13,7 +13,7 @@ def getenv_or (name, default):
         return default
 
 cc = getenv_or ('CC', 'clang')
-cflags = getenv_or ('CFLAGS', '-std=c99 -O3 -fomit-frame-pointer -I./include -lffi')
+cflags = getenv_or ('CFLAGS', '-std=c99 -O3 -fomit-frame-pointer -I./include -lffi -lm')
 
 sysname = platform.uname()[0]
 
@@ -35,6 +35,50 @@ def test_t_dump_image():
     exp1 = open ('tests/t_dump_image.exp').read()
     assert (exp0 == exp1)
 
+def compile_test (base, *flags):
+    return system ('self/compile %s %s' % (PJ ('tests', base + '.scm'), ' '.join (flags)))
+
+# run a dumping test, then load its image: the loaded image should
+#   print the last <resumed> lines of the expected output.  the
+#   generational collector dumps differently, so repeat with -G.
+def check_dump (base, resumed):
+    exp = open (PJ ('tests', base + '.exp')).read()
+    lines = exp.split ('\n')
+    for flags in ([], ['-G']):
+        assert (compile_test (base, *flags) == 0)
+        assert (run_test (base) == exp)
+        assert (run_test (base, '-l') == '\n'.join (lines[-(resumed + 1):]))
+
+def test_t_dump_twice():
+    # the image must resume at the second dump, not the first.
+    check_dump ('t_dump_twice', 2)
+
+def test_t_dump_los():
+    # a large object shared by old and young objects.
+    check_dump ('t_dump_los', 3)
+
+def test_t_oldyoung():
+    # this one is about the write barrier, so run it under the
+    #   generational collector too.
+    exp = open ('tests/t_oldyoung.exp').read()
+    for flags in ([], ['-G']):
+        assert (compile_test ('t_oldyoung', *flags) == 0)
+        assert (run_test ('t_oldyoung') == exp)
+
+def test_t_pargc():
+    # build with the parallel collector, starting from a heap small
+    #   enough that it collects with the to-space nearly full.
+    exp = open ('tests/t_pargc.exp').read()
+    env = {'IRKEN_HEAP': '8000000', 'IRKEN_GC_THREADS': '4'}
+    os.environ.update (env)
+    try:
+        for flags in ([], ['-G']):
+            assert (compile_test ('t_pargc', '-f', '"-DIRK_PARALLEL_GC -pthread"', *flags) == 0)
+            assert (run_test ('t_pargc') == exp)
+    finally:
+        for name in env:
+            del os.environ[name]
+
 def test_t21():
     out = run_test ('t21')
     exp = open ('gc.c').read()
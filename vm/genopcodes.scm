@@ -2,14 +2,91 @@
 
 ;; generate an include file for irkvm.c with information
 ;;  about all the opcodes.
+;;
+;; usage: vm/genopcodes [<ngrams-file> [<nsuperops>]]
+;;
+;; with an <ngrams-file> (written by a VM_NGRAMS build of irkvm, see
+;;   vm/irkvm.c) it picks a new set of superinstructions and rewrites
+;;   self/superops.scm.  otherwise it uses the ones already there.
+;;   either way it writes vm/irkvm.h, the fused handlers in
+;;   vm/irkvm_super.h, the wide handlers in vm/irkvm_wide.h and the
+;;   JIT's stencils in vm/irkvm_jit.h.
 
-(include "lib/basis.scm")
-(include "lib/map.scm")
-(include "self/byteops.scm")
+(require "lib/basis.scm")
+(require "lib/map.scm")
+(require "self/byteops.scm")
 
-(define (generate-irkvm-h)
+;; "<count> <op> <op> [<op>]"
+(define (read-ngrams path)
+  (let ((file (file/open-read path))
+        (r '()))
+    (for-list line (file/read-lines file)
+      (match (string-split line #\space) with
+        (n . ops)
+        -> (push! r {count=(string->int n) ops=(map string->symbol ops)})
+        _ -> (impossible)))
+    (file/close file)
+    r))
+
+(define (fusable? ops)
+  (match (reverse ops) with
+    (last . middle)
+    -> (and (every? (lambda (op) (member-eq? op superop-middle)) middle)
+            (or (member-eq? last superop-middle)
+                (member-eq? last superop-last)))
+    _ -> #f))
+
+;; greedy, by the number of dispatches saved.  picking (a b c) takes
+;;   its count away from (a b) and (b c), since the compiler fuses the
+;;   longest sequence it can.
+(define (pick-superops ngrams n)
+  (let ((grams (filter (lambda (g) (fusable? g.ops)) ngrams))
+        (bigrams (map-maker magic-cmp))
+        (r '()))
+    (define (score g) (* g.count (- (length g.ops) 1)))
+    (define (take-from ops count)
+      (match (bigrams::get ops) with
+        (maybe:yes g) -> (set! g.count (max 0 (- g.count count)))
+        (maybe:no) -> #u))
+    (for-list g grams
+      (when (= 2 (length g.ops))
+        (bigrams::add g.ops g)))
+    (let loop ((n n))
+      (when (> n 0)
+        (let ((best (fold (lambda (g best) (if (> (score g) (score best)) g best))
+                          {count=0 ops=(list 'none 'none)}
+                          grams)))
+          (when (> best.count 0)
+            (push! r best.ops)
+            (set! grams (filter (lambda (g) (not (eq? g best))) grams))
+            (match best.ops with
+              (a b c) -> (begin (take-from (list a b) best.count)
+                                (take-from (list b c) best.count))
+              _ -> #u)
+            (loop (- n 1))))))
+    (reverse r)))
+
+(define (write-superops-scm runs)
+  (let ((file (stdio/open-write "self/superops.scm")))
+    (stdio/write
+     file
+     (format
+      ";; -*- Mode: Irken -*-\n\n"
+      ";; generated by " sys.argv[0] " - do not edit\n"
+      ";; superinstructions, see self/byteops.scm.\n\n"
+      "(define superop-runs\n"
+      "  (list\n"
+      (join (lambda (ops) (format "   (list " (join (lambda (op) (format "'" (sym op))) " " ops) ")\n")) "" runs)
+      "   ))\n"))
+    (stdio/close file)))
+
+(define (generate-irkvm-h superops)
   (let ((file (stdio/open-write "vm/irkvm.h"))
-        (nops (vector-length opcode-info)))
+        (nbase (vector-length opcode-info))
+        (nsuper (vector-length superops))
+        (nops (+ nbase nsuper))
+        (infos (append (vector->list opcode-info)
+                       (map (lambda (s) s.info) (vector->list superops)))))
 
     (define (W s)
       (stdio/write file s))
@@ -24,28 +101,113 @@
         "  int nargs;\n"
         "  int varargs;\n"
         "  int target;\n"
+        "  int wide;\n"
         "} opcode_info_t;\n\n"
         "opcode_info_t irk_opcodes[" (int nops) "] = {\n"
         ))
 
     (let ((lines '()))
-      (for-range i (vector-length opcode-info)
-        (let ((op opcode-info[i]))
-          (push! lines
-                (format
-                 "  {"(rpad 15 "\"" (sym op.name) "\", ")
-                 (int op.nargs) ", "
-                 (int (B op.varargs)) ", "
-                 (int (B op.target)) "}"))))
+      (for-list op infos
+        (push! lines
+               (format
+                "  {"(rpad 15 "\"" (sym op.name) "\", ")
+                (int op.nargs) ", "
+                (int (B op.varargs)) ", "
+                (int (B op.target)) ", "
+                (int (B (and (< op.code nbase) (wide-op? op.name)))) "}")))
       (W (format (join ",\n" (reverse lines)))))
-    (W "\n};\n")
+    (W "\n};\n\n")
+    ;; the opcodes each superinstruction runs.
+    (W (format
+        "#define IRK_MAX_SUPEROP 3\n\n"
+        "typedef struct {\n"
+        "  int len;\n"
+        "  int ops[IRK_MAX_SUPEROP];\n"
+        "} superop_info_t;\n\n"
+        "superop_info_t irk_superops[" (int (+ nsuper 1)) "] = {\n"))
+    (for-vector s superops
+      (W (format "  {" (int (length s.ops)) ", {"
+                 (join (lambda (op) (let ((info (opcode-named op))) (int->string info.code))) ", " s.ops)
+                 "}}, // " (sym s.info.name) "\n")))
+    (W "  {0, {0}}\n};\n")
     ;; emit symbolic names for each opcode.
-    (for-range i (vector-length opcode-info)
-      (let ((op opcode-info[i]))
-        (W (format "#define IRK_OP_" (rpad 10 (upcase (symbol->string op.name)))
-                   " " (int i) "\n"))))
+    (for-list op infos
+      (W (format "#define IRK_OP_" (rpad 10 (upcase (symbol->string op.name)))
+                 " " (int op.code) "\n")))
+    (W (format "#define IRK_NUM_BASE_OPCODES " (int nbase) "\n"))
     (W (format "#define IRK_NUM_OPCODES " (int nops) "\n"))
+    ;; the dispatch table for vm_go().
+    (W "\n#define IRK_DISPATCH_TABLE")
+    (for-list op infos
+      (W (format " \\\n  &&l_" (sym op.name) ",")))
+    (W "\n")
+    ;; and for wide insns, see vm/irkvm_wide.h.
+    (W "\n#define IRK_WIDE_DISPATCH_TABLE")
+    (for-vector op opcode-info
+      (W (if (wide-op? op.name)
+             (format " \\\n  &&lw_" (sym op.name) ",")
+             " \\\n  &&l_wide_bad,")))
+    (W "\n")
     (stdio/close file)
     ))
 
-(generate-irkvm-h)
+;; each DO_<OP> leaves the pc at the next insn, which is the next
+;;   opcode of the superinstruction.
+(define (generate-irkvm-super-h superops)
+  (let ((file (stdio/open-write "vm/irkvm_super.h")))
+    (define (W s)
+      (stdio/write file s))
+    (W (format "// generated by " sys.argv[0] " - do not edit\n"
+               "// the superinstruction handlers, included in vm_go().\n"))
+    (for-vector s superops
+      (W (format "\n l_" (sym s.info.name) ":\n"))
+      (for-list op s.ops
+        (W (format "  DO_" (upcase (symbol->string op)) "();\n")))
+      (W "  DISPATCH();\n"))
+    (stdio/close file)))
+
+;; the DO_<OP> macros again, with the operand macros switched to wide.
+(define (generate-irkvm-wide-h)
+  (let ((file (stdio/open-write "vm/irkvm_wide.h")))
+    (define (W s)
+      (stdio/write file s))
+    (W (format "// generated by " sys.argv[0] " - do not edit\n"
+               "// the handlers for wide insns, included in vm_go().\n"))
+    (for-vector op opcode-info
+      (when (wide-op? op.name)
+        (W (format "\n lw_" (sym op.name) ":\n"
+                   "  DO_" (upcase (symbol->string op.name)) "();\n"
+                   "  DISPATCH();\n"))
+        #u))
+    (stdio/close file)))
+
+;; a stencil for each of <jit-ops>, and the table of them by opcode.
+;;   vm/irkvm_jit.c includes this once for narrow insns and once for
+;;   wide ones, with JIT_STENCIL naming each set.
+(define (generate-irkvm-jit-h)
+  (let ((file (stdio/open-write "vm/irkvm_jit.h")))
+    (define (W s)
+      (stdio/write file s))
+    (W (format "// generated by " sys.argv[0] " - do not edit\n"
+               "// the JIT's stencils, included in vm/irkvm_jit.c.\n\n"))
+    (for-list name jit-ops
+      (W (format "JIT_DEFINE (" (sym name) ", " (upcase (symbol->string name)) ")\n")))
+    (W "\nstatic jit_stencil_t JIT_STENCIL(table)[IRK_NUM_BASE_OPCODES] = {")
+    (for-vector op opcode-info
+      (W (if (member-eq? op.name jit-ops)
+             (format "\n  JIT_STENCIL(" (sym op.name) "),")
+             "\n  0,")))
+    (W "\n};\n")
+    (stdio/close file)))
+
+(let ((superops
+       (if (> sys.argc 1)
+           (let ((n (if (> sys.argc 2) (string->int sys.argv[2]) 32))
+                 (runs (pick-superops (read-ngrams sys.argv[1]) n)))
+             (write-superops-scm runs)
+             (make-superop-info runs))
+           superop-info)))
+  (generate-irkvm-h superops)
+  (generate-irkvm-super-h superops)
+  (generate-irkvm-wide-h)
+  (generate-irkvm-jit-h))
@@ -7,6 +7,7 @@
 #include "rdtsc.h"
 #include <sys/utsname.h>
 #include <dlfcn.h>
+#include <fcntl.h>
 
 #ifdef __APPLE__
 #include <ffi/ffi.h>
@@ -16,6 +17,13 @@
 
 #include "irkvm.h"
 
+// the JIT (vm/irkvm_jit.c) is for x86-64 Linux, and stays out of the
+//   way of the instrumented builds.  -DVM_NO_JIT leaves it out.
+#if defined(__x86_64__) && defined(__linux__) \
+  && !defined(VM_PROFILE) && !defined(VM_NGRAMS) && !defined(VM_NO_JIT)
+#define VM_JIT
+#endif
+
 static object * allocate (irk_int tc, irk_int size);
 static object * alloc_no_clear (irk_int tc, irk_int size);
 static object * dump_object (object * ob, int depth);
@@ -46,55 +54,6 @@ void DO (object * x);
     }                                           \
   } while (0)
 
-int
-next (FILE * f, irk_int * n)
-{
-  irk_int b = fgetc (f);
-  if (b == -1) {
-    return -1;
-  } else {
-    *n = b;
-    return 0;
-  }
-}
-
-int
-read_int (FILE * f, irk_int * r)
-{
-  irk_int n = 0;
-  CHECK (next (f, &n));
-  if (n == 254) {
-    irk_int r0;
-    CHECK (read_int (f, &r0));
-    *r = -r0;
-    return 0;
-  } else if (n == 255) {
-    irk_int bytes;
-    n = 0;
-    CHECK (next (f, &bytes));
-    for (int i=0; i < bytes; i++) {
-      n <<= 8;
-      n |= fgetc (f);
-    }
-    *r = n;
-    return 0;
-  } else {
-    *r = n;
-    return 0;
-  }
-}
-
-int
-read_string (FILE * f, void * b, irk_int n)
-{
-  size_t r = fread (b, 1, n, f);
-  if (r == n) {
-    return 0;
-  } else {
-    return -1;
-  }
-}
-
 object *
 vm_list_cons (object * car, object * cdr)
 {
@@ -129,149 +88,94 @@ get_sizeoff_entry (irk_int sindex)
   }
 }
 
+// an insn is its opcode followed by its operands, a signed byte each.
+//   when an operand doesn't fit, the compiler makes the insn wide: the
+//   'wide' opcode, then the opcode, then each operand in four bytes.
+//   see resolve-labels in self/bytecode.scm.
+typedef uint8_t bytecode_t;
+
+static irk_int bytecode_len;
+static bytecode_t * bytecode;
+
+static inline
+irk_int
+insn_wide (irk_int pc)
+{
+  return bytecode[pc] == IRK_OP_WIDE;
+}
+
+// the opcode of the insn at <pc>, past any wide prefix.
+static inline
 irk_int
-read_literal (FILE * f, object * ob)
+insn_op (irk_int pc)
 {
-  irk_int code = 0;
-  irk_int n = 0;
-  CHECK (next (f, &code));
-  switch (code) {
-  case '+':
-    CHECK (read_int (f, &n));
-    *ob = TAG_INTEGER(n);
-    break;
-  case '-':
-    CHECK (read_int (f, &n));
-    *ob =  TAG_INTEGER(-n);
-    break;
-  case 'T':
-    *ob =  IRK_TRUE;
-    break;
-  case 'F':
-    *ob =  IRK_FALSE;
-    break;
-  case 'u':
-    *ob =  IRK_UNDEFINED;
-    break;
-  case 'c':
-    CHECK (read_int (f, &n));
-    *ob =  TO_CHAR (n);
-    break;
-  case 'S': {
-    CHECK (read_int (f, &n));
-    irk_string * t = (irk_string *) alloc_no_clear (TC_STRING, string_tuple_length (n));
-    t->len = n;
-    CHECK (read_string (f, t->data, n));
-    *ob = (object *) t;
-  }
-    break;
-  case 'Y': { // symbol
-    // first create the string
-    CHECK (read_int (f, &n));
-    irk_string * t = (irk_string *) alloc_no_clear (TC_STRING, string_tuple_length (n));
-    t->len = n;
-    CHECK (read_string (f, t->data, n));
-    // fprintf (stderr, "sym "); fwrite (t->data, 1, n, stderr); fprintf (stderr, "\n");
-    // now wrap as a symbol
-    object * sym = allocate (TC_SYMBOL, 2);
-    sym[1] = t;
-    sym[2] = TAG_INTEGER (vm_internal_symbol_counter++);
-    // push onto the global list (for lib/symbol.scm)
-    vm_internal_symbol_list = vm_list_cons (sym, vm_internal_symbol_list);
-    *ob = sym;
-  }
-    break;
-  case 'I': // immediate (e.g., (list:nil))
-    CHECK (read_int (f, &n));
-    *ob = (object) n;
-    break;
-  case 'C': { // tuple (e.g., (list:cons ...))
-    irk_int tag;
-    irk_int nargs;
-    CHECK (read_int (f, &tag));
-    CHECK (read_int (f, &nargs));
-    object * ob0 = allocate (tag, nargs);
-    for (int i=0; i < nargs; i++) {
-      CHECK (read_literal (f, &(ob0[i+1])));
-    }
-    *ob = ob0;
+  return bytecode[pc + insn_wide (pc)];
+}
+
+static inline
+irk_int
+wide_arg (bytecode_t * p)
+{
+  int32_t arg;
+  memcpy (&arg, p, sizeof (arg));
+  return arg;
+}
+
+// operand <n> (counting from 1) of the insn at <pc>.
+static
+irk_int
+insn_arg (irk_int pc, irk_int n)
+{
+  if (insn_wide (pc)) {
+    return wide_arg (bytecode + pc + (4 * n) - 2);
+  } else {
+    return ((int8_t *) bytecode)[pc + n];
   }
+}
+
+// length in bytes of the insn at <pc>, opcode included.
+static
+irk_int
+insn_length (irk_int pc)
+{
+  irk_int op = insn_op (pc);
+  irk_int units;
+  // special-case varargs opcodes
+  switch (op) {
+  case IRK_OP_TRCALL:
+  case IRK_OP_MAKE:
+    units = 4 + insn_arg (pc, 3);
     break;
-  case 'V': { // vector
-    irk_int nargs;
-    CHECK (read_int (f, &nargs));
-    if (nargs > 0) {
-      object * ob0 = allocate (TC_VECTOR, nargs);
-      for (int i=0; i < nargs; i++) {
-        CHECK (read_literal (f, &(ob0[i+1])));
-      }
-      *ob = ob0;
-    } else {
-      *ob = (object) TC_EMPTY_VECTOR;
-    }
-  }
+  case IRK_OP_NVCASE:
+    units = 4 + (2 * insn_arg (pc, 3));
     break;
-  case 'P': { // reference to previous literal
-    irk_int index;
-    CHECK (read_int (f, &index));
-    *ob = bytecode_literals[index+1];
-  }
+  case IRK_OP_FFI:
+    units = 5 + insn_arg (pc, 4);
     break;
   default:
-    fprintf (stderr, "bad literal code: %" PRIdPTR "\n", code);
-    return -1;
+    units = 1 + irk_opcodes[op].nargs;
   }
-  return 0;
+  // the prefix and the opcode, then four bytes per operand.
+  return insn_wide (pc) ? 2 + 4 * (units - 1) : units;
 }
 
+// the insns after a superinstruction must be the rest of its
+//   sequence, or the bytecode was made for a different VM.
 static
 irk_int
-read_literals (FILE * f)
+superop_mismatch (irk_int pc)
 {
-  // read the outer vector specially so we can resolve
-  //   internal pointer references.
-  irk_int code = 0;
-  CHECK (next (f, &code));
-  if (code == 'V') {
-    irk_int nlits = 0;
-    CHECK (read_int (f, &nlits));
-    object * lits0 = allocate (TC_VECTOR, nlits);
-    bytecode_literals = lits0;
-    for (int i=0; i < nlits; i++) {
-      CHECK (read_literal (f, &(lits0[i+1])));
-    }
-    // field lookup table
-    CHECK (read_literal (f, (object *) &vm_field_lookup_table));
-    irk_ambig_size = irk_get_vector_length (vm_field_lookup_table[1]);
-    // sizeoff literal index
-    object * sizeoff_index_ob;
-    CHECK (read_literal (f, (object *) &sizeoff_index_ob));
-    irk_int sizeoff_index = 1 + UNTAG_INTEGER (sizeoff_index_ob);
-    object * sizeoff_literal;
-    CHECK (read_literal (f, (object *) &sizeoff_literal));
-    if (sizeoff_index > 0) {
-      bytecode_literals[sizeoff_index] = sizeoff_literal;
+  superop_info_t * run = &irk_superops[bytecode[pc] - IRK_NUM_BASE_OPCODES];
+  for (int i=1; i < run->len; i++) {
+    pc += insn_length (pc);
+    // a wide insn is never fused.
+    if (pc >= bytecode_len || bytecode[pc] != run->ops[i]) {
+      return 1;
     }
-    // read the metadata index
-    object * metadata_index_ob;
-    CHECK (read_literal (f, (object *) &metadata_index_ob));
-    vm_metadata_index = UNTAG_INTEGER (metadata_index_ob);
-    return 0;
-  } else {
-    fprintf (stderr, "bytecode file does not start with vector.\n");
-    return -1;
   }
+  return 0;
 }
 
-// Only small programs fit into a 16-bit bytecode.
-//typedef uint16_t bytecode_t;
-//#define BYTECODE_MAX UINT16_MAX
-typedef int32_t bytecode_t;
-#define BYTECODE_MAX INT32_MAX
-
-static irk_int bytecode_len;
-static bytecode_t * bytecode;
-
 // NOTE: because we are using computed gotos in the main VM loop,
 //  any opcode that is out of range causes a segfault.  here we
 //  scan the bytecode here to ensure that all are in range before
@@ -287,78 +191,111 @@ scan_bytecode()
     if (!((op >= 0) && (op < IRK_NUM_OPCODES))) {
       fprintf (stderr, "out of range opcode %d at position %d.\n", op, (int)i);
       return -1;
+    } else if (op >= IRK_NUM_BASE_OPCODES && superop_mismatch (i)) {
+      fprintf (stderr, "superinstruction %s at position %d doesn't match the code.\n",
+               irk_opcodes[op].name, (int)i);
+      return -1;
+    } else if (op == IRK_OP_WIDE
+               && (i + 1 >= bytecode_len || bytecode[i+1] >= IRK_NUM_BASE_OPCODES
+                   || !irk_opcodes[bytecode[i+1]].wide)) {
+      fprintf (stderr, "bad wide insn at position %d.\n", (int)i);
+      return -1;
     } else {
       // opcode is in range.  now skip its args.
-      opcode_info_t code = irk_opcodes[op];
-      // special-case varargs opcodes
-      int nargs = 0;
-      int nvar = 0;
-      switch (op) {
-      case IRK_OP_TRCALL:
-        nvar = bytecode[i+3];
-        nargs = 3 + nvar;
-        break;
-      case IRK_OP_MAKE:
-        nvar = bytecode[i+3];
-        nargs = 3 + nvar;
-        break;
-      case IRK_OP_NVCASE:
-        nvar = bytecode[i+3];
-        nargs = 3 + (2 * nvar);
-        break;
-      case IRK_OP_FFI:
-        nvar = bytecode[i+4];
-        nargs = 4 + nvar;
-        break;
-      default:
-        nargs = code.nargs;
-        break;
-      }
-      //fprintf (stdout, "%8d %s\n", (int)i, code.name);
-      i += nargs + 1;
+      //fprintf (stdout, "%8d %s\n", (int)i, irk_opcodes[op].name);
+      i += insn_length (i);
     }
   }
   return 0;
 }
 
+// --------------------------------------------------
+// binary bytecode files
+// --------------------------------------------------
+//
+// self/bytecode.scm writes a header, then the literals as a heap
+//   image, then the code (see bytecode_t), all in the byte order
+//   given by <endian>.  The image starts with two roots, the literals
+//   vector and the field lookup table, and each pointer in it is the
+//   byte offset of its object from the start of the image.  The whole
+//   file is mapped privately: the code is used where it is, and the
+//   image is relocated in place.  Literals stay outside the heap, as
+//   they do in compiled C.
+
+#define IRK_BYC_MAGIC   "IRKBYC\0\0"
+#define IRK_BYC_VERSION 3
+#define IRK_BYC_ENDIAN  0x01020304
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t endian;              // IRK_BYC_ENDIAN in the writer's byte order
+  uint32_t word_size;
+  uint32_t nopcodes;            // IRK_NUM_OPCODES of the compiler
+  uint64_t lit_offset;          // bytes from the start of the file
+  uint64_t lit_words;
+  uint64_t code_offset;
+  uint64_t code_len;            // in bytes
+  uint64_t metadata_index;
+} irk_byc_header;
+
 static
 irk_int
-read_bytecode (FILE * f)
+read_bytecode_image (char * path)
 {
-  irk_int codelen = 0;
-  CHECK (read_int (f, &codelen));
-  bytecode = (bytecode_t *) malloc (sizeof(bytecode_t) * codelen);
-  if (!bytecode) {
-    fprintf (stderr, "unable to allocate bytecode array.\n");
+  int fd = open (path, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat (fd, &st) != 0) {
+    fprintf (stderr, "unable to open '%s'\n", path);
     return -1;
-  } else {
-    for (int i=0; i < codelen; i++) {
-      irk_int code = 0;
-      CHECK (read_int (f, &code));
-      if (code > BYTECODE_MAX) {
-        return -1;
-      } else {
-        bytecode[i] = code;
-      }
-    }
-    bytecode_len = codelen;
-    return 0;
   }
-}
-
-static
-irk_int
-read_magic (FILE * f)
-{
-  char magic0[] = "IRKVM0";
-  char magic1[] = "      ";
-  CHECK (read_string (f, magic1, strlen(magic0)));
-  if (0 == strncmp (magic0, magic1, strlen(magic0))) {
-    return 0;
-  } else {
-    fprintf (stderr, "not a bytecode file.\n");
+  size_t size = (size_t) st.st_size;
+  char * map = (size < sizeof (irk_byc_header)) ? MAP_FAILED
+    : mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (map == MAP_FAILED) {
+    fprintf (stderr, "unable to map '%s'\n", path);
+    return -1;
+  }
+  irk_byc_header * h = (irk_byc_header *) map;
+  char * problem = NULL;
+  if (h->endian != IRK_BYC_ENDIAN) {
+    problem = "wrong byte order";
+  } else if (h->version != IRK_BYC_VERSION) {
+    problem = "unsupported version";
+  } else if (h->word_size != sizeof (object)) {
+    problem = "wrong word size";
+  } else if (h->nopcodes != IRK_NUM_OPCODES) {
+    problem = "made for a VM with different opcodes";
+  } else if ((h->lit_offset % sizeof (object)) != 0
+             || h->lit_words < 2
+             || h->lit_offset + h->lit_words * sizeof (object) > size
+             || (h->code_offset % sizeof (bytecode_t)) != 0
+             || h->code_offset + h->code_len * sizeof (bytecode_t) > size) {
+    problem = "truncated or corrupt";
+  }
+  if (problem) {
+    fprintf (stderr, "%s: %s\n", path, problem);
+    munmap (map, size);
     return -1;
   }
+  object * lits = (object *) (map + h->lit_offset);
+  object * end = lits + h->lit_words;
+  gc_relocate (2, lits, end, - (irk_int) ((uintptr_t) lits / sizeof (object)));
+  bytecode_literals = (object *) lits[0];
+  vm_field_lookup_table = (object *) lits[1];
+  irk_ambig_size = irk_get_vector_length (vm_field_lookup_table[1]);
+  vm_metadata_index = (irk_int) h->metadata_index;
+  // the symbols were numbered by the compiler, in the order they were laid out.
+  for (object * p = lits + 2; p < end; p += GET_TUPLE_LENGTH (*p) + 1) {
+    if (IS_TYPE (TC_SYMBOL, *p)) {
+      vm_internal_symbol_list = vm_list_cons ((object *) p, vm_internal_symbol_list);
+      vm_internal_symbol_counter++;
+    }
+  }
+  bytecode = (bytecode_t *) (map + h->code_offset);
+  bytecode_len = (irk_int) h->code_len;
+  return 0;
 }
 
 static
@@ -366,13 +303,18 @@ irk_int
 read_bytecode_file (char * path)
 {
   FILE * f = fopen (path, "rb");
+  char magic[8];
   if (!f) {
     fprintf (stderr, "unable to open '%s'\n", path);
     return -1;
+  } else if (fread (magic, 1, sizeof (magic), f) != sizeof (magic)
+             || 0 != memcmp (magic, IRK_BYC_MAGIC, sizeof (magic))) {
+    fclose (f);
+    fprintf (stderr, "%s: not a bytecode file (or an old one, recompile it)\n", path);
+    return -1;
   } else {
-    CHECK (read_magic (f));
-    CHECK (read_literals (f));
-    CHECK (read_bytecode (f));
+    fclose (f);
+    CHECK (read_bytecode_image (path));
     CHECK (scan_bytecode());
     return 0;
   }
@@ -384,7 +326,8 @@ object * vm_k = IRK_NIL;
 object * vm_top = IRK_NIL;
 object * vm_result = IRK_NIL;
 
-// Use the higher, (likely) unused user tags for these.
+// Use the higher, (likely) unused user tags for these (just above
+//   TC_FLOAT).
 // XXX consider instead using TC_CLOSURE/etc with
 //   these and using conditional code in the gc.
 #define TC_VM_CLOSURE (63<<2)
@@ -459,14 +402,14 @@ vm_varset (irk_int depth, irk_int index, object * val)
   for (int i=0; i < depth; i++) {
     lenv = (object *) lenv[1];
   }
-  lenv[index+2] = val;
+  IRK_STORE (lenv[index+2], val);
 }
 
 static
 void
 vm_push_lenv (object * rib)
 {
-  rib[1] = vm_lenv;
+  IRK_STORE (rib[1], vm_lenv);
   vm_lenv = rib;
 }
 
@@ -489,6 +432,39 @@ vm_get_field_offset (irk_int index, irk_int label_code)
   }
 }
 
+// rref and rset carry an inline cache in their last two operands:
+//   the last record tag seen there plus one (zero when empty), and
+//   the index of the label in that record.  in a narrow insn they are
+//   unsigned bytes, and a tag or index too big for one isn't cached.
+static inline
+irk_int
+narrow_field_index (bytecode_t * cache, irk_int tag, irk_int label_code)
+{
+  if (cache[0] == tag + 1) {
+    return cache[1];
+  } else {
+    irk_int index = vm_get_field_offset (tag, label_code);
+    if (tag < 255 && index < 256) {
+      cache[0] = tag + 1;
+      cache[1] = index;
+    }
+    return index;
+  }
+}
+
+static inline
+irk_int
+wide_field_index (bytecode_t * cache, irk_int tag, irk_int label_code)
+{
+  if (wide_arg (cache) == tag + 1) {
+    return wide_arg (cache + 4);
+  } else {
+    int32_t slot[2] = {tag + 1, vm_get_field_offset (tag, label_code)};
+    memcpy (cache, slot, sizeof (slot));
+    return slot[1];
+  }
+}
+
 object * vm_the_closure = IRK_NIL;
 
 static
@@ -499,6 +475,11 @@ vm_set_closure (object * closure)
   return 0;
 }
 
+#ifdef VM_PROFILE
+static void vmprof_gc_begin (void);
+static void vmprof_gc_end (void);
+#endif
+
 #define N_VM_ROOTS 5
 
 static
@@ -518,7 +499,12 @@ vm_gc (int nreg)
   heap1[3] = (object) bytecode_literals;
   heap1[4] = (object) vm_field_lookup_table;
   // NOTE: adjust value of N_VM_ROOTS if you add more roots!
-  nwords = do_gc (N_VM_ROOTS + nreg);
+#ifdef VM_PROFILE
+  vmprof_gc_begin();
+#endif
+  gc_check_progress();
+  gc_stats_begin();
+  nwords = gc_collect (N_VM_ROOTS + nreg);
   // replace roots
   vm_lenv = (object *) heap0[0];
   vm_k    = (object *) heap0[1];
@@ -526,7 +512,12 @@ vm_gc (int nreg)
   bytecode_literals = (object*) heap0[3];
   vm_field_lookup_table = (object *) heap0[4];
   // set new limit
-  limit = heap0 + (heap_size - 1024);
+  gc_set_limit (1024);
+  gc_last_freep = freep;
+  gc_stats_end();
+#ifdef VM_PROFILE
+  vmprof_gc_end();
+#endif
 #if USE_CYCLECOUNTER
   t1 = rdtsc();
   gc_ticks += (t1 - t0);
@@ -576,7 +567,7 @@ vm_do_ffi (object * vm_regs, irk_int pc, irk_int nargs, object * result)
   void * pvals[nargs];
   int good = 1;
   for (int i=0; i < nargs; i++) {
-    object * ob = vm_regs[bytecode[pc+5+i]];
+    object * ob = vm_regs[insn_arg (pc, 5+i)];
     switch (get_case (ob)) {
     case TC_INT:
       // Note: we can't use sint here, because it is not a synonym for 'intptr_t',
@@ -623,7 +614,7 @@ vm_do_ffi (object * vm_regs, irk_int pc, irk_int nargs, object * result)
   if (good) {
     ffi_type * rtype;
     // parse rtype
-    unsigned char rcode = (unsigned char) GET_CHAR (vm_regs[bytecode[pc+3]]);
+    unsigned char rcode = (unsigned char) GET_CHAR (vm_regs[insn_arg (pc, 3)]);
     switch (rcode) {
     case 'i':
       rtype = &ffi_type_pointer;
@@ -643,7 +634,7 @@ vm_do_ffi (object * vm_regs, irk_int pc, irk_int nargs, object * result)
       return -1;
     }
     if (FFI_OK == ffi_prep_cif (&cif, FFI_DEFAULT_ABI, nargs, rtype, args)) {
-      void * pfun = (void*) get_foreign (vm_regs[bytecode[pc+2]]);
+      void * pfun = (void*) get_foreign (vm_regs[insn_arg (pc, 2)]);
       if (pfun) {
         ffi_arg rc;
         ffi_call (&cif, pfun, &rc, pvals);
@@ -810,13 +801,39 @@ vm_cset (object * dst, irk_int code, object * val)
   return 0;
 }
 
+// a continuation saves the first <nregs> registers.  this is kept
+//   out of line: inlined, gcc knows <nregs> is a byte and copies them
+//   with 'rep movsq', which is slow for a handful of words.
+static __attribute__((noinline))
+void
+vm_save_regs (object * k, object ** regs, irk_int nregs)
+{
+  memcpy (k + 4, regs, nregs * sizeof (object));
+}
+
 // note: must match the value in self/cps.scm:make-register-allocator
 #define NREGS 20
-#define BC1 code[pc+1]
-#define BC2 code[pc+2]
-#define BC3 code[pc+3]
-#define BC4 code[pc+4]
-#define BC5 code[pc+5]
+
+// operand <n> of the insn at pc, and the pc of the next insn after
+//   one with <n> operands.  vm_go() switches these to the WIDE_
+//   versions for the wide handlers (see bytecode_t).
+#define NARROW_ARG(n) ((irk_int) ((int8_t *) code)[pc+(n)])
+#define NARROW_NEXT(n) (pc + (n))
+#define WIDE_ARG(n) wide_arg (code + pc + (4 * (n)) - 2)
+#define WIDE_NEXT(n) (pc + (4 * (n)) - 2)
+// the field index for <tag>, through the cache at operand <n>.
+#define NARROW_FIELD_INDEX(n,tag,label) narrow_field_index (code + pc + (n), tag, label)
+#define WIDE_FIELD_INDEX(n,tag,label) wide_field_index (code + pc + (4 * (n)) - 2, tag, label)
+
+#define ARG(n) NARROW_ARG(n)
+#define NEXT(n) NARROW_NEXT(n)
+#define FIELD_INDEX(n,tag,label) NARROW_FIELD_INDEX(n,tag,label)
+
+#define BC1 ARG(1)
+#define BC2 ARG(2)
+#define BC3 ARG(3)
+#define BC4 ARG(4)
+#define BC5 ARG(5)
 
 #define REG1 vm_regs[BC1]
 #define REG2 vm_regs[BC2]
@@ -832,6 +849,389 @@ vm_cset (object * dst, irk_int code, object * val)
 //   this would also be a cleaner way of handling %%cexp stuff, so
 //   %%cexp can only work with prims.
 
+// sampling profiler, see header1.c.  the interpreter's pc isn't
+//   visible to the signal handler, so the handler asks vm_go() to
+//   take the sample at the next call, tail call or return.  every
+//   loop goes through one of those.
+static volatile int irk_sample_pending = 0;
+
+static void
+irk_sample_vm (void * uc)
+{
+  if (gc_active) {
+    irk_sample_record (0, IRK_NIL, TC_VM_CONT, 1);
+  } else {
+    irk_sample_pending = 1;
+  }
+}
+
+#define SAMPLE_POINT()                                  \
+  do {                                                  \
+    if (irk_sample_pending) {                           \
+      irk_sample_pending = 0;                           \
+      irk_sample_record (pc, vm_k, TC_VM_CONT, 1);      \
+    }                                                   \
+  } while (0)
+
+#ifdef VM_JIT
+// the interpreter enters native code at calls, returns and loops: the
+//   places a unit can start.  jit_entry[pc] is its code for <pc>, and
+//   jit_count[pc] the times <pc> has been reached without one.
+static void ** jit_entry;
+static int32_t * jit_count;
+static int32_t jit_threshold;
+static irk_int jit_run (object ** regs, irk_int pc);
+
+#define JIT_POINT()                                             \
+  do {                                                          \
+    if (jit_entry                                               \
+        && (jit_entry[pc] || ++jit_count[pc] >= jit_threshold)) { \
+      pc = jit_run (vm_regs, pc);                               \
+    }                                                           \
+  } while (0)
+#else
+#define JIT_POINT()
+#endif
+
+// the compiler writes <path>.map next to the bytecode: one "<pc> <name>"
+//   line for each place where the enclosing function changes.
+static void
+read_pc_map (char * path)
+{
+  char mpath[4096];
+  snprintf (mpath, sizeof (mpath), "%s.map", path);
+  FILE * f = fopen (mpath, "r");
+  if (!f) {
+    fprintf (stderr, "no pc map: %s\n", mpath);
+    return;
+  }
+  irk_int n = 0;
+  irk_int size = 1024;
+  irk_pc_entry * table = malloc (size * sizeof (irk_pc_entry));
+  long pc;
+  char name[1024];
+  while (fscanf (f, "%ld %1023s", &pc, name) == 2) {
+    if (n == size) {
+      size *= 2;
+      table = realloc (table, size * sizeof (irk_pc_entry));
+    }
+    table[n].pc = (void *) (uintptr_t) pc;
+    table[n].name = strdup (name);
+    n++;
+  }
+  fclose (f);
+  irk_pc_table = table;
+  irk_pc_table_size = n;
+}
+
+#ifdef VM_NGRAMS
+// training build for superinstructions: count the runs of two and
+//   three opcodes where each falls through to the next, and write
+//   them to $IRKVM_NGRAMS at exit as "<count> <op> <op> [<op>]"
+//   lines.  vm/genopcodes picks the superinstructions from this.  a
+//   superinstruction counts as the opcodes it runs, so a trained
+//   build can be retrained.
+
+#define NBASE IRK_NUM_BASE_OPCODES
+
+static uint64_t * ngram2;
+static uint64_t * ngram3;
+static irk_int ngram_next = -1; // pc of the fall-through insn
+static irk_int ngram_prev1 = -1;
+static irk_int ngram_prev2 = -1;
+
+static void
+ngram_step (irk_int pc, irk_int op)
+{
+  if (pc == ngram_next) {
+    ngram2[ngram_prev1 * NBASE + op]++;
+    if (ngram_prev2 >= 0) {
+      ngram3[(ngram_prev2 * NBASE + ngram_prev1) * NBASE + op]++;
+    }
+    ngram_prev2 = ngram_prev1;
+  } else {
+    ngram_prev2 = -1;
+  }
+  ngram_prev1 = op;
+  ngram_next = pc + insn_length (pc);
+}
+
+static void
+ngram_count (irk_int pc)
+{
+  irk_int op = insn_op (pc);
+  if (op < NBASE) {
+    ngram_step (pc, op);
+  } else {
+    superop_info_t * run = &irk_superops[op - NBASE];
+    for (int i=0; i < run->len; i++) {
+      ngram_step (pc, run->ops[i]);
+      pc += insn_length (pc);
+    }
+  }
+}
+
+static void
+ngram_dump (void)
+{
+  FILE * f = fopen (getenv ("IRKVM_NGRAMS"), "w");
+  if (!f) {
+    fprintf (stderr, "unable to write n-grams to %s\n", getenv ("IRKVM_NGRAMS"));
+    return;
+  }
+  for (int a=0; a < NBASE; a++) {
+    for (int b=0; b < NBASE; b++) {
+      uint64_t n = ngram2[a * NBASE + b];
+      if (n) {
+        fprintf (f, "%" PRIu64 " %s %s\n", n, irk_opcodes[a].name, irk_opcodes[b].name);
+      }
+      for (int c=0; c < NBASE; c++) {
+        n = ngram3[(a * NBASE + b) * NBASE + c];
+        if (n) {
+          fprintf (f, "%" PRIu64 " %s %s %s\n", n, irk_opcodes[a].name, irk_opcodes[b].name, irk_opcodes[c].name);
+        }
+      }
+    }
+  }
+  fclose (f);
+}
+
+static void
+ngram_init (void)
+{
+  if (!getenv ("IRKVM_NGRAMS")) {
+    fprintf (stderr, "built with VM_NGRAMS, but $IRKVM_NGRAMS is not set\n");
+    exit (1);
+  }
+  ngram2 = calloc (NBASE * NBASE, sizeof (uint64_t));
+  ngram3 = calloc (NBASE * NBASE * NBASE, sizeof (uint64_t));
+  atexit (ngram_dump);
+}
+#endif
+
+#ifdef VM_PROFILE
+// profiling build: at each dispatch, charge the cycles since the last
+//   one to the opcode (and function) that was running, and count the
+//   transition between the two.  collections are counted against the
+//   opcode that started them; their cycles are also included in that
+//   opcode's cycles.  functions come from the pc map.  the report goes
+//   to $IRKVM_PROFILE at exit.
+
+#define NOPS IRK_NUM_OPCODES
+
+static uint64_t vmprof_op_count[NOPS];
+static uint64_t vmprof_op_cycles[NOPS];
+static uint64_t vmprof_pairs[NOPS * NOPS];
+static uint64_t vmprof_gc_count[NOPS];
+static uint64_t vmprof_gc_cycles[NOPS];
+static uint64_t * vmprof_fun_count;
+static uint64_t * vmprof_fun_cycles;
+static const char ** vmprof_fun_names;
+static irk_int vmprof_nfuns;
+static irk_int * vmprof_fun_of_pc; // -1 if there's no pc map
+static irk_int vmprof_op = -1;
+static irk_int vmprof_fun = -1;
+static uint64_t vmprof_t0;
+static uint64_t vmprof_gc_t0;
+
+static inline void
+vmprof_step (irk_int pc)
+{
+  uint64_t t = rdtsc();
+  irk_int op = insn_op (pc);
+  if (vmprof_op >= 0) {
+    uint64_t dt = t - vmprof_t0;
+    vmprof_op_cycles[vmprof_op] += dt;
+    vmprof_pairs[vmprof_op * NOPS + op]++;
+    if (vmprof_fun >= 0) {
+      vmprof_fun_cycles[vmprof_fun] += dt;
+    }
+  }
+  vmprof_op_count[op]++;
+  vmprof_fun = vmprof_fun_of_pc[pc];
+  if (vmprof_fun >= 0) {
+    vmprof_fun_count[vmprof_fun]++;
+  }
+  vmprof_op = op;
+  vmprof_t0 = t;
+}
+
+static void
+vmprof_gc_begin (void)
+{
+  vmprof_gc_t0 = rdtsc();
+}
+
+static void
+vmprof_gc_end (void)
+{
+  if (vmprof_op >= 0) {
+    vmprof_gc_count[vmprof_op]++;
+    vmprof_gc_cycles[vmprof_op] += rdtsc() - vmprof_gc_t0;
+  }
+}
+
+// sort indices by descending key.
+static uint64_t * vmprof_keys;
+
+static int
+vmprof_cmp (const void * a, const void * b)
+{
+  uint64_t ka = vmprof_keys[*(irk_int *)a];
+  uint64_t kb = vmprof_keys[*(irk_int *)b];
+  return (ka < kb) - (ka > kb);
+}
+
+static irk_int *
+vmprof_sort (uint64_t * keys, irk_int n)
+{
+  irk_int * order = malloc (n * sizeof (irk_int));
+  for (irk_int i=0; i < n; i++) {
+    order[i] = i;
+  }
+  vmprof_keys = keys;
+  qsort (order, n, sizeof (irk_int), vmprof_cmp);
+  return order;
+}
+
+static double
+vmprof_percent (uint64_t n, uint64_t total)
+{
+  return total ? (100.0 * n) / total : 0.0;
+}
+
+static void
+vmprof_dump (void)
+{
+  FILE * f = fopen (getenv ("IRKVM_PROFILE"), "w");
+  if (!f) {
+    fprintf (stderr, "unable to write profile to %s\n", getenv ("IRKVM_PROFILE"));
+    return;
+  }
+  uint64_t insns = 0, cycles = 0, gcs = 0, gc_cycles = 0;
+  for (irk_int i=0; i < NOPS; i++) {
+    insns += vmprof_op_count[i];
+    cycles += vmprof_op_cycles[i];
+    gcs += vmprof_gc_count[i];
+    gc_cycles += vmprof_gc_cycles[i];
+  }
+  fprintf (f, "# %" PRIu64 " insns, %" PRIu64 " cycles, %" PRIu64 " collections (%" PRIu64 " cycles)\n",
+           insns, cycles, gcs, gc_cycles);
+  irk_int * order = vmprof_sort (vmprof_op_cycles, NOPS);
+  fprintf (f, "\n# opcodes: count cycles cycles/insn %%cycles\n");
+  for (irk_int i=0; i < NOPS; i++) {
+    irk_int op = order[i];
+    uint64_t n = vmprof_op_count[op];
+    if (n) {
+      fprintf (f, "%-18s %12" PRIu64 " %14" PRIu64 " %8.1f %6.2f\n",
+               irk_opcodes[op].name, n, vmprof_op_cycles[op],
+               (double) vmprof_op_cycles[op] / n,
+               vmprof_percent (vmprof_op_cycles[op], cycles));
+    }
+  }
+  free (order);
+  if (vmprof_nfuns) {
+    order = vmprof_sort (vmprof_fun_cycles, vmprof_nfuns);
+    fprintf (f, "\n# functions: insns cycles %%cycles\n");
+    for (irk_int i=0; i < vmprof_nfuns; i++) {
+      irk_int fn = order[i];
+      if (vmprof_fun_count[fn]) {
+        fprintf (f, "%12" PRIu64 " %14" PRIu64 " %6.2f %s\n",
+                 vmprof_fun_count[fn], vmprof_fun_cycles[fn],
+                 vmprof_percent (vmprof_fun_cycles[fn], cycles),
+                 vmprof_fun_names[fn]);
+      }
+    }
+    free (order);
+  }
+  order = vmprof_sort (vmprof_pairs, NOPS * NOPS);
+  fprintf (f, "\n# opcode pairs: count %%insns\n");
+  for (irk_int i=0; i < NOPS * NOPS; i++) {
+    irk_int p = order[i];
+    uint64_t n = vmprof_pairs[p];
+    if (!n) {
+      break;
+    }
+    fprintf (f, "%-18s %-18s %12" PRIu64 " %6.2f\n",
+             irk_opcodes[p / NOPS].name, irk_opcodes[p % NOPS].name,
+             n, vmprof_percent (n, insns));
+  }
+  free (order);
+  order = vmprof_sort (vmprof_gc_cycles, NOPS);
+  fprintf (f, "\n# collections: count cycles %%cycles\n");
+  for (irk_int i=0; i < NOPS; i++) {
+    irk_int op = order[i];
+    if (vmprof_gc_count[op]) {
+      fprintf (f, "%-18s %12" PRIu64 " %14" PRIu64 " %6.2f\n",
+               irk_opcodes[op].name, vmprof_gc_count[op], vmprof_gc_cycles[op],
+               vmprof_percent (vmprof_gc_cycles[op], cycles));
+    }
+  }
+  free (order);
+  fclose (f);
+}
+
+static int
+vmprof_name_cmp (const void * a, const void * b)
+{
+  return strcmp (((irk_pc_entry *)a)->name, ((irk_pc_entry *)b)->name);
+}
+
+// a function's code can be split up by the functions nested inside
+//   it, so the pc map may name it more than once: number the distinct
+//   names, then give each pc the number of the entry covering it.
+static void
+vmprof_map_functions (void)
+{
+  irk_int n = irk_pc_table_size;
+  irk_pc_entry * by_name = malloc (n * sizeof (irk_pc_entry));
+  memcpy (by_name, irk_pc_table, n * sizeof (irk_pc_entry));
+  qsort (by_name, n, sizeof (irk_pc_entry), vmprof_name_cmp);
+  vmprof_fun_names = malloc (n * sizeof (char *));
+  for (irk_int i=0; i < n; i++) {
+    if (i == 0 || strcmp (by_name[i].name, by_name[i-1].name) != 0) {
+      vmprof_fun_names[vmprof_nfuns++] = by_name[i].name;
+    }
+  }
+  free (by_name);
+  vmprof_fun_count = calloc (vmprof_nfuns, sizeof (uint64_t));
+  vmprof_fun_cycles = calloc (vmprof_nfuns, sizeof (uint64_t));
+  for (irk_int i=0; i < n; i++) {
+    irk_int lo = 0, hi = vmprof_nfuns;
+    while (strcmp (vmprof_fun_names[lo], irk_pc_table[i].name) != 0) {
+      irk_int mid = (lo + hi) / 2;
+      if (strcmp (vmprof_fun_names[mid], irk_pc_table[i].name) <= 0) {
+        lo = mid;
+      } else {
+        hi = mid;
+      }
+    }
+    irk_int start = (irk_int) (uintptr_t) irk_pc_table[i].pc;
+    irk_int end = (i + 1 < n) ? (irk_int) (uintptr_t) irk_pc_table[i+1].pc : bytecode_len;
+    for (irk_int pc = start; pc < end && pc < bytecode_len; pc++) {
+      vmprof_fun_of_pc[pc] = lo;
+    }
+  }
+}
+
+static void
+vmprof_init (void)
+{
+  if (!getenv ("IRKVM_PROFILE")) {
+    fprintf (stderr, "built with VM_PROFILE, but $IRKVM_PROFILE is not set\n");
+    exit (1);
+  }
+  vmprof_fun_of_pc = malloc (bytecode_len * sizeof (irk_int));
+  for (irk_int pc=0; pc < bytecode_len; pc++) {
+    vmprof_fun_of_pc[pc] = -1;
+  }
+  if (irk_pc_table_size) {
+    vmprof_map_functions();
+  }
+  atexit (vmprof_dump);
+}
+#endif
+
 object
 vm_go (void)
 {
@@ -848,22 +1248,13 @@ vm_go (void)
   // https://en.wikipedia.org/wiki/Threaded_code
   // http://eli.thegreenplace.net/2012/07/12/computed-goto-for-efficient-dispatch-tables
 
+  // generated by vm/genopcodes, in opcode order.
   static void* dispatch_table[] = {
-    &&l_lit, &&l_litc, &&l_ret, &&l_add, &&l_sub, &&l_mul, &&l_div,
-    &&l_srem, &&l_shl, &&l_ashr, &&l_or, &&l_xor, &&l_and, &&l_eq, &&l_lt,
-    &&l_gt, &&l_le, &&l_ge, &&l_cmp, &&l_tst, &&l_jmp, &&l_fun, &&l_tail,
-    &&l_tail0, &&l_env, &&l_stor, &&l_ref, &&l_mov, &&l_epush, &&l_trcall,
-    &&l_trcall0, &&l_ref0, &&l_call, &&l_call0, &&l_pop, &&l_printo,
-    &&l_prints, &&l_topis, &&l_topref, &&l_topset, &&l_set, &&l_set0,
-    &&l_pop0, &&l_epop, &&l_tron, &&l_troff, &&l_gc, &&l_imm, &&l_make,
-    &&l_makei, &&l_exit, &&l_nvcase, &&l_tupref, &&l_vlen, &&l_vref,
-    &&l_vset, &&l_vmake, &&l_alloc, &&l_rref, &&l_rset, &&l_getcc,
-    &&l_putcc, &&l_ffi, &&l_smake, &&l_sfromc, &&l_slen,
-    &&l_sref, &&l_sset, &&l_scopy, &&l_unchar, &&l_gist, &&l_argv,
-    &&l_quiet, &&l_heap, &&l_readf, &&l_malloc, &&l_halloc, &&l_cget,
-    &&l_cset, &&l_free, &&l_sizeoff, &&l_sgetp, &&l_caref, &&l_csref,
-    &&l_dlopen, &&l_dlsym0, &&l_dlsym, &&l_csize, &&l_cref2int, &&l_int2cref,
-    &&l_ob2int, &&l_obptr2int, &&l_errno, &&l_meta
+    IRK_DISPATCH_TABLE
+  };
+
+  static void* wide_dispatch_table[] = {
+    IRK_WIDE_DISPATCH_TABLE
   };
 
   assert ((sizeof (dispatch_table) / sizeof (void *)) == (sizeof (irk_opcodes) / sizeof (opcode_info_t)));
@@ -878,8 +1269,26 @@ vm_go (void)
   } while (0)
 
 
+#define NGRAM_DISPATCH()                        \
+  do {                                          \
+    ngram_count (pc);                           \
+    goto *dispatch_table[code[pc]];             \
+  } while (0)
+
+#define PROFILE_DISPATCH()                      \
+  do {                                          \
+    vmprof_step (pc);                           \
+    goto *dispatch_table[code[pc]];             \
+  } while (0)
+
   //#define DISPATCH() DEBUG_DISPATCH()
+#if defined(VM_PROFILE)
+#define DISPATCH() PROFILE_DISPATCH()
+#elif defined(VM_NGRAMS)
+#define DISPATCH() NGRAM_DISPATCH()
+#else
 #define DISPATCH() NORMAL_DISPATCH()
+#endif
 
   // print_regs ((object*)vm_regs, 10);
   // print_stack (vm_k);
@@ -890,353 +1299,510 @@ vm_go (void)
   // fprintf (stderr, "\n");
   DISPATCH();
 
+  // an opcode that can be part of a superinstruction (see
+  //   self/byteops.scm) has its body in a DO_<OP> macro, which leaves
+  //   the pc at the next insn.  the superinstruction handlers at the
+  //   end of this function run a sequence of these.
+
+#define DO_LIT()                                \
+  do {                                          \
+    REG1 = bytecode_literals[BC2+1];            \
+    pc = NEXT (3);                              \
+  } while (0)
  l_lit:
-  REG1 = bytecode_literals[BC2+1];
-  pc += 3;
+  DO_LIT();
   DISPATCH();
+#define DO_LITC()                               \
+  do {                                          \
+    REG1 = irk_copy_tuple (bytecode_literals[BC2+1]); \
+    pc = NEXT (3);                              \
+  } while (0)
  l_litc:
-  REG1 = irk_copy_tuple (bytecode_literals[BC2+1]);
-  pc += 3;
+  DO_LITC();
   DISPATCH();
+#define DO_RET()                                \
+  do {                                          \
+    SAMPLE_POINT();                             \
+    vm_result = REG1;                           \
+    if (vm_k == IRK_NIL) {                      \
+      pc = NEXT (1);                            \
+      return vm_result;                         \
+    } else {                                    \
+      /* VMCONT := stack lenv pc reg0 reg1 ... */ \
+      pc = UNTAG_INTEGER (vm_k[3]);             \
+      JIT_POINT();                              \
+    }                                           \
+  } while (0)
  l_ret:
-  vm_result = REG1;
-  if (vm_k == IRK_NIL) {
-    pc += 1;
-    return vm_result;
-  } else {
-    // VMCONT := stack lenv pc reg0 reg1 ...
-    pc = UNTAG_INTEGER (vm_k[3]);
-  }
+  DO_RET();
   DISPATCH();
 
 #define BINOP(op)                               \
   do {                                          \
     REG1 = box(unbox(REG2) op unbox(REG3));     \
-    pc += 4;                                    \
-    DISPATCH();                                 \
+    pc = NEXT (4);                              \
   } while (0)
 
- l_add  : BINOP(+);
- l_sub  : BINOP(-);
- l_mul  : BINOP(*);
- l_div  : BINOP(/);
- l_srem : BINOP(%);
- l_shl  : BINOP(<<);
- l_ashr : BINOP(>>);
- l_or   : BINOP(|);
- l_xor  : BINOP(^);
- l_and  : BINOP(&);
-#undef BINOP
+#define DO_ADD()  BINOP(+)
+#define DO_SUB()  BINOP(-)
+#define DO_MUL()  BINOP(*)
+#define DO_DIV()  BINOP(/)
+#define DO_SREM() BINOP(%)
+#define DO_SHL()  BINOP(<<)
+#define DO_ASHR() BINOP(>>)
+#define DO_OR()   BINOP(|)
+#define DO_XOR()  BINOP(^)
+#define DO_AND()  BINOP(&)
+
+ l_add  : DO_ADD();  DISPATCH();
+ l_sub  : DO_SUB();  DISPATCH();
+ l_mul  : DO_MUL();  DISPATCH();
+ l_div  : DO_DIV();  DISPATCH();
+ l_srem : DO_SREM(); DISPATCH();
+ l_shl  : DO_SHL();  DISPATCH();
+ l_ashr : DO_ASHR(); DISPATCH();
+ l_or   : DO_OR();   DISPATCH();
+ l_xor  : DO_XOR();  DISPATCH();
+ l_and  : DO_AND();  DISPATCH();
 
 #define CMPOP(op)                                       \
   do {                                                  \
     REG1 = IRK_TEST (unbox(REG2) op unbox(REG3));      \
-    pc += 4;                                            \
-    DISPATCH();                                         \
+    pc = NEXT (4);                                      \
   } while (0)
 
- l_eq   : CMPOP(==);
- l_lt   : CMPOP(<);
- l_gt   : CMPOP(>);
- l_le   : CMPOP(<=);
- l_ge   : CMPOP(>=);
-#undef CMPOP
+#define DO_EQ() CMPOP(==)
+#define DO_LT() CMPOP(<)
+#define DO_GT() CMPOP(>)
+#define DO_LE() CMPOP(<=)
+#define DO_GE() CMPOP(>=)
 
+ l_eq   : DO_EQ(); DISPATCH();
+ l_lt   : DO_LT(); DISPATCH();
+ l_gt   : DO_GT(); DISPATCH();
+ l_le   : DO_LE(); DISPATCH();
+ l_ge   : DO_GE(); DISPATCH();
+
+#define DO_CMP()                                \
+  do {                                          \
+    /* CMP target a b */                        \
+    /* note: magic_cmp returns -1|0|+1, we adjust that to UITAG 0|1|2 */ \
+    /*   to match the 'cmp' datatype from core.scm. */ \
+    REG1 = (object*) UITAG (1 + magic_cmp (REG2, REG3)); \
+    pc = NEXT (4);                              \
+  } while (0)
  l_cmp:
-  // CMP target a b
-  // note: magic_cmp returns -1|0|+1, we adjust that to UITAG 0|1|2
-  //   to match the 'cmp' datatype from core.scm.
-  REG1 = (object*) UITAG (1 + magic_cmp (REG2, REG3));
-  pc += 4;
+  DO_CMP();
   DISPATCH();
+#define DO_TST()                                \
+  do {                                          \
+    if (REG1 == IRK_TRUE) {                     \
+      pc = NEXT (3);                            \
+    } else {                                    \
+      pc += BC2;                                \
+    }                                           \
+  } while (0)
  l_tst:
-  if (REG1 == IRK_TRUE) {
-    pc += 3;
-  } else {
-    pc += BC2;
-  }
+  DO_TST();
   DISPATCH();
+#define DO_JMP()                                \
+  do {                                          \
+    pc += BC1;                                  \
+  } while (0)
  l_jmp:
-  pc += BC1;
-  DISPATCH();
- l_fun: {
-    // FUN target pc
-    // closure := {uN lits code pc lenv}
-    // 252 := max pointer type tag (temp)
-    // fprintf (stderr, "fun target=%d pc=%d\n", BC1, BC2);
-    object * closure = allocate (TC_VM_CLOSURE, 4);
-    // temp: lits and code are ignored
-    closure[1] = IRK_NIL;
-    closure[2] = IRK_NIL;
-    closure[3] = TAG_INTEGER (pc + 3);
-    closure[4] = vm_lenv;
-    REG1 = closure;
-    pc += BC2;
-  }
-  DISPATCH();
- l_tail: {
-    // TAIL closure args
-    // closure:= lits code pc lenv
-    // link args into lenv.
-    object * rib = REG2;
-    rib[1] = REG1[4];
-    vm_lenv = rib;
-    pc = UNTAG_INTEGER (REG1[3]);
-  }
+  DO_JMP();
+  DISPATCH();
+#define DO_FUN()                                \
+  do {                                          \
+    /* FUN target pc */                         \
+    /* closure := {uN lits code pc lenv} */     \
+    /* 252 := max pointer type tag (temp) */    \
+    /* fprintf (stderr, "fun target=%d pc=%d\n", BC1, BC2); */ \
+    object * closure = allocate (TC_VM_CLOSURE, 4); \
+    /* temp: lits and code are ignored */       \
+    closure[1] = IRK_NIL;                       \
+    closure[2] = IRK_NIL;                       \
+    closure[3] = TAG_INTEGER (NEXT (3));        \
+    closure[4] = vm_lenv;                       \
+    REG1 = closure;                             \
+    pc += BC2;                                  \
+  } while (0)
+ l_fun:
+  DO_FUN();
+  DISPATCH();
+#define DO_TAIL()                               \
+  do {                                          \
+    /* TAIL closure args */                     \
+    /* closure:= lits code pc lenv */           \
+    /* link args into lenv. */                  \
+    SAMPLE_POINT();                             \
+    object * rib = REG2;                        \
+    IRK_STORE (rib[1], REG1[4]);                \
+    vm_lenv = rib;                              \
+    pc = UNTAG_INTEGER (REG1[3]);               \
+    JIT_POINT();                                \
+  } while (0)
+ l_tail:
+  DO_TAIL();
   DISPATCH();
+#define DO_TAIL0()                              \
+  do {                                          \
+    /* TAIL0 closure */                         \
+    SAMPLE_POINT();                             \
+    vm_lenv = REG1[4];                          \
+    pc = UNTAG_INTEGER (REG1[3]);               \
+    JIT_POINT();                                \
+  } while (0)
  l_tail0:
-  // TAIL0 closure
-  vm_lenv = REG1[4];
-  pc = UNTAG_INTEGER (REG1[3]);
+  DO_TAIL0();
   DISPATCH();
+#define DO_ENV()                                \
+  do {                                          \
+    /* ENV <target> <size> */                   \
+    REG1 = allocate (TC_VM_LENV, BC2+1);        \
+    pc = NEXT (3);                              \
+  } while (0)
  l_env:
-  // ENV <target> <size>
-  REG1 = allocate (TC_VM_LENV, BC2+1);
-  pc += 3;
+  DO_ENV();
   DISPATCH();
+#define DO_STOR()                               \
+  do {                                          \
+    /* STOR tuple index arg */                  \
+    IRK_STORE (REG1[BC2+1], REG3);              \
+    pc = NEXT (4);                              \
+  } while (0)
  l_stor:
-  // STOR tuple index arg
-  REG1[BC2+1] = REG3;
-  pc += 4;
+  DO_STOR();
   DISPATCH();
+#define DO_REF()                                \
+  do {                                          \
+    /* REF <target> <depth> <index> */          \
+    REG1 = vm_varref (BC2, BC3);                \
+    pc = NEXT (4);                              \
+  } while (0)
  l_ref:
-  // REF <target> <depth> <index>
-  REG1 = vm_varref (BC2, BC3);
-  pc += 4;
+  DO_REF();
   DISPATCH();
+#define DO_MOV()                                \
+  do {                                          \
+    REG1 = REG2;                                \
+    pc = NEXT (3);                              \
+  } while (0)
  l_mov:
-  REG1 = REG2;
-  pc += 3;
-  DISPATCH();
- l_epush: {
-    // EPUSH args
-    object * rib = REG1;
-    // lenv := next arg0 arg1 ...
-    rib[1] = vm_lenv;
-    vm_lenv = rib;
-    pc += 2;
-  }
-  DISPATCH();
- l_trcall: {
-    // TRCALL pc depth nregs reg0 ...
-    irk_int depth = BC2;
-    for (int i=0; i < depth; i++) {
-      vm_lenv = (object *) vm_lenv[1];
-    }
-    irk_int nregs = BC3;
-    object * rib = (object *) vm_lenv;
-    // lenv := next arg0 arg1 ...
-    for (int i=0; i < nregs; i++) {
-      rib[i+2] = vm_regs[code[pc+4+i]];
-    }
-    pc += BC1;
-  }
+  DO_MOV();
   DISPATCH();
- l_trcall0: {
-    // TRCALL0 pc depth
-    irk_int depth = BC2;
-    for (int i=0; i < depth; i++) {
-      vm_lenv = (object *) vm_lenv[1];
-    }
-    pc += BC1;
-  }
+#define DO_EPUSH()                              \
+  do {                                          \
+    /* EPUSH args */                            \
+    object * rib = REG1;                        \
+    /* lenv := next arg0 arg1 ... */            \
+    IRK_STORE (rib[1], vm_lenv);                \
+    vm_lenv = rib;                              \
+    pc = NEXT (2);                              \
+  } while (0)
+ l_epush:
+  DO_EPUSH();
+  DISPATCH();
+#define DO_TRCALL()                             \
+  do {                                          \
+    /* TRCALL pc depth nregs reg0 ... */        \
+    SAMPLE_POINT();                             \
+    irk_int depth = BC2;                        \
+    for (int i=0; i < depth; i++) {             \
+      vm_lenv = (object *) vm_lenv[1];          \
+    }                                           \
+    irk_int nregs = BC3;                        \
+    object * rib = (object *) vm_lenv;          \
+    /* lenv := next arg0 arg1 ... */            \
+    for (int i=0; i < nregs; i++) {             \
+      IRK_STORE (rib[i+2], vm_regs[ARG (4+i)]); \
+    }                                           \
+    pc += BC1;                                  \
+    JIT_POINT();                                \
+  } while (0)
+ l_trcall:
+  DO_TRCALL();
+  DISPATCH();
+#define DO_TRCALL0()                            \
+  do {                                          \
+    /* TRCALL0 pc depth */                      \
+    SAMPLE_POINT();                             \
+    irk_int depth = BC2;                        \
+    for (int i=0; i < depth; i++) {             \
+      vm_lenv = (object *) vm_lenv[1];          \
+    }                                           \
+    pc += BC1;                                  \
+    JIT_POINT();                                \
+  } while (0)
+ l_trcall0:
+  DO_TRCALL0();
   DISPATCH();
+#define DO_REF0()                               \
+  do {                                          \
+    /* REF0 target index */                     \
+    REG1 = vm_lenv[BC2+2];                      \
+    pc = NEXT (3);                              \
+  } while (0)
  l_ref0:
-  // REF0 target index
-  REG1 = vm_lenv[BC2+2];
-  pc += 3;
-  DISPATCH();
- l_call: {
-    // CALL closure args nregs
-    // VMCONT := stack lenv pc reg0 reg1 ...
-    irk_int nregs = BC3;
-    object * k = allocate (TC_VM_CONT, 3 + nregs);
-    k[1] = vm_k;
-    k[2] = vm_lenv;
-    k[3] = TAG_INTEGER (pc + 4);
-    for (int i=0; i < nregs; i++) {
-      k[4+i] = vm_regs[i];
-    }
-    vm_k = k;
-    // CLOSURE := lits code pc lenv
-    object * closure = REG1;
-    object * rib = REG2;
-    rib[1] = closure[4];
-    vm_lenv = rib;
-    // vm_lits = closure[1];
-    // vm_code = closure[2];
-    pc = UNTAG_INTEGER (closure[3]);
-  }
-  DISPATCH();
- l_call0: {
-    // CALL0 closure nregs
-    // VMCONT := stack lenv pc reg0 reg1 ...
-    irk_int nregs = BC2;
-    object * k = allocate (TC_VM_CONT, 3 + nregs);
-    k[1] = vm_k;
-    k[2] = vm_lenv;
-    k[3] = TAG_INTEGER (pc + 3);
-    for (int i=0; i < nregs; i++) {
-      k[4+i] = vm_regs[i];
-    }
-    vm_k = k;
-    // CLOSURE := lits code pc lenv
-    object * closure = REG1;
-    vm_lenv = closure[4];
-    // vm_lits = closure[1];
-    // vm_code = closure[2];
-    pc = UNTAG_INTEGER (closure[3]);
-  }
-  DISPATCH();
- l_pop: {
-    // POP target
-    // VMCONT := stack lenv pc reg0 reg1 ...
-    irk_int nregs = GET_TUPLE_LENGTH (vm_k[0]) - 3;
-    for (int i=0; i < nregs; i++) {
-      vm_regs[i] = vm_k[4+i];
-    }
-    vm_lenv = vm_k[2];
-    vm_k = vm_k[1];
-    REG1 = vm_result;
-    pc += 2;
-  }
+  DO_REF0();
   DISPATCH();
- l_pop0: {
-    irk_int nregs = GET_TUPLE_LENGTH (vm_k[0]) - 3;
-    for (int i=0; i < nregs; i++) {
-      vm_regs[i] = vm_k[4+i];
-    }
-    vm_lenv = vm_k[2];
-    vm_k = vm_k[1];
-    pc += 1;
-  }
+#define DO_CALL()                               \
+  do {                                          \
+    /* CALL closure args nregs */               \
+    /* VMCONT := stack lenv pc reg0 reg1 ... */ \
+    SAMPLE_POINT();                             \
+    irk_int nregs = BC3;                        \
+    object * k = allocate (TC_VM_CONT, 3 + nregs); \
+    k[1] = vm_k;                                \
+    k[2] = vm_lenv;                             \
+    k[3] = TAG_INTEGER (NEXT (4));              \
+    vm_save_regs (k, vm_regs, nregs);           \
+    vm_k = k;                                   \
+    /* CLOSURE := lits code pc lenv */          \
+    object * closure = REG1;                    \
+    object * rib = REG2;                        \
+    IRK_STORE (rib[1], closure[4]);             \
+    vm_lenv = rib;                              \
+    /* vm_lits = closure[1]; */                 \
+    /* vm_code = closure[2]; */                 \
+    pc = UNTAG_INTEGER (closure[3]);            \
+    JIT_POINT();                                \
+  } while (0)
+ l_call:
+  DO_CALL();
+  DISPATCH();
+#define DO_CALL0()                              \
+  do {                                          \
+    /* CALL0 closure nregs */                   \
+    /* VMCONT := stack lenv pc reg0 reg1 ... */ \
+    SAMPLE_POINT();                             \
+    irk_int nregs = BC2;                        \
+    object * k = allocate (TC_VM_CONT, 3 + nregs); \
+    k[1] = vm_k;                                \
+    k[2] = vm_lenv;                             \
+    k[3] = TAG_INTEGER (NEXT (3));              \
+    vm_save_regs (k, vm_regs, nregs);           \
+    vm_k = k;                                   \
+    /* CLOSURE := lits code pc lenv */          \
+    object * closure = REG1;                    \
+    vm_lenv = closure[4];                       \
+    /* vm_lits = closure[1]; */                 \
+    /* vm_code = closure[2]; */                 \
+    pc = UNTAG_INTEGER (closure[3]);            \
+    JIT_POINT();                                \
+  } while (0)
+ l_call0:
+  DO_CALL0();
+  DISPATCH();
+#define DO_POP()                                \
+  do {                                          \
+    /* POP target */                            \
+    /* VMCONT := stack lenv pc reg0 reg1 ... */ \
+    irk_int nregs = GET_TUPLE_LENGTH (vm_k[0]) - 3; \
+    for (int i=0; i < nregs; i++) {             \
+      vm_regs[i] = vm_k[4+i];                   \
+    }                                           \
+    vm_lenv = vm_k[2];                          \
+    vm_k = vm_k[1];                             \
+    REG1 = vm_result;                           \
+    pc = NEXT (2);                              \
+  } while (0)
+ l_pop:
+  DO_POP();
+  DISPATCH();
+#define DO_POP0()                               \
+  do {                                          \
+    irk_int nregs = GET_TUPLE_LENGTH (vm_k[0]) - 3; \
+    for (int i=0; i < nregs; i++) {             \
+      vm_regs[i] = vm_k[4+i];                   \
+    }                                           \
+    vm_lenv = vm_k[2];                          \
+    vm_k = vm_k[1];                             \
+    pc = NEXT (1);                              \
+  } while (0)
+ l_pop0:
+  DO_POP0();
   DISPATCH();
  l_printo:
   // PRINTO arg
   print_object (REG1);
-  pc += 2;
+  pc = NEXT (2);
   DISPATCH();
  l_prints: {
     // PRINTS arg
     irk_string * s = (irk_string *) REG1;
     fwrite (s->data, 1, s->len, stdout);
-    pc += 2;
+    pc = NEXT (2);
   }
   DISPATCH();
  l_topis:
   // TOPIS <env>
   vm_top = (object *) REG1;
-  pc += 2;
+  pc = NEXT (2);
   DISPATCH();
+#define DO_TOPREF()                             \
+  do {                                          \
+    /* TOPREF target index */                   \
+    REG1 = vm_top[BC2+2];                       \
+    pc = NEXT (3);                              \
+  } while (0)
  l_topref:
-  // TOPREF target index
-  REG1 = vm_top[BC2+2];
-  pc += 3;
+  DO_TOPREF();
   DISPATCH();
+#define DO_TOPSET()                             \
+  do {                                          \
+    /* TOPSET index val */                      \
+    IRK_STORE (vm_top[BC1+2], REG2);            \
+    pc = NEXT (3);                              \
+  } while (0)
  l_topset:
-  // TOPSET index val
-  vm_top[BC1+2] = REG2;
-  pc += 3;
+  DO_TOPSET();
   DISPATCH();
+#define DO_SET()                                \
+  do {                                          \
+    /* SET depth index val */                   \
+    vm_varset (BC1, BC2, REG3);                 \
+    pc = NEXT (4);                              \
+  } while (0)
  l_set:
-  // SET depth index val
-  vm_varset (BC1, BC2, REG3);
-  pc += 4;
+  DO_SET();
   DISPATCH();
+#define DO_SET0()                               \
+  do {                                          \
+    /* SET0 index val */                        \
+    vm_varset (0, BC1, REG2);                   \
+    pc = NEXT (3);                              \
+  } while (0)
  l_set0:
-  // SET0 index val
-  vm_varset (0, BC1, REG2);
-  pc += 3;
+  DO_SET0();
   DISPATCH();
+#define DO_EPOP()                               \
+  do {                                          \
+    /* EPOP */                                  \
+    /* lenv := next val0 val1 ... */            \
+    vm_lenv = vm_lenv[1];                       \
+    pc = NEXT (1);                              \
+  } while (0)
  l_epop:
-  // EPOP
-  // lenv := next val0 val1 ...
-  vm_lenv = vm_lenv[1];
-  pc += 1;
+  DO_EPOP();
   DISPATCH();
  l_tron:
   // NYI
-  pc += 1;
+  pc = NEXT (1);
   DISPATCH();
  l_troff:
   // NYI
-  pc += 1;
+  pc = NEXT (1);
   DISPATCH();
+#define DO_GC()                                 \
+  do {                                          \
+    if (freep >= limit) {                       \
+      vm_gc(0);                                 \
+    }                                           \
+    pc = NEXT (1);                              \
+  } while (0)
  l_gc:
-  if (freep >= limit) {
-    vm_gc(0);
-  }
-  pc += 1;
+  DO_GC();
   DISPATCH();
+#define DO_IMM()                                \
+  do {                                          \
+    /* IMM target tag */                        \
+    REG1 = (object *) (irk_int) BC2;            \
+    pc = NEXT (3);                              \
+  } while (0)
  l_imm:
-  // IMM target tag
-  REG1 = (object *) (irk_int) BC2;
-  pc += 3;
-  DISPATCH();
- l_make: {
-    // MAKE target tag nelem elem0 ...
-    irk_int nelem = BC3;
-    object * ob = allocate (BC2, nelem);
-    for (int i=0; i < nelem; i++) {
-      ob[i+1] = vm_regs[code[pc+4+i]];
-    }
-    REG1 = ob;
-    pc += 4 + nelem;
-  }
+  DO_IMM();
   DISPATCH();
+#define DO_MAKE()                               \
+  do {                                          \
+    /* MAKE target tag nelem elem0 ... */       \
+    irk_int nelem = BC3;                        \
+    object * ob = allocate (BC2, nelem);        \
+    for (int i=0; i < nelem; i++) {             \
+      ob[i+1] = vm_regs[ARG (4+i)];             \
+    }                                           \
+    REG1 = ob;                                  \
+    pc = NEXT (4 + nelem);                      \
+  } while (0)
+ l_make:
+  DO_MAKE();
+  DISPATCH();
+#define DO_MAKEI()                              \
+  do {                                          \
+    /* MAKEI target tag payload */              \
+    REG1 = (object*)((UNTAG_INTEGER(REG3)<<8) | (UNTAG_INTEGER(REG2) & 0xff)); \
+    pc = NEXT (4);                              \
+  } while (0)
  l_makei:
-  // MAKEI target tag payload
-  REG1 = (object*)((UNTAG_INTEGER(REG3)<<8) | (UNTAG_INTEGER(REG2) & 0xff));
-  pc += 4;
+  DO_MAKEI();
   DISPATCH();
  l_exit:
   vm_result = REG1;
   return vm_result;
- l_nvcase: {
-    // NVCASE ob elabel nalts tag0 label0 tag1 label1 ...
-    irk_int tag = get_case (REG1);
-    irk_int nalts = BC3;
-    irk_int pc0 = BC2;
-    //fprintf (stderr, " tag=%d nalts=%d pc=%d\n", tag, nalts, pc);
-    for (int i=0; i < nalts; i++) {
-      //fprintf (stderr, "  testing %d\n", code[pc+4+(i*2)]);
-      if (tag == code[pc+4+(i*2)]) {
-        pc0 = code[pc+4+(i*2)+1];
-        break;
-      }
-    }
-    pc += pc0;
-  }
+#define DO_NVCASE()                             \
+  do {                                          \
+    /* NVCASE ob elabel nalts tag0 label0 tag1 label1 ... */ \
+    irk_int tag = get_case (REG1);              \
+    irk_int nalts = BC3;                        \
+    irk_int pc0 = BC2;                          \
+    /*fprintf (stderr, " tag=%d nalts=%d pc=%d\n", tag, nalts, pc); */ \
+    for (int i=0; i < nalts; i++) {             \
+      /*fprintf (stderr, "  testing %d\n", ARG (4+(i*2))); */ \
+      if (tag == ARG (4+(i*2))) {               \
+        pc0 = ARG (4+(i*2)+1);                  \
+        break;                                  \
+      }                                         \
+    }                                           \
+    pc += pc0;                                  \
+  } while (0)
+ l_nvcase:
+  DO_NVCASE();
   DISPATCH();
+#define DO_TUPREF()                             \
+  do {                                          \
+    /* TUPREF target ob index */                \
+    REG1 = REG2[BC3+1];                         \
+    pc = NEXT (4);                              \
+  } while (0)
  l_tupref:
-  // TUPREF target ob index
-  REG1 = REG2[BC3+1];
-  pc += 4;
+  DO_TUPREF();
   DISPATCH();
+#define DO_VLEN()                               \
+  do {                                          \
+    /* VLEN target vec */                       \
+    if (REG2 == (object*) TC_EMPTY_VECTOR) {    \
+      REG1 = TAG_INTEGER (0);                   \
+    } else {                                    \
+      REG1 = TAG_INTEGER (GET_TUPLE_LENGTH (*REG2)); \
+    }                                           \
+    pc = NEXT (3);                              \
+  } while (0)
  l_vlen:
-  // VLEN target vec
-  if (REG2 == (object*) TC_EMPTY_VECTOR) {
-    REG1 = TAG_INTEGER (0);
-  } else {
-    REG1 = TAG_INTEGER (GET_TUPLE_LENGTH (*REG2));
-  }
-  pc += 3;
+  DO_VLEN();
   DISPATCH();
+#define DO_VREF()                               \
+  do {                                          \
+    /* VREF target vec index-reg */             \
+    vector_range_check (REG2, UNTAG_INTEGER(REG3)); \
+    REG1 = REG2[UNTAG_INTEGER(REG3)+1];         \
+    pc = NEXT (4);                              \
+  } while (0)
  l_vref:
-  // VREF target vec index-reg
-  vector_range_check (REG2, UNTAG_INTEGER(REG3));
-  REG1 = REG2[UNTAG_INTEGER(REG3)+1];
-  pc += 4;
+  DO_VREF();
   DISPATCH();
+#define DO_VSET()                               \
+  do {                                          \
+    /* VSET vec index-reg val */                \
+    vector_range_check (REG1, UNTAG_INTEGER(REG2)); \
+    IRK_STORE (REG1[UNTAG_INTEGER(REG2)+1], REG3); \
+    pc = NEXT (4);                              \
+  } while (0)
  l_vset:
-  // VSET vec index-reg val
-  vector_range_check (REG1, UNTAG_INTEGER(REG2));
-  REG1[UNTAG_INTEGER(REG2)+1] = REG3;
-  pc += 4;
+  DO_VSET();
   DISPATCH();
  l_vmake: {
     // VMAKE target size val
-    // XXX heap check.
+    // make-vector does the heap check (a HEAP insn) first.
     irk_int nelems = UNTAG_INTEGER(REG2);
     if (nelems == 0) {
       REG1 = (object *) TC_EMPTY_VECTOR;
@@ -1247,40 +1813,50 @@ vm_go (void)
       }
       REG1 = ob;
     }
-    pc += 4;
+    pc = NEXT (4);
   }
   DISPATCH();
+#define DO_ALLOC()                              \
+  do {                                          \
+    /* ALLOC <target> <tag> <size> */           \
+    REG1 = allocate (BC2, BC3);                 \
+    pc = NEXT (4);                              \
+  } while (0)
  l_alloc:
-  // ALLOC <target> <tag> <size>
-  REG1 = allocate (BC2, BC3);
-  pc += 4;
+  DO_ALLOC();
   DISPATCH();
- l_rref: {
-    // RREF target rec label-code
-    irk_int tag = (GET_TYPECODE (REG2[0]) - TC_USEROBJ) >> 2;
-    irk_int index = vm_get_field_offset (tag, BC3);
-    REG1 = REG2[index+1];
-    pc += 4;
-  }
+#define DO_RREF()                               \
+  do {                                          \
+    /* RREF target rec label-code cache-tag cache-index */ \
+    irk_int tag = (GET_TYPECODE (REG2[0]) - TC_USEROBJ) >> 2; \
+    irk_int index = FIELD_INDEX (4, tag, BC3);  \
+    REG1 = REG2[index+1];                       \
+    pc = NEXT (6);                              \
+  } while (0)
+ l_rref:
+  DO_RREF();
   DISPATCH();
- l_rset: {
-    // RSET rec label-code val
-    irk_int tag = (GET_TYPECODE (REG1[0]) - TC_USEROBJ) >> 2;
-    irk_int index = vm_get_field_offset (tag, BC2);
-    REG1[index+1] = REG3;
-    pc += 4;
-  }
+#define DO_RSET()                               \
+  do {                                          \
+    /* RSET rec label-code val cache-tag cache-index */ \
+    irk_int tag = (GET_TYPECODE (REG1[0]) - TC_USEROBJ) >> 2; \
+    irk_int index = FIELD_INDEX (4, tag, BC2);  \
+    IRK_STORE (REG1[index+1], REG3);            \
+    pc = NEXT (6);                              \
+  } while (0)
+ l_rset:
+  DO_RSET();
   DISPATCH();
  l_getcc:
   // GETCC target
   REG1 = vm_k;
-  pc += 2;
+  pc = NEXT (2);
   DISPATCH();
  l_putcc:
   // PUTCC target k v
   vm_k = REG2;
   REG1 = REG3;
-  pc += 4;
+  pc = NEXT (4);
   DISPATCH();
  // l_irk: {
  //    // IRK target closure nargs arg0 ...
@@ -1288,7 +1864,7 @@ vm_go (void)
  //    object * rib = allocate (TC_ENV, nargs + 1);
  //    object * closure = REG2;
  //    for (int i=0; i < nargs; i++) {
- //      rib[i+2] = vm_regs[code[pc+4+i]];
+ //      rib[i+2] = vm_regs[ARG (4+i)];
  //    }
  //    invoke_closure (closure, rib);
  //    REG1 = result;
@@ -1307,34 +1883,38 @@ vm_go (void)
       fprintf (stderr, "op_ffi failed\n");
       return TAG_INTEGER ((unsigned)-1);
     }
-    pc += nargs + 5;
+    pc = NEXT (nargs + 5);
   }
   DISPATCH();
  l_smake: {
     // SMAKE target size
-    // XXX heap check.
+    // make-string does the heap check (a HEAP insn) first.
     irk_int slen = UNTAG_INTEGER (REG2);
-    irk_string * s = (irk_string*)alloc_no_clear (TC_STRING, string_tuple_length (slen));
+    irk_string * s = (irk_string*)alloc_bytes (TC_STRING, string_tuple_length (slen));
     s->len = slen;
     REG1 = (object*)s;
   }
-  pc += 3;
+  pc = NEXT (3);
   DISPATCH();
  l_sfromc: {
     // SFROMC target src len
     irk_int slen = UNTAG_INTEGER (REG3);
     char * src = (char *) get_foreign (REG2);
-    irk_string * dst = (irk_string *) alloc_no_clear (TC_STRING, string_tuple_length (slen));
+    irk_string * dst = (irk_string *) alloc_bytes (TC_STRING, string_tuple_length (slen));
     dst->len = slen;
     memcpy (GET_STRING_POINTER (dst), src, slen);
     REG1 = (object *) dst;
-    pc += 4;
+    pc = NEXT (4);
     DISPATCH();
   }
+#define DO_SLEN()                               \
+  do {                                          \
+    /* SLEN target string */                    \
+    REG1 = TAG_INTEGER ((irk_int)((irk_string *) REG2)->len); \
+    pc = NEXT (3);                              \
+  } while (0)
  l_slen:
-  // SLEN target string
-  REG1 = TAG_INTEGER ((irk_int)((irk_string *) REG2)->len);
-  pc += 3;
+  DO_SLEN();
   DISPATCH();
  l_sref: {
     // SREF target string index
@@ -1347,7 +1927,7 @@ vm_go (void)
       fprintf (stderr, "string ref out of range: %" PRIdPTR " %d\n", index, s->len);
       return TAG_INTEGER ((unsigned)-1);
     }
-    pc += 4;
+    pc = NEXT (4);
   }
   DISPATCH();
  l_sset: {
@@ -1365,7 +1945,7 @@ vm_go (void)
       fprintf (stderr, "string set out of range: %" PRIdPTR " %d\n", index, s->len);
       return TAG_INTEGER ((unsigned)-1);
     }
-    pc += 4;
+    pc = NEXT (4);
   }
   DISPATCH();
  l_scopy: {
@@ -1384,33 +1964,37 @@ vm_go (void)
       fprintf (stderr, "scopy out of range\n");
       return TAG_INTEGER ((unsigned)-1);
     }
-    pc += 6;
+    pc = NEXT (6);
   }
   DISPATCH();
+#define DO_UNCHAR()                             \
+  do {                                          \
+    /* UNCHAR target char */                    \
+    REG1 = (object*) TAG_INTEGER ((uintptr_t)GET_CHAR (REG2)); \
+    pc = NEXT (3);                              \
+  } while (0)
  l_unchar:
-  // UNCHAR target char
-  REG1 = (object*) TAG_INTEGER ((uintptr_t)GET_CHAR (REG2));
-  pc += 3;
+  DO_UNCHAR();
   DISPATCH();
  l_gist:
   // GIST target
   REG1 = vm_internal_symbol_list;
-  pc += 2;
+  pc = NEXT (2);
   DISPATCH();
  l_argv:
   // ARGV target
   REG1 = irk_make_argv();
-  pc += 2;
+  pc = NEXT (2);
   DISPATCH();
  l_quiet:
   // QUIET yesno
   verbose_gc = (REG1 == IRK_TRUE);
-  pc += 2;
+  pc = NEXT (2);
   DISPATCH();
  l_heap: {
     // HEAP size nreg
     irk_int size = UNTAG_INTEGER (REG1);
-    if (freep + size >= limit) {
+    while (freep + size >= limit) {
       irk_int nreg = BC2;
       for (int i=0; i < nreg; i++) {
         heap1[N_VM_ROOTS + i] = vm_regs[i];
@@ -1421,69 +2005,78 @@ vm_go (void)
       }
     }
   }
-  pc += 3;
+  pc = NEXT (3);
   DISPATCH();
  l_readf: {
     // READF target path
     object * slist = (object *) IRK_NIL;
     irk_int r = vm_read_file ((irk_string *) REG2, &slist);
     REG1 = slist;
-    pc += 3;
-    DISPATCH();
-  }
- l_malloc: {
-    // MALLOC target sindex nelem
-    object * result;
-    irk_int sindex = BC2;
-    irk_int nelem = UNTAG_INTEGER (REG3);
-    irk_int sizeoff = get_sizeoff_entry (sindex);
-    result = (object*) malloc (sizeoff * nelem);
-    if (!result) {
-      fprintf (stderr, "malloc failed.\n");
-      return TAG_INTEGER ((unsigned)-1);
-    } else {
-      REG1 = make_foreign (result);
-      pc += 4;
-      DISPATCH();
-    }
-  }
- l_halloc: {
-    // HALLOC target sindex nelem
-    irk_int sindex = BC2;
-    irk_int nelem = UNTAG_INTEGER (REG3);
-    irk_int sizeoff = get_sizeoff_entry (sindex);
-    REG1 = make_halloc (sizeoff, nelem);
-    pc += 4;
+    pc = NEXT (3);
     DISPATCH();
   }
- l_cget: {
-    // CGET target src code
-    object * result;
-    irk_int r = vm_cget (&result, REG2, (irk_int) BC3);
-    if (r == 0) {
-      REG1 = result;
-      pc += 4;
-      DISPATCH();
-    } else {
-      fprintf (stderr, "vm_cget failed.\n");
-      return TAG_INTEGER ((unsigned)-1);
-    }
-  }
- l_cset: {
-    // CSET dst code val
-    irk_int r = vm_cset (REG1, (irk_int) BC2, REG3);
-    if (r == 0) {
-      pc += 4;
-      DISPATCH();
-    } else {
-      fprintf (stderr, "vm_cset failed.\n");
-      return TAG_INTEGER ((unsigned)-1);
-    }
-  }
+  // an sindex (or a ctype code) can be big, so these can be wide
+  //   too (see self/byteops.scm:wide-ops).
+#define DO_MALLOC()                             \
+  do {                                          \
+    /* MALLOC target sindex nelem */            \
+    object * result;                            \
+    irk_int sindex = BC2;                       \
+    irk_int nelem = UNTAG_INTEGER (REG3);       \
+    irk_int sizeoff = get_sizeoff_entry (sindex); \
+    result = (object*) malloc (sizeoff * nelem); \
+    if (!result) {                              \
+      fprintf (stderr, "malloc failed.\n");     \
+      return TAG_INTEGER ((unsigned)-1);        \
+    }                                           \
+    REG1 = make_foreign (result);               \
+    pc = NEXT (4);                              \
+  } while (0)
+ l_malloc:
+  DO_MALLOC();
+  DISPATCH();
+#define DO_HALLOC()                             \
+  do {                                          \
+    /* HALLOC target sindex nelem */            \
+    irk_int sindex = BC2;                       \
+    irk_int nelem = UNTAG_INTEGER (REG3);       \
+    irk_int sizeoff = get_sizeoff_entry (sindex); \
+    REG1 = make_halloc (sizeoff, nelem);        \
+    pc = NEXT (4);                              \
+  } while (0)
+ l_halloc:
+  DO_HALLOC();
+  DISPATCH();
+#define DO_CGET()                               \
+  do {                                          \
+    /* CGET target src code */                  \
+    object * result;                            \
+    if (vm_cget (&result, REG2, BC3) != 0) {    \
+      fprintf (stderr, "vm_cget failed.\n");    \
+      return TAG_INTEGER ((unsigned)-1);        \
+    }                                           \
+    REG1 = result;                              \
+    pc = NEXT (4);                              \
+  } while (0)
+ l_cget:
+  DO_CGET();
+  DISPATCH();
+#define DO_CSET()                               \
+  do {                                          \
+    /* CSET dst code val */                     \
+    if (vm_cset (REG1, BC2, REG3) != 0) {       \
+      fprintf (stderr, "vm_cset failed.\n");    \
+      return TAG_INTEGER ((unsigned)-1);        \
+    }                                           \
+    pc = NEXT (4);                              \
+  } while (0)
+ l_cset:
+  DO_CSET();
+  DISPATCH();
  l_free: {
     // FREE src
     free_foreign (REG1);
-    pc += 2;
+    pc = NEXT (2);
     DISPATCH();
   }
  l_sizeoff: {
@@ -1491,96 +2084,203 @@ vm_go (void)
     irk_int index = UNTAG_INTEGER (REG1);
     irk_int val   = UNTAG_INTEGER (REG2);
     vm_sizeoff_table[index] = val;
-    pc += 3;
+    pc = NEXT (3);
     DISPATCH();
   }
  l_sgetp: {
     // SGETP dst src
     irk_string * s = (irk_string *) REG1;
     REG2 = make_foreign (s->data);
-    pc += 3;
-    DISPATCH();
-  }
- l_caref: {
-    // CAREF dst src sindex num
-    irk_int sizeoff = get_sizeoff_entry (BC3);
-    char * src = (char *) get_foreign (REG2);
-    char * dst = src + (sizeoff * UNTAG_INTEGER (REG4));
-    REG1 = make_foreign (dst);
-    pc += 5;
-    DISPATCH();
-  }
- l_csref: {
-    // CSREF dst src sindex
-    irk_int sizeoff = get_sizeoff_entry (BC3);
-    // fprintf (stderr, "csref: sizeoff=%ld\n", sizeoff);
-    char * src = (char *) get_foreign (REG2);
-    // fprintf (stderr, "csref: src=%p\n", src);
-    char * dst = src + sizeoff;
-    // fprintf (stderr, "csref: dst=%p\n", dst);
-    REG1 = make_foreign (dst);
-    pc += 4;
+    pc = NEXT (3);
     DISPATCH();
   }
+#define DO_CAREF()                              \
+  do {                                          \
+    /* CAREF dst src sindex num */              \
+    irk_int sizeoff = get_sizeoff_entry (BC3);  \
+    char * src = (char *) get_foreign (REG2);   \
+    char * dst = src + (sizeoff * UNTAG_INTEGER (REG4)); \
+    REG1 = make_foreign (dst);                  \
+    pc = NEXT (5);                              \
+  } while (0)
+ l_caref:
+  DO_CAREF();
+  DISPATCH();
+#define DO_CSREF()                              \
+  do {                                          \
+    /* CSREF dst src sindex */                  \
+    irk_int sizeoff = get_sizeoff_entry (BC3);  \
+    char * src = (char *) get_foreign (REG2);   \
+    char * dst = src + sizeoff;                 \
+    REG1 = make_foreign (dst);                  \
+    pc = NEXT (4);                              \
+  } while (0)
+ l_csref:
+  DO_CSREF();
+  DISPATCH();
  l_dlopen:
   // DLOPEN target name
   REG1 = make_foreign (dlopen (GET_STRING_POINTER (REG2), RTLD_LAZY));
-  pc += 3;
+  pc = NEXT (3);
   DISPATCH();
  l_dlsym0:
   // DLSYM target name
   REG1 = make_foreign (dlsym (RTLD_DEFAULT, GET_STRING_POINTER (REG2)));
-  pc += 3;
+  pc = NEXT (3);
   DISPATCH();
  l_dlsym:
   // DLSYM target handle name
   REG1 = make_foreign (dlsym (get_foreign(REG2), GET_STRING_POINTER (REG3)));
-  pc += 4;
+  pc = NEXT (4);
   DISPATCH();
+#define DO_CSIZE()                              \
+  do {                                          \
+    /* CSIZE target sindex */                   \
+    REG1 = TAG_INTEGER (get_sizeoff_entry (BC2)); \
+    pc = NEXT (3);                              \
+  } while (0)
  l_csize:
-  // CSIZE target sindex
-  REG1 = TAG_INTEGER (get_sizeoff_entry (BC2));
-  pc += 3;
+  DO_CSIZE();
   DISPATCH();
  l_cref2int:
   // CREF2INT target src
   REG1 = TAG_INTEGER ((irk_int) get_foreign (REG2));
-  pc += 3;
+  pc = NEXT (3);
   DISPATCH();
  l_int2cref:
   // INT2CREF target src
   REG1 = make_foreign ((void*) unbox (REG2));
-  pc += 3;
+  pc = NEXT (3);
   DISPATCH();
  l_ob2int:
   // OB2INT target src
   REG1 = TAG_INTEGER ((irk_int)REG2);
-  pc += 3;
+  pc = NEXT (3);
   DISPATCH();
  l_obptr2int:
   // OBPTR2INT target src
   REG1 = TAG_INTEGER ((irk_int)(*REG2));
-  pc += 3;
+  pc = NEXT (3);
   DISPATCH();
  l_errno:
   // ERRNO target
   REG1 = TAG_INTEGER ((irk_int) errno);
-  pc += 2;
+  pc = NEXT (2);
   DISPATCH();
  l_meta:
   // META target
   REG1 = bytecode_literals[vm_metadata_index];
-  pc += 2;
+  pc = NEXT (2);
   DISPATCH();
+ l_gcstat:
+  // GCSTAT target which
+  if (UNTAG_INTEGER (REG2) == 0) {
+    REG1 = irk_gc_stats();
+  } else {
+    REG1 = irk_gc_pauses();
+  }
+  pc = NEXT (3);
+  DISPATCH();
+ l_fop2:
+  // FOP2 target op a b
+  REG1 = irk_float_op2 (REG2, REG3, REG4);
+  pc = NEXT (5);
+  DISPATCH();
+ l_fop1:
+  // FOP1 target op a
+  REG1 = irk_float_op1 (REG2, REG3);
+  pc = NEXT (4);
+  DISPATCH();
+ l_fcmp:
+  // FCMP target op a b
+  REG1 = irk_float_cmp (REG2, REG3, REG4);
+  pc = NEXT (5);
+  DISPATCH();
+ l_fconv:
+  // FCONV target op a
+  REG1 = irk_float_conv (REG2, REG3);
+  pc = NEXT (4);
+  DISPATCH();
+  // packed arrays: range checks are done by lib/packed.scm.
+ l_pmake:
+  // PMAKE target kind n
+  REG1 = irk_packed_make (REG2, REG3);
+  pc = NEXT (4);
+  DISPATCH();
+ l_plen:
+  // PLEN target array
+  REG1 = irk_packed_len (REG2);
+  pc = NEXT (3);
+  DISPATCH();
+ l_pref:
+  // PREF target array index
+  REG1 = irk_packed_ref (REG2, REG3);
+  pc = NEXT (4);
+  DISPATCH();
+ l_pset:
+  // PSET array index val
+  irk_packed_set (REG1, REG2, REG3);
+  pc = NEXT (4);
+  DISPATCH();
+ l_pfill:
+  // PFILL array start n val
+  irk_packed_fill (REG1, REG2, REG3, REG4);
+  pc = NEXT (5);
+  DISPATCH();
+ l_pcopy:
+  // PCOPY src sstart n dst dstart
+  irk_packed_copy (REG1, REG2, REG3, REG4, REG5);
+  pc = NEXT (6);
+  DISPATCH();
+ l_wide:
+  // WIDE op arg0 ...
+  goto *wide_dispatch_table[code[pc+1]];
+ l_wide_bad:
+  // scan_bytecode() checks for these.
+  fprintf (stderr, "%s can't be wide\n", irk_opcodes[code[pc+1]].name);
+  abort();
+
+#include "irkvm_super.h"
+
+  // a wide insn runs the same DO_<OP> as a narrow one, with four-byte
+  //   operands after the opcode.
+#undef ARG
+#undef NEXT
+#undef FIELD_INDEX
+#define ARG(n) WIDE_ARG(n)
+#define NEXT(n) WIDE_NEXT(n)
+#define FIELD_INDEX(n,tag,label) WIDE_FIELD_INDEX(n,tag,label)
+#include "irkvm_wide.h"
 }
 
+#ifdef VM_JIT
+#include "irkvm_jit.c"
+#endif
+
 void
 toplevel (void) {
+  irk_sample_hook = irk_sample_vm;
+  // anything sampled so far was native code.
+  irk_nsamples = 0;
   if (irk_argc < 2) {
     fprintf (stderr, "Usage: %s <bytecode-file> <arg0> <arg1> ...\n", irk_argv[0]);
   } else if (-1 == read_bytecode_file (irk_argv[1])) {
     fprintf (stderr, "failed to read bytecode file: %s\n", irk_argv[1]);
   } else {
+#ifdef VM_PROFILE
+    read_pc_map (irk_argv[1]);
+    vmprof_init();
+#else
+    if (irk_sample_path) {
+      read_pc_map (irk_argv[1]);
+    }
+#endif
+#ifdef VM_NGRAMS
+    ngram_init();
+#endif
+#ifdef VM_JIT
+    jit_init();
+#endif
     object * result = vm_go();
     //print_object (result);
     //fprintf (stdout, "\n");
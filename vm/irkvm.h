@@ -5,103 +5,191 @@ typedef struct {
   int nargs;
   int varargs;
   int target;
+  int wide;
 } opcode_info_t;
 
-opcode_info_t irk_opcodes[94] = {
-  {"lit",         2, 0, 1},
-  {"litc",        2, 0, 1},
-  {"ret",         1, 0, 0},
-  {"add",         3, 0, 1},
-  {"sub",         3, 0, 1},
-  {"mul",         3, 0, 1},
-  {"div",         3, 0, 1},
-  {"srem",        3, 0, 1},
-  {"shl",         3, 0, 1},
-  {"ashr",        3, 0, 1},
-  {"or",          3, 0, 1},
-  {"xor",         3, 0, 1},
-  {"and",         3, 0, 1},
-  {"eq",          3, 0, 1},
-  {"lt",          3, 0, 1},
-  {"gt",          3, 0, 1},
-  {"le",          3, 0, 1},
-  {"ge",          3, 0, 1},
-  {"cmp",         3, 0, 1},
-  {"tst",         2, 0, 0},
-  {"jmp",         1, 0, 0},
-  {"fun",         2, 0, 1},
-  {"tail",        2, 0, 0},
-  {"tail0",       1, 0, 0},
-  {"env",         2, 0, 1},
-  {"stor",        3, 0, 0},
-  {"ref",         3, 0, 1},
-  {"mov",         2, 0, 0},
-  {"epush",       1, 0, 0},
-  {"trcall",      3, 1, 0},
-  {"trcall0",     2, 0, 0},
-  {"ref0",        2, 0, 1},
-  {"call",        3, 0, 0},
-  {"call0",       2, 0, 0},
-  {"pop",         1, 0, 1},
-  {"printo",      1, 0, 0},
-  {"prints",      1, 0, 0},
-  {"topis",       1, 0, 0},
-  {"topref",      2, 0, 1},
-  {"topset",      2, 0, 0},
-  {"set",         3, 0, 0},
-  {"set0",        2, 0, 0},
-  {"pop0",        0, 0, 0},
-  {"epop",        0, 0, 0},
-  {"tron",        0, 0, 0},
-  {"troff",       0, 0, 0},
-  {"gc",          0, 0, 0},
-  {"imm",         2, 0, 1},
-  {"make",        4, 1, 1},
-  {"makei",       3, 0, 1},
-  {"exit",        1, 0, 0},
-  {"nvcase",      5, 1, 0},
-  {"tupref",      3, 0, 1},
-  {"vlen",        2, 0, 1},
-  {"vref",        3, 0, 1},
-  {"vset",        3, 0, 0},
-  {"vmake",       3, 0, 1},
-  {"alloc",       3, 0, 1},
-  {"rref",        3, 0, 1},
-  {"rset",        3, 0, 0},
-  {"getcc",       1, 0, 1},
-  {"putcc",       3, 0, 1},
-  {"ffi",         4, 1, 1},
-  {"smake",       2, 0, 1},
-  {"sfromc",      3, 0, 1},
-  {"slen",        2, 0, 1},
-  {"sref",        3, 0, 1},
-  {"sset",        3, 0, 0},
-  {"scopy",       5, 0, 0},
-  {"unchar",      2, 0, 1},
-  {"gist",        1, 0, 1},
-  {"argv",        1, 0, 1},
-  {"quiet",       1, 0, 0},
-  {"heap",        2, 0, 0},
-  {"readf",       2, 0, 1},
-  {"malloc",      3, 0, 1},
-  {"halloc",      3, 0, 1},
-  {"cget",        3, 0, 1},
-  {"cset",        3, 0, 0},
-  {"free",        1, 0, 0},
-  {"sizeoff",     2, 0, 0},
-  {"sgetp",       2, 0, 1},
-  {"caref",       4, 0, 1},
-  {"csref",       3, 0, 1},
-  {"dlopen",      2, 0, 1},
-  {"dlsym0",      2, 0, 1},
-  {"dlsym",       3, 0, 1},
-  {"csize",       2, 0, 1},
-  {"cref2int",    2, 0, 1},
-  {"int2cref",    2, 0, 1},
-  {"ob2int",      2, 0, 1},
-  {"obptr2int",   2, 0, 1},
-  {"errno",       1, 0, 1},
-  {"meta",        1, 0, 1}
+opcode_info_t irk_opcodes[138] = {
+  {"lit",         2, 0, 1, 1},
+  {"litc",        2, 0, 1, 1},
+  {"ret",         1, 0, 0, 1},
+  {"add",         3, 0, 1, 1},
+  {"sub",         3, 0, 1, 1},
+  {"mul",         3, 0, 1, 1},
+  {"div",         3, 0, 1, 1},
+  {"srem",        3, 0, 1, 1},
+  {"shl",         3, 0, 1, 1},
+  {"ashr",        3, 0, 1, 1},
+  {"or",          3, 0, 1, 1},
+  {"xor",         3, 0, 1, 1},
+  {"and",         3, 0, 1, 1},
+  {"eq",          3, 0, 1, 1},
+  {"lt",          3, 0, 1, 1},
+  {"gt",          3, 0, 1, 1},
+  {"le",          3, 0, 1, 1},
+  {"ge",          3, 0, 1, 1},
+  {"cmp",         3, 0, 1, 1},
+  {"tst",         2, 0, 0, 1},
+  {"jmp",         1, 0, 0, 1},
+  {"fun",         2, 0, 1, 1},
+  {"tail",        2, 0, 0, 1},
+  {"tail0",       1, 0, 0, 1},
+  {"env",         2, 0, 1, 1},
+  {"stor",        3, 0, 0, 1},
+  {"ref",         3, 0, 1, 1},
+  {"mov",         2, 0, 0, 1},
+  {"epush",       1, 0, 0, 1},
+  {"trcall",      3, 1, 0, 1},
+  {"trcall0",     2, 0, 0, 1},
+  {"ref0",        2, 0, 1, 1},
+  {"call",        3, 0, 0, 1},
+  {"call0",       2, 0, 0, 1},
+  {"pop",         1, 0, 1, 1},
+  {"printo",      1, 0, 0, 0},
+  {"prints",      1, 0, 0, 0},
+  {"topis",       1, 0, 0, 0},
+  {"topref",      2, 0, 1, 1},
+  {"topset",      2, 0, 0, 1},
+  {"set",         3, 0, 0, 1},
+  {"set0",        2, 0, 0, 1},
+  {"pop0",        0, 0, 0, 1},
+  {"epop",        0, 0, 0, 1},
+  {"tron",        0, 0, 0, 0},
+  {"troff",       0, 0, 0, 0},
+  {"gc",          0, 0, 0, 1},
+  {"imm",         2, 0, 1, 1},
+  {"make",        4, 1, 1, 1},
+  {"makei",       3, 0, 1, 1},
+  {"exit",        1, 0, 0, 0},
+  {"nvcase",      5, 1, 0, 1},
+  {"tupref",      3, 0, 1, 1},
+  {"vlen",        2, 0, 1, 1},
+  {"vref",        3, 0, 1, 1},
+  {"vset",        3, 0, 0, 1},
+  {"vmake",       3, 0, 1, 0},
+  {"alloc",       3, 0, 1, 1},
+  {"rref",        5, 0, 1, 1},
+  {"rset",        5, 0, 0, 1},
+  {"getcc",       1, 0, 1, 0},
+  {"putcc",       3, 0, 1, 0},
+  {"ffi",         4, 1, 1, 0},
+  {"smake",       2, 0, 1, 0},
+  {"sfromc",      3, 0, 1, 0},
+  {"slen",        2, 0, 1, 1},
+  {"sref",        3, 0, 1, 0},
+  {"sset",        3, 0, 0, 0},
+  {"scopy",       5, 0, 0, 0},
+  {"unchar",      2, 0, 1, 1},
+  {"gist",        1, 0, 1, 0},
+  {"argv",        1, 0, 1, 0},
+  {"quiet",       1, 0, 0, 0},
+  {"heap",        2, 0, 0, 0},
+  {"readf",       2, 0, 1, 0},
+  {"malloc",      3, 0, 1, 1},
+  {"halloc",      3, 0, 1, 1},
+  {"cget",        3, 0, 1, 1},
+  {"cset",        3, 0, 0, 1},
+  {"free",        1, 0, 0, 0},
+  {"sizeoff",     2, 0, 0, 0},
+  {"sgetp",       2, 0, 1, 0},
+  {"caref",       4, 0, 1, 1},
+  {"csref",       3, 0, 1, 1},
+  {"dlopen",      2, 0, 1, 0},
+  {"dlsym0",      2, 0, 1, 0},
+  {"dlsym",       3, 0, 1, 0},
+  {"csize",       2, 0, 1, 1},
+  {"cref2int",    2, 0, 1, 0},
+  {"int2cref",    2, 0, 1, 0},
+  {"ob2int",      2, 0, 1, 0},
+  {"obptr2int",   2, 0, 1, 0},
+  {"errno",       1, 0, 1, 0},
+  {"meta",        1, 0, 1, 0},
+  {"gcstat",      2, 0, 1, 0},
+  {"fop2",        4, 0, 1, 0},
+  {"fop1",        3, 0, 1, 0},
+  {"fcmp",        4, 0, 1, 0},
+  {"fconv",       3, 0, 1, 0},
+  {"pmake",       3, 0, 1, 0},
+  {"plen",        2, 0, 1, 0},
+  {"pref",        3, 0, 1, 0},
+  {"pset",        3, 0, 0, 0},
+  {"pfill",       4, 0, 0, 0},
+  {"pcopy",       5, 0, 0, 0},
+  {"wide",        0, 0, 0, 0},
+  {"ref_tupref_stor", 3, 0, 1, 0},
+  {"ref0_tupref_ref0", 2, 0, 1, 0},
+  {"gc_ref0_nvcase", 0, 0, 0, 0},
+  {"tupref_stor_ref", 3, 0, 1, 0},
+  {"stor_ref_tupref", 3, 0, 0, 0},
+  {"tupref_ref0_tupref", 3, 0, 1, 0},
+  {"stor_ref0",   3, 0, 0, 0},
+  {"env_epush_ref", 2, 0, 1, 0},
+  {"env_ref_stor", 2, 0, 1, 0},
+  {"epush_ref_tupref", 1, 0, 0, 0},
+  {"pop_stor_ref0", 1, 0, 1, 0},
+  {"ref0_tupref_mov", 2, 0, 1, 0},
+  {"stor_topref_call", 3, 0, 0, 0},
+  {"stor_ref_call", 3, 0, 0, 0},
+  {"ref0_stor_ref", 2, 0, 1, 0},
+  {"stor_ref0_nvcase", 3, 0, 0, 0},
+  {"ref_stor_ref0", 3, 0, 1, 0},
+  {"tupref_stor_env", 3, 0, 1, 0},
+  {"stor_ref0_stor", 3, 0, 0, 0},
+  {"stor_env_ref", 3, 0, 0, 0},
+  {"env_ref0_stor", 2, 0, 1, 0},
+  {"ref0_ref0",   2, 0, 1, 0},
+  {"gc_env_epush", 0, 0, 0, 0},
+  {"mov_ref0",    2, 0, 0, 0},
+  {"stor_topref_tail", 3, 0, 0, 0},
+  {"eq_tst",      3, 0, 1, 0},
+  {"stor_env_ref0", 3, 0, 0, 0},
+  {"mov_tupref_mov", 2, 0, 0, 0},
+  {"env_epush_env", 2, 0, 1, 0},
+  {"ref0_eq_tst", 2, 0, 1, 0},
+  {"ref0_stor_topref", 2, 0, 1, 0},
+  {"ref_stor_topref", 3, 0, 1, 0}
+};
+
+#define IRK_MAX_SUPEROP 3
+
+typedef struct {
+  int len;
+  int ops[IRK_MAX_SUPEROP];
+} superop_info_t;
+
+superop_info_t irk_superops[33] = {
+  {3, {26, 52, 25}}, // ref_tupref_stor
+  {3, {31, 52, 31}}, // ref0_tupref_ref0
+  {3, {46, 31, 51}}, // gc_ref0_nvcase
+  {3, {52, 25, 26}}, // tupref_stor_ref
+  {3, {25, 26, 52}}, // stor_ref_tupref
+  {3, {52, 31, 52}}, // tupref_ref0_tupref
+  {2, {25, 31}}, // stor_ref0
+  {3, {24, 28, 26}}, // env_epush_ref
+  {3, {24, 26, 25}}, // env_ref_stor
+  {3, {28, 26, 52}}, // epush_ref_tupref
+  {3, {34, 25, 31}}, // pop_stor_ref0
+  {3, {31, 52, 27}}, // ref0_tupref_mov
+  {3, {25, 38, 32}}, // stor_topref_call
+  {3, {25, 26, 32}}, // stor_ref_call
+  {3, {31, 25, 26}}, // ref0_stor_ref
+  {3, {25, 31, 51}}, // stor_ref0_nvcase
+  {3, {26, 25, 31}}, // ref_stor_ref0
+  {3, {52, 25, 24}}, // tupref_stor_env
+  {3, {25, 31, 25}}, // stor_ref0_stor
+  {3, {25, 24, 26}}, // stor_env_ref
+  {3, {24, 31, 25}}, // env_ref0_stor
+  {2, {31, 31}}, // ref0_ref0
+  {3, {46, 24, 28}}, // gc_env_epush
+  {2, {27, 31}}, // mov_ref0
+  {3, {25, 38, 22}}, // stor_topref_tail
+  {2, {13, 19}}, // eq_tst
+  {3, {25, 24, 31}}, // stor_env_ref0
+  {3, {27, 52, 27}}, // mov_tupref_mov
+  {3, {24, 28, 24}}, // env_epush_env
+  {3, {31, 13, 19}}, // ref0_eq_tst
+  {3, {31, 25, 38}}, // ref0_stor_topref
+  {3, {26, 25, 38}}, // ref_stor_topref
+  {0, {0}}
 };
 #define IRK_OP_LIT        0
 #define IRK_OP_LITC       1
@@ -197,4 +285,297 @@ opcode_info_t irk_opcodes[94] = {
 #define IRK_OP_OBPTR2INT  91
 #define IRK_OP_ERRNO      92
 #define IRK_OP_META       93
-#define IRK_NUM_OPCODES 94
+#define IRK_OP_GCSTAT     94
+#define IRK_OP_FOP2       95
+#define IRK_OP_FOP1       96
+#define IRK_OP_FCMP       97
+#define IRK_OP_FCONV      98
+#define IRK_OP_PMAKE      99
+#define IRK_OP_PLEN       100
+#define IRK_OP_PREF       101
+#define IRK_OP_PSET       102
+#define IRK_OP_PFILL      103
+#define IRK_OP_PCOPY      104
+#define IRK_OP_WIDE       105
+#define IRK_OP_REF_TUPREF_STOR 106
+#define IRK_OP_REF0_TUPREF_REF0 107
+#define IRK_OP_GC_REF0_NVCASE 108
+#define IRK_OP_TUPREF_STOR_REF 109
+#define IRK_OP_STOR_REF_TUPREF 110
+#define IRK_OP_TUPREF_REF0_TUPREF 111
+#define IRK_OP_STOR_REF0  112
+#define IRK_OP_ENV_EPUSH_REF 113
+#define IRK_OP_ENV_REF_STOR 114
+#define IRK_OP_EPUSH_REF_TUPREF 115
+#define IRK_OP_POP_STOR_REF0 116
+#define IRK_OP_REF0_TUPREF_MOV 117
+#define IRK_OP_STOR_TOPREF_CALL 118
+#define IRK_OP_STOR_REF_CALL 119
+#define IRK_OP_REF0_STOR_REF 120
+#define IRK_OP_STOR_REF0_NVCASE 121
+#define IRK_OP_REF_STOR_REF0 122
+#define IRK_OP_TUPREF_STOR_ENV 123
+#define IRK_OP_STOR_REF0_STOR 124
+#define IRK_OP_STOR_ENV_REF 125
+#define IRK_OP_ENV_REF0_STOR 126
+#define IRK_OP_REF0_REF0  127
+#define IRK_OP_GC_ENV_EPUSH 128
+#define IRK_OP_MOV_REF0   129
+#define IRK_OP_STOR_TOPREF_TAIL 130
+#define IRK_OP_EQ_TST     131
+#define IRK_OP_STOR_ENV_REF0 132
+#define IRK_OP_MOV_TUPREF_MOV 133
+#define IRK_OP_ENV_EPUSH_ENV 134
+#define IRK_OP_REF0_EQ_TST 135
+#define IRK_OP_REF0_STOR_TOPREF 136
+#define IRK_OP_REF_STOR_TOPREF 137
+#define IRK_NUM_BASE_OPCODES 106
+#define IRK_NUM_OPCODES 138
+
+#define IRK_DISPATCH_TABLE \
+  &&l_lit, \
+  &&l_litc, \
+  &&l_ret, \
+  &&l_add, \
+  &&l_sub, \
+  &&l_mul, \
+  &&l_div, \
+  &&l_srem, \
+  &&l_shl, \
+  &&l_ashr, \
+  &&l_or, \
+  &&l_xor, \
+  &&l_and, \
+  &&l_eq, \
+  &&l_lt, \
+  &&l_gt, \
+  &&l_le, \
+  &&l_ge, \
+  &&l_cmp, \
+  &&l_tst, \
+  &&l_jmp, \
+  &&l_fun, \
+  &&l_tail, \
+  &&l_tail0, \
+  &&l_env, \
+  &&l_stor, \
+  &&l_ref, \
+  &&l_mov, \
+  &&l_epush, \
+  &&l_trcall, \
+  &&l_trcall0, \
+  &&l_ref0, \
+  &&l_call, \
+  &&l_call0, \
+  &&l_pop, \
+  &&l_printo, \
+  &&l_prints, \
+  &&l_topis, \
+  &&l_topref, \
+  &&l_topset, \
+  &&l_set, \
+  &&l_set0, \
+  &&l_pop0, \
+  &&l_epop, \
+  &&l_tron, \
+  &&l_troff, \
+  &&l_gc, \
+  &&l_imm, \
+  &&l_make, \
+  &&l_makei, \
+  &&l_exit, \
+  &&l_nvcase, \
+  &&l_tupref, \
+  &&l_vlen, \
+  &&l_vref, \
+  &&l_vset, \
+  &&l_vmake, \
+  &&l_alloc, \
+  &&l_rref, \
+  &&l_rset, \
+  &&l_getcc, \
+  &&l_putcc, \
+  &&l_ffi, \
+  &&l_smake, \
+  &&l_sfromc, \
+  &&l_slen, \
+  &&l_sref, \
+  &&l_sset, \
+  &&l_scopy, \
+  &&l_unchar, \
+  &&l_gist, \
+  &&l_argv, \
+  &&l_quiet, \
+  &&l_heap, \
+  &&l_readf, \
+  &&l_malloc, \
+  &&l_halloc, \
+  &&l_cget, \
+  &&l_cset, \
+  &&l_free, \
+  &&l_sizeoff, \
+  &&l_sgetp, \
+  &&l_caref, \
+  &&l_csref, \
+  &&l_dlopen, \
+  &&l_dlsym0, \
+  &&l_dlsym, \
+  &&l_csize, \
+  &&l_cref2int, \
+  &&l_int2cref, \
+  &&l_ob2int, \
+  &&l_obptr2int, \
+  &&l_errno, \
+  &&l_meta, \
+  &&l_gcstat, \
+  &&l_fop2, \
+  &&l_fop1, \
+  &&l_fcmp, \
+  &&l_fconv, \
+  &&l_pmake, \
+  &&l_plen, \
+  &&l_pref, \
+  &&l_pset, \
+  &&l_pfill, \
+  &&l_pcopy, \
+  &&l_wide, \
+  &&l_ref_tupref_stor, \
+  &&l_ref0_tupref_ref0, \
+  &&l_gc_ref0_nvcase, \
+  &&l_tupref_stor_ref, \
+  &&l_stor_ref_tupref, \
+  &&l_tupref_ref0_tupref, \
+  &&l_stor_ref0, \
+  &&l_env_epush_ref, \
+  &&l_env_ref_stor, \
+  &&l_epush_ref_tupref, \
+  &&l_pop_stor_ref0, \
+  &&l_ref0_tupref_mov, \
+  &&l_stor_topref_call, \
+  &&l_stor_ref_call, \
+  &&l_ref0_stor_ref, \
+  &&l_stor_ref0_nvcase, \
+  &&l_ref_stor_ref0, \
+  &&l_tupref_stor_env, \
+  &&l_stor_ref0_stor, \
+  &&l_stor_env_ref, \
+  &&l_env_ref0_stor, \
+  &&l_ref0_ref0, \
+  &&l_gc_env_epush, \
+  &&l_mov_ref0, \
+  &&l_stor_topref_tail, \
+  &&l_eq_tst, \
+  &&l_stor_env_ref0, \
+  &&l_mov_tupref_mov, \
+  &&l_env_epush_env, \
+  &&l_ref0_eq_tst, \
+  &&l_ref0_stor_topref, \
+  &&l_ref_stor_topref,
+
+#define IRK_WIDE_DISPATCH_TABLE \
+  &&lw_lit, \
+  &&lw_litc, \
+  &&lw_ret, \
+  &&lw_add, \
+  &&lw_sub, \
+  &&lw_mul, \
+  &&lw_div, \
+  &&lw_srem, \
+  &&lw_shl, \
+  &&lw_ashr, \
+  &&lw_or, \
+  &&lw_xor, \
+  &&lw_and, \
+  &&lw_eq, \
+  &&lw_lt, \
+  &&lw_gt, \
+  &&lw_le, \
+  &&lw_ge, \
+  &&lw_cmp, \
+  &&lw_tst, \
+  &&lw_jmp, \
+  &&lw_fun, \
+  &&lw_tail, \
+  &&lw_tail0, \
+  &&lw_env, \
+  &&lw_stor, \
+  &&lw_ref, \
+  &&lw_mov, \
+  &&lw_epush, \
+  &&lw_trcall, \
+  &&lw_trcall0, \
+  &&lw_ref0, \
+  &&lw_call, \
+  &&lw_call0, \
+  &&lw_pop, \
+  &&l_wide_bad, \
+  &&l_wide_bad, \
+  &&l_wide_bad, \
+  &&lw_topref, \
+  &&lw_topset, \
+  &&lw_set, \
+  &&lw_set0, \
+  &&lw_pop0, \
+  &&lw_epop, \
+  &&l_wide_bad, \
+  &&l_wide_bad, \
+  &&lw_gc, \
+  &&lw_imm, \
+  &&lw_make, \
+  &&lw_makei, \
+  &&l_wide_bad, \
+  &&lw_nvcase, \
+  &&lw_tupref, \
+  &&lw_vlen, \
+  &&lw_vref, \
+  &&lw_vset, \
+  &&l_wide_bad, \
+  &&lw_alloc, \
+  &&lw_rref, \
+  &&lw_rset, \
+  &&l_wide_bad, \
+  &&l_wide_bad, \
+  &&l_wide_bad, \
+  &&l_wide_bad, \
+  &&l_wide_bad, \
+  &&lw_slen, \
+  &&l_wide_bad, \
+  &&l_wide_bad, \
+  &&l_wide_bad, \
+  &&lw_unchar, \
+  &&l_wide_bad, \
+  &&l_wide_bad, \
+  &&l_wide_bad, \
+  &&l_wide_bad, \
+  &&l_wide_bad, \
+  &&lw_malloc, \
+  &&lw_halloc, \
+  &&lw_cget, \
+  &&lw_cset, \
+  &&l_wide_bad, \
+  &&l_wide_bad, \
+  &&l_wide_bad, \
+  &&lw_caref, \
+  &&lw_csref, \
+  &&l_wide_bad, \
+  &&l_wide_bad, \
+  &&l_wide_bad, \
+  &&lw_csize, \
+  &&l_wide_bad, \
+  &&l_wide_bad, \
+  &&l_wide_bad, \
+  &&l_wide_bad, \
+  &&l_wide_bad, \
+  &&l_wide_bad, \
+  &&l_wide_bad, \
+  &&l_wide_bad, \
+  &&l_wide_bad, \
+  &&l_wide_bad, \
+  &&l_wide_bad, \
+  &&l_wide_bad, \
+  &&l_wide_bad, \
+  &&l_wide_bad, \
+  &&l_wide_bad, \
+  &&l_wide_bad, \
+  &&l_wide_bad, \
+  &&l_wide_bad,
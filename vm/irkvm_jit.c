@@ -0,0 +1,584 @@
+// -*- Mode: C -*-
+
+// a template JIT for x86-64 Linux, included at the end of vm/irkvm.c.
+//
+// a unit is the code reachable from a hot pc (the target of a call,
+//   return or loop) without leaving through a call or return.  it is
+//   compiled one insn at a time, in bytecode order where it falls
+//   through:
+//
+//   - the common insns (mov, lit, add, tst, ...) get their own
+//     machine code, with the registers addressed off rbx.
+//   - the rest of <jit-ops> (self/byteops.scm) call their stencil, a
+//     function made from the insn's DO_<OP> macro (vm/irkvm_jit.h).
+//   - any other insn (ffi, dlsym, ...) returns to the interpreter,
+//     which runs it and the rest of that function.
+//
+// all of the VM's state stays where the interpreter keeps it: the
+//   registers in vm_go()'s array and vm_lenv, vm_k and vm_top in their
+//   globals.  a continuation holds a pc, so a call or return goes
+//   through jit_entry[] to the native code for the pc it lands on,
+//   or back to the interpreter.  that's also why getcc/putcc need
+//   nothing special.
+
+#include <sys/mman.h>
+
+typedef irk_int (*jit_stencil_t) (object ** vm_regs, irk_int pc);
+
+// the DO_<OP> macros leave the operand macros switched to wide, see
+//   the end of vm_go().  the stencils aren't JIT points themselves.
+#undef JIT_POINT
+#define JIT_POINT()
+
+#define JIT_DEFINE(name, NAME)                                  \
+  static irk_int                                                \
+  JIT_STENCIL(name) (object ** vm_regs, irk_int pc)             \
+  {                                                             \
+    bytecode_t * code = bytecode;                               \
+    (void) code;                                                \
+    DO_##NAME();                                                \
+    return pc;                                                  \
+  }
+
+#undef ARG
+#undef NEXT
+#undef FIELD_INDEX
+#define ARG(n) NARROW_ARG(n)
+#define NEXT(n) NARROW_NEXT(n)
+#define FIELD_INDEX(n,tag,label) NARROW_FIELD_INDEX(n,tag,label)
+#define JIT_STENCIL(name) jit_op_##name
+#include "irkvm_jit.h"
+
+#undef ARG
+#undef NEXT
+#undef FIELD_INDEX
+#undef JIT_STENCIL
+#define ARG(n) WIDE_ARG(n)
+#define NEXT(n) WIDE_NEXT(n)
+#define FIELD_INDEX(n,tag,label) WIDE_FIELD_INDEX(n,tag,label)
+#define JIT_STENCIL(name) jit_wop_##name
+#include "irkvm_jit.h"
+
+// RET <val>: the pc to go to, or its own pc at the end of the program
+//   (the interpreter returns from vm_go() there).
+static irk_int
+jit_ret (object ** vm_regs, irk_int pc)
+{
+  if (vm_k == IRK_NIL) {
+    return pc;
+  } else {
+    SAMPLE_POINT();
+    vm_result = vm_regs[insn_arg (pc, 1)];
+    return UNTAG_INTEGER (vm_k[3]);
+  }
+}
+
+// the code buffer: jit_enter and jit_exit, then the units.
+#define JIT_CODE_SIZE (32 << 20)
+// the most insns in a unit, and the code space left for the next one.
+#define JIT_MAX_INSNS 8192
+#define JIT_MAX_FIXUPS (JIT_MAX_INSNS * 2)
+#define JIT_SLACK 65536
+
+static uint8_t * jit_code;
+static uint8_t * jit_p;
+static irk_int (*jit_enter) (object ** regs, void * entry);
+static uint8_t * jit_exit; // rax = pc
+
+// while compiling a unit: the native address of each insn in it.
+static uint8_t ** jit_label;
+static irk_int jit_ninsns;
+static irk_int jit_insns[JIT_MAX_INSNS];
+// insns waiting to be compiled.
+static irk_int jit_ntodo;
+static irk_int jit_todo[JIT_MAX_FIXUPS];
+// rel32 jumps to insns, patched at the end.
+static irk_int jit_nfixups;
+static struct {
+  uint8_t * at;
+  irk_int pc;
+} jit_fixups[JIT_MAX_FIXUPS];
+// set when the unit doesn't fit in the tables above.
+static int jit_full;
+// insns after a call, where a return comes back in.
+static irk_int jit_nreturns;
+static irk_int jit_returns[JIT_MAX_INSNS];
+
+// --------------------------------------------------
+// x86-64 encoding
+// --------------------------------------------------
+
+enum { RAX=0, RCX=1, RDX=2, RBX=3, RSP=4, RBP=5, RSI=6, RDI=7 };
+
+static inline void
+jit_byte (int b)
+{
+  *jit_p++ = (uint8_t) b;
+}
+
+static inline void
+jit_int32 (int32_t n)
+{
+  memcpy (jit_p, &n, 4);
+  jit_p += 4;
+}
+
+static inline void
+jit_int64 (int64_t n)
+{
+  memcpy (jit_p, &n, 8);
+  jit_p += 8;
+}
+
+// <reg> and [<base> + <disp>]; <base> is never rsp or r12.
+static void
+jit_modrm_disp (int reg, int base, int32_t disp)
+{
+  if (disp >= -128 && disp < 128) {
+    jit_byte (0x40 | (reg << 3) | base);
+    jit_byte (disp);
+  } else {
+    jit_byte (0x80 | (reg << 3) | base);
+    jit_int32 (disp);
+  }
+}
+
+// mov <r>, [<base> + <disp>]
+static void
+jit_load (int r, int base, int32_t disp)
+{
+  jit_byte (0x48); jit_byte (0x8b);
+  jit_modrm_disp (r, base, disp);
+}
+
+// mov [<base> + <disp>], <r>
+static void
+jit_store (int base, int32_t disp, int r)
+{
+  jit_byte (0x48); jit_byte (0x89);
+  jit_modrm_disp (r, base, disp);
+}
+
+// mov <r>, <n>
+static void
+jit_imm64 (int r, void * n)
+{
+  jit_byte (0x48); jit_byte (0xb8 + r);
+  jit_int64 ((int64_t) n);
+}
+
+// mov <r>, [<global>]
+static void
+jit_load_global (int r, object ** global)
+{
+  jit_imm64 (r, global);
+  jit_load (r, r, 0);
+}
+
+// sar <r>, 1
+static void
+jit_unbox (int r)
+{
+  jit_byte (0x48); jit_byte (0xd1); jit_byte (0xf8 | r);
+}
+
+static void
+jit_rel32 (uint8_t * target)
+{
+  jit_int32 ((int32_t) (target - (jit_p + 4)));
+}
+
+// jmp/jcc to the insn at <pc>, compiling it later if need be.
+static void
+jit_jump_to (irk_int pc)
+{
+  if (jit_nfixups == JIT_MAX_FIXUPS || jit_ntodo == JIT_MAX_FIXUPS) {
+    jit_full = 1;
+  } else {
+    jit_fixups[jit_nfixups].at = jit_p;
+    jit_fixups[jit_nfixups].pc = pc;
+    jit_nfixups++;
+    if (!jit_label[pc]) {
+      jit_todo[jit_ntodo++] = pc;
+    }
+  }
+  jit_int32 (0);
+}
+
+// call the stencil <fun> for the insn at <pc>: rax = the next pc.
+static void
+jit_call_stencil (void * fun, irk_int pc)
+{
+  jit_byte (0x48); jit_byte (0x89); jit_byte (0xdf);  // mov rdi, rbx
+  jit_byte (0x48); jit_byte (0xc7); jit_byte (0xc6);  // mov rsi, pc
+  jit_int32 (pc);
+  jit_imm64 (RAX, fun);
+  jit_byte (0xff); jit_byte (0xd0);                   // call rax
+}
+
+// leave for the insn at pc rax: through jit_entry[], or back to the
+//   interpreter.
+static void
+jit_chain (void)
+{
+  jit_imm64 (RCX, jit_entry);
+  jit_byte (0x48); jit_byte (0x8b); jit_byte (0x14); jit_byte (0xc1); // mov rdx, [rcx+rax*8]
+  jit_byte (0x48); jit_byte (0x85); jit_byte (0xd2);                  // test rdx, rdx
+  jit_byte (0x0f); jit_byte (0x84); jit_rel32 (jit_exit);             // jz jit_exit
+  jit_byte (0xff); jit_byte (0xe2);                                   // jmp rdx
+}
+
+// back to the interpreter, to run the insn at <pc>.
+static void
+jit_leave (irk_int pc)
+{
+  jit_byte (0xb8); jit_int32 (pc);                    // mov eax, pc
+  jit_byte (0xe9); jit_rel32 (jit_exit);
+}
+
+// --------------------------------------------------
+// insns
+// --------------------------------------------------
+
+#define JREG(n) (8 * insn_arg (pc, n))
+
+// <target> <a> <b>: box (unbox (a) <op> unbox (b))
+static void
+jit_arith (irk_int pc, int op)
+{
+  jit_load (RAX, RBX, JREG(2));
+  jit_unbox (RAX);
+  jit_load (RCX, RBX, JREG(3));
+  jit_unbox (RCX);
+  jit_byte (0x48); jit_byte (op); jit_byte (0xc8);    // add/sub rax, rcx
+  jit_byte (0x48); jit_byte (0x01); jit_byte (0xc0);  // add rax, rax
+  jit_byte (0x48); jit_byte (0x83); jit_byte (0xc8); jit_byte (0x01); // or rax, 1
+  jit_store (RBX, JREG(1), RAX);
+}
+
+// <target> <a> <b>: IRK_TEST (unbox (a) <cc> unbox (b))
+static void
+jit_compare (irk_int pc, int cc)
+{
+  jit_load (RAX, RBX, JREG(2));
+  jit_unbox (RAX);
+  jit_load (RCX, RBX, JREG(3));
+  jit_unbox (RCX);
+  jit_byte (0x48); jit_byte (0x39); jit_byte (0xc8);  // cmp rax, rcx
+  jit_byte (0xb8); jit_int32 ((int32_t) (irk_int) IRK_FALSE); // mov eax, #f
+  jit_byte (0xba); jit_int32 ((int32_t) (irk_int) IRK_TRUE);  // mov edx, #t
+  jit_byte (0x48); jit_byte (0x0f); jit_byte (0x40 | cc); jit_byte (0xc2); // cmovcc rax, rdx
+  jit_store (RBX, JREG(1), RAX);
+}
+
+// <target> := <global>[<index>]
+static void
+jit_global_ref (irk_int pc, object ** global, irk_int index)
+{
+  jit_load_global (RAX, global);
+  jit_load (RAX, RAX, 8 * index);
+  jit_store (RBX, JREG(1), RAX);
+}
+
+// rax := the lexical env <depth> ribs up.  ref and set go to the
+//   stencil past this depth.
+#define JIT_MAX_DEPTH 8
+
+static void
+jit_lenv (irk_int depth)
+{
+  jit_load_global (RAX, &vm_lenv);
+  for (irk_int i=0; i < depth; i++) {
+    jit_load (RAX, RAX, 8);
+  }
+}
+
+// compile the insn at <pc>, and return the pc it goes on to, or -1
+//   if it doesn't.
+static irk_int
+jit_insn (irk_int pc)
+{
+  irk_int op = insn_op (pc);
+  irk_int next = pc + insn_length (pc);
+  if (op >= IRK_NUM_BASE_OPCODES) {
+    // a superinstruction: its insns are still in place.
+    op = irk_superops[op - IRK_NUM_BASE_OPCODES].ops[0];
+  }
+  switch (op) {
+  case IRK_OP_MOV:
+    jit_load (RAX, RBX, JREG(2));
+    jit_store (RBX, JREG(1), RAX);
+    return next;
+  case IRK_OP_IMM:
+    // mov qword [rbx + target], imm
+    jit_byte (0x48); jit_byte (0xc7);
+    jit_modrm_disp (0, RBX, JREG(1));
+    jit_int32 (insn_arg (pc, 2));
+    return next;
+  case IRK_OP_LIT:
+    jit_global_ref (pc, &bytecode_literals, insn_arg (pc, 2) + 1);
+    return next;
+  case IRK_OP_REF0:
+    jit_global_ref (pc, &vm_lenv, insn_arg (pc, 2) + 2);
+    return next;
+  case IRK_OP_TOPREF:
+    jit_global_ref (pc, &vm_top, insn_arg (pc, 2) + 2);
+    return next;
+  case IRK_OP_REF:
+    if (insn_arg (pc, 2) <= JIT_MAX_DEPTH) {
+      jit_lenv (insn_arg (pc, 2));
+      jit_load (RAX, RAX, 8 * (insn_arg (pc, 3) + 2));
+      jit_store (RBX, JREG(1), RAX);
+      return next;
+    }
+    break;
+  case IRK_OP_GC: {
+    // if freep >= limit, call the stencil.
+    jit_load_global (RAX, &freep);
+    jit_load_global (RCX, &limit);
+    jit_byte (0x48); jit_byte (0x39); jit_byte (0xc8);  // cmp rax, rcx
+    jit_byte (0x72); jit_byte (0);                      // jb over
+    uint8_t * over = jit_p;
+    jit_call_stencil (jit_op_gc, pc);
+    over[-1] = (uint8_t) (jit_p - over);
+    return next;
+  }
+  case IRK_OP_TUPREF:
+    jit_load (RAX, RBX, JREG(2));
+    jit_load (RAX, RAX, 8 * (insn_arg (pc, 3) + 1));
+    jit_store (RBX, JREG(1), RAX);
+    return next;
+#ifndef IRK_GENERATIONAL
+  case IRK_OP_STOR:
+    jit_load (RAX, RBX, JREG(1));
+    jit_load (RCX, RBX, JREG(3));
+    jit_store (RAX, 8 * (insn_arg (pc, 2) + 1), RCX);
+    return next;
+  case IRK_OP_TOPSET:
+    jit_load_global (RAX, &vm_top);
+    jit_load (RCX, RBX, JREG(2));
+    jit_store (RAX, 8 * (insn_arg (pc, 1) + 2), RCX);
+    return next;
+  case IRK_OP_SET:
+  case IRK_OP_SET0: {
+    // SET depth index val, SET0 index val
+    irk_int n = (op == IRK_OP_SET) ? 1 : 0;
+    irk_int depth = n ? insn_arg (pc, 1) : 0;
+    if (depth <= JIT_MAX_DEPTH) {
+      jit_lenv (depth);
+      jit_load (RCX, RBX, JREG(n + 2));
+      jit_store (RAX, 8 * (insn_arg (pc, n + 1) + 2), RCX);
+      return next;
+    }
+    break;
+  }
+  case IRK_OP_EPUSH:
+    // rib[1] := vm_lenv; vm_lenv := rib
+    jit_load (RAX, RBX, JREG(1));
+    jit_imm64 (RCX, &vm_lenv);
+    jit_load (RDX, RCX, 0);
+    jit_store (RAX, 8, RDX);
+    jit_store (RCX, 0, RAX);
+    return next;
+  case IRK_OP_EPOP:
+    jit_imm64 (RCX, &vm_lenv);
+    jit_load (RAX, RCX, 0);
+    jit_load (RAX, RAX, 8);
+    jit_store (RCX, 0, RAX);
+    return next;
+  case IRK_OP_ENV: {
+    // allocate (TC_VM_LENV, size + 1), see header1.c
+    irk_int size = insn_arg (pc, 2) + 1;
+    jit_imm64 (RCX, &freep);
+    jit_load (RAX, RCX, 0);
+    jit_byte (0x48); jit_byte (0xc7); jit_byte (0x00);  // mov qword [rax], header
+    jit_int32 ((int32_t) (size << 8 | TC_VM_LENV));
+    jit_byte (0x48); jit_byte (0x8d); jit_byte (0x90);  // lea rdx, [rax + 8 * (size + 1)]
+    jit_int32 (8 * (size + 1));
+    jit_store (RCX, 0, RDX);
+    jit_store (RBX, JREG(1), RAX);
+    return next;
+  }
+#endif
+  case IRK_OP_ADD: jit_arith (pc, 0x01); return next;
+  case IRK_OP_SUB: jit_arith (pc, 0x29); return next;
+  case IRK_OP_EQ: jit_compare (pc, 0x4); return next;
+  case IRK_OP_LT: jit_compare (pc, 0xc); return next;
+  case IRK_OP_GT: jit_compare (pc, 0xf); return next;
+  case IRK_OP_LE: jit_compare (pc, 0xe); return next;
+  case IRK_OP_GE: jit_compare (pc, 0xd); return next;
+  case IRK_OP_TST:
+    // cmp qword [rbx + val], #t; jne else
+    jit_byte (0x48); jit_byte (0x81);
+    jit_modrm_disp (7, RBX, JREG(1));
+    jit_int32 ((int32_t) (irk_int) IRK_TRUE);
+    jit_byte (0x0f); jit_byte (0x85);
+    jit_jump_to (pc + insn_arg (pc, 2));
+    return next;
+  case IRK_OP_JMP:
+    return pc + insn_arg (pc, 1);
+  case IRK_OP_RET:
+    jit_call_stencil (jit_ret, pc);
+    jit_chain();
+    return -1;
+  }
+  jit_stencil_t stencil = (insn_wide (pc) ? jit_wop_table : jit_op_table)[op];
+  if (!stencil) {
+    jit_leave (pc);
+    return -1;
+  }
+  jit_call_stencil (stencil, pc);
+  switch (op) {
+  case IRK_OP_FUN:
+    // skip the body.
+    return pc + insn_arg (pc, 2);
+  case IRK_OP_TRCALL:
+  case IRK_OP_TRCALL0:
+    return pc + insn_arg (pc, 1);
+  case IRK_OP_NVCASE: {
+    // NVCASE ob elabel nalts tag0 label0 tag1 label1 ...
+    irk_int nalts = insn_arg (pc, 3);
+    for (irk_int i=0; i < nalts; i++) {
+      jit_byte (0x48); jit_byte (0x3d);               // cmp rax, target
+      jit_int32 (pc + insn_arg (pc, 4 + (i * 2) + 1));
+      jit_byte (0x0f); jit_byte (0x84);               // je
+      jit_jump_to (pc + insn_arg (pc, 4 + (i * 2) + 1));
+    }
+    return pc + insn_arg (pc, 2);
+  }
+  case IRK_OP_CALL:
+  case IRK_OP_CALL0:
+    if (jit_ntodo == JIT_MAX_FIXUPS) {
+      jit_full = 1;
+    } else {
+      jit_returns[jit_nreturns++] = next;
+      jit_todo[jit_ntodo++] = next;
+    }
+    jit_chain();
+    return -1;
+  case IRK_OP_TAIL:
+  case IRK_OP_TAIL0:
+    jit_chain();
+    return -1;
+  default:
+    return next;
+  }
+}
+
+// does the insn at <pc> leave the unit right away?
+static int
+jit_leaves (irk_int pc)
+{
+  irk_int op = insn_op (pc);
+  if (op >= IRK_NUM_BASE_OPCODES) {
+    op = irk_superops[op - IRK_NUM_BASE_OPCODES].ops[0];
+  }
+  return op == IRK_OP_RET || !(insn_wide (pc) ? jit_wop_table : jit_op_table)[op];
+}
+
+// compile the unit at <root>.  returns its entry, or NULL when it
+//   can't be compiled (or doesn't need to be), and then <root> isn't
+//   tried again.
+static void *
+jit_compile (irk_int root)
+{
+  uint8_t * start = jit_p;
+  int ok = 1;
+  jit_ninsns = jit_ntodo = jit_nfixups = jit_nreturns = jit_full = 0;
+  if (jit_leaves (root)) {
+    ok = 0;
+  } else {
+    jit_todo[jit_ntodo++] = root;
+  }
+  while (ok && jit_ntodo > 0) {
+    irk_int pc = jit_todo[--jit_ntodo];
+    // emit a run of insns, until one doesn't fall through.
+    while (pc >= 0) {
+      if (jit_label[pc]) {
+        jit_byte (0xe9);
+        jit_jump_to (pc);
+        break;
+      } else if (jit_full || jit_ninsns == JIT_MAX_INSNS
+                 || (jit_code + JIT_CODE_SIZE) - jit_p < JIT_SLACK) {
+        ok = 0;
+        break;
+      } else {
+        jit_label[pc] = jit_p;
+        jit_insns[jit_ninsns++] = pc;
+        pc = jit_insn (pc);
+      }
+    }
+  }
+  void * entry = NULL;
+  if (ok && !jit_full) {
+    for (irk_int i=0; i < jit_nfixups; i++) {
+      uint8_t * at = jit_fixups[i].at;
+      int32_t rel = (int32_t) (jit_label[jit_fixups[i].pc] - (at + 4));
+      memcpy (at, &rel, 4);
+    }
+    entry = jit_label[root];
+    jit_entry[root] = entry;
+    for (irk_int i=0; i < jit_nreturns; i++) {
+      irk_int pc = jit_returns[i];
+      if (!jit_entry[pc] && !jit_leaves (pc)) {
+        jit_entry[pc] = jit_label[pc];
+      }
+    }
+  } else {
+    jit_p = start;
+    jit_count[root] = INT32_MIN;
+  }
+  for (irk_int i=0; i < jit_ninsns; i++) {
+    jit_label[jit_insns[i]] = NULL;
+  }
+  return entry;
+}
+
+// the interpreter calls this at a call, return or loop when <pc> has
+//   native code or has just become hot.  it returns the pc to go on
+//   interpreting from.
+static irk_int
+jit_run (object ** regs, irk_int pc)
+{
+  void * entry = jit_entry[pc];
+  while (entry || (entry = jit_compile (pc))) {
+    pc = jit_enter (regs, entry);
+    entry = jit_entry[pc];
+    if (!entry && ++jit_count[pc] < jit_threshold) {
+      break;
+    }
+  }
+  return pc;
+}
+
+// IRKVM_JIT=0 turns the JIT off, IRKVM_JIT=<n> compiles a unit when
+//   it's been entered <n> times (default 100).
+static void
+jit_init (void)
+{
+  char * env = getenv ("IRKVM_JIT");
+  jit_threshold = env ? atoi (env) : 100;
+  if (jit_threshold <= 0) {
+    return;
+  }
+  jit_code = mmap (NULL, JIT_CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (jit_code == MAP_FAILED) {
+    fprintf (stderr, "irkvm: no memory for the JIT, running without it.\n");
+    return;
+  }
+  jit_label = calloc (bytecode_len, sizeof (uint8_t *));
+  jit_count = calloc (bytecode_len, sizeof (int32_t));
+  jit_p = jit_code;
+  // jit_enter (regs, entry): the units use rbx for the registers, and
+  //   keep the stack aligned for the stencils.
+  jit_enter = (irk_int (*) (object **, void *)) jit_p;
+  jit_byte (0x53);                                    // push rbx
+  jit_byte (0x48); jit_byte (0x89); jit_byte (0xfb);  // mov rbx, rdi
+  jit_byte (0xff); jit_byte (0xe6);                   // jmp rsi
+  jit_exit = jit_p;
+  jit_byte (0x5b);                                    // pop rbx
+  jit_byte (0xc3);                                    // ret
+  // this turns on JIT_POINT().
+  jit_entry = calloc (bytecode_len, sizeof (void *));
+}
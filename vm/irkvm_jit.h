@@ -0,0 +1,170 @@
+// generated by vm/genopcodes - do not edit
+// the JIT's stencils, included in vm/irkvm_jit.c.
+
+JIT_DEFINE (lit, LIT)
+JIT_DEFINE (litc, LITC)
+JIT_DEFINE (add, ADD)
+JIT_DEFINE (sub, SUB)
+JIT_DEFINE (mul, MUL)
+JIT_DEFINE (div, DIV)
+JIT_DEFINE (srem, SREM)
+JIT_DEFINE (shl, SHL)
+JIT_DEFINE (ashr, ASHR)
+JIT_DEFINE (or, OR)
+JIT_DEFINE (xor, XOR)
+JIT_DEFINE (and, AND)
+JIT_DEFINE (eq, EQ)
+JIT_DEFINE (lt, LT)
+JIT_DEFINE (gt, GT)
+JIT_DEFINE (le, LE)
+JIT_DEFINE (ge, GE)
+JIT_DEFINE (cmp, CMP)
+JIT_DEFINE (env, ENV)
+JIT_DEFINE (stor, STOR)
+JIT_DEFINE (ref, REF)
+JIT_DEFINE (mov, MOV)
+JIT_DEFINE (epush, EPUSH)
+JIT_DEFINE (ref0, REF0)
+JIT_DEFINE (pop, POP)
+JIT_DEFINE (topref, TOPREF)
+JIT_DEFINE (topset, TOPSET)
+JIT_DEFINE (set, SET)
+JIT_DEFINE (set0, SET0)
+JIT_DEFINE (pop0, POP0)
+JIT_DEFINE (epop, EPOP)
+JIT_DEFINE (gc, GC)
+JIT_DEFINE (imm, IMM)
+JIT_DEFINE (makei, MAKEI)
+JIT_DEFINE (tupref, TUPREF)
+JIT_DEFINE (vlen, VLEN)
+JIT_DEFINE (vref, VREF)
+JIT_DEFINE (vset, VSET)
+JIT_DEFINE (alloc, ALLOC)
+JIT_DEFINE (rref, RREF)
+JIT_DEFINE (rset, RSET)
+JIT_DEFINE (slen, SLEN)
+JIT_DEFINE (unchar, UNCHAR)
+JIT_DEFINE (tst, TST)
+JIT_DEFINE (jmp, JMP)
+JIT_DEFINE (fun, FUN)
+JIT_DEFINE (tail, TAIL)
+JIT_DEFINE (tail0, TAIL0)
+JIT_DEFINE (trcall, TRCALL)
+JIT_DEFINE (trcall0, TRCALL0)
+JIT_DEFINE (call, CALL)
+JIT_DEFINE (call0, CALL0)
+JIT_DEFINE (make, MAKE)
+JIT_DEFINE (nvcase, NVCASE)
+JIT_DEFINE (halloc, HALLOC)
+JIT_DEFINE (caref, CAREF)
+JIT_DEFINE (csref, CSREF)
+JIT_DEFINE (csize, CSIZE)
+
+static jit_stencil_t JIT_STENCIL(table)[IRK_NUM_BASE_OPCODES] = {
+  JIT_STENCIL(lit),
+  JIT_STENCIL(litc),
+  0,
+  JIT_STENCIL(add),
+  JIT_STENCIL(sub),
+  JIT_STENCIL(mul),
+  JIT_STENCIL(div),
+  JIT_STENCIL(srem),
+  JIT_STENCIL(shl),
+  JIT_STENCIL(ashr),
+  JIT_STENCIL(or),
+  JIT_STENCIL(xor),
+  JIT_STENCIL(and),
+  JIT_STENCIL(eq),
+  JIT_STENCIL(lt),
+  JIT_STENCIL(gt),
+  JIT_STENCIL(le),
+  JIT_STENCIL(ge),
+  JIT_STENCIL(cmp),
+  JIT_STENCIL(tst),
+  JIT_STENCIL(jmp),
+  JIT_STENCIL(fun),
+  JIT_STENCIL(tail),
+  JIT_STENCIL(tail0),
+  JIT_STENCIL(env),
+  JIT_STENCIL(stor),
+  JIT_STENCIL(ref),
+  JIT_STENCIL(mov),
+  JIT_STENCIL(epush),
+  JIT_STENCIL(trcall),
+  JIT_STENCIL(trcall0),
+  JIT_STENCIL(ref0),
+  JIT_STENCIL(call),
+  JIT_STENCIL(call0),
+  JIT_STENCIL(pop),
+  0,
+  0,
+  0,
+  JIT_STENCIL(topref),
+  JIT_STENCIL(topset),
+  JIT_STENCIL(set),
+  JIT_STENCIL(set0),
+  JIT_STENCIL(pop0),
+  JIT_STENCIL(epop),
+  0,
+  0,
+  JIT_STENCIL(gc),
+  JIT_STENCIL(imm),
+  JIT_STENCIL(make),
+  JIT_STENCIL(makei),
+  0,
+  JIT_STENCIL(nvcase),
+  JIT_STENCIL(tupref),
+  JIT_STENCIL(vlen),
+  JIT_STENCIL(vref),
+  JIT_STENCIL(vset),
+  0,
+  JIT_STENCIL(alloc),
+  JIT_STENCIL(rref),
+  JIT_STENCIL(rset),
+  0,
+  0,
+  0,
+  0,
+  0,
+  JIT_STENCIL(slen),
+  0,
+  0,
+  0,
+  JIT_STENCIL(unchar),
+  0,
+  0,
+  0,
+  0,
+  0,
+  0,
+  JIT_STENCIL(halloc),
+  0,
+  0,
+  0,
+  0,
+  0,
+  JIT_STENCIL(caref),
+  JIT_STENCIL(csref),
+  0,
+  0,
+  0,
+  JIT_STENCIL(csize),
+  0,
+  0,
+  0,
+  0,
+  0,
+  0,
+  0,
+  0,
+  0,
+  0,
+  0,
+  0,
+  0,
+  0,
+  0,
+  0,
+  0,
+  0,
+};
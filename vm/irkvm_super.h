@@ -0,0 +1,190 @@
+// generated by vm/genopcodes - do not edit
+// the superinstruction handlers, included in vm_go().
+
+ l_ref_tupref_stor:
+  DO_REF();
+  DO_TUPREF();
+  DO_STOR();
+  DISPATCH();
+
+ l_ref0_tupref_ref0:
+  DO_REF0();
+  DO_TUPREF();
+  DO_REF0();
+  DISPATCH();
+
+ l_gc_ref0_nvcase:
+  DO_GC();
+  DO_REF0();
+  DO_NVCASE();
+  DISPATCH();
+
+ l_tupref_stor_ref:
+  DO_TUPREF();
+  DO_STOR();
+  DO_REF();
+  DISPATCH();
+
+ l_stor_ref_tupref:
+  DO_STOR();
+  DO_REF();
+  DO_TUPREF();
+  DISPATCH();
+
+ l_tupref_ref0_tupref:
+  DO_TUPREF();
+  DO_REF0();
+  DO_TUPREF();
+  DISPATCH();
+
+ l_stor_ref0:
+  DO_STOR();
+  DO_REF0();
+  DISPATCH();
+
+ l_env_epush_ref:
+  DO_ENV();
+  DO_EPUSH();
+  DO_REF();
+  DISPATCH();
+
+ l_env_ref_stor:
+  DO_ENV();
+  DO_REF();
+  DO_STOR();
+  DISPATCH();
+
+ l_epush_ref_tupref:
+  DO_EPUSH();
+  DO_REF();
+  DO_TUPREF();
+  DISPATCH();
+
+ l_pop_stor_ref0:
+  DO_POP();
+  DO_STOR();
+  DO_REF0();
+  DISPATCH();
+
+ l_ref0_tupref_mov:
+  DO_REF0();
+  DO_TUPREF();
+  DO_MOV();
+  DISPATCH();
+
+ l_stor_topref_call:
+  DO_STOR();
+  DO_TOPREF();
+  DO_CALL();
+  DISPATCH();
+
+ l_stor_ref_call:
+  DO_STOR();
+  DO_REF();
+  DO_CALL();
+  DISPATCH();
+
+ l_ref0_stor_ref:
+  DO_REF0();
+  DO_STOR();
+  DO_REF();
+  DISPATCH();
+
+ l_stor_ref0_nvcase:
+  DO_STOR();
+  DO_REF0();
+  DO_NVCASE();
+  DISPATCH();
+
+ l_ref_stor_ref0:
+  DO_REF();
+  DO_STOR();
+  DO_REF0();
+  DISPATCH();
+
+ l_tupref_stor_env:
+  DO_TUPREF();
+  DO_STOR();
+  DO_ENV();
+  DISPATCH();
+
+ l_stor_ref0_stor:
+  DO_STOR();
+  DO_REF0();
+  DO_STOR();
+  DISPATCH();
+
+ l_stor_env_ref:
+  DO_STOR();
+  DO_ENV();
+  DO_REF();
+  DISPATCH();
+
+ l_env_ref0_stor:
+  DO_ENV();
+  DO_REF0();
+  DO_STOR();
+  DISPATCH();
+
+ l_ref0_ref0:
+  DO_REF0();
+  DO_REF0();
+  DISPATCH();
+
+ l_gc_env_epush:
+  DO_GC();
+  DO_ENV();
+  DO_EPUSH();
+  DISPATCH();
+
+ l_mov_ref0:
+  DO_MOV();
+  DO_REF0();
+  DISPATCH();
+
+ l_stor_topref_tail:
+  DO_STOR();
+  DO_TOPREF();
+  DO_TAIL();
+  DISPATCH();
+
+ l_eq_tst:
+  DO_EQ();
+  DO_TST();
+  DISPATCH();
+
+ l_stor_env_ref0:
+  DO_STOR();
+  DO_ENV();
+  DO_REF0();
+  DISPATCH();
+
+ l_mov_tupref_mov:
+  DO_MOV();
+  DO_TUPREF();
+  DO_MOV();
+  DISPATCH();
+
+ l_env_epush_env:
+  DO_ENV();
+  DO_EPUSH();
+  DO_ENV();
+  DISPATCH();
+
+ l_ref0_eq_tst:
+  DO_REF0();
+  DO_EQ();
+  DO_TST();
+  DISPATCH();
+
+ l_ref0_stor_topref:
+  DO_REF0();
+  DO_STOR();
+  DO_TOPREF();
+  DISPATCH();
+
+ l_ref_stor_topref:
+  DO_REF();
+  DO_STOR();
+  DO_TOPREF();
+  DISPATCH();
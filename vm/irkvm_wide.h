@@ -0,0 +1,250 @@
+// generated by vm/genopcodes - do not edit
+// the handlers for wide insns, included in vm_go().
+
+ lw_lit:
+  DO_LIT();
+  DISPATCH();
+
+ lw_litc:
+  DO_LITC();
+  DISPATCH();
+
+ lw_ret:
+  DO_RET();
+  DISPATCH();
+
+ lw_add:
+  DO_ADD();
+  DISPATCH();
+
+ lw_sub:
+  DO_SUB();
+  DISPATCH();
+
+ lw_mul:
+  DO_MUL();
+  DISPATCH();
+
+ lw_div:
+  DO_DIV();
+  DISPATCH();
+
+ lw_srem:
+  DO_SREM();
+  DISPATCH();
+
+ lw_shl:
+  DO_SHL();
+  DISPATCH();
+
+ lw_ashr:
+  DO_ASHR();
+  DISPATCH();
+
+ lw_or:
+  DO_OR();
+  DISPATCH();
+
+ lw_xor:
+  DO_XOR();
+  DISPATCH();
+
+ lw_and:
+  DO_AND();
+  DISPATCH();
+
+ lw_eq:
+  DO_EQ();
+  DISPATCH();
+
+ lw_lt:
+  DO_LT();
+  DISPATCH();
+
+ lw_gt:
+  DO_GT();
+  DISPATCH();
+
+ lw_le:
+  DO_LE();
+  DISPATCH();
+
+ lw_ge:
+  DO_GE();
+  DISPATCH();
+
+ lw_cmp:
+  DO_CMP();
+  DISPATCH();
+
+ lw_tst:
+  DO_TST();
+  DISPATCH();
+
+ lw_jmp:
+  DO_JMP();
+  DISPATCH();
+
+ lw_fun:
+  DO_FUN();
+  DISPATCH();
+
+ lw_tail:
+  DO_TAIL();
+  DISPATCH();
+
+ lw_tail0:
+  DO_TAIL0();
+  DISPATCH();
+
+ lw_env:
+  DO_ENV();
+  DISPATCH();
+
+ lw_stor:
+  DO_STOR();
+  DISPATCH();
+
+ lw_ref:
+  DO_REF();
+  DISPATCH();
+
+ lw_mov:
+  DO_MOV();
+  DISPATCH();
+
+ lw_epush:
+  DO_EPUSH();
+  DISPATCH();
+
+ lw_trcall:
+  DO_TRCALL();
+  DISPATCH();
+
+ lw_trcall0:
+  DO_TRCALL0();
+  DISPATCH();
+
+ lw_ref0:
+  DO_REF0();
+  DISPATCH();
+
+ lw_call:
+  DO_CALL();
+  DISPATCH();
+
+ lw_call0:
+  DO_CALL0();
+  DISPATCH();
+
+ lw_pop:
+  DO_POP();
+  DISPATCH();
+
+ lw_topref:
+  DO_TOPREF();
+  DISPATCH();
+
+ lw_topset:
+  DO_TOPSET();
+  DISPATCH();
+
+ lw_set:
+  DO_SET();
+  DISPATCH();
+
+ lw_set0:
+  DO_SET0();
+  DISPATCH();
+
+ lw_pop0:
+  DO_POP0();
+  DISPATCH();
+
+ lw_epop:
+  DO_EPOP();
+  DISPATCH();
+
+ lw_gc:
+  DO_GC();
+  DISPATCH();
+
+ lw_imm:
+  DO_IMM();
+  DISPATCH();
+
+ lw_make:
+  DO_MAKE();
+  DISPATCH();
+
+ lw_makei:
+  DO_MAKEI();
+  DISPATCH();
+
+ lw_nvcase:
+  DO_NVCASE();
+  DISPATCH();
+
+ lw_tupref:
+  DO_TUPREF();
+  DISPATCH();
+
+ lw_vlen:
+  DO_VLEN();
+  DISPATCH();
+
+ lw_vref:
+  DO_VREF();
+  DISPATCH();
+
+ lw_vset:
+  DO_VSET();
+  DISPATCH();
+
+ lw_alloc:
+  DO_ALLOC();
+  DISPATCH();
+
+ lw_rref:
+  DO_RREF();
+  DISPATCH();
+
+ lw_rset:
+  DO_RSET();
+  DISPATCH();
+
+ lw_slen:
+  DO_SLEN();
+  DISPATCH();
+
+ lw_unchar:
+  DO_UNCHAR();
+  DISPATCH();
+
+ lw_malloc:
+  DO_MALLOC();
+  DISPATCH();
+
+ lw_halloc:
+  DO_HALLOC();
+  DISPATCH();
+
+ lw_cget:
+  DO_CGET();
+  DISPATCH();
+
+ lw_cset:
+  DO_CSET();
+  DISPATCH();
+
+ lw_caref:
+  DO_CAREF();
+  DISPATCH();
+
+ lw_csref:
+  DO_CSREF();
+  DISPATCH();
+
+ lw_csize:
+  DO_CSIZE();
+  DISPATCH();
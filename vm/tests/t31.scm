@@ -13,7 +13,7 @@
 (printn (string->symbol "f"))
 (let ((lx '(a b c d e)))
   (printn (string->symbol "f"))
-  (printn the-symbol-table)
-  (for-map k v the-symbol-table
+  (printn (hashtable/count the-symbol-table))
+  (for-hashtable k v the-symbol-table
     (printf "k= " (string k) " v=" (sym v) " index=" (int (symbol->index v)) "\n")
     ))